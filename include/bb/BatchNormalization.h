@@ -295,6 +295,19 @@ public:
         if ( !m_fix_beta  ) { gradients.PushBack(m_dbeta);  }
         return gradients;
     }
+
+    /**
+     * @brief  統計量取得
+     * @detail 移動平均と移動分散を取得する
+     * @return 統計量を返す
+     */
+    Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_running_mean);
+        statistics.PushBack(m_running_var);
+        return statistics;
+    }
     
 
     // ノード単位でのForward計算
@@ -667,6 +680,26 @@ public:
      * @return backward演算結果
      */
     FrameBuffer Backward(FrameBuffer dy_buf)
+    {
+        // 入力勾配もパラメータ勾配も不要なら何もしない
+        if ( !m_input_gradient && m_frozen ) {
+            m_x_buf = FrameBuffer();
+            return FrameBuffer();
+        }
+
+        auto dx_buf = BackwardNorm(dy_buf);
+
+        // 固定時は計算された勾配を捨てる
+        if ( m_frozen ) {
+            m_dgamma->FillZero();
+            m_dbeta->FillZero();
+        }
+
+        return dx_buf;
+    }
+
+protected:
+    FrameBuffer BackwardNorm(FrameBuffer dy_buf)
     {
         if (m_bypass) {
             return dy_buf;
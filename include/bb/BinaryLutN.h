@@ -138,6 +138,14 @@ public:
         auto ptr = lock_InputIndex_const();
         return (index_t)ptr(node, input_index);
     }
+
+    bool PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        BB_ASSERT((index_t)order.size() == GetShapeSize(m_output_shape));
+        Tensor_PermuteOuter(m_input_index, order);
+        Tensor_PermuteOuter(m_table,       order);
+        return true;
+    }
     
     // LUT操作の定義
     int GetLutTableSize(index_t node) const
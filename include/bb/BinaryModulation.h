@@ -11,6 +11,10 @@
 #pragma once
 
 
+#include <vector>
+#include <limits>
+#include <cmath>
+
 #include "bb/Model.h"
 #include "bb/RealToBinary.h"
 #include "bb/BinaryToReal.h"
@@ -201,6 +205,20 @@ public:
         return gradients;
     }  
 
+    /**
+     * @brief  統計量取得
+     * @detail 内部のレイヤーの統計量をまとめて取得する
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_real2bin->GetStatistics());
+        statistics.PushBack(m_layer->GetStatistics());
+        statistics.PushBack(m_bin2real->GetStatistics());
+        return statistics;
+    }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -215,9 +233,40 @@ public:
         shape = m_layer->SetInputShape(shape);
         shape = m_bin2real->SetInputShape(shape);
 
+        this->SetChainInputGradient({m_real2bin, m_layer, m_bin2real}, this->m_input_gradient);
         return shape;
     }
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail 手前に学習対象が無い内部レイヤーは入力勾配を不要とする
+     * @param  enable 入力勾配が必要か
+     */
+    void SetInputGradient(bool enable)
+    {
+        this->m_input_gradient = enable;
+        this->SetChainInputGradient({m_real2bin, m_layer, m_bin2real}, enable);
+    }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail 内部のレイヤーをまとめて固定する
+     * @param  frozen 固定するなら true
+     */
+    void SetFrozen(bool frozen)
+    {
+        this->m_frozen = frozen;
+        m_real2bin->SetFrozen(frozen);
+        m_layer   ->SetFrozen(frozen);
+        m_bin2real->SetFrozen(frozen);
+        SetInputGradient(this->m_input_gradient);
+    }
+
+    bool IsTrainable(void)
+    {
+        return m_real2bin->IsTrainable() || m_layer->IsTrainable() || m_bin2real->IsTrainable();
+    }
+
 
     /**
      * @brief  入力形状取得
@@ -278,6 +327,122 @@ public:
         return x_buf;
     }
 
+    /**
+     * @brief  打ち切り付き推論 (anytime inference)
+     * @detail 推論用の変調フレームを chunk_size 個程度ずつ評価してスコアを積算し、
+     *         1位と2位の平均スコアの差が confidence / sqrt(評価済み変調数) 以上になったサンプルは
+     *         以降の評価を打ち切る (スコアは [0,1] の平均なので Hoeffding の不等式の形の境界)
+     *         固定閾値の場合は各回が入力範囲全体を均等に覆うよう閾値を飛び飛びに割り当てるので、
+     *         最後まで評価したサンプルは Forward と同じ結果になる
+     * @param  x_buf      入力データ
+     * @param  chunk_size 1回に評価する変調フレーム数
+     * @param  confidence 打ち切り境界の係数 (大きいほど精度寄り、0 なら1回目で打ち切り)
+     * @param  used_size  サンプル毎に評価した変調フレーム数を返す (不要なら nullptr)
+     * @return 推論結果
+     */
+    FrameBuffer ForwardAnytime(FrameBuffer x_buf, index_t chunk_size, RealType confidence, std::vector<index_t> *used_size = nullptr)
+    {
+        index_t modulation_size = m_inference_create.modulation_size;
+        index_t frame_size      = x_buf.GetFrameSize();
+        index_t node_size       = GetOutputNodeSize();
+
+        // 分割できない場合は通常の推論
+        if ( !m_binary_mode || chunk_size <= 0 || chunk_size >= modulation_size ) {
+            if ( used_size != nullptr ) {
+                used_size->assign(frame_size, m_binary_mode ? modulation_size : 1);
+            }
+            return Forward(x_buf, false);
+        }
+
+        BB_ASSERT(x_buf.GetType() == DataType<RealType>::type);
+
+        // 推論モードへ
+        if ( m_training ) {
+            m_training = false;
+            m_modulation_size = modulation_size;
+            m_real2bin->SetValueGenerator(m_inference_create.value_generator);
+        }
+
+        index_t chunk_count = (modulation_size + chunk_size - 1) / chunk_size;
+        index_t input_node_size = x_buf.GetNodeSize();
+
+        std::vector<RealType> sum(frame_size * node_size, (RealType)0);
+        std::vector<index_t>  count(frame_size, 0);
+        std::vector<index_t>  active(frame_size);
+        for ( index_t frame = 0; frame < frame_size; ++frame ) {
+            active[frame] = frame;
+        }
+
+        for ( index_t chunk = 0; chunk < chunk_count && !active.empty(); ++chunk ) {
+            // chunk 回目は閾値番号 chunk, chunk + chunk_count, ... を受け持つ
+            index_t size = (modulation_size - chunk + chunk_count - 1) / chunk_count;
+            m_real2bin->SetModulationSize(size);
+            m_real2bin->SetModulationPhase(modulation_size, chunk, chunk_count);
+            m_bin2real->SetModulationSize(size);
+
+            // 打ち切られていないサンプルだけ集める
+            FrameBuffer xa_buf = x_buf;
+            if ( (index_t)active.size() < frame_size ) {
+                xa_buf = FrameBuffer((index_t)active.size(), x_buf.GetShape(), x_buf.GetType());
+                auto x_ptr  = x_buf.LockConst<RealType>();
+                auto xa_ptr = xa_buf.Lock<RealType>(true);
+                for ( index_t node = 0; node < input_node_size; ++node ) {
+                    for ( index_t i = 0; i < (index_t)active.size(); ++i ) {
+                        xa_ptr.Set(i, node, x_ptr.Get(active[i], node));
+                    }
+                }
+            }
+
+            FrameBuffer ya_buf = m_real2bin->Forward(xa_buf, false);
+            ya_buf = m_layer   ->Forward(ya_buf, false);
+            ya_buf = m_bin2real->Forward(ya_buf, false);
+
+            // 積算して打ち切り判定
+            std::vector<index_t> next;
+            auto ya_ptr = ya_buf.LockConst<RealType>();
+            for ( index_t i = 0; i < (index_t)active.size(); ++i ) {
+                index_t frame = active[i];
+                count[frame] += size;
+
+                RealType top1 = std::numeric_limits<RealType>::lowest();
+                RealType top2 = std::numeric_limits<RealType>::lowest();
+                for ( index_t node = 0; node < node_size; ++node ) {
+                    RealType &s = sum[frame * node_size + node];
+                    s += ya_ptr.Get(i, node) * (RealType)size;
+                    RealType mean = s / (RealType)count[frame];
+                    if ( mean > top1 ) { top2 = top1; top1 = mean; }
+                    else if ( mean > top2 ) { top2 = mean; }
+                }
+
+                if ( node_size < 2 || (top1 - top2) < confidence / std::sqrt((RealType)count[frame]) ) {
+                    next.push_back(frame);
+                }
+            }
+            active.swap(next);
+        }
+
+        // 通常の推論設定に戻す
+        m_real2bin->SetModulationPhase(0);
+        m_real2bin->SetModulationSize(modulation_size);
+        m_bin2real->SetModulationSize(modulation_size);
+
+        FrameBuffer y_buf(frame_size, GetOutputShape(), DataType<RealType>::type);
+        {
+            auto y_ptr = y_buf.Lock<RealType>(true);
+            for ( index_t frame = 0; frame < frame_size; ++frame ) {
+                for ( index_t node = 0; node < node_size; ++node ) {
+                    y_ptr.Set(frame, node, sum[frame * node_size + node] / (RealType)count[frame]);
+                }
+            }
+        }
+
+        if ( used_size != nullptr ) {
+            *used_size = count;
+        }
+
+        return y_buf;
+    }
+
    /**
      * @brief  backward演算
      * @detail backward演算を行う
@@ -290,10 +455,7 @@ public:
             return dy_buf = m_layer->Backward(dy_buf);
         }
 
-        dy_buf = m_bin2real->Backward(dy_buf);
-        dy_buf = m_layer   ->Backward(dy_buf);
-        dy_buf = m_real2bin->Backward(dy_buf);
-        return dy_buf; 
+        return this->BackwardChain({m_real2bin, m_layer, m_bin2real}, dy_buf);
     }
     
 protected:
@@ -13,6 +13,7 @@
 #include <random>
 
 #include "bb/Model.h"
+#include "bb/BitPlane.h"
 
 
 namespace bb {
@@ -36,6 +37,7 @@ protected:
     bool                m_host_only   = false;
 
     index_t             m_modulation_size;
+    index_t             m_bit_plane_size = 0;   // 0 以外で入力をビットプレーンとして桁の重みで積算 (BitPlane.h)
 
     indices_t           m_input_shape;
     indices_t           m_output_shape;
@@ -45,6 +47,7 @@ public:
     {
         indices_t       output_shape;   
         index_t         modulation_size = 1;
+        index_t         bit_plane_size  = 0;    //< 0 以外で入力を k ビットのビットプレーンとして扱う
     };
 
 protected:
@@ -52,6 +55,7 @@ protected:
     {
         m_output_shape    = create.output_shape;
         m_modulation_size = create.modulation_size;
+        m_bit_plane_size  = create.bit_plane_size;
     }
 
     /**
@@ -98,6 +102,19 @@ public:
         m_modulation_size = modulation_size;
     }
 
+    /**
+     * @brief  ビットプレーン入力設定
+     * @detail 0 以外を設定すると、入力を k 枚のビットプレーン (RealToBinary の bit_plane_size 出力) とみなし、
+     *         各プレーンを 2^plane の重みで積算して [0, 1] の値に戻す
+     * @param  bit_plane_size ビット数 k (0 で通常の積算に戻す)
+     */
+    void SetBitPlaneSize(index_t bit_plane_size)
+    {
+        m_bit_plane_size = bit_plane_size;
+    }
+
+    index_t GetBitPlaneSize(void) const { return m_bit_plane_size; }
+
     /**
      * @brief  入力のshape設定
      * @detail 入力のshape設定
@@ -110,12 +127,16 @@ public:
         m_input_shape = shape;
 
         if (m_output_shape.empty()) {
-            m_output_shape = m_input_shape;
+            m_output_shape = (m_bit_plane_size > 0) ? BitPlane_GetValueShape(m_input_shape, m_bit_plane_size) : m_input_shape;
+        }
+        if ( m_bit_plane_size > 0 ) {
+            BB_ASSERT(GetShapeSize(m_input_shape) == GetShapeSize(m_output_shape) * m_bit_plane_size);
         }
 
-        // 整数倍の多重化のみ許容
-        BB_ASSERT(GetShapeSize(m_input_shape) >= GetShapeSize(m_output_shape));
-        BB_ASSERT(GetShapeSize(m_input_shape) % GetShapeSize(m_output_shape) == 0);
+        // 整数倍の多重化のみ許容 (出力の方が多い場合、対応する入力の無い出力は 0 になる)
+        if ( GetShapeSize(m_input_shape) >= GetShapeSize(m_output_shape) ) {
+            BB_ASSERT(GetShapeSize(m_input_shape) % GetShapeSize(m_output_shape) == 0);
+        }
 
         return m_output_shape;
     }
@@ -159,7 +180,8 @@ public:
         FrameBuffer y_buf(x_buf.GetFrameSize() / m_modulation_size, m_output_shape, DataType<RealType>::type);
 
 #ifdef BB_WITH_CUDA
-        if ( DataType<BinType>::type == BB_TYPE_FP32 && DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only
+        if ( DataType<BinType>::type == BB_TYPE_FP32 && DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only && m_bit_plane_size == 0
+            && GetInputNodeSize() >= GetOutputNodeSize()
             && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
             auto x_ptr = x_buf.LockDeviceMemoryConst();
             auto y_ptr = y_buf.LockDeviceMemory(true);
@@ -179,7 +201,7 @@ public:
             return y_buf;
         }
 
-        if ( DataType<BinType>::type == BB_TYPE_BIT && DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only
+        if ( DataType<BinType>::type == BB_TYPE_BIT && DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only && m_bit_plane_size == 0
             && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
             auto x_ptr = x_buf.LockDeviceMemoryConst();
             auto y_ptr = y_buf.LockDeviceMemory(true);
@@ -200,6 +222,45 @@ public:
         }
 #endif
 
+        if ( DataType<BinType>::type == BB_TYPE_BIT ) {
+            // Bit 入力は変調グループ毎にパックされたままポピュレーションカウントで積算
+            auto x_ptr = x_buf.LockMemoryConst();
+            auto y_ptr = y_buf.LockMemory(true);
+            auto x_addr = (std::uint8_t const *)x_ptr.GetAddr();
+            auto y_addr = (std::uint8_t       *)y_ptr.GetAddr();
+
+            index_t input_node_size   = GetInputNodeSize();
+            index_t output_node_size  = GetOutputNodeSize();
+            index_t output_frame_size = y_buf.GetFrameSize();
+            index_t x_frame_stride    = x_buf.GetFrameStride();
+            index_t y_frame_stride    = y_buf.GetFrameStride();
+            index_t modulation_size   = m_modulation_size;
+            bool    bit_plane         = (m_bit_plane_size > 0);
+
+            #pragma omp parallel for
+            for (index_t node = 0; node < output_node_size; ++node) {
+                std::vector<std::int64_t> count(output_frame_size, 0);
+                index_t n = 0;
+                index_t g = 0;
+                for (index_t input_node = node; input_node < input_node_size; input_node += output_node_size, ++g) {
+                    std::int64_t weight = bit_plane ? ((std::int64_t)1 << g) : 1;   // ビットプレーンは桁の重み
+                    auto x_vec = (std::uint64_t const *)(x_addr + input_node * x_frame_stride);
+                    for (index_t frame = 0; frame < output_frame_size; ++frame) {
+                        count[frame] += weight * bb_popcnt_bits(x_vec, frame * modulation_size, modulation_size);
+                    }
+                    n += weight * modulation_size;
+                }
+
+                // 出力ノードが入力ノードより多いと対応する入力が無いので 0 とする
+                auto y_vec = (RealType *)(y_addr + node * y_frame_stride);
+                for (index_t frame = 0; frame < output_frame_size; ++frame) {
+                    y_vec[frame] = (n > 0) ? (RealType)count[frame] / (RealType)n : (RealType)0;
+                }
+            }
+
+            return y_buf;
+        }
+
         {
             auto x_ptr = x_buf.LockConst<BinType>();
             auto y_ptr = y_buf.Lock<RealType>(true);
@@ -208,23 +269,20 @@ public:
             index_t output_node_size  = GetOutputNodeSize();
             index_t output_frame_size = y_buf.GetFrameSize();
 
-            index_t node_size = std::max(input_node_size, output_node_size);
-
-            std::vector<RealType>   vec_v(output_node_size, (RealType)0);
-            std::vector<int>        vec_n(output_node_size, 0);
-            for (index_t frame = 0; frame < output_frame_size; ++frame) {
-                std::fill(vec_v.begin(), vec_v.end(), (RealType)0);
-                std::fill(vec_n.begin(), vec_n.end(), 0);
-                for (index_t node = 0; node < node_size; ++node) {
-                    for (index_t i = 0; i < m_modulation_size; ++i) {
-                        RealType bin_sig = (RealType)x_ptr.Get(frame*m_modulation_size + i, node);
-                        vec_v[node % output_node_size] += bin_sig;
-                        vec_n[node % output_node_size] += 1;
+            #pragma omp parallel for
+            for (index_t node = 0; node < output_node_size; ++node) {
+                for (index_t frame = 0; frame < output_frame_size; ++frame) {
+                    RealType    v = 0;
+                    int         n = 0;
+                    int         g = 0;
+                    for (index_t input_node = node; input_node < input_node_size; input_node += output_node_size, ++g) {
+                        int weight = (m_bit_plane_size > 0) ? (1 << g) : 1;
+                        for (index_t i = 0; i < m_modulation_size; ++i) {
+                            v += (RealType)x_ptr.Get(frame*m_modulation_size + i, input_node) * (RealType)weight;
+                            n += weight;
+                        }
                     }
-                }
-
-                for (index_t node = 0; node < output_node_size; ++node) {
-                    y_ptr.Set(frame, node, vec_v[node] / (RealType)vec_n[node]);
+                    y_ptr.Set(frame, node, (n > 0) ? v / (RealType)n : (RealType)0);
                 }
             }
 
@@ -235,7 +293,7 @@ public:
 
     FrameBuffer Backward(FrameBuffer dy_buf)
     {
-        if ( !m_binary_mode || (m_modulation_size == 1 && m_input_shape == m_output_shape) ) {
+        if ( !m_binary_mode || (m_modulation_size == 1 && m_input_shape == m_output_shape && m_bit_plane_size == 0) ) {
             return dy_buf;
         }
         
@@ -245,7 +303,8 @@ public:
         FrameBuffer dx_buf(dy_buf.GetFrameSize() * m_modulation_size, m_input_shape, DataType<RealType>::type);
 
 #ifdef BB_WITH_CUDA
-        if ( DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only 
+        if ( DataType<RealType>::type == BB_TYPE_FP32 && !m_host_only && m_bit_plane_size == 0
+                && GetInputNodeSize() >= GetOutputNodeSize()
                 && dy_buf.IsDeviceAvailable() && dx_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
 
             auto dy_ptr = dy_buf.LockDeviceMemoryConst();
@@ -275,12 +334,19 @@ public:
             auto dy_ptr = dy_buf.LockConst<RealType>();
             auto dx_ptr = dx_buf.Lock<RealType>();
 
-            RealType  gain = (RealType)output_node_size / ((RealType)input_node_size * (RealType)m_modulation_size);
+            index_t   node_mux_size = std::max(input_node_size / output_node_size, (index_t)1);
+            RealType  gain = (RealType)1 / ((RealType)node_mux_size * (RealType)m_modulation_size);
             for (index_t node = 0; node < input_node_size; node++) {
+                RealType node_gain = gain;
+                if ( m_bit_plane_size > 0 ) {
+                    // ビットプレーンは桁の重みに比例
+                    index_t g = node / output_node_size;
+                    node_gain = (RealType)(1 << g) / ((RealType)((1 << m_bit_plane_size) - 1) * (RealType)m_modulation_size);
+                }
                 for (index_t frame = 0; frame < output_frame_size; ++frame) {
                     for (index_t i = 0; i < m_modulation_size; i++) {
                         auto grad = dy_ptr.Get(frame, node % output_node_size);
-                        grad *= gain;
+                        grad *= node_gain;
                         dx_ptr.Set(frame*m_modulation_size + i, node, grad);
                     }
                 }
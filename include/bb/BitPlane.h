@@ -0,0 +1,145 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#include "bb/DataType.h"
+#include "bb/FrameBuffer.h"
+
+
+namespace bb {
+
+
+// 多ビット活性化のビットプレーン表現
+//   k ビットの値 N 個を、k 枚のビットプレーンを並べた Bit 型の N*k ノードとして持つ
+//   ノードの並びはプレーンが最上位の軸 (node = plane * N + n、plane 0 が LSB) で、
+//   形状は最上位の次元を k 倍したもの (画像 {w, h, c} なら {w, h, k*c}) とする
+//   各プレーンは通常の Bit ノードなので、LUT 層の入力はプレーン単位で任意に接続でき
+//   ビットスライスの SIMD 処理 (LutNetFused, LutCnnStreamer など) もそのまま使える
+
+
+// 値の形状からビットプレーンの形状へ
+inline indices_t BitPlane_GetShape(indices_t shape, index_t bit_plane_size)
+{
+    BB_ASSERT(!shape.empty() && bit_plane_size > 0);
+    shape.back() *= bit_plane_size;
+    return shape;
+}
+
+// ビットプレーンの形状から値の形状へ
+inline indices_t BitPlane_GetValueShape(indices_t shape, index_t bit_plane_size)
+{
+    BB_ASSERT(!shape.empty() && bit_plane_size > 0);
+    BB_ASSERT(shape.back() % bit_plane_size == 0);
+    shape.back() /= bit_plane_size;
+    return shape;
+}
+
+
+/**
+ * @brief  実数をビットプレーンに量子化
+ * @detail [lo, hi] を 2^k - 1 段階に丸めて各ビットをプレーンに書き込む
+ * @param  x_buf          入力 (RealType)
+ * @param  bit_plane_size ビット数 k
+ * @param  lo             入力の下限
+ * @param  hi             入力の上限
+ * @return ビットプレーン (Bit型)
+ */
+template <typename RealType = float>
+FrameBuffer BitPlane_Encode(FrameBuffer const &x_buf, index_t bit_plane_size, RealType lo, RealType hi)
+{
+    BB_ASSERT(x_buf.GetType() == DataType<RealType>::type);
+    BB_ASSERT(bit_plane_size > 0 && bit_plane_size <= 16);
+
+    index_t frame_size = x_buf.GetFrameSize();
+    index_t node_size  = x_buf.GetNodeSize();
+    FrameBuffer y_buf(frame_size, BitPlane_GetShape(x_buf.GetShape(), bit_plane_size), BB_TYPE_BIT);
+
+    auto x_ptr = x_buf.LockConst<RealType>();
+    auto y_ptr = y_buf.LockMemory(true);
+    auto y_addr   = (std::uint8_t *)y_ptr.GetAddr();
+    auto y_stride = y_buf.GetFrameStride();
+
+    int      level_max = (1 << bit_plane_size) - 1;
+    RealType scale     = (RealType)level_max / (hi - lo);
+    index_t  word_size = (frame_size + 63) / 64;
+
+    #pragma omp parallel for
+    for ( index_t node = 0; node < node_size; ++node ) {
+        RealType const *x_addr = x_ptr.GetAddr(node);
+        for ( index_t word = 0; word < word_size; ++word ) {
+            std::uint64_t planes[16] = {0};
+            index_t frame_end = std::min(frame_size, (word + 1) * 64);
+            for ( index_t frame = word * 64; frame < frame_end; ++frame ) {
+                RealType v = (x_addr[frame] - lo) * scale;
+                int      q = (int)std::floor(v + (RealType)0.5);
+                q = std::max(0, std::min(level_max, q));
+                for ( index_t p = 0; p < bit_plane_size; ++p ) {
+                    planes[p] |= ((std::uint64_t)((q >> p) & 1) << (frame % 64));
+                }
+            }
+            for ( index_t p = 0; p < bit_plane_size; ++p ) {
+                auto y_vec = (std::uint64_t *)(y_addr + y_stride * (p * node_size + node));
+                y_vec[word] = planes[p];
+            }
+        }
+    }
+
+    return y_buf;
+}
+
+
+/**
+ * @brief  ビットプレーンを実数に戻す
+ * @param  x_buf          ビットプレーン (Bit型)
+ * @param  bit_plane_size ビット数 k
+ * @param  lo             出力の下限
+ * @param  hi             出力の上限
+ * @return 実数 (RealType)
+ */
+template <typename RealType = float>
+FrameBuffer BitPlane_Decode(FrameBuffer const &x_buf, index_t bit_plane_size, RealType lo, RealType hi)
+{
+    BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+    BB_ASSERT(bit_plane_size > 0 && bit_plane_size <= 16);
+
+    index_t frame_size = x_buf.GetFrameSize();
+    FrameBuffer y_buf(frame_size, BitPlane_GetValueShape(x_buf.GetShape(), bit_plane_size), DataType<RealType>::type);
+    index_t node_size  = y_buf.GetNodeSize();
+
+    auto x_ptr = x_buf.LockMemoryConst();
+    auto y_ptr = y_buf.Lock<RealType>(true);
+    auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+    auto x_stride = x_buf.GetFrameStride();
+
+    RealType step = (hi - lo) / (RealType)((1 << bit_plane_size) - 1);
+
+    #pragma omp parallel for
+    for ( index_t node = 0; node < node_size; ++node ) {
+        RealType *y_addr = y_ptr.GetAddr(node);
+        for ( index_t frame = 0; frame < frame_size; ++frame ) {
+            int q = 0;
+            for ( index_t p = 0; p < bit_plane_size; ++p ) {
+                auto x_vec = (std::uint64_t const *)(x_addr + x_stride * (p * node_size + node));
+                q |= (int)((x_vec[frame / 64] >> (frame % 64)) & 1) << p;
+            }
+            y_addr[frame] = lo + step * (RealType)q;
+        }
+    }
+
+    return y_buf;
+}
+
+
+}
+
+// end of file
@@ -0,0 +1,184 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "bb/DataType.h"
+#include "bb/SimdSupport.h"
+
+
+namespace bb {
+
+
+// Bit 型 FrameBuffer (node 毎にフレーム方向へビットを詰めた配置) と
+// フレーム毎に node が並んだ配列 (numpy の C 配列の並び) との相互変換
+//   64フレーム x 64ノードのタイル単位で、フレーム毎にノード方向へビットを詰めてから
+//   64x64 のビット行列転置で node 毎のワードに並べ替える
+
+
+// 64x64 ビット行列の転置 (m[i] の bit j と m[j] の bit i を入れ替える)
+inline void BitTranspose64x64(std::uint64_t m[64])
+{
+    std::uint64_t mask = 0x00000000ffffffffULL;
+    for ( int j = 32; j != 0; j >>= 1, mask ^= (mask << j) ) {
+        for ( int k = 0; k < 64; k = ((k | j) + 1) & ~j ) {
+            std::uint64_t t = ((m[k] >> j) ^ m[k | j]) & mask;
+            m[k]     ^= (t << j);
+            m[k | j] ^= t;
+        }
+    }
+}
+
+
+// p[0..size) の各値が正かどうかをビットに詰める (size <= 64)
+template <typename Tp>
+inline std::uint64_t BitPack64(Tp const *p, int size)
+{
+    std::uint64_t bits = 0;
+    for ( int i = 0; i < size; ++i ) {
+        if ( (bool)Bit(p[i]) ) {
+            bits |= ((std::uint64_t)1 << i);
+        }
+    }
+    return bits;
+}
+
+#ifdef __AVX2__
+template <>
+inline std::uint64_t BitPack64<float>(float const *p, int size)
+{
+    std::uint64_t bits = 0;
+    int i = 0;
+    __m256 zero = _mm256_setzero_ps();
+    for ( ; i + 8 <= size; i += 8 ) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        bits |= ((std::uint64_t)(std::uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(v, zero, _CMP_GT_OQ)) << i);
+    }
+    for ( ; i < size; ++i ) {
+        if ( p[i] > 0.0f ) {
+            bits |= ((std::uint64_t)1 << i);
+        }
+    }
+    return bits;
+}
+
+template <>
+inline std::uint64_t BitPack64<std::uint8_t>(std::uint8_t const *p, int size)
+{
+    std::uint64_t bits = 0;
+    int i = 0;
+    __m256i zero = _mm256_setzero_si256();
+    for ( ; i + 32 <= size; i += 32 ) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)(p + i));
+        std::uint32_t z = (std::uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+        bits |= ((std::uint64_t)(~z) << i);
+    }
+    for ( ; i < size; ++i ) {
+        if ( p[i] != 0 ) {
+            bits |= ((std::uint64_t)1 << i);
+        }
+    }
+    return bits;
+}
+#endif
+
+
+/**
+ * @brief  フレーム毎の配列から Bit 型の配置へ変換
+ * @param  row         row(frame) で frame の先頭 (node_size 個の値) を返す関数
+ * @param  frame_size  フレーム数
+ * @param  node_size   ノード数
+ * @param  dst         書き込み先 (node 毎に dst_stride バイト, 64bit ワード境界)
+ * @param  dst_stride  ノード毎のバイト数
+ */
+template <typename Tp, class RowFunc>
+void BitTranspose_FromFrameMajor(RowFunc row, index_t frame_size, index_t node_size, void *dst, index_t dst_stride)
+{
+    index_t frame_tiles = (frame_size + 63) / 64;
+    index_t node_tiles  = (node_size  + 63) / 64;
+
+    #pragma omp parallel for
+    for ( index_t node_tile = 0; node_tile < node_tiles; ++node_tile ) {
+        index_t node_base = node_tile * 64;
+        int     nodes     = (int)std::min<index_t>(64, node_size - node_base);
+
+        for ( index_t frame_tile = 0; frame_tile < frame_tiles; ++frame_tile ) {
+            index_t frame_base = frame_tile * 64;
+            int     frames     = (int)std::min<index_t>(64, frame_size - frame_base);
+
+            std::uint64_t m[64];
+            for ( int f = 0; f < frames; ++f ) {
+                m[f] = BitPack64<Tp>(row(frame_base + f) + node_base, nodes);
+            }
+            for ( int f = frames; f < 64; ++f ) {
+                m[f] = 0;
+            }
+
+            BitTranspose64x64(m);
+
+            for ( int n = 0; n < nodes; ++n ) {
+                auto dst_vec = (std::uint64_t *)((std::uint8_t *)dst + (node_base + n) * dst_stride);
+                dst_vec[frame_tile] = m[n];
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief  Bit 型の配置からフレーム毎の配列へ変換 (値は 0 か 1)
+ * @param  row         row(frame) で frame の先頭 (node_size 個の書き込み先) を返す関数
+ * @param  frame_size  フレーム数
+ * @param  node_size   ノード数
+ * @param  src         読み出し元 (node 毎に src_stride バイト, 64bit ワード境界)
+ * @param  src_stride  ノード毎のバイト数
+ */
+template <typename Tp, class RowFunc>
+void BitTranspose_ToFrameMajor(RowFunc row, index_t frame_size, index_t node_size, void const *src, index_t src_stride)
+{
+    index_t frame_tiles = (frame_size + 63) / 64;
+    index_t node_tiles  = (node_size  + 63) / 64;
+
+    #pragma omp parallel for
+    for ( index_t frame_tile = 0; frame_tile < frame_tiles; ++frame_tile ) {
+        index_t frame_base = frame_tile * 64;
+        int     frames     = (int)std::min<index_t>(64, frame_size - frame_base);
+
+        for ( index_t node_tile = 0; node_tile < node_tiles; ++node_tile ) {
+            index_t node_base = node_tile * 64;
+            int     nodes     = (int)std::min<index_t>(64, node_size - node_base);
+
+            std::uint64_t m[64];
+            for ( int n = 0; n < nodes; ++n ) {
+                auto src_vec = (std::uint64_t const *)((std::uint8_t const *)src + (node_base + n) * src_stride);
+                m[n] = src_vec[frame_tile];
+            }
+            for ( int n = nodes; n < 64; ++n ) {
+                m[n] = 0;
+            }
+
+            BitTranspose64x64(m);
+
+            for ( int f = 0; f < frames; ++f ) {
+                Tp *dst_vec = row(frame_base + f) + node_base;
+                for ( int n = 0; n < nodes; ++n ) {
+                    dst_vec[n] = ((m[f] >> n) & 1) ? (Tp)1 : (Tp)0;
+                }
+            }
+        }
+    }
+}
+
+
+}
+
+// end of file
@@ -179,17 +179,19 @@ public:
 
             auto hw_size = m_h_size * m_w_size;
 
-            for (index_t c = 0; c < m_c_size; ++c) {
-                #pragma omp parallel for
-                for (index_t xy = 0; xy < hw_size; ++xy) {
-                    for ( index_t output_frame = 0; output_frame < output_frame_size; ++output_frame ) {
-                        index_t output_node = c * hw_size + xy;
-                        index_t input_frame = output_frame * hw_size + xy;
-                        index_t input_node  = c;
-                        y_ptr.Set(output_frame, output_node, x_ptr.Get(input_frame, input_node));
+            // 出力ノード x 出力フレームのブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_c_size * hw_size, output_frame_size,
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t output_node = node_start; output_node < node_end; ++output_node) {
+                        index_t c  = output_node / hw_size;
+                        index_t xy = output_node % hw_size;
+                        for ( index_t output_frame = frame_start; output_frame < frame_end; ++output_frame ) {
+                            index_t input_frame = output_frame * hw_size + xy;
+                            index_t input_node  = c;
+                            y_ptr.Set(output_frame, output_node, x_ptr.Get(input_frame, input_node));
+                        }
                     }
-                }
-            }
+                });
             return y_buf;
         }
 
@@ -217,6 +219,10 @@ public:
     
     FrameBuffer Backward(FrameBuffer dy_buf)
     {
+        if ( !m_input_gradient ) {
+            return FrameBuffer();
+        }
+
         BB_ASSERT(dy_buf.GetType() == DataType<BT>::type);
 
         index_t output_frame_size = dy_buf.GetFrameSize();
@@ -253,18 +259,18 @@ public:
             
             auto hw_size = m_h_size * m_w_size;
 
-            for (index_t c = 0; c < m_c_size; ++c) {
-                #pragma omp parallel for
-                for (index_t xy = 0; xy < hw_size; ++xy) {
-                    for (index_t output_frame = 0; output_frame < output_frame_size; ++output_frame) {
-                        index_t output_node = c * hw_size + xy;
-                        index_t input_frame = output_frame * hw_size + xy;
-                        index_t input_node  = c;
+            // 書き込み先(入力側)のノード x フレームのブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_c_size, input_frame_size,
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t input_node = node_start; input_node < node_end; ++input_node) {
+                        for (index_t input_frame = frame_start; input_frame < frame_end; ++input_frame) {
+                            index_t output_frame = input_frame / hw_size;
+                            index_t output_node  = input_node * hw_size + input_frame % hw_size;
 
-                        dx_ptr.Set(input_frame, input_node, dy_ptr.Get(output_frame, output_node));
+                            dx_ptr.Set(input_frame, input_node, dy_ptr.Get(output_frame, output_node));
+                        }
                     }
-                }
-            }
+                });
 
             return dx_buf;
         }
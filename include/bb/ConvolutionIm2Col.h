@@ -170,6 +170,70 @@ public:
         return m_output_shape;
     }
 
+    index_t GetOutputHeight(void) const { return m_output_h_size; }
+    index_t GetOutputWidth(void)  const { return m_output_w_size; }
+    FT      GetBorderValue(void)  const { return m_border_value; }
+
+    /**
+     * @brief  参照する入力ノードの取得
+     * @detail 1画像内の出力位置 pixel (y * 出力幅 + x) の出力ノード node が参照する入力ノードを返す
+     *         (Forward と同じ境界処理を行う)
+     * @param  pixel 出力位置
+     * @param  node  出力ノード (c, fy, fx)
+     * @return 入力ノード (境界外で固定値 GetBorderValue() になる場合は -1)
+     */
+    index_t GetInputNodeIndex(index_t pixel, index_t node) const
+    {
+        index_t c  = node / (m_filter_h_size * m_filter_w_size);
+        index_t fy = (node / m_filter_w_size) % m_filter_h_size;
+        index_t fx = node % m_filter_w_size;
+        index_t iy = GetInputY(pixel / m_output_w_size, fy);
+        index_t ix = GetInputX(pixel % m_output_w_size, fx);
+        if ( iy < 0 || ix < 0 ) {
+            return -1;
+        }
+        return (c * m_input_h_size + iy) * m_input_w_size + ix;
+    }
+
+    /**
+     * @brief  参照する入力行の取得
+     * @detail 境界処理は x, y 独立に行われるので行と列に分けて求められる
+     * @param  y  出力行
+     * @param  fy フィルタ内の行
+     * @return 入力行 (境界外で固定値になる場合は -1)
+     */
+    index_t GetInputY(index_t y, index_t fy) const
+    {
+        index_t iy = y * m_y_stride - m_y_offset + fy;
+        if ( iy >= 0 && iy < m_input_h_size ) {
+            return iy;
+        }
+        index_t ix = 0;
+        if ( Border(m_border_mode, ix, iy, m_input_w_size, m_input_h_size) ) {
+            return iy;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief  参照する入力列の取得
+     * @param  x  出力列
+     * @param  fx フィルタ内の列
+     * @return 入力列 (境界外で固定値になる場合は -1)
+     */
+    index_t GetInputX(index_t x, index_t fx) const
+    {
+        index_t ix = x * m_x_stride - m_x_offset + fx;
+        if ( ix >= 0 && ix < m_input_w_size ) {
+            return ix;
+        }
+        index_t iy = 0;
+        if ( Border(m_border_mode, ix, iy, m_input_w_size, m_input_h_size) ) {
+            return ix;
+        }
+        return -1;
+    }
+
 
 protected:
     inline index_t GetInputNode(index_t c, index_t y, index_t x)
@@ -183,7 +247,7 @@ protected:
     }
 
 
-    inline bool Border(int border_mode, index_t &x, index_t &y, index_t w, index_t h)
+    static inline bool Border(int border_mode, index_t &x, index_t &y, index_t w, index_t h)
     {
         switch ( border_mode ) {
         case BB_BORDER_REFLECT:
@@ -304,12 +368,17 @@ public:
             auto x_ptr = x_buf.LockConst<FT>();
             auto y_ptr = y_buf.Lock<FT>(true);
 
-            for (index_t c = 0; c < m_input_c_size; ++c ) {
-                #pragma omp parallel for
-                for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                    #pragma omp parallel for
-                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                        for ( index_t output_frame = 0; output_frame < output_frame_size; ++output_frame ) {
+            auto x_view = x_ptr.GetView();
+            auto y_view = y_ptr.GetView();
+
+            // 出力ノード(c, fy, fx) x 出力フレームのブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_input_c_size * m_filter_h_size * m_filter_w_size, output_frame_size,
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t output_node = node_start; output_node < node_end; ++output_node) {
+                        index_t c  = output_node / (m_filter_h_size * m_filter_w_size);
+                        index_t fy = (output_node / m_filter_w_size) % m_filter_h_size;
+                        index_t fx = output_node % m_filter_w_size;
+                        for ( index_t output_frame = frame_start; output_frame < frame_end; ++output_frame ) {
                             index_t input_frame = output_frame / output_size;
                             index_t f           = output_frame % output_size;
                             index_t iy = (f / m_output_w_size) * m_y_stride - m_y_offset + fy;
@@ -318,21 +387,19 @@ public:
                             FT in_sig = m_border_value;
                             if ( iy >= 0 && iy < m_input_h_size && ix >= 0 && ix < m_input_w_size ) {
                                 index_t input_node  = (c * m_input_h_size  + iy) * m_input_w_size  + ix;
-                                in_sig = x_ptr.Get(input_frame, input_node);
+                                in_sig = x_view.Get(input_frame, input_node);
                             }
                             else {
                               if ( Border(m_border_mode, ix, iy, m_input_w_size, m_input_h_size) ) {
                                     index_t input_node = (c * m_input_h_size  + iy) * m_input_w_size  + ix;
-                                    in_sig = x_ptr.Get(input_frame, input_node);
+                                    in_sig = x_view.Get(input_frame, input_node);
                                 }
                             }
 
-                            index_t output_node = (c * m_filter_h_size + fy) * m_filter_w_size + fx;    
-                            y_ptr.Set(output_frame, output_node, in_sig);
+                            y_view.Set(output_frame, output_node, in_sig);
                         }
                     }
-                }
-            }
+                });
 
             return y_buf;
         }
@@ -341,6 +408,10 @@ public:
 
     FrameBuffer Backward(FrameBuffer dy_buf)
     {
+        if ( !m_input_gradient ) {
+            return FrameBuffer();
+        }
+
         BB_ASSERT(dy_buf.GetType() == DataType<BT>::type);
         
         // 出力設定
@@ -378,19 +449,23 @@ public:
             auto dy_ptr = dy_buf.LockConst<BT>();
             auto dx_ptr = dx_buf.Lock<BT>();
 
+            auto dy_view = dy_ptr.GetView();
+            auto dx_view = dx_ptr.GetView();
+
             index_t iy_limit = (m_output_h_size - 1) * m_y_stride;
             index_t ix_limit = (m_output_w_size - 1) * m_x_stride;
 
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                #pragma omp parallel for
-                for (index_t y = 0; y < m_input_h_size; ++y ) {
-                    #pragma omp parallel for
-                    for (index_t x = 0; x < m_input_w_size; ++x ) {
-                        index_t input_node = (c * m_input_h_size + y) * m_input_w_size + x;
+            // 入力ノード(c, y, x) x 入力フレームのブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_input_c_size * m_input_h_size * m_input_w_size, m_input_frame_size,
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t input_node = node_start; input_node < node_end; ++input_node) {
+                        index_t c = input_node / (m_input_h_size * m_input_w_size);
+                        index_t y = (input_node / m_input_w_size) % m_input_h_size;
+                        index_t x = input_node % m_input_w_size;
                         index_t x_align = x % m_x_stride;
                         index_t y_align = y % m_y_stride;
-                        for ( index_t input_frame = 0; input_frame < m_input_frame_size; ++input_frame ) {
-                            BT dx = 0; // dx_ptr.Get(input_frame, input_node);
+                        for ( index_t input_frame = frame_start; input_frame < frame_end; ++input_frame ) {
+                            BT dx = 0; // dx_view.Get(input_frame, input_node);
                             float dy = 0;
                             for (index_t fy = y_align; fy < m_filter_h_size; fy += m_y_stride ) {
                                 index_t iy = y - fy + m_y_offset;
@@ -400,16 +475,15 @@ public:
                                         if ( ix >= 0 && ix <= ix_limit ) {
                                             index_t output_frame = (input_frame * m_output_h_size + (iy/m_y_stride)) * m_output_w_size + (ix/m_x_stride);
                                             index_t output_node  = (c * m_filter_h_size + fy) * m_filter_w_size + fx;
-                                            dy += dy_ptr.Get(output_frame, output_node);
+                                            dy += dy_view.Get(output_frame, output_node);
                                         }
                                     }
                                 }
                             }
-                            dx_ptr.Set(input_frame, input_node, dx + dy);
+                            dx_view.Set(input_frame, input_node, dx + dy);
                         }
                     }
-                }
-            }
+                });
 
             return dx_buf;
         }
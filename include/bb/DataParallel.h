@@ -0,0 +1,254 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bb/Model.h"
+#include "bb/Variables.h"
+#include "bb/ThreadPool.h"
+
+
+namespace bb {
+
+
+// データ並列学習用の複製ネット群
+//   先頭(マスター)と同じ構成の複製にミニバッチを分けて Forward/Backward を並列に行い、
+//   勾配を木構造で足し込んでマスターのオプティマイザで1回だけ更新する
+//   複製は ThreadPool::ParallelForStatic で常に同じワーカーが受け持ち、複製内の並列処理は
+//   複製毎に作った独立したワーカー群(ThreadPool::Create)と頭割りした OpenMP スレッドで行う
+//   (CPU への固定は行わない)
+//   BatchNormalization などの正規化は複製毎に自分のミニバッチの統計で行う (SyncBN ではない)
+class DataParallel
+{
+protected:
+    std::vector< std::shared_ptr<Model> >   m_nets;         // [0] がマスター
+    std::vector<Variables>                  m_params;
+    std::vector<Variables>                  m_grads;
+    std::vector<Variables>                  m_stats;
+    std::vector< std::shared_ptr<ThreadPool> >  m_pools;    // 複製毎のワーカー群
+
+protected:
+    DataParallel(std::shared_ptr<Model> net, std::vector< std::shared_ptr<Model> > const &replicas)
+    {
+        BB_ASSERT(net != nullptr);
+        m_nets.push_back(net);
+        for ( auto replica : replicas ) {
+            BB_ASSERT(replica != nullptr);
+            m_nets.push_back(replica);
+        }
+    }
+
+    // 変数の中身のコピー(Variables の代入は参照の共有になるため)
+    static void CopyVariables(Variables &dst, Variables const &src)
+    {
+        BB_ASSERT(dst.GetSize() == src.GetSize());
+        for ( index_t i = 0; i < src.GetSize(); ++i ) {
+            BB_ASSERT(dst[i].GetMemorySize() == src[i].GetMemorySize());
+            auto src_ptr = src[i].LockMemoryConst();
+            auto dst_ptr = dst[i].LockMemory(true);
+            memcpy(dst_ptr.GetAddr(), src_ptr.GetAddr(), src[i].GetMemorySize());
+        }
+    }
+
+    static void CopyTensor(Tensor &dst, Tensor const &src)
+    {
+        BB_ASSERT(dst.GetMemorySize() == src.GetMemorySize());
+        auto src_ptr = src.LockMemoryConst();
+        auto dst_ptr = dst.LockMemory(true);
+        memcpy(dst_ptr.GetAddr(), src_ptr.GetAddr(), src.GetMemorySize());
+    }
+
+    // 複製毎に func(index) を並列実行
+    template <class Func>
+    void Run(index_t size, Func func)
+    {
+        auto &pool = ThreadPool::GetInstance();
+        int  threads_per_replica = std::max(1, pool.GetThreadCount() / (int)size);
+
+        // 複製毎のワーカー群 (呼び出し元となる共通プールのスレッドを含めて threads_per_replica 本)
+        if ( (index_t)m_pools.size() < size || m_pools[0]->GetThreadCount() != threads_per_replica ) {
+            m_pools.clear();
+            for ( index_t i = 0; i < size; ++i ) {
+                m_pools.push_back(ThreadPool::Create(threads_per_replica));
+            }
+        }
+
+        pool.ParallelForStatic(0, size, [&](index_t start, index_t end) {
+#ifdef _OPENMP
+                // 複製内の OpenMP は受け持ちのコア数に制限する
+                int org_threads = omp_get_max_threads();
+                omp_set_num_threads(threads_per_replica);
+#endif
+                for ( index_t i = start; i < end; ++i ) {
+                    // 複製内の ThreadPool::GetInstance() は自分のワーカー群だけを使う
+                    ThreadPool::Scope scope(*m_pools[i]);
+                    func(i);
+                }
+#ifdef _OPENMP
+                omp_set_num_threads(org_threads);
+#endif
+            });
+    }
+
+    // 木構造の足し込み (結果は vars[0])
+    void TreeReduce(std::vector<Variables> &vars, index_t size)
+    {
+        for ( index_t stride = 1; stride < size; stride *= 2 ) {
+            ThreadPool::GetInstance().ParallelFor(0, (size + 2*stride - 1) / (2*stride), 1, [&](index_t start, index_t end) {
+                    for ( index_t k = start; k < end; ++k ) {
+                        index_t i = k * 2 * stride;
+                        if ( i + stride < size ) {
+                            vars[i] += vars[i + stride];
+                        }
+                    }
+                });
+        }
+    }
+
+public:
+    static std::shared_ptr<DataParallel> Create(std::shared_ptr<Model> net, std::vector< std::shared_ptr<Model> > const &replicas)
+    {
+        return std::shared_ptr<DataParallel>(new DataParallel(net, replicas));
+    }
+
+    index_t                 GetSize(void) const       { return (index_t)m_nets.size(); }
+    std::shared_ptr<Model>  GetNet(index_t i) const   { return m_nets[i]; }
+
+    /**
+     * @brief  マスターの状態を複製へ配る
+     * @detail パラメータ・統計量を含む全状態を Save/Load でコピーする
+     *         学習開始時やファイル読込後に呼ぶ
+     */
+    void Broadcast(void)
+    {
+        std::stringstream ss;
+        m_nets[0]->Save(ss);
+        std::string state = ss.str();
+        for ( index_t i = 1; i < GetSize(); ++i ) {
+            std::istringstream is(state);
+            m_nets[i]->Load(is);
+        }
+
+        m_params.clear();
+        m_grads.clear();
+        m_stats.clear();
+        for ( auto net : m_nets ) {
+            m_params.push_back(net->GetParameters());
+            m_grads.push_back(net->GetGradients());
+            m_stats.push_back(net->GetStatistics());
+        }
+        for ( index_t i = 1; i < GetSize(); ++i ) {
+            m_grads[i] = 0;
+        }
+    }
+
+    /**
+     * @brief  複製毎に Forward
+     * @param  x_bufs 複製毎の入力 (GetSize() 個まで)
+     * @param  train  学習時 true
+     * @return 複製毎の出力
+     */
+    std::vector<FrameBuffer> Forward(std::vector<FrameBuffer> const &x_bufs, bool train=true)
+    {
+        BB_ASSERT((index_t)x_bufs.size() <= GetSize());
+        if ( m_params.empty() ) {
+            Broadcast();
+        }
+
+        std::vector<FrameBuffer> y_bufs(x_bufs.size());
+        Run((index_t)x_bufs.size(), [&](index_t i) { y_bufs[i] = m_nets[i]->Forward(x_bufs[i], train); });
+        return y_bufs;
+    }
+
+    /**
+     * @brief  複製毎に Backward
+     * @param  dy_bufs 複製毎の誤差 (Forward と同じ数)
+     */
+    void Backward(std::vector<FrameBuffer> const &dy_bufs)
+    {
+        BB_ASSERT((index_t)dy_bufs.size() <= GetSize());
+        Run((index_t)dy_bufs.size(), [&](index_t i) { m_nets[i]->Backward(dy_bufs[i]); });
+    }
+
+    /**
+     * @brief  勾配の集約
+     * @detail 全複製の勾配の和をマスターの勾配にし、複製側はゼロに戻す
+     */
+    void ReduceGradients(void)
+    {
+        TreeReduce(m_grads, GetSize());
+        for ( index_t i = 1; i < GetSize(); ++i ) {
+            m_grads[i] = 0;
+        }
+    }
+
+    /**
+     * @brief  統計量の集約
+     * @detail 今回計算した複製の統計量を全体の統計量にまとめて全複製に設定する
+     *         GetStatistics() は層毎に (平均, 分散) の組で並ぶので、平均は単純平均、
+     *         分散は複製内の分散の平均に複製間の平均のばらつきを加えたもの
+     *           mean = mean_i の平均,  var = var_i の平均 + (mean_i - mean)^2 の平均
+     *         とする (各複製のフレーム数は等しいものとして重み付けはしない)
+     * @param  size 今回計算した複製の数
+     */
+    void ReduceStatistics(index_t size)
+    {
+        if ( m_stats.empty() || m_stats[0].GetSize() == 0 ) {
+            return;
+        }
+        BB_ASSERT(m_stats[0].GetSize() % 2 == 0);
+
+        double scale = 1.0 / (double)size;
+        for ( index_t j = 0; j < m_stats[0].GetSize(); j += 2 ) {
+            Tensor mean = m_stats[0][j].Clone();
+            Tensor var  = m_stats[0][j+1].Clone();
+            for ( index_t i = 1; i < size; ++i ) {
+                mean += m_stats[i][j];
+                var  += m_stats[i][j+1];
+            }
+            mean *= scale;
+            var  *= scale;
+            for ( index_t i = 0; i < size; ++i ) {
+                Tensor diff = m_stats[i][j] - mean;
+                var += (diff * diff) * scale;
+            }
+            CopyTensor(m_stats[0][j],   mean);
+            CopyTensor(m_stats[0][j+1], var);
+        }
+
+        for ( index_t i = 1; i < GetSize(); ++i ) {
+            CopyVariables(m_stats[i], m_stats[0]);
+        }
+    }
+
+    /**
+     * @brief  パラメータの同期
+     * @detail マスターのパラメータ(オプティマイザ更新後)を複製へコピーする
+     */
+    void SyncParameters(void)
+    {
+        for ( index_t i = 1; i < GetSize(); ++i ) {
+            CopyVariables(m_params[i], m_params[0]);
+        }
+    }
+};
+
+
+}
+
+// end of file
@@ -11,6 +11,7 @@
 
 #include <assert.h>
 #include <cstdint>
+#include <vector>
 
 #include "bb/Assert.h"
 #include "bb/SimdSupport.h"
@@ -32,6 +33,7 @@ namespace bb {
 #define BB_TYPE_FP16            (0x0100 + 16)
 #define BB_TYPE_FP32            (0x0100 + 32)
 #define BB_TYPE_FP64            (0x0100 + 64)
+#define BB_TYPE_BF16            (0x0180 + 16)
 
 #define BB_TYPE_INT8            (0x0200 + 8)
 #define BB_TYPE_INT16           (0x0200 + 16)
@@ -403,6 +405,52 @@ inline Sign::Sign(const Binary& bin) { m_value = (bool)bin; }
 inline Sign& Sign::operator=(const Binary& bin) { m_value = (bool)bin; return *this; }
 
 
+// 半精度 (IEEE754 binary16) の格納用の型
+//   メモリ帯域と容量を半分にするためのもので、演算は float に変換して行う
+class Float16
+{
+protected:
+    std::uint16_t   m_bits;
+
+public:
+    Float16() {}
+    Float16(float v) { m_bits = bb_cvtss_sh(v); }
+    template<typename Tp>
+    Float16(Tp v) { m_bits = bb_cvtss_sh((float)v); }
+
+    static Float16 FromBits(std::uint16_t bits) { Float16 h; h.m_bits = bits; return h; }
+    std::uint16_t  GetBits(void) const { return m_bits; }
+
+    Float16& operator=(float v)  { m_bits = bb_cvtss_sh(v); return *this; }
+    Float16& operator+=(float v) { m_bits = bb_cvtss_sh(bb_cvtsh_ss(m_bits) + v); return *this; }
+
+    operator float() const { return bb_cvtsh_ss(m_bits); }
+};
+
+// bfloat16 (float の上位16bit) の格納用の型
+//   指数部が float と同じなので勾配などダイナミックレンジが必要なものに向く
+class BFloat16
+{
+protected:
+    std::uint16_t   m_bits;
+
+public:
+    BFloat16() {}
+    BFloat16(float v) { m_bits = bb_cvtss_bf16(v); }
+    template<typename Tp>
+    BFloat16(Tp v) { m_bits = bb_cvtss_bf16((float)v); }
+
+    static BFloat16 FromBits(std::uint16_t bits) { BFloat16 h; h.m_bits = bits; return h; }
+    std::uint16_t   GetBits(void) const { return m_bits; }
+
+    BFloat16& operator=(float v)  { m_bits = bb_cvtss_bf16(v); return *this; }
+    BFloat16& operator+=(float v) { m_bits = bb_cvtss_bf16(bb_cvtbf16_ss(m_bits) + v); return *this; }
+
+    operator float() const { return bb_cvtbf16_ss(m_bits); }
+};
+
+
+
 
 // データタイプ定義
 template<typename _Tp> class DataType
@@ -537,6 +585,28 @@ public:
     };
 };
 
+template<> class DataType<Float16>
+{
+public:
+    typedef Float16 value_type;
+    enum {
+        type = BB_TYPE_FP16,
+        size = 2,
+        bit_size = 16,
+    };
+};
+
+template<> class DataType<BFloat16>
+{
+public:
+    typedef BFloat16 value_type;
+    enum {
+        type = BB_TYPE_BF16,
+        size = 2,
+        bit_size = 16,
+    };
+};
+
 template<> class DataType<float>
 {
 public:
@@ -566,6 +636,7 @@ inline int DataType_GetBitSize(int type)
     case BB_TYPE_BIT:    return 1;
     case BB_TYPE_BINARY: return 8;
     case BB_TYPE_FP16:   return 16;
+    case BB_TYPE_BF16:   return 16;
     case BB_TYPE_FP32:   return 32;
     case BB_TYPE_FP64:   return 64;
     case BB_TYPE_INT8:   return 8;
@@ -587,6 +658,7 @@ inline int DataType_GetByteSize(int type)
     case BB_TYPE_BIT:    return 1;
     case BB_TYPE_BINARY: return 1;
     case BB_TYPE_FP16:   return 2;
+    case BB_TYPE_BF16:   return 2;
     case BB_TYPE_FP32:   return 4;
     case BB_TYPE_FP64:   return 8;
     case BB_TYPE_INT8:   return 1;
@@ -670,6 +742,76 @@ inline void DataType_Add<Bit>(void* base, index_t index, Bit value)
 
 
 
+// float との一括変換 (AVX2 のロード/ストア段で変換する)
+inline void DataType_Convert(float const *src, Float16 *dst, index_t size)
+{
+    auto p = (std::uint16_t *)dst;
+    index_t i = 0;
+#ifdef __AVX2__
+    for ( ; i + 8 <= size; i += 8 ) {
+        bb_mm256_storeu_ps_ph(&p[i], _mm256_loadu_ps(&src[i]));
+    }
+#endif
+    for ( ; i < size; ++i ) {
+        p[i] = bb_cvtss_sh(src[i]);
+    }
+}
+
+inline void DataType_Convert(Float16 const *src, float *dst, index_t size)
+{
+    auto p = (std::uint16_t const *)src;
+    index_t i = 0;
+#ifdef __AVX2__
+    for ( ; i + 8 <= size; i += 8 ) {
+        _mm256_storeu_ps(&dst[i], bb_mm256_loadu_ph_ps(&p[i]));
+    }
+#endif
+    for ( ; i < size; ++i ) {
+        dst[i] = bb_cvtsh_ss(p[i]);
+    }
+}
+
+inline void DataType_Convert(float const *src, BFloat16 *dst, index_t size)
+{
+    auto p = (std::uint16_t *)dst;
+    index_t i = 0;
+#ifdef __AVX2__
+    for ( ; i + 8 <= size; i += 8 ) {
+        bb_mm256_storeu_ps_bf16(&p[i], _mm256_loadu_ps(&src[i]));
+    }
+#endif
+    for ( ; i < size; ++i ) {
+        p[i] = bb_cvtss_bf16(src[i]);
+    }
+}
+
+inline void DataType_Convert(BFloat16 const *src, float *dst, index_t size)
+{
+    auto p = (std::uint16_t const *)src;
+    index_t i = 0;
+#ifdef __AVX2__
+    for ( ; i + 8 <= size; i += 8 ) {
+        _mm256_storeu_ps(&dst[i], bb_mm256_loadu_bf16_ps(&p[i]));
+    }
+#endif
+    for ( ; i < size; ++i ) {
+        dst[i] = bb_cvtbf16_ss(p[i]);
+    }
+}
+
+
+#ifdef __AVX2__
+// 格納型から float x8 の読み書き (SIMD カーネルを格納型で共通化する為)
+inline __m256 bb_mm256_loadu_ps(float    const *p) { return _mm256_loadu_ps(p); }
+inline __m256 bb_mm256_loadu_ps(Float16  const *p) { return bb_mm256_loadu_ph_ps((std::uint16_t const *)p); }
+inline __m256 bb_mm256_loadu_ps(BFloat16 const *p) { return bb_mm256_loadu_bf16_ps((std::uint16_t const *)p); }
+
+inline void bb_mm256_storeu_ps(float    *p, __m256 v) { _mm256_storeu_ps(p, v); }
+inline void bb_mm256_storeu_ps(Float16  *p, __m256 v) { bb_mm256_storeu_ps_ph((std::uint16_t *)p, v); }
+inline void bb_mm256_storeu_ps(BFloat16 *p, __m256 v) { bb_mm256_storeu_ps_bf16((std::uint16_t *)p, v); }
+#endif
+
+
 // シリアライズ
 template<typename T>
 inline void SaveValue(std::ostream &os, T const &val)
@@ -11,9 +11,13 @@
 #pragma once
 
 #include <random>
+#include <vector>
 
 #include "bb/DataType.h"
 #include "bb/Model.h"
+#include "bb/SimdSupport.h"
+#include "bb/FrameMajorBuffer.h"
+#include "bb/QuantizeInt8.h"
 
 #ifdef BB_WITH_CUDA
 #include "cuda_runtime.h"
@@ -34,7 +38,10 @@ class DenseAffine : public Model
 
 protected:
     bool                        m_binary_mode = false;
+    bool                        m_xnor_mode = false;    // 入力と重みを符号で2値化し XNOR + popcount で演算
     bool                        m_host_only = false;
+    bool                        m_int8_mode = false;
+    bool                        m_int8_calibrate = false;
 
     T                           m_initialize_std = (T)0.01;
     std::string                 m_initializer = "he";
@@ -47,10 +54,26 @@ protected:
 
     FrameBuffer                 m_x_buf;
 
+    // XNOR モードの Backward 用に保存した2値化入力
+    index_t                     m_x_bit_frame_size = 0;
+    std::vector<std::uint64_t>  m_x_bit;        // [frame][word]
+
     std::shared_ptr<Tensor>     m_W;
     std::shared_ptr<Tensor>     m_b;
     std::shared_ptr<Tensor>     m_dW;
     std::shared_ptr<Tensor>     m_db;
+
+    // 2値モードの host 演算用に符号をビットに詰めた重み
+    std::uint64_t               m_W_bit_revision = 0;
+    std::vector<std::uint64_t>  m_W_bit;        // [output_node][word]
+    std::vector<T>              m_W_scale;      // 出力ノード毎のスケール (|W| の平均)
+
+    // INT8 推論用
+    float                       m_x_int8_abs_max = 0;   // 較正した入力の max|x|
+    std::uint64_t               m_W_int8_revision = 0;
+    std::vector<std::int8_t>    m_W_int8;               // [output_node][Int8_GetStride(input_node_size)]
+    std::vector<float>          m_W_int8_scale;         // 出力ノード毎のスケール
+    std::vector<std::int32_t>   m_W_int8_sum;           // 出力ノード毎の総和
     
 #ifdef BB_WITH_CUDA
     bool                        m_cublasEnable = false;
@@ -98,11 +121,35 @@ protected:
             m_binary_mode = EvalBool(args[1]);
         }
 
+        // XNOR モード設定 (入力を x > 0 で ±1 とみなす2値レイヤーとして学習・推論とも host で演算)
+        if ( args.size() == 2 && args[0] == "xnor" )
+        {
+            m_xnor_mode = EvalBool(args[1]);
+        }
+
         // HostOnlyモード設定
         if (args.size() == 2 && args[0] == "host_only")
         {
             m_host_only = EvalBool(args[1]);
         }
+
+        // INT8 推論の較正 (有効にした後の Forward で入力の範囲を集計する)
+        if (args.size() == 2 && args[0] == "int8_calibrate")
+        {
+            m_int8_calibrate = EvalBool(args[1]);
+            if ( m_int8_calibrate ) {
+                m_x_int8_abs_max = 0;
+            }
+        }
+
+        // INT8 推論モード設定
+        if (args.size() == 2 && args[0] == "int8")
+        {
+            m_int8_mode = EvalBool(args[1]);
+            if ( m_int8_mode ) {
+                m_int8_calibrate = false;
+            }
+        }
     }
 
 
@@ -173,6 +220,10 @@ public:
     auto lock_db(void)             { return m_db->Lock<T>(); }
     auto lock_db_const(void) const { return m_db->LockConst<T>(); }
 
+    // INT8 推論の入力スケール (較正結果の max|x|)
+    void  SetInt8InputAbsMax(float abs_max) { m_x_int8_abs_max = abs_max; }
+    float GetInt8InputAbsMax(void) const    { return m_x_int8_abs_max; }
+
 
    /**
      * @brief  入力のshape設定
@@ -252,13 +303,253 @@ public:
     }
 
 
+protected:
+    // 重みの符号をビットに詰める (重みが変わった時だけ作り直す)
+    void PackBinaryWeight(void)
+    {
+        auto revision = m_W->GetRevision();
+        if ( !m_W_bit.empty() && revision == m_W_bit_revision ) {
+            return;
+        }
+
+        index_t word_size = (m_input_node_size + 63) / 64;
+        m_W_bit.assign(m_output_node_size * word_size, 0);
+        m_W_scale.resize(m_output_node_size);
+
+        auto W_ptr = lock_W_const();
+
+        #pragma omp parallel for
+        for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+            auto w_bit = &m_W_bit[output_node * word_size];
+            T    sum   = 0;
+            for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                T w = W_ptr(output_node, input_node);
+                if ( w > 0 ) {
+                    w_bit[input_node / 64] |= ((std::uint64_t)1 << (input_node % 64));
+                }
+                sum += std::abs(w);
+            }
+            m_W_scale[output_node] = sum / (T)m_input_node_size;
+        }
+
+        m_W_bit_revision = revision;
+    }
+
+    /**
+     * @brief  XNOR モードの host 版 Forward
+     * @detail 入力(x > 0 を +1)と重みの符号をビットに詰めて XNOR + popcount で内積を取り、
+     *         出力ノード毎のスケールを掛けてバイアスを加える
+     * @param  x_buf 入力
+     * @param  y_buf 出力
+     * @param  train true なら Backward 用に2値化した入力を保存する
+     */
+    void ForwardBinaryHost(FrameBuffer const &x_buf, FrameBuffer &y_buf, bool train)
+    {
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t word_size  = (m_input_node_size + 63) / 64;
+
+        // 入力をフレーム毎のビット列に詰める
+        std::vector<std::uint64_t> x_bit(frame_size * word_size, 0);
+        {
+            FrameMajorBuffer<T> x_fm(x_buf);
+
+            #pragma omp parallel for
+            for (index_t frame = 0; frame < frame_size; ++frame) {
+                auto x_row = x_fm.GetRow(frame);
+                auto x_vec = &x_bit[frame * word_size];
+                for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                    if ( x_row[input_node] > (T)0 ) {
+                        x_vec[input_node / 64] |= ((std::uint64_t)1 << (input_node % 64));
+                    }
+                }
+            }
+        }
+
+        PackBinaryWeight();
+
+        // 末尾の詰め物は両者 0 なので XNOR で 1 になる分を差し引く
+        index_t pad_size = word_size * 64 - m_input_node_size;
+
+        {
+            auto y_ptr = y_buf.Lock<T>(true);
+            auto b_ptr = lock_b_const();
+
+            auto y_view = y_ptr.GetView();
+
+            #pragma omp parallel for
+            for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                auto w_vec = &m_W_bit[output_node * word_size];
+                T    scale = m_W_scale[output_node];
+                T    bias  = b_ptr(output_node);
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    index_t match = (index_t)bb_popcnt_xnor(&x_bit[frame * word_size], w_vec, word_size) - pad_size;
+                    y_view.Set(frame, output_node, scale * (T)(2 * match - m_input_node_size) + bias);
+                }
+            }
+        }
+
+        if ( train ) {
+            m_x_bit_frame_size = frame_size;
+            m_x_bit.swap(x_bit);
+        }
+    }
+
+    /**
+     * @brief  XNOR モードの host 版 Backward
+     * @detail Forward で使った実効重み scale * sign(W) で dx を求め、
+     *         dW は保存した2値化入力との積を実数の重みにそのまま流す (straight-through)
+     * @param  dy_buf 出力の勾配
+     * @param  dx_buf 入力の勾配 (m_input_gradient の時だけ書く)
+     */
+    void BackwardBinaryHost(FrameBuffer const &dy_buf, FrameBuffer &dx_buf)
+    {
+        index_t frame_size = dy_buf.GetFrameSize();
+        index_t word_size  = (m_input_node_size + 63) / 64;
+        BB_ASSERT(m_x_bit_frame_size == frame_size);
+
+        index_t dy_stride = dy_buf.GetFrameStride() / sizeof(T);
+        auto dy_ptr  = dy_buf.LockMemoryConst();
+        auto dy_addr = (T const *)dy_ptr.GetAddr();
+
+        // dx (入力ノード毎に独立)
+        if ( m_input_gradient ) {
+            index_t dx_stride = dx_buf.GetFrameStride() / sizeof(T);
+            auto dx_ptr  = dx_buf.LockMemory(true);
+            auto dx_addr = (T *)dx_ptr.GetAddr();
+
+            #pragma omp parallel for
+            for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                T *dx_vec = &dx_addr[input_node * dx_stride];
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    dx_vec[frame] = 0;
+                }
+                for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                    T const *dy_vec = &dy_addr[output_node * dy_stride];
+                    bool     sign   = ((m_W_bit[output_node * word_size + input_node / 64] >> (input_node % 64)) & 1) != 0;
+                    T        w      = sign ? m_W_scale[output_node] : -m_W_scale[output_node];
+                    for (index_t frame = 0; frame < frame_size; ++frame) {
+                        dx_vec[frame] += w * dy_vec[frame];
+                    }
+                }
+            }
+        }
+
+        // dW, db (出力ノード毎に独立)
+        if ( !m_frozen ) {
+            auto dW_ptr  = lock_dW();
+            auto db_ptr  = lock_db();
+            auto dW_addr = &dW_ptr[0];
+
+            #pragma omp parallel for
+            for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                T const *dy_vec = &dy_addr[output_node * dy_stride];
+                T       *dW_vec = &dW_addr[output_node * m_input_node_size];
+
+                T db = 0;
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    db += dy_vec[frame];
+                }
+                db_ptr(output_node) += db;
+
+                // 保存した2値化入力 (±1) との積を積算
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    T    dy    = dy_vec[frame];
+                    auto x_vec = &m_x_bit[frame * word_size];
+                    for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                        bool bit = ((x_vec[input_node / 64] >> (input_node % 64)) & 1) != 0;
+                        dW_vec[input_node] += bit ? dy : -dy;
+                    }
+                }
+            }
+        }
+    }
+
+    // 重みを出力ノード毎のスケールで int8 に量子化する (重みが変わった時だけ作り直す)
+    void PackInt8Weight(void)
+    {
+        auto revision = m_W->GetRevision();
+        if ( !m_W_int8.empty() && revision == m_W_int8_revision ) {
+            return;
+        }
+
+        index_t stride = Int8_GetStride(m_input_node_size);
+        m_W_int8.assign(m_output_node_size * stride, 0);
+        m_W_int8_scale.resize(m_output_node_size);
+        m_W_int8_sum.resize(m_output_node_size);
+
+        auto W_ptr  = lock_W_const();
+        auto W_addr = W_ptr.GetAddr();
+
+        #pragma omp parallel for
+        for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+            T const *W_vec   = &W_addr[output_node * m_input_node_size];
+            float    abs_max = 0;
+            for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                abs_max = std::max(abs_max, (float)std::abs(W_vec[input_node]));
+            }
+            float scale = Int8_GetScale(abs_max);
+            auto  w_vec = &m_W_int8[output_node * stride];
+            Int8_Quantize<T>(W_vec, w_vec, m_input_node_size, scale);
+
+            std::int32_t sum = 0;
+            for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                sum += w_vec[input_node];
+            }
+            m_W_int8_scale[output_node] = scale;
+            m_W_int8_sum[output_node]   = sum;
+        }
+
+        m_W_int8_revision = revision;
+    }
+
+    /**
+     * @brief  INT8 の host 版 Forward
+     * @detail 較正した入力スケールで入力を int8 に量子化し、int8 の重みと
+     *         int32 で積和してから float に戻してバイアスを加える
+     * @param  x_buf 入力
+     * @param  y_buf 出力
+     */
+    void ForwardInt8Host(FrameBuffer const &x_buf, FrameBuffer &y_buf)
+    {
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t stride     = Int8_GetStride(m_input_node_size);
+        float   x_scale    = Int8_GetScale(m_x_int8_abs_max);
+
+        PackInt8Weight();
+
+        FrameMajorBuffer<T> x_fm(x_buf);
+        FrameMajorBuffer<T> y_fm(frame_size, m_output_node_size);
+
+        auto b_ptr = lock_b_const();
+
+        #pragma omp parallel for
+        for (index_t frame = 0; frame < frame_size; ++frame) {
+            std::vector<std::int8_t> x_vec(stride, 0);
+            Int8_Quantize<T>(x_fm.GetRow(frame), &x_vec[0], m_input_node_size, x_scale);
+
+            T *y_vec = y_fm.GetRow(frame);
+            for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                std::int32_t sum = Int8_Dot(&x_vec[0], &m_W_int8[output_node * stride], stride, m_W_int8_sum[output_node]);
+                y_vec[output_node] = (T)((float)sum * (x_scale * m_W_int8_scale[output_node])) + b_ptr(output_node);
+            }
+        }
+
+        y_fm.ToFrameBuffer(y_buf);
+    }
+
+public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
         BB_ASSERT(x_buf.GetType() == DataType<T>::type);
         BB_ASSERT(x_buf.GetNodeSize() == m_input_node_size);
 
-        // backwardの為に保存
-        if ( train ) {
+        // INT8 推論用に入力範囲を集計
+        if ( m_int8_calibrate ) {
+            m_x_int8_abs_max = std::max(m_x_int8_abs_max, Int8_AbsMax<T>(x_buf));
+        }
+
+        // backwardの為に保存 (XNOR モードは2値化した入力だけを保存する)
+        if ( train && !m_xnor_mode ) {
             m_x_buf = x_buf;
         }
 
@@ -270,6 +561,18 @@ public:
         // 出力を設定
         FrameBuffer y_buf(x_buf.GetFrameSize(), m_output_shape, DataType<T>::type);
 
+        // INT8 推論
+        if ( !train && m_int8_mode && m_x_int8_abs_max > 0 ) {
+            ForwardInt8Host(x_buf, y_buf);
+            return y_buf;
+        }
+
+        // XNOR モード (float の W・x とは値が変わるので学習時もデバイスより優先し、Backward も揃える)
+        if ( m_xnor_mode ) {
+            ForwardBinaryHost(x_buf, y_buf, train);
+            return y_buf;
+        }
+
 #ifdef BB_WITH_CUDA
         if (DataType<T>::type == BB_TYPE_FP32 && m_cublasEnable && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable())
         {
@@ -312,19 +615,33 @@ public:
 #endif
 
         {
+            // node-major のまま出力ノード毎に y = b + Σ W x (フレーム方向は連続アクセス)
             auto frame_size   = x_buf.GetFrameSize();
 
-            auto x_ptr = x_buf.LockConst<T>();
-            auto y_ptr = y_buf.Lock<T>();
+            index_t x_stride = x_buf.GetFrameStride() / sizeof(T);
+            index_t y_stride = y_buf.GetFrameStride() / sizeof(T);
+            auto x_ptr  = x_buf.LockMemoryConst();
+            auto y_ptr  = y_buf.LockMemory(true);
+            auto x_addr = (T const *)x_ptr.GetAddr();
+            auto y_addr = (T       *)y_ptr.GetAddr();
+
             auto W_ptr = lock_W_const();
             auto b_ptr = lock_b_const();
+            auto W_addr = W_ptr.GetAddr();
 
             #pragma omp parallel for
-            for (index_t frame = 0; frame < frame_size; ++frame) {
-                for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
-                    y_ptr.Set(frame, output_node, b_ptr(output_node));
-                    for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
-                        y_ptr.Add(frame, output_node, x_ptr.Get(frame, input_node) * W_ptr(output_node, input_node));
+            for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                T const *W_vec = &W_addr[output_node * m_input_node_size];
+                T       *y_vec = &y_addr[output_node * y_stride];
+                T        b     = b_ptr(output_node);
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    y_vec[frame] = b;
+                }
+                for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                    T const *x_vec = &x_addr[input_node * x_stride];
+                    T        w     = W_vec[input_node];
+                    for (index_t frame = 0; frame < frame_size; ++frame) {
+                        y_vec[frame] += w * x_vec[frame];
                     }
                 }
             }
@@ -344,91 +661,151 @@ public:
         FrameBuffer x_buf = m_x_buf;
         m_x_buf = FrameBuffer();
 
-        FrameBuffer dx_buf(dy_buf.GetFrameSize(), {m_input_node_size}, DataType<T>::type);
+        // 入力勾配もパラメータ勾配も不要なら何もしない
+        if ( !m_input_gradient && m_frozen ) {
+            return FrameBuffer();
+        }
+
+        FrameBuffer dx_buf;
+        if ( m_input_gradient ) {
+            dx_buf.Resize(dy_buf.GetFrameSize(), {m_input_node_size}, DataType<T>::type);
+        }
+
+        if ( m_xnor_mode ) {
+            BackwardBinaryHost(dy_buf, dx_buf);
+            m_x_bit.clear();
+            m_x_bit_frame_size = 0;
+            return dx_buf;
+        }
 
 
         #ifdef BB_WITH_CUDA
-        if (DataType<T>::type == BB_TYPE_FP32 && m_cublasEnable && dy_buf.IsDeviceAvailable() && x_buf.IsDeviceAvailable() && dx_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable())
+        if (DataType<T>::type == BB_TYPE_FP32 && m_cublasEnable && dy_buf.IsDeviceAvailable() && x_buf.IsDeviceAvailable() && (!m_input_gradient || dx_buf.IsDeviceAvailable()) && Manager::IsDeviceAvailable())
         {
             auto dy_ptr = dy_buf.LockDeviceMemoryConst();
             auto x_ptr  = x_buf.LockDeviceMemoryConst();
-            auto dx_ptr = dx_buf.LockDeviceMemory(true);
             auto W_ptr  = m_W->LockDeviceMemoryConst();
             auto b_ptr  = m_b->LockDeviceMemoryConst();
-            auto dW_ptr = m_dW->LockDeviceMemory();
-            auto db_ptr = m_db->LockDeviceMemory();
-            
-            bbcu_fp32_MatrixColwiseSum
-                (
-                    (float const *)dy_ptr.GetAddr(),
-                    (float       *)db_ptr.GetAddr(),
-                    (int          )dy_buf.GetNodeSize(),
-                    (int          )dy_buf.GetFrameSize(),
-                    (int          )(dy_buf.GetFrameStride() / sizeof(float))
-                );
 
             float alpha = 1.0f;
             float beta = 0.0f;
-            BB_CUBLAS_SAFE_CALL(cublasSgemm
-                (
-                    m_cublasHandle,
-                    CUBLAS_OP_N,
-                    CUBLAS_OP_T,
-                    (int)dx_buf.GetFrameSize(),
-                    (int)dx_buf.GetNodeSize(),
-                    (int)dy_buf.GetNodeSize(),
-                    &alpha,
-                    (const float *)dy_ptr.GetAddr(),
-                    (int)(dy_buf.GetFrameStride() / sizeof(float)),
-                    (const float *)W_ptr.GetAddr(),
-                    (int)dx_buf.GetNodeSize(),
-                    &beta,
-                    (float *)dx_ptr.GetAddr(),
-                    (int)(dx_buf.GetFrameStride() / sizeof(float))
-                ));
-            
-            beta = 1.0f;
-            BB_CUBLAS_SAFE_CALL(cublasSgemm
-                (
-                    m_cublasHandle,
-                    CUBLAS_OP_T,
-                    CUBLAS_OP_N,
-                    (int)dx_buf.GetNodeSize(),
-                    (int)dy_buf.GetNodeSize(),
-                    (int)dx_buf.GetFrameSize(),
-                    &alpha,
-                    (const float *)x_ptr.GetAddr(),
-                    (int)(x_buf.GetFrameStride() / sizeof(float)),
-                    (const float *)dy_ptr.GetAddr(),
-                    (int)(dy_buf.GetFrameStride() / sizeof(float)),
-                    &beta,
-                    (float *)dW_ptr.GetAddr(),
-                    (int)dx_buf.GetNodeSize()
-                ));
+            if ( m_input_gradient ) {
+                auto dx_ptr = dx_buf.LockDeviceMemory(true);
+                BB_CUBLAS_SAFE_CALL(cublasSgemm
+                    (
+                        m_cublasHandle,
+                        CUBLAS_OP_N,
+                        CUBLAS_OP_T,
+                        (int)dx_buf.GetFrameSize(),
+                        (int)dx_buf.GetNodeSize(),
+                        (int)dy_buf.GetNodeSize(),
+                        &alpha,
+                        (const float *)dy_ptr.GetAddr(),
+                        (int)(dy_buf.GetFrameStride() / sizeof(float)),
+                        (const float *)W_ptr.GetAddr(),
+                        (int)dx_buf.GetNodeSize(),
+                        &beta,
+                        (float *)dx_ptr.GetAddr(),
+                        (int)(dx_buf.GetFrameStride() / sizeof(float))
+                    ));
+            }
+
+            if ( !m_frozen ) {
+                auto dW_ptr = m_dW->LockDeviceMemory();
+                auto db_ptr = m_db->LockDeviceMemory();
+
+                bbcu_fp32_MatrixColwiseSum
+                    (
+                        (float const *)dy_ptr.GetAddr(),
+                        (float       *)db_ptr.GetAddr(),
+                        (int          )dy_buf.GetNodeSize(),
+                        (int          )dy_buf.GetFrameSize(),
+                        (int          )(dy_buf.GetFrameStride() / sizeof(float))
+                    );
+
+                beta = 1.0f;
+                BB_CUBLAS_SAFE_CALL(cublasSgemm
+                    (
+                        m_cublasHandle,
+                        CUBLAS_OP_T,
+                        CUBLAS_OP_N,
+                        (int)m_input_node_size,
+                        (int)dy_buf.GetNodeSize(),
+                        (int)dy_buf.GetFrameSize(),
+                        &alpha,
+                        (const float *)x_ptr.GetAddr(),
+                        (int)(x_buf.GetFrameStride() / sizeof(float)),
+                        (const float *)dy_ptr.GetAddr(),
+                        (int)(dy_buf.GetFrameStride() / sizeof(float)),
+                        &beta,
+                        (float *)dW_ptr.GetAddr(),
+                        (int)m_input_node_size
+                    ));
+            }
             
             return dx_buf;
         }
 #endif
 
         {
-            dx_buf.FillZero();
+            // node-major のまま演算 (書き込み先のノードで分担するので競合しない)
+            index_t dy_stride = dy_buf.GetFrameStride() / sizeof(T);
+            auto dy_ptr  = dy_buf.LockMemoryConst();
+            auto dy_addr = (T const *)dy_ptr.GetAddr();
+
+            // dx (入力ノード毎に独立)
+            if ( m_input_gradient ) {
+                index_t dx_stride = dx_buf.GetFrameStride() / sizeof(T);
+                auto dx_ptr  = dx_buf.LockMemory(true);
+                auto dx_addr = (T *)dx_ptr.GetAddr();
+
+                auto W_ptr  = lock_W_const();
+                auto W_addr = W_ptr.GetAddr();
+
+                #pragma omp parallel for
+                for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
+                    T *dx_vec = &dx_addr[input_node * dx_stride];
+                    for (index_t frame = 0; frame < frame_size; ++frame) {
+                        dx_vec[frame] = 0;
+                    }
+                    for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
+                        T const *dy_vec = &dy_addr[output_node * dy_stride];
+                        T        w      = W_addr[output_node * m_input_node_size + input_node];
+                        for (index_t frame = 0; frame < frame_size; ++frame) {
+                            dx_vec[frame] += w * dy_vec[frame];
+                        }
+                    }
+                }
+            }
 
-            auto x_ptr  = x_buf.LockConst<T>();
-            auto dy_ptr = dy_buf.LockConst<T>();
-            auto dx_ptr = dx_buf.Lock<T>();
-            auto W_ptr  = lock_W_const();
-            auto b_ptr  = lock_b_const();
-            auto dW_ptr = lock_dW();
-            auto db_ptr = lock_db();
+            // dW, db (出力ノード毎に独立)
+            if ( !m_frozen ) {
+                index_t x_stride = x_buf.GetFrameStride() / sizeof(T);
+                auto x_ptr  = x_buf.LockMemoryConst();
+                auto x_addr = (T const *)x_ptr.GetAddr();
 
-            #pragma omp parallel for
-            for (index_t frame = 0; frame < frame_size; ++frame) {
+                auto dW_ptr  = lock_dW();
+                auto db_ptr  = lock_db();
+                auto dW_addr = &dW_ptr[0];
+
+                #pragma omp parallel for
                 for (index_t output_node = 0; output_node < m_output_node_size; ++output_node) {
-                    auto grad = dy_ptr.Get(frame, output_node);
-                    db_ptr(output_node) += grad;
+                    T const *dy_vec = &dy_addr[output_node * dy_stride];
+                    T       *dW_vec = &dW_addr[output_node * m_input_node_size];
+
+                    T db = 0;
+                    for (index_t frame = 0; frame < frame_size; ++frame) {
+                        db += dy_vec[frame];
+                    }
+                    db_ptr(output_node) += db;
+
                     for (index_t input_node = 0; input_node < m_input_node_size; ++input_node) {
-                        dx_ptr.Add(frame, input_node, grad * W_ptr(output_node, input_node));
-                        dW_ptr(output_node, input_node) += grad * x_ptr.Get(frame, input_node);
+                        T const *x_vec = &x_addr[input_node * x_stride];
+                        T dw = 0;
+                        for (index_t frame = 0; frame < frame_size; ++frame) {
+                            dw += dy_vec[frame] * x_vec[frame];
+                        }
+                        dW_vec[input_node] += dw;
                     }
                 }
             }
@@ -11,21 +11,30 @@
 #pragma once
 
 
+#include <cstring>
+
 #include "bb/Manager.h"
 #include "bb/Activation.h"
+#include "bb/Philox.h"
 
 
 namespace bb {
 
 
 // Dropout
+//   マスクはカウンタベース乱数 (Philox) で (seed, step, node, frame) から決まるので保存せず、
+//   Backward では Forward と同じ step で作り直す
+//   フレームの 32 個分を 1 ワードのビットマスクとして生成して適用する
 template <typename FT = float, typename BT = float>
-class Dropout : public Activation<FT, BT>
+class Dropout : public Activation
 {
 protected:
     double                  m_rate = 0.5;
-    std::mt19937_64         m_mt;
-    Tensor_<std::int8_t>    m_mask;
+    bool                    m_per_element = false;  // false ならノード単位 (全フレーム共通)
+    std::uint32_t           m_key[2];
+    std::uint32_t           m_step = 0;             // 学習時の Forward 毎に進める
+    std::uint64_t           m_threshold = 0;        // 乱数がこれ以上なら保持
+    index_t                 m_frame_size = 0;
     
     bool                    m_host_only = false;
 
@@ -50,18 +59,175 @@ protected:
     }
 
 
+    // ノード単位のマスク
+    bool NodeKeep(index_t node) const
+    {
+        std::uint32_t ctr[4] = { 0, (std::uint32_t)node, m_step, 1 };
+        std::uint32_t out[4];
+        Philox4x32_10(ctr, m_key, out);
+        return out[0] >= m_threshold;
+    }
+
+    // フレーム group*32 ～ group*32+31 のマスク (bit=1 で保持)
+    //   フレーム f は counter {group*8 + f%8, node, step, 0} の出力 (f%32)/8 番目の値を使う
+    std::uint32_t ElementMask(index_t node, index_t group) const
+    {
+        if ( m_threshold == 0 )                    { return 0xffffffff; }
+        if ( m_threshold > (std::uint64_t)0xffffffff ) { return 0; }
+
+#ifdef __AVX2__
+        __m256i c[4];
+        c[0] = _mm256_add_epi32(_mm256_set1_epi32((int)(group * 8)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        c[1] = _mm256_set1_epi32((int)node);
+        c[2] = _mm256_set1_epi32((int)m_step);
+        c[3] = _mm256_setzero_si256();
+        Philox4x32_10_x8(c, m_key);
+
+        // 符号無し比較 u >= threshold  <=>  (u ^ 0x80000000) > ((threshold - 1) ^ 0x80000000)
+        __m256i sign = _mm256_set1_epi32((int)0x80000000);
+        __m256i th   = _mm256_set1_epi32((int)(((std::uint32_t)m_threshold - 1) ^ 0x80000000));
+        std::uint32_t mask = 0;
+        for ( int w = 0; w < 4; ++w ) {
+            __m256i keep = _mm256_cmpgt_epi32(_mm256_xor_si256(c[w], sign), th);
+            mask |= (std::uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(keep)) << (w * 8);
+        }
+        return mask;
+#else
+        std::uint32_t mask = 0;
+        for ( int l = 0; l < 8; ++l ) {
+            std::uint32_t ctr[4] = { (std::uint32_t)(group * 8 + l), (std::uint32_t)node, m_step, 0 };
+            std::uint32_t out[4];
+            Philox4x32_10(ctr, m_key, out);
+            for ( int w = 0; w < 4; ++w ) {
+                if ( out[w] >= m_threshold ) {
+                    mask |= ((std::uint32_t)1 << (w * 8 + l));
+                }
+            }
+        }
+        return mask;
+#endif
+    }
+
+    // マスクを掛ける (x と y は同じ形状)
+    template <typename Tp>
+    void ApplyMask(FrameBuffer const &x_buf, FrameBuffer &y_buf)
+    {
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t node_size  = x_buf.GetNodeSize();
+        index_t group_size = (frame_size + 31) / 32;
+
+#ifdef __AVX2__
+        if ( DataType<Tp>::type == BB_TYPE_FP32 ) {
+            // ビュー入力は参照元のストライドのままなので、x と y のストライドは別に扱う
+            index_t x_stride = x_buf.GetFrameStride() / sizeof(float);
+            index_t y_stride = y_buf.GetFrameStride() / sizeof(float);
+            auto x_ptr  = x_buf.LockMemoryConst();
+            auto y_ptr  = y_buf.LockMemory(true);
+            auto x_addr = (float const *)x_ptr.GetAddr();
+            auto y_addr = (float       *)y_ptr.GetAddr();
+
+            __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+            #pragma omp parallel for
+            for (index_t node = 0; node < node_size; ++node) {
+                auto x_vec = &x_addr[node * x_stride];
+                auto y_vec = &y_addr[node * y_stride];
+
+                if ( !m_per_element ) {
+                    if ( NodeKeep(node) ) {
+                        memcpy(y_vec, x_vec, frame_size * sizeof(float));
+                    }
+                    else {
+                        memset(y_vec, 0, frame_size * sizeof(float));
+                    }
+                    continue;
+                }
+
+                for (index_t group = 0; group < group_size; ++group) {
+                    std::uint32_t mask  = ElementMask(node, group);
+                    index_t       end   = std::min(group * 32 + 32, frame_size);
+                    index_t       frame = group * 32;
+                    for ( ; frame + 8 <= end; frame += 8) {
+                        __m256i bits = _mm256_set1_epi32((int)((mask >> (frame % 32)) & 0xff));
+                        __m256  keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(bits, sel), sel));
+                        _mm256_storeu_ps(&y_vec[frame], _mm256_and_ps(_mm256_loadu_ps(&x_vec[frame]), keep));
+                    }
+                    for ( ; frame < end; ++frame) {
+                        y_vec[frame] = ((mask >> (frame % 32)) & 1) ? x_vec[frame] : 0.0f;
+                    }
+                }
+            }
+            return;
+        }
+#endif
+
+        auto x_ptr = x_buf.LockConst<Tp>();
+        auto y_ptr = y_buf.Lock<Tp>(true);
+
+        #pragma omp parallel for
+        for (index_t node = 0; node < node_size; ++node) {
+            bool node_keep = m_per_element || NodeKeep(node);
+            for (index_t group = 0; group < group_size; ++group) {
+                std::uint32_t mask = m_per_element ? ElementMask(node, group) : 0xffffffff;
+                for (index_t frame = group * 32; frame < std::min(group * 32 + 32, frame_size); ++frame) {
+                    if ( node_keep && ((mask >> (frame % 32)) & 1) ) {
+                        y_ptr.Set(frame, node, x_ptr.Get(frame, node));
+                    }
+                    else {
+                        y_ptr.Set(frame, node, (Tp)0);
+                    }
+                }
+            }
+        }
+    }
+
 public:
-    static std::shared_ptr<Dropout> Create(double rate=0.5, std::uint64_t seed=1)
+    /**
+     * @brief  生成
+     * @param  rate        落とす割合
+     * @param  seed        乱数の種
+     * @param  per_element true ならフレーム毎(要素毎)、false ならノード単位でマスクする
+     */
+    static std::shared_ptr<Dropout> Create(double rate=0.5, std::uint64_t seed=1, bool per_element=false)
     {
         auto self = std::shared_ptr<Dropout>(new Dropout);
-        self->m_rate = rate;
-        self->m_mt.seed(seed);
+        self->m_rate        = rate;
+        self->m_per_element = per_element;
+        self->m_key[0]      = (std::uint32_t)(seed >> 0);
+        self->m_key[1]      = (std::uint32_t)(seed >> 32);
         return self;
     }
 
     ~Dropout() {}
 
     std::string GetClassName(void) const { return "Dropout"; }
+
+    /**
+     * @brief  直前の学習時 Forward のマスク
+     * @return 保持した要素が 1 の Bit 型 FrameBuffer
+     */
+    FrameBuffer GetMask(void) const
+    {
+        FrameBuffer mask_buf(m_frame_size, m_y_buf.GetShape(), BB_TYPE_BIT);
+        mask_buf.FillZero();
+
+        index_t node_size  = mask_buf.GetNodeSize();
+        index_t group_size = (m_frame_size + 31) / 32;
+
+        auto ptr  = mask_buf.LockMemory();
+        auto addr = (std::uint8_t *)ptr.GetAddr();
+        for (index_t node = 0; node < node_size; ++node) {
+            auto mask_vec = (std::uint32_t *)(addr + node * mask_buf.GetFrameStride());
+            for (index_t group = 0; group < group_size; ++group) {
+                std::uint32_t mask = m_per_element ? ElementMask(node, group) : (NodeKeep(node) ? 0xffffffff : 0);
+                if ( group * 32 + 32 > m_frame_size ) {
+                    mask &= (std::uint32_t)(((std::uint64_t)1 << (m_frame_size % 32)) - 1);
+                }
+                mask_vec[group] = mask;
+            }
+        }
+        return mask_buf;
+    }
     
     
     // ノード単位でのForward計算
@@ -85,38 +251,23 @@ public:
         // 戻り値のサイズ設定
         m_y_buf.ResizeLike(x_buf);
 
-        m_mask.Resize(x_buf.GetNodeSize());
-
         {
             index_t frame_size = x_buf.GetFrameSize();
             index_t node_size  = x_buf.GetNodeSize();
 
-            auto x_ptr = x_buf.LockConst<FT>();
-            auto y_ptr = m_y_buf.Lock<FT>(true);
-
             if (train) {
-                // generate mask
-                auto mask_ptr = m_mask.Lock(true);
-                std::uniform_real_distribution<double> dist(0.0, 1.0);
-                for (index_t node = 0; node < node_size; ++node) {
-                    mask_ptr[node] = (dist(m_mt) > m_rate) ? 0xff : 0;
-                }
+                // マスクは step を進めて乱数から生成
+                double th = m_rate * 4294967296.0;
+                m_threshold  = (std::uint64_t)std::min(4294967296.0, std::max(0.0, th));
+                m_frame_size = frame_size;
+                ++m_step;
 
-                #pragma omp parallel for
-                for (index_t node = 0; node < node_size; ++node) {
-                    if (mask_ptr[node] != 0) {
-                        for (index_t frame = 0; frame < frame_size; ++frame) {
-                            y_ptr.Set(frame, node, x_ptr.Get(frame, node));
-                        }
-                    }
-                    else {
-                        for (index_t frame = 0; frame < frame_size; ++frame) {
-                            y_ptr.Set(frame, node, (FT)0);
-                        }
-                    }
-                }
+                ApplyMask<FT>(x_buf, m_y_buf);
             }
             else {
+                auto x_ptr = x_buf.LockConst<FT>();
+                auto y_ptr = m_y_buf.Lock<FT>(true);
+
                 #pragma omp parallel for
                 for (index_t node = 0; node < node_size; ++node) {
                     for (index_t frame = 0; frame < frame_size; ++frame) {
@@ -140,33 +291,15 @@ public:
     {
         BB_ASSERT(dy_buf.GetType() == DataType<BT>::type);
 
+        BB_ASSERT(dy_buf.GetFrameSize() == m_frame_size);
+
         // 戻り値のサイズ設定
         m_dx_buf.ResizeLike(dy_buf);
 
-        {
-            index_t frame_size = m_dx_buf.GetFrameSize();
-            index_t node_size = m_dx_buf.GetNodeSize();
-            
-            auto dy_ptr = dy_buf.LockConst<BT>();
-            auto dx_ptr = m_dx_buf.Lock<BT>(true);
-            auto mask_ptr = m_mask.LockConst();
+        // Forward と同じ step のマスクを作り直して掛ける
+        ApplyMask<BT>(dy_buf, m_dx_buf);
 
-            #pragma omp parallel for
-            for (index_t node = 0; node < node_size; ++node) {
-                if ( mask_ptr[node] != 0 ) {
-                    for (index_t frame = 0; frame < frame_size; ++frame) {
-                        dx_ptr.Set(frame, node, dy_ptr.Get(frame, node));
-                    }
-                }
-                else {
-                    for (index_t frame = 0; frame < frame_size; ++frame) {
-                        dx_ptr.Set(frame, node, 0);
-                    }
-                }
-            }
-
-            return m_dx_buf;
-        }
+        return m_dx_buf;
     }
 };
 
@@ -18,6 +18,7 @@
 
 #include "bb/Sequential.h"
 #include "bb/LutLayer.h"
+#include "bb/LutNetlist.h"
 #include "bb/LoweringConvolution.h"
 #include "bb/MaxPooling.h"
 
@@ -280,6 +281,29 @@ void ExportVerilog_LutLayers(std::ostream& os, std::string module_name, std::sha
 
 
 
+// LUT-Network 基本レイヤーの直列接続をネットリスト最適化してから出力
+//   レイヤー毎のサブモジュールには分けず、register_depth 段の LUT 毎に FF を置いた
+//   1つのモジュールを出力する(ポート構成は ExportVerilog_LutLayers と同じ)
+template <typename FT = Bit, typename BT = float>
+void ExportVerilog_LutLayersOptimized(std::ostream& os, std::string module_name, std::vector< std::shared_ptr< LutLayer<FT, BT> > > layers, index_t register_depth = 1)
+{
+    auto netlist = LutNetlist::Create<FT, BT>(layers);
+    netlist->Optimize();
+    netlist->ExportVerilog(os, module_name, register_depth);
+}
+
+
+// LUT-Network 基本レイヤーの直列接続をネットリスト最適化してから出力
+template <typename FT = Bit, typename BT = float>
+void ExportVerilog_LutLayersOptimized(std::ostream& os, std::string module_name, std::shared_ptr<bb::Sequential> net, index_t register_depth = 1)
+{
+    auto netlist = LutNetlist::Create<FT, BT>(net);
+    netlist->Optimize();
+    netlist->ExportVerilog(os, module_name, register_depth);
+}
+
+
+
 // Convolutionモジュールの出力
 inline void ExportVerilog_LutConvolutionModule(std::ostream& os, std::string module_name, std::string mlp_name, int in_c, int out_c, int n, int m)
 {
@@ -88,6 +88,28 @@ public:
     }
     
 
+    // 出力ノードの並べ替え (新しい i 番目 = 元の order[i] 番目)
+    void PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        BB_ASSERT((index_t)order.size() == this->GetOutputNodeSize());
+        m_reverse_table_dirty = true;
+        Tensor_PermuteOuter(m_input_table, order);
+    }
+
+    // 入力ノード番号の付け替え (元の入力 i は input_map[i] に移る)
+    void RemapInputNode(std::vector<index_t> const &input_map)
+    {
+        BB_ASSERT((index_t)input_map.size() == this->GetInputNodeSize());
+        auto ptr = Lock_InputTable();
+        auto output_node_size = this->GetOutputNodeSize();
+        for ( index_t node = 0; node < output_node_size; ++node ) {
+            for ( index_t i = 0; i < N; ++i ) {
+                ptr(node, i) = (IndexType)input_map[ptr(node, i)];
+            }
+        }
+    }
+
+
     // Lock
     auto Lock_InputTable(void)
     {
@@ -19,6 +19,7 @@
 
 #include "bb/DataType.h"
 #include "bb/Tensor.h"
+#include "bb/BitTranspose.h"
 
 
 namespace bb {
@@ -46,6 +47,101 @@ namespace bb {
 
 
 
+// -------------------------------------
+//  型固定のアクセス用ビュー
+// -------------------------------------
+
+// ロック済みのメモリに型を固定して直接アクセスするビュー
+//   先頭アドレスとストライドだけを保持するので、要素アクセスはポインタ演算だけになる
+//   ロックは取得元の Ptr が保持しているので、Ptr より長く使わないこと
+template <typename Tp>
+class FrameView
+{
+protected:
+    std::uint8_t    *m_addr;
+    index_t         m_frame_stride;
+    index_t         m_frame_size;
+    index_t         m_node_size;
+
+public:
+    FrameView(void *addr, index_t frame_stride, index_t frame_size, index_t node_size)
+    {
+        m_addr         = (std::uint8_t *)addr;
+        m_frame_stride = frame_stride;
+        m_frame_size   = frame_size;
+        m_node_size    = node_size;
+    }
+
+    inline index_t GetFrameSize(void)   const { return m_frame_size; }
+    inline index_t GetNodeSize(void)    const { return m_node_size; }
+    inline index_t GetFrameStride(void) const { return m_frame_stride; }
+
+    // ノードの先頭 (Bit 型の場合はバイト単位のアドレスとして扱うこと)
+    inline Tp *GetRow(index_t node) const
+    {
+        return (Tp *)(m_addr + m_frame_stride * node);
+    }
+
+    inline Tp Get(index_t frame, index_t node) const
+    {
+        return DataType_Read<Tp>(GetRow(node), frame);
+    }
+
+    inline void Set(index_t frame, index_t node, Tp value) const
+    {
+        DataType_Write<Tp>(GetRow(node), frame, value);
+    }
+
+    inline void Add(index_t frame, index_t node, Tp value) const
+    {
+        DataType_Add<Tp>(GetRow(node), frame, value);
+    }
+};
+
+// const 版
+template <typename Tp>
+class FrameConstView
+{
+protected:
+    std::uint8_t const  *m_addr;
+    index_t             m_frame_stride;
+    index_t             m_frame_size;
+    index_t             m_node_size;
+
+public:
+    FrameConstView(void const *addr, index_t frame_stride, index_t frame_size, index_t node_size)
+    {
+        m_addr         = (std::uint8_t const *)addr;
+        m_frame_stride = frame_stride;
+        m_frame_size   = frame_size;
+        m_node_size    = node_size;
+    }
+
+    FrameConstView(FrameView<Tp> const &view)
+    {
+        m_addr         = (std::uint8_t const *)view.GetRow(0);
+        m_frame_stride = view.GetFrameStride();
+        m_frame_size   = view.GetFrameSize();
+        m_node_size    = view.GetNodeSize();
+    }
+
+    inline index_t GetFrameSize(void)   const { return m_frame_size; }
+    inline index_t GetNodeSize(void)    const { return m_node_size; }
+    inline index_t GetFrameStride(void) const { return m_frame_stride; }
+
+    // ノードの先頭 (Bit 型の場合はバイト単位のアドレスとして扱うこと)
+    inline Tp const *GetRow(index_t node) const
+    {
+        return (Tp const *)(m_addr + m_frame_stride * node);
+    }
+
+    inline Tp Get(index_t frame, index_t node) const
+    {
+        return DataType_Read<Tp>(GetRow(node), frame);
+    }
+};
+
+
 // -------------------------------------
 //  アクセス用ポインタクラス定義
 // -------------------------------------
@@ -130,6 +226,11 @@ public:
         return (Tp *)GetNodeBaseAddr(node);
     }
 
+    inline FrameConstView<Tp> GetView(void) const
+    {
+        return FrameConstView<Tp>(m_ptr.GetAddr(), m_buf->GetFrameStride(), m_buf->GetFrameSize(), m_buf->GetNodeSize());
+    }
+
     inline Tp Get(index_t frame, index_t node) const
     {
         return ReadValue(GetNodeBaseAddr(node),  frame);
@@ -220,6 +321,11 @@ public:
         return (Tp *)GetNodeBaseAddr(node);
     }
 
+    inline FrameView<Tp> GetView(void)
+    {
+        return FrameView<Tp>(m_ptr.GetAddr(), m_buf->GetFrameStride(), m_buf->GetFrameSize(), m_buf->GetNodeSize());
+    }
+
     inline void Set(index_t frame, index_t node, Tp value)
     {
         return WriteValue(GetNodeBaseAddr(node),  frame, value);
@@ -276,6 +382,9 @@ protected:
     index_t                 m_node_size = 0;
     std::vector<index_t>    m_node_shape;
 
+    bool                    m_view = false;         // 他のバッファのメモリを参照するビューか
+    index_t                 m_byte_offset = 0;      // ビューの場合の m_tensor 先頭からのオフセット
+
 public:
     /**
       * @brief  デフォルトコンストラクタ
@@ -330,6 +439,8 @@ public:
         m_frame_stride  = buf.m_frame_stride;
         m_node_size     = buf.m_node_size;
         m_node_shape    = buf.m_node_shape;
+        m_view          = buf.m_view;
+        m_byte_offset   = buf.m_byte_offset;
 
         return *this;
     }
@@ -341,6 +452,20 @@ public:
      */
     FrameBuffer Clone(void) const
     {
+        // ビューは参照範囲だけを詰めてコピーする
+        if ( m_view ) {
+            FrameBuffer clone_buf(m_frame_size, m_node_shape, m_data_type, IsHostOnly());
+            auto src_ptr = LockMemoryConst();
+            auto dst_ptr = clone_buf.LockMemory(true);
+            auto src_addr = (std::uint8_t const *)src_ptr.GetAddr();
+            auto dst_addr = (std::uint8_t       *)dst_ptr.GetAddr();
+            #pragma omp parallel for
+            for (index_t node = 0; node < m_node_size; ++node) {
+                memcpy(dst_addr + clone_buf.m_frame_stride * node, src_addr + m_frame_stride * node, clone_buf.m_frame_stride);
+            }
+            return clone_buf;
+        }
+
         FrameBuffer clone_buf;
 
         clone_buf.m_tensor       = m_tensor.Clone();
@@ -353,6 +478,58 @@ public:
         return clone_buf;
     }
 
+    /**
+     * @brief  型変換
+     * @detail 指定した型に変換したコピーを返す
+     *         FP32 と FP16/BF16 の間は AVX2 で一括変換する
+     * @param  type 変換後の型
+     * @return 変換したバッファ
+     */
+    FrameBuffer ConvertType(int type) const
+    {
+        if ( type == m_data_type ) {
+            return Clone();
+        }
+
+        FrameBuffer dst_buf(m_frame_size, m_node_shape, type, IsHostOnly());
+
+        // FP32 <-> FP16/BF16
+        if ( (m_data_type == BB_TYPE_FP32 && (type == BB_TYPE_FP16 || type == BB_TYPE_BF16))
+                || (type == BB_TYPE_FP32 && (m_data_type == BB_TYPE_FP16 || m_data_type == BB_TYPE_BF16)) ) {
+            auto src_ptr  = LockMemoryConst();
+            auto dst_ptr  = dst_buf.LockMemory(true);
+            auto src_addr = (std::uint8_t const *)src_ptr.GetAddr();
+            auto dst_addr = (std::uint8_t       *)dst_ptr.GetAddr();
+            auto src_type = m_data_type;
+            auto frame_size   = m_frame_size;
+            auto src_stride   = m_frame_stride;
+            auto dst_stride   = dst_buf.m_frame_stride;
+
+            #pragma omp parallel for
+            for (index_t node = 0; node < m_node_size; ++node) {
+                auto src = src_addr + src_stride * node;
+                auto dst = dst_addr + dst_stride * node;
+                switch ( type ) {
+                case BB_TYPE_FP16: DataType_Convert((float const *)src, (Float16  *)dst, frame_size); break;
+                case BB_TYPE_BF16: DataType_Convert((float const *)src, (BFloat16 *)dst, frame_size); break;
+                default:
+                    if ( src_type == BB_TYPE_FP16 ) { DataType_Convert((Float16  const *)src, (float *)dst, frame_size); }
+                    else                            { DataType_Convert((BFloat16 const *)src, (float *)dst, frame_size); }
+                    break;
+                }
+            }
+            return dst_buf;
+        }
+
+        // 他は1要素ずつ
+        for (index_t node = 0; node < m_node_size; ++node) {
+            for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                dst_buf.SetFP64(frame, node, GetFP64(frame, node));
+            }
+        }
+        return dst_buf;
+    }
+
     bool IsHostOnly(void) const
     {
         return m_tensor.IsHostOnly();
@@ -379,6 +556,13 @@ public:
      */
     void Resize(index_t frame_size, indices_t shape, int data_type)
     {
+        // ビューは参照元と切り離して新たに確保する
+        if ( m_view ) {
+            m_tensor      = Tensor(IsHostOnly());
+            m_view        = false;
+            m_byte_offset = 0;
+        }
+
         m_data_type    = data_type;
         m_frame_size   = frame_size;
         m_frame_stride = ((frame_size * DataType_GetBitSize(data_type) + 255) / 256) * (256 / 8);        // frame軸は256bit境界にあわせる(SIMD命令用)
@@ -403,6 +587,19 @@ public:
 
         // メモリ確保
         m_tensor.Resize(tensor_shape, tensor_type);
+
+        // ノード毎の行を、それを処理するカーネルと同じ OpenMP の static 分担で先に触れて
+        // NUMA ノードへの配置を決める (ノードループは omp parallel for schedule(static))
+        if ( Manager::IsNumaFirstTouch() && m_node_size > 0 && m_frame_stride > 0 ) {
+            auto ptr  = LockMemory(true);
+            auto addr = (std::uint8_t *)ptr.GetAddr();
+            index_t node_size    = m_node_size;
+            index_t frame_stride = m_frame_stride;
+            #pragma omp parallel for schedule(static)
+            for ( index_t node = 0; node < node_size; ++node ) {
+                memset(addr + node * frame_stride, 0, frame_stride);
+            }
+        }
     }
 
 
@@ -498,6 +695,8 @@ public:
 
         switch ( GetType() ) {
         case BB_TYPE_BIT:    CopyTo_<Bit     >(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
+        case BB_TYPE_FP16:   CopyTo_<Float16 >(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
+        case BB_TYPE_BF16:   CopyTo_<BFloat16>(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
         case BB_TYPE_FP32:   CopyTo_<float   >(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
         case BB_TYPE_FP64:   CopyTo_<double  >(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
         case BB_TYPE_INT8:   CopyTo_<int8_t  >(dst, frame_size, src_frame_offset, dst_frame_offset, node_size, src_node_offset, dst_node_offset); return;
@@ -521,6 +720,11 @@ public:
     
     void Save(std::ostream &os) const 
     {
+        if ( m_view ) {
+            Clone().Save(os);
+            return;
+        }
+
         os.write((char const *)&m_data_type, sizeof(m_data_type));
         SaveIndex(os, m_frame_size);
         SaveIndex(os, m_frame_stride);
@@ -531,6 +735,12 @@ public:
 
     void Load(std::istream &is)
     {
+        if ( m_view ) {
+            m_tensor      = Tensor(IsHostOnly());
+            m_view        = false;
+            m_byte_offset = 0;
+        }
+
         is.read((char *)&m_data_type, sizeof(m_data_type));
         m_frame_size   = LoadIndex(is); 
         m_frame_stride = LoadIndex(is);
@@ -555,6 +765,10 @@ public:
     template <class Archive>
     void serialize(Archive& archive, std::uint32_t const version)
     {
+        if ( m_view ) {
+            *this = Clone();
+        }
+
         archive(cereal::make_nvp("data_type",    m_data_type));
         archive(cereal::make_nvp("frame_size",   m_frame_size));
         archive(cereal::make_nvp("frame_stride", m_frame_stride));
@@ -601,6 +815,11 @@ public:
         BB_ASSERT(total == m_node_size);
 
         m_node_shape = shape;
+
+        // ビューの m_tensor は参照元の形状のまま
+        if ( m_view ) {
+            return;
+        }
         
         std::vector<index_t> tensor_shape;
         tensor_shape.push_back(-1);
@@ -622,6 +841,17 @@ public:
      */
     void FillZero(void)
     {
+        if ( m_view ) {
+            index_t byte_size = (m_frame_size * DataType_GetBitSize(m_data_type) + 7) / 8;
+            auto ptr  = LockMemory();
+            auto addr = (std::uint8_t *)ptr.GetAddr();
+            #pragma omp parallel for
+            for (index_t node = 0; node < m_node_size; ++node) {
+                memset(addr + m_frame_stride * node, 0, byte_size);
+            }
+            return;
+        }
+
         m_tensor.FillZero();
     }
 
@@ -638,7 +868,7 @@ public:
     // debug
     inline bool IsValidValue(void) const
     {
-        return m_tensor.IsValidValue();
+        return GetCompactTensor_().IsValidValue();
     }
 
     // debug
@@ -662,10 +892,30 @@ public:
 
     index_t GetFrameStride(void)  const { return m_frame_stride; }
 
-    Memory::Ptr         LockMemory(bool new_buf=false) const    { return m_tensor.LockMemory(new_buf); }
-    Memory::ConstPtr    LockMemoryConst(void) const             { return m_tensor.LockMemoryConst(); }
-    Memory::DevPtr      LockDeviceMemory(bool new_buf=false) const { return m_tensor.LockDeviceMemory(new_buf); }
-    Memory::DevConstPtr LockDeviceMemoryConst(void) const          { return m_tensor.LockDeviceMemoryConst(); }
+    // ビューの場合は参照範囲の先頭を指す (参照範囲外を壊さないよう new_buf は無視する)
+    Memory::Ptr LockMemory(bool new_buf=false) const
+    {
+        if ( m_view ) { return m_tensor.LockMemory(false).Offset(m_byte_offset); }
+        return m_tensor.LockMemory(new_buf);
+    }
+
+    Memory::ConstPtr LockMemoryConst(void) const
+    {
+        if ( m_view ) { return m_tensor.LockMemoryConst().Offset(m_byte_offset); }
+        return m_tensor.LockMemoryConst();
+    }
+
+    Memory::DevPtr LockDeviceMemory(bool new_buf=false) const
+    {
+        if ( m_view ) { return m_tensor.LockDeviceMemory(false).Offset(m_byte_offset); }
+        return m_tensor.LockDeviceMemory(new_buf);
+    }
+
+    Memory::DevConstPtr LockDeviceMemoryConst(void) const
+    {
+        if ( m_view ) { return m_tensor.LockDeviceMemoryConst().Offset(m_byte_offset); }
+        return m_tensor.LockDeviceMemoryConst();
+    }
 
     // 型指定アクセス
     template <typename MemTp, typename ValueTp>
@@ -783,10 +1033,12 @@ protected:
     }
 
     template<typename Tp>
-    Tp ReadValue(void *base, index_t frame) const
+    Tp ReadValue(void const *base, index_t frame) const
     {
         switch (m_data_type) {
         case BB_TYPE_BIT:    return static_cast<Tp>(DataType_Read<Bit>         (base, frame));  break;
+        case BB_TYPE_FP16:   return static_cast<Tp>((float)DataType_Read<Float16> (base, frame));  break;
+        case BB_TYPE_BF16:   return static_cast<Tp>((float)DataType_Read<BFloat16>(base, frame));  break;
         case BB_TYPE_FP32:   return static_cast<Tp>(DataType_Read<float>       (base, frame));  break;
         case BB_TYPE_FP64:   return static_cast<Tp>(DataType_Read<double>      (base, frame));  break;
         case BB_TYPE_INT8:   return static_cast<Tp>(DataType_Read<std::int8_t> (base, frame));  break;
@@ -807,6 +1059,8 @@ protected:
     {
         switch (m_data_type) {
         case BB_TYPE_BIT:    DataType_Write<Bit>         (base, frame, static_cast<Bit>     (value));   break;
+        case BB_TYPE_FP16:   DataType_Write<Float16>     (base, frame, Float16 ((float)value));      break;
+        case BB_TYPE_BF16:   DataType_Write<BFloat16>    (base, frame, BFloat16((float)value));      break;
         case BB_TYPE_FP32:   DataType_Write<float>       (base, frame, static_cast<float>   (value));   break;
         case BB_TYPE_FP64:   DataType_Write<double>      (base, frame, static_cast<double>  (value));   break;
         case BB_TYPE_INT8:   DataType_Write<std::int8_t> (base, frame, static_cast<int8_t>  (value));   break;
@@ -826,6 +1080,8 @@ protected:
     {
         switch (m_data_type) {
         case BB_TYPE_BIT:    DataType_Add<Bit>         (base, frame, static_cast<Bit>     (value)); break;
+        case BB_TYPE_FP16:   DataType_Add<Float16>     (base, frame, Float16 ((float)value));    break;
+        case BB_TYPE_BF16:   DataType_Add<BFloat16>    (base, frame, BFloat16((float)value));    break;
         case BB_TYPE_FP32:   DataType_Add<float>       (base, frame, static_cast<float>   (value)); break;
         case BB_TYPE_FP64:   DataType_Add<double>      (base, frame, static_cast<double>  (value)); break;
         case BB_TYPE_INT8:   DataType_Add<std::int8_t> (base, frame, static_cast<int8_t>  (value)); break;
@@ -844,6 +1100,8 @@ protected:
 public:
 
     friend FrameBufferConstPtr_<Bit      const, FrameBuffer const, Memory::ConstPtr>;
+    friend FrameBufferConstPtr_<Float16  const, FrameBuffer const, Memory::ConstPtr>;
+    friend FrameBufferConstPtr_<BFloat16 const, FrameBuffer const, Memory::ConstPtr>;
     friend FrameBufferConstPtr_<float    const, FrameBuffer const, Memory::ConstPtr>;
     friend FrameBufferConstPtr_<double   const, FrameBuffer const, Memory::ConstPtr>;
     friend FrameBufferConstPtr_<int8_t   const, FrameBuffer const, Memory::ConstPtr>;
@@ -856,6 +1114,8 @@ public:
     friend FrameBufferConstPtr_<uint64_t const, FrameBuffer const, Memory::ConstPtr>;
 
     friend FrameBufferConstPtr_<Bit     , FrameBuffer, Memory::Ptr>;
+    friend FrameBufferConstPtr_<Float16 , FrameBuffer, Memory::Ptr>;
+    friend FrameBufferConstPtr_<BFloat16, FrameBuffer, Memory::Ptr>;
     friend FrameBufferConstPtr_<float   , FrameBuffer, Memory::Ptr>;
     friend FrameBufferConstPtr_<double  , FrameBuffer, Memory::Ptr>;
     friend FrameBufferConstPtr_<int8_t  , FrameBuffer, Memory::Ptr>;
@@ -868,6 +1128,8 @@ public:
     friend FrameBufferConstPtr_<uint64_t, FrameBuffer, Memory::Ptr>;
 
     friend FrameBufferPtr_<Bit     , FrameBuffer, Memory::Ptr>;
+    friend FrameBufferPtr_<Float16 , FrameBuffer, Memory::Ptr>;
+    friend FrameBufferPtr_<BFloat16, FrameBuffer, Memory::Ptr>;
     friend FrameBufferPtr_<float   , FrameBuffer, Memory::Ptr>;
     friend FrameBufferPtr_<double  , FrameBuffer, Memory::Ptr>;
     friend FrameBufferPtr_<int8_t  , FrameBuffer, Memory::Ptr>;
@@ -1047,6 +1309,18 @@ public:
     void SetVector(std::vector< std::vector<Tp> > const &data)
     {
         BB_ASSERT(data.size() == (size_t)m_frame_size);
+
+        // Bit 型へはタイル単位のビット行列転置で一括設定
+        if ( m_data_type == BB_TYPE_BIT ) {
+            for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                BB_ASSERT(data[frame].size() == (size_t)m_node_size);
+            }
+            auto ptr = LockMemory(true);
+            BitTranspose_FromFrameMajor<Tp>([&](index_t frame) { return data[frame].data(); },
+                    m_frame_size, m_node_size, ptr.GetAddr(), m_frame_stride);
+            return;
+        }
+
         for (index_t frame = 0; frame < m_frame_size; ++frame) {
             BB_ASSERT(data[frame].size() == (size_t)m_node_size);
             for (index_t node = 0; node < m_node_size; ++node) {
@@ -1058,9 +1332,21 @@ public:
     template<typename Tp>
     void SetVector(std::vector< std::vector<Tp> > const &data, index_t offset)
     {
-        BB_ASSERT(GetType() == DataType<Tp>::type);
         BB_ASSERT(offset + m_frame_size <= (index_t)data.size() );
 
+        // Bit 型へはタイル単位のビット行列転置で一括設定
+        if ( m_data_type == BB_TYPE_BIT ) {
+            for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                BB_ASSERT(data[frame + offset].size() == (size_t)m_node_size);
+            }
+            auto ptr = LockMemory(true);
+            BitTranspose_FromFrameMajor<Tp>([&](index_t frame) { return data[frame + offset].data(); },
+                    m_frame_size, m_node_size, ptr.GetAddr(), m_frame_stride);
+            return;
+        }
+
+        BB_ASSERT(GetType() == DataType<Tp>::type);
+
         auto ptr = Lock<Tp>();
         for (index_t frame = 0; frame < m_frame_size; ++frame) {
             BB_ASSERT(data[frame].size() == (size_t)m_node_size);
@@ -1070,6 +1356,108 @@ public:
         }
     }
 
+    /**
+     * @brief  連続メモリからの一括設定
+     * @detail data は frame 毎に node_size 個の値が並んだ配列(numpy の C 配列と同じ並び)
+     *         バッファの型と異なる場合は値を変換し、Bit 型へは2値化して格納する
+     * @param  data 先頭フレームのアドレス
+     */
+    template<typename Tp>
+    void SetArray(Tp const *data)
+    {
+        if ( m_data_type == BB_TYPE_BIT ) {
+            auto ptr = LockMemory(true);
+            BitTranspose_FromFrameMajor<Tp>([&](index_t frame) { return data + frame * m_node_size; },
+                    m_frame_size, m_node_size, ptr.GetAddr(), m_frame_stride);
+            return;
+        }
+
+        if ( m_data_type != DataType<Tp>::type ) {
+            // 型が異なる場合は SetValue と同じく値を変換して格納
+            auto ptr  = LockMemory();
+            auto addr = ptr.GetAddr();
+            #pragma omp parallel for
+            for (index_t node = 0; node < m_node_size; ++node) {
+                auto base = GetNodeBaseAddr(addr, node);
+                for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                    WriteValue<Tp>(base, frame, data[frame * m_node_size + node]);
+                }
+            }
+            return;
+        }
+
+        auto ptr = Lock<Tp>();
+        #pragma omp parallel for
+        for (index_t node = 0; node < m_node_size; ++node) {
+            for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                ptr.Set(frame, node, data[frame * m_node_size + node]);
+            }
+        }
+    }
+
+    /**
+     * @brief  連続メモリへの一括取得
+     * @detail SetArray と同じ並びで書き出す
+     * @param  data 書き出し先(frame_size * node_size 個)
+     */
+    template<typename Tp>
+    void GetArray(Tp *data) const
+    {
+        if ( m_data_type == BB_TYPE_BIT ) {
+            auto ptr = LockMemoryConst();
+            BitTranspose_ToFrameMajor<Tp>([&](index_t frame) { return data + frame * m_node_size; },
+                    m_frame_size, m_node_size, ptr.GetAddr(), m_frame_stride);
+            return;
+        }
+
+        if ( m_data_type != DataType<Tp>::type ) {
+            // 型が異なる場合は GetValue と同じく値を変換して取得
+            auto ptr  = LockMemoryConst();
+            auto addr = ptr.GetAddr();
+            #pragma omp parallel for
+            for (index_t node = 0; node < m_node_size; ++node) {
+                auto base = GetNodeBaseAddr(addr, node);
+                for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                    data[frame * m_node_size + node] = ReadValue<Tp>(base, frame);
+                }
+            }
+            return;
+        }
+
+        auto ptr = LockConst<Tp>();
+        #pragma omp parallel for
+        for (index_t node = 0; node < m_node_size; ++node) {
+            for (index_t frame = 0; frame < m_frame_size; ++frame) {
+                data[frame * m_node_size + node] = ptr.Get(frame, node);
+            }
+        }
+    }
+
+    /**
+     * @brief  フレーム毎の vector として一括取得
+     * @detail SetVector の逆で、Bit 型は 0 か 1 の値になる
+     * @return [frame][node] の値
+     */
+    template<typename Tp>
+    std::vector< std::vector<Tp> > GetVector(void) const
+    {
+        std::vector< std::vector<Tp> > data(m_frame_size, std::vector<Tp>(m_node_size));
+
+        if ( m_data_type == BB_TYPE_BIT ) {
+            auto ptr = LockMemoryConst();
+            BitTranspose_ToFrameMajor<Tp>([&](index_t frame) { return data[frame].data(); },
+                    m_frame_size, m_node_size, ptr.GetAddr(), m_frame_stride);
+            return data;
+        }
+
+        for (index_t frame = 0; frame < m_frame_size; ++frame) {
+            for (index_t node = 0; node < m_node_size; ++node) {
+                data[frame][node] = GetValue<Tp>(frame, node);
+            }
+        }
+        return data;
+    }
+
     // テンソルの設定
 public:
     template<typename Tp>
@@ -1101,15 +1489,15 @@ public:
 
 
     // 部分切り出し
-    FrameBuffer GetRange(index_t start, index_t size)
+    FrameBuffer GetRange(index_t start, index_t size) const
     {
         BB_ASSERT(start >= 0 && start < m_frame_size);
-        BB_ASSERT(size >= 0 &&  size < m_frame_size - start);
+        BB_ASSERT(size >= 0 &&  size <= m_frame_size - start);
 
         FrameBuffer buf(size, m_node_shape, m_data_type);
 
-        auto src_ptr = m_tensor.LockMemoryConst();
-        auto dst_ptr = buf.m_tensor.LockMemory(true);
+        auto src_ptr = LockMemoryConst();
+        auto dst_ptr = buf.LockMemory(true);
         auto src_addr = (std::int8_t const *)src_ptr.GetAddr();
         auto dst_addr = (std::int8_t       *)dst_ptr.GetAddr();
 
@@ -1137,42 +1525,132 @@ public:
 
         return buf;
     }
-    
 
+    /**
+     * @brief  フレーム範囲のビューを作れるか
+     * @detail 先頭は 256bit 境界(SIMD命令のアライメント)、末尾は 256bit 境界か
+     *         バッファの末尾である必要がある (末尾の端数ワードを他のフレームと共有しないため)
+     * @param  start 先頭フレーム
+     * @param  size  フレーム数
+     * @return 作れるなら true
+     */
+    bool IsFrameRangeViewable(index_t start, index_t size) const
+    {
+        index_t bit_size = DataType_GetBitSize(m_data_type);
+        if ( start < 0 || size <= 0 || start + size > m_frame_size ) {
+            return false;
+        }
+        return (start * bit_size) % 256 == 0 && ((size * bit_size) % 256 == 0 || start + size == m_frame_size);
+    }
+
+    /**
+     * @brief  フレーム範囲のビュー
+     * @detail メモリをコピーせず、同じメモリの一部を参照するバッファを返す
+     *         書き込みは参照元にも反映される
+     *         フレームストライドは参照元のままなので、受け取る側は入出力のストライドを別に扱うこと
+     * @param  start 先頭フレーム
+     * @param  size  フレーム数
+     * @return ビュー
+     */
+    FrameBuffer GetFrameRangeView(index_t start, index_t size) const
+    {
+        BB_ASSERT(IsFrameRangeViewable(start, size));
+
+        FrameBuffer buf(*this);
+        buf.m_view         = true;
+        buf.m_byte_offset += start * DataType_GetBitSize(m_data_type) / 8;
+        buf.m_frame_size   = size;
+        return buf;
+    }
 
+    /**
+     * @brief  ノード範囲のビュー
+     * @detail メモリをコピーせず、同じメモリの一部を参照するバッファを返す
+     *         ビューの shape は1次元になる
+     * @param  start 先頭ノード
+     * @param  size  ノード数
+     * @return ビュー
+     */
+    FrameBuffer GetNodeRangeView(index_t start, index_t size) const
+    {
+        BB_ASSERT(start >= 0 && size > 0 && start + size <= m_node_size);
+
+        FrameBuffer buf(*this);
+        buf.m_view         = true;
+        buf.m_byte_offset += start * m_frame_stride;
+        buf.m_node_size    = size;
+        buf.m_node_shape   = indices_t({size});
+        return buf;
+    }
+
+    bool IsView(void) const { return m_view; }
+
+
+protected:
+    // 全体を一括で扱う演算用に、ビューは参照範囲を詰めたテンソルにする
+    Tensor GetCompactTensor_(void) const
+    {
+        return m_view ? Clone().m_tensor : m_tensor;
+    }
+
+    // テンソル全体への演算(ビューは詰めたコピーに演算して書き戻す)
+    template <class Func>
+    FrameBuffer& ApplyTensor_(Func func)
+    {
+        if ( !m_view ) {
+            func(m_tensor);
+            return *this;
+        }
+
+        auto tmp = Clone();
+        func(tmp.m_tensor);
+
+        auto src_ptr = tmp.LockMemoryConst();
+        auto dst_ptr = LockMemory();
+        auto src_addr = (std::uint8_t const *)src_ptr.GetAddr();
+        auto dst_addr = (std::uint8_t       *)dst_ptr.GetAddr();
+        index_t byte_size = (m_frame_size * DataType_GetBitSize(m_data_type) + 7) / 8;
+        #pragma omp parallel for
+        for (index_t node = 0; node < m_node_size; ++node) {
+            memcpy(dst_addr + m_frame_stride * node, src_addr + tmp.m_frame_stride * node, byte_size);
+        }
+        return *this;
+    }
+
+public:
 
     // -------------------------------------
     //  演算
     // -------------------------------------
 
-    inline FrameBuffer& operator+=(FrameBuffer src) { m_tensor += src.m_tensor; return *this; }
-    inline FrameBuffer& operator+=(double src)      { m_tensor += src; return *this; }
-    inline FrameBuffer& operator-=(FrameBuffer src) { m_tensor -= src.m_tensor; return *this; }
-    inline FrameBuffer& operator-=(double src)      { m_tensor -= src; return *this; }
-    inline FrameBuffer& operator*=(FrameBuffer src) { m_tensor *= src.m_tensor; return *this; }
-    inline FrameBuffer& operator*=(double src)      { m_tensor *= src; return *this; }
-    inline FrameBuffer& operator/=(FrameBuffer src) { m_tensor /= src.m_tensor; return *this; }
-    inline FrameBuffer& operator/=(double src)      { m_tensor /= src; return *this; }
+    inline FrameBuffer& operator+=(FrameBuffer src) { auto t = src.GetCompactTensor_(); return ApplyTensor_([&](Tensor &dst) { dst += t; }); }
+    inline FrameBuffer& operator+=(double src)      { return ApplyTensor_([&](Tensor &dst) { dst += src; }); }
+    inline FrameBuffer& operator-=(FrameBuffer src) { auto t = src.GetCompactTensor_(); return ApplyTensor_([&](Tensor &dst) { dst -= t; }); }
+    inline FrameBuffer& operator-=(double src)      { return ApplyTensor_([&](Tensor &dst) { dst -= src; }); }
+    inline FrameBuffer& operator*=(FrameBuffer src) { auto t = src.GetCompactTensor_(); return ApplyTensor_([&](Tensor &dst) { dst *= t; }); }
+    inline FrameBuffer& operator*=(double src)      { return ApplyTensor_([&](Tensor &dst) { dst *= src; }); }
+    inline FrameBuffer& operator/=(FrameBuffer src) { auto t = src.GetCompactTensor_(); return ApplyTensor_([&](Tensor &dst) { dst /= t; }); }
+    inline FrameBuffer& operator/=(double src)      { return ApplyTensor_([&](Tensor &dst) { dst /= src; }); }
 
     
     FrameBuffer Sqrt(void)
     {
         FrameBuffer dst(GetFrameSize(), GetShape(), GetType(), IsHostOnly());
-        dst.m_tensor = m_tensor.Sqrt();
+        dst.m_tensor = GetCompactTensor_().Sqrt();
         return dst;
     }
 
     FrameBuffer Exp(void)
     {
         FrameBuffer dst(GetFrameSize(), GetShape(), GetType(), IsHostOnly());
-        dst.m_tensor = m_tensor.Exp();
+        dst.m_tensor = GetCompactTensor_().Exp();
         return dst;
     }
     
 
     double Sum(void)
     {
-        return m_tensor.Sum();
+        return GetCompactTensor_().Sum();
     }
 
     double Norm(void)
@@ -1202,21 +1680,21 @@ public:
 inline FrameBuffer operator+(FrameBuffer const &src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor + src1.m_tensor;
+    dst.m_tensor = src0.GetCompactTensor_() + src1.GetCompactTensor_();
     return dst;
 }
 
 inline FrameBuffer operator+(FrameBuffer const &src0, double src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor + src1;
+    dst.m_tensor = src0.GetCompactTensor_() + src1;
     return dst;
 }
 
 inline FrameBuffer operator+(double src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src1.GetFrameSize(), src1.GetShape(), src1.GetType(), src1.IsHostOnly());
-    dst.m_tensor = src0 + src1.m_tensor;
+    dst.m_tensor = src0 + src1.GetCompactTensor_();
     return dst;
 }
 
@@ -1224,21 +1702,21 @@ inline FrameBuffer operator+(double src0, FrameBuffer const &src1)
 inline FrameBuffer operator-(FrameBuffer const &src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor - src1.m_tensor;
+    dst.m_tensor = src0.GetCompactTensor_() - src1.GetCompactTensor_();
     return dst;
 }
 
 inline FrameBuffer operator-(FrameBuffer const &src0, double src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor - src1;
+    dst.m_tensor = src0.GetCompactTensor_() - src1;
     return dst;
 }
 
 inline FrameBuffer operator-(double src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src1.GetFrameSize(), src1.GetShape(), src1.GetType(), src1.IsHostOnly());
-    dst.m_tensor = src0 - src1.m_tensor;
+    dst.m_tensor = src0 - src1.GetCompactTensor_();
     return dst;
 }
 
@@ -1246,21 +1724,21 @@ inline FrameBuffer operator-(double src0, FrameBuffer const &src1)
 inline FrameBuffer operator*(FrameBuffer const &src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor * src1.m_tensor;
+    dst.m_tensor = src0.GetCompactTensor_() * src1.GetCompactTensor_();
     return dst;
 }
 
 inline FrameBuffer operator*(FrameBuffer const &src0, double src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor * src1;
+    dst.m_tensor = src0.GetCompactTensor_() * src1;
     return dst;
 }
 
 inline FrameBuffer operator*(double src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src1.GetFrameSize(), src1.GetShape(), src1.GetType(), src1.IsHostOnly());
-    dst.m_tensor = src0 * src1.m_tensor;
+    dst.m_tensor = src0 * src1.GetCompactTensor_();
     return dst;
 }
 
@@ -1268,35 +1746,35 @@ inline FrameBuffer operator*(double src0, FrameBuffer const &src1)
 inline FrameBuffer operator/(FrameBuffer const &src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor / src1.m_tensor;
+    dst.m_tensor = src0.GetCompactTensor_() / src1.GetCompactTensor_();
     return dst;
 }
 
 inline FrameBuffer operator/(FrameBuffer const &src0, double src1)
 {
     FrameBuffer dst(src0.GetFrameSize(), src0.GetShape(), src0.GetType(), src0.IsHostOnly());
-    dst.m_tensor = src0.m_tensor / src1;
+    dst.m_tensor = src0.GetCompactTensor_() / src1;
     return dst;
 }
 
 inline FrameBuffer operator/(double src0, FrameBuffer const &src1)
 {
     FrameBuffer dst(src1.GetFrameSize(), src1.GetShape(), src1.GetType(), src1.IsHostOnly());
-    dst.m_tensor = src0 / src1.m_tensor;
+    dst.m_tensor = src0 / src1.GetCompactTensor_();
     return dst;
 }
 
 inline FrameBuffer Sqrt(FrameBuffer const &src)
 {
     FrameBuffer dst(src.GetFrameSize(), src.GetShape(), src.GetType(), src.IsHostOnly());
-    dst.m_tensor = Sqrt(src.m_tensor);
+    dst.m_tensor = Sqrt(src.GetCompactTensor_());
     return dst;
 }
 
 inline FrameBuffer Exp(FrameBuffer const &src)
 {
     FrameBuffer dst(src.GetFrameSize(), src.GetShape(), src.GetType(), src.IsHostOnly());
-    dst.m_tensor = Exp(src.m_tensor);
+    dst.m_tensor = Exp(src.GetCompactTensor_());
     return dst;
 }
 
@@ -1322,6 +1800,8 @@ inline std::ostream& operator<<(std::ostream& os, FrameBuffer const &buf)
 {
     switch (buf.GetType()) {
     case BB_TYPE_BIT:    return os << buf.LockConst<Bit     >();
+    case BB_TYPE_FP16:   return os << buf.LockConst<Float16 >();
+    case BB_TYPE_BF16:   return os << buf.LockConst<BFloat16>();
     case BB_TYPE_FP32:   return os << buf.LockConst<float   >();
     case BB_TYPE_FP64:   return os << buf.LockConst<double  >();
     case BB_TYPE_INT8:   return os << buf.LockConst<int8_t  >();
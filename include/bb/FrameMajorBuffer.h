@@ -0,0 +1,202 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "bb/DataType.h"
+#include "bb/FrameBuffer.h"
+#include "bb/SimdSupport.h"
+
+
+namespace bb {
+
+
+// 行列転置 dst[c][r] = src[r][c] (キャッシュ単位のブロック毎に処理)
+template <typename Tp>
+void Transpose_Blocked(Tp const *src, index_t src_stride, Tp *dst, index_t dst_stride, index_t rows, index_t cols)
+{
+    index_t const block = 32;
+    index_t row_blocks = (rows + block - 1) / block;
+    index_t col_blocks = (cols + block - 1) / block;
+
+    #pragma omp parallel for
+    for ( index_t b = 0; b < row_blocks * col_blocks; ++b ) {
+        index_t r0 = (b / col_blocks) * block;
+        index_t c0 = (b % col_blocks) * block;
+        index_t r1 = std::min(r0 + block, rows);
+        index_t c1 = std::min(c0 + block, cols);
+        for ( index_t r = r0; r < r1; ++r ) {
+            for ( index_t c = c0; c < c1; ++c ) {
+                dst[c * dst_stride + r] = src[r * src_stride + c];
+            }
+        }
+    }
+}
+
+#ifdef __AVX2__
+// 8x8 の float 転置
+inline void Transpose_8x8_ps(float const *src, index_t src_stride, float *dst, index_t dst_stride)
+{
+    __m256 r0 = _mm256_loadu_ps(&src[0 * src_stride]);
+    __m256 r1 = _mm256_loadu_ps(&src[1 * src_stride]);
+    __m256 r2 = _mm256_loadu_ps(&src[2 * src_stride]);
+    __m256 r3 = _mm256_loadu_ps(&src[3 * src_stride]);
+    __m256 r4 = _mm256_loadu_ps(&src[4 * src_stride]);
+    __m256 r5 = _mm256_loadu_ps(&src[5 * src_stride]);
+    __m256 r6 = _mm256_loadu_ps(&src[6 * src_stride]);
+    __m256 r7 = _mm256_loadu_ps(&src[7 * src_stride]);
+
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(&dst[0 * dst_stride], _mm256_permute2f128_ps(r0, r4, 0x20));
+    _mm256_storeu_ps(&dst[1 * dst_stride], _mm256_permute2f128_ps(r1, r5, 0x20));
+    _mm256_storeu_ps(&dst[2 * dst_stride], _mm256_permute2f128_ps(r2, r6, 0x20));
+    _mm256_storeu_ps(&dst[3 * dst_stride], _mm256_permute2f128_ps(r3, r7, 0x20));
+    _mm256_storeu_ps(&dst[4 * dst_stride], _mm256_permute2f128_ps(r0, r4, 0x31));
+    _mm256_storeu_ps(&dst[5 * dst_stride], _mm256_permute2f128_ps(r1, r5, 0x31));
+    _mm256_storeu_ps(&dst[6 * dst_stride], _mm256_permute2f128_ps(r2, r6, 0x31));
+    _mm256_storeu_ps(&dst[7 * dst_stride], _mm256_permute2f128_ps(r3, r7, 0x31));
+}
+
+template <>
+inline void Transpose_Blocked<float>(float const *src, index_t src_stride, float *dst, index_t dst_stride, index_t rows, index_t cols)
+{
+    index_t const block = 32;
+    index_t row_blocks = (rows + block - 1) / block;
+    index_t col_blocks = (cols + block - 1) / block;
+
+    #pragma omp parallel for
+    for ( index_t b = 0; b < row_blocks * col_blocks; ++b ) {
+        index_t r0 = (b / col_blocks) * block;
+        index_t c0 = (b % col_blocks) * block;
+        index_t r1 = std::min(r0 + block, rows);
+        index_t c1 = std::min(c0 + block, cols);
+        index_t r8 = r0 + ((r1 - r0) & ~(index_t)7);
+        index_t c8 = c0 + ((c1 - c0) & ~(index_t)7);
+
+        // 8x8 単位
+        for ( index_t r = r0; r < r8; r += 8 ) {
+            for ( index_t c = c0; c < c8; c += 8 ) {
+                Transpose_8x8_ps(&src[r * src_stride + c], src_stride, &dst[c * dst_stride + r], dst_stride);
+            }
+        }
+
+        // 端数
+        for ( index_t r = r0; r < r1; ++r ) {
+            for ( index_t c = (r < r8 ? c8 : c0); c < c1; ++c ) {
+                dst[c * dst_stride + r] = src[r * src_stride + c];
+            }
+        }
+    }
+}
+#endif
+
+
+// FrameBuffer の内容をフレーム毎の行 (frame-major) に並べ替えて保持するバッファ
+//   FrameBuffer は node 毎にフレームが並ぶ (node-major) ので、1フレームの全ノードを
+//   まとめて詰め直す演算 (2値パッキングや INT8 量子化など) の作業用に使う
+//   FrameBuffer 自体にはレイアウトの区別を持たせず、Sequential での自動変換や
+//   畳み込み向けの NCHWc 形式も持たない。Get/Set や LockMemory、CUDA カーネルなど
+//   FrameBuffer を扱う全ての箇所が node-major を前提にしているためで、
+//   DenseAffine や Softmax もノード毎にフレーム方向を連続アクセスする順で書けば
+//   転置が要らない。畳み込みは LoweringConvolution で node-major に展開する
+template <typename Tp>
+class FrameMajorBuffer
+{
+protected:
+    index_t         m_frame_size  = 0;
+    index_t         m_node_size   = 0;
+    index_t         m_node_stride = 0;
+    std::vector<Tp> m_data;
+
+public:
+    FrameMajorBuffer() {}
+
+    FrameMajorBuffer(index_t frame_size, index_t node_size)
+    {
+        Resize(frame_size, node_size);
+    }
+
+    explicit FrameMajorBuffer(FrameBuffer const &buf)
+    {
+        FromFrameBuffer(buf);
+    }
+
+    void Resize(index_t frame_size, index_t node_size)
+    {
+        m_frame_size  = frame_size;
+        m_node_size   = node_size;
+        m_node_stride = (node_size + 7) & ~(index_t)7;
+        m_data.assign(m_frame_size * m_node_stride, (Tp)0);
+    }
+
+    index_t GetFrameSize(void)  const { return m_frame_size; }
+    index_t GetNodeSize(void)   const { return m_node_size; }
+    index_t GetNodeStride(void) const { return m_node_stride; }
+
+    Tp       *GetRow(index_t frame)       { return &m_data[frame * m_node_stride]; }
+    Tp const *GetRow(index_t frame) const { return &m_data[frame * m_node_stride]; }
+
+    Tp   Get(index_t frame, index_t node) const        { return m_data[frame * m_node_stride + node]; }
+    void Set(index_t frame, index_t node, Tp value)    { m_data[frame * m_node_stride + node] = value; }
+
+    // FrameBuffer (node-major) から変換
+    void FromFrameBuffer(FrameBuffer const &buf)
+    {
+        BB_ASSERT(buf.GetType() == DataType<Tp>::type);
+
+        Resize(buf.GetFrameSize(), buf.GetNodeSize());
+        if ( m_frame_size == 0 || m_node_size == 0 ) {
+            return;
+        }
+
+        auto ptr = buf.LockConst<Tp>();
+        Transpose_Blocked<Tp>(ptr.GetAddr(), buf.GetFrameStride() / (index_t)sizeof(Tp),
+                &m_data[0], m_node_stride, m_node_size, m_frame_size);
+    }
+
+    // FrameBuffer (node-major) へ書き戻す
+    void ToFrameBuffer(FrameBuffer &buf) const
+    {
+        BB_ASSERT(buf.GetType() == DataType<Tp>::type);
+        BB_ASSERT(buf.GetFrameSize() == m_frame_size);
+        BB_ASSERT(buf.GetNodeSize()  == m_node_size);
+        if ( m_frame_size == 0 || m_node_size == 0 ) {
+            return;
+        }
+
+        auto ptr = buf.Lock<Tp>(true);
+        Transpose_Blocked<Tp>(&m_data[0], m_node_stride,
+                ptr.GetAddr(), buf.GetFrameStride() / (index_t)sizeof(Tp), m_frame_size, m_node_size);
+    }
+};
+
+
+}
+
+// end of file
@@ -60,14 +60,18 @@ public:
         auto t_ptr = t.LockConst<T>();
         auto dy_ptr = m_dy.Lock<T>();
 
+        auto y_view  = y_ptr.GetView();
+        auto t_view  = t_ptr.GetView();
+        auto dy_view = dy_ptr.GetView();
+
         for (index_t frame = 0; frame < frame_size; ++frame) {
             for (index_t node = 0; node < node_size; ++node) {
-                auto signal = y_ptr.Get(frame, node);
-                auto target = t_ptr.Get(frame, node);
+                auto signal = y_view.Get(frame, node);
+                auto target = t_view.Get(frame, node);
                 auto grad = signal - target;
                 auto error = grad * grad;
 
-                dy_ptr.Set(frame, node, grad / (T)batch_size);
+                dy_view.Set(frame, node, grad / (T)batch_size);
                 m_loss += error / (double)node_size;
             }
         }
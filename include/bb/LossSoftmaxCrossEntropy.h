@@ -64,6 +64,10 @@ public:
         if ( DataType<T>::type == BB_TYPE_FP32
                 && y_buf.IsDeviceAvailable() && dy_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
 
+            // カーネルは y/t/dy 共通のストライドで読むのでビューは詰めたコピーにする
+            if ( y_buf.IsView() ) { y_buf = y_buf.Clone(); }
+            if ( t_buf.IsView() ) { t_buf = t_buf.Clone(); }
+
             auto y_ptr        = y_buf.LockDeviceMemoryConst();
             auto t_ptr        = t_buf.LockDeviceMemoryConst();
             auto dy_ptr       = dy_buf.LockDeviceMemory(true);
@@ -100,12 +104,16 @@ public:
             auto loss_buf_ptr = m_loss_buf.Lock(true);
             auto loss_ptr     = m_loss.Lock();
 
+            auto y_view  = y_ptr.GetView();
+            auto t_view  = t_ptr.GetView();
+            auto dy_view = dy_ptr.GetView();
+
             #pragma omp parallel for
             for (index_t frame = 0; frame < frame_size; ++frame) {
                 // max
-                auto c = y_ptr.Get(frame, 0);
+                auto c = y_view.Get(frame, 0);
                 for (index_t node = 1; node < node_size; ++node) {
-                    c = std::max(c, y_ptr.Get(frame, node));
+                    c = std::max(c, y_view.Get(frame, node));
                 }
                 if (!Real_IsValid(c)) {
                     std::cout << "loss c : nan" << std::endl;
@@ -114,20 +122,20 @@ public:
                 // sum(exp(y - c))
                 T sum = 0;
                 for (index_t node = 0; node < node_size; ++node) {
-                    sum += std::exp(y_ptr.Get(frame, node) - c);
+                    sum += std::exp(y_view.Get(frame, node) - c);
                 }
 
                 for (index_t node = 0; node < node_size; ++node) {
-                    T softmax = std::exp(y_ptr.Get(frame, node) - c) / sum;
-                    if (t_ptr.Get(frame, node) > 0) {
+                    T softmax = std::exp(y_view.Get(frame, node) - c) / sum;
+                    if (t_view.Get(frame, node) > 0) {
                         loss_buf_ptr[frame] = std::log(softmax + (T)1.0e-7);
                     }
-                    T dy = (softmax - t_ptr.Get(frame, node)) / (T)batch_size;
+                    T dy = (softmax - t_view.Get(frame, node)) / (T)batch_size;
                     if (!Real_IsValid(dy)) {
                         std::cout << "loss dy : nan" << std::endl;
                     }
 
-                    dy_ptr.Set(frame, node, dy);
+                    dy_view.Set(frame, node, dy);
                 }
             }
 
@@ -130,6 +130,11 @@ public:
         return m_layer;
     }
 
+    std::shared_ptr< Im2Col > GetIm2Col(void)
+    {
+        return m_im2col;
+    }
+
 
     index_t GetFilterHeight(void) { return m_filter_h_size; }
     index_t GetFilterWidth(void)  { return m_filter_w_size; }
@@ -176,6 +181,20 @@ public:
         return gradients;
     }  
 
+    /**
+     * @brief  統計量取得
+     * @detail 内部のレイヤーの統計量をまとめて取得する
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_im2col->GetStatistics());
+        statistics.PushBack(m_layer->GetStatistics());
+        statistics.PushBack(m_col2im->GetStatistics());
+        return statistics;
+    }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -211,9 +230,40 @@ public:
         shape = m_layer->SetInputShape(shape);
         shape = m_col2im->SetInputShape(shape);
 
+        this->SetChainInputGradient({m_im2col, m_layer, m_col2im}, this->m_input_gradient);
         return shape;
     }
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail 手前に学習対象が無い内部レイヤーは入力勾配を不要とする
+     * @param  enable 入力勾配が必要か
+     */
+    void SetInputGradient(bool enable)
+    {
+        this->m_input_gradient = enable;
+        if ( m_col2im ) {
+            this->SetChainInputGradient({m_im2col, m_layer, m_col2im}, enable);
+        }
+    }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail 内部のレイヤーをまとめて固定する
+     * @param  frozen 固定するなら true
+     */
+    void SetFrozen(bool frozen)
+    {
+        this->m_frozen = frozen;
+        m_layer->SetFrozen(frozen);
+        SetInputGradient(this->m_input_gradient);
+    }
+
+    bool IsTrainable(void)
+    {
+        return m_layer->IsTrainable();
+    }
+
 
     /**
      * @brief  入力形状取得
@@ -259,10 +309,7 @@ public:
      */
     FrameBuffer Backward(FrameBuffer dy_buf)
     {
-        dy_buf = m_col2im->Backward(dy_buf);
-        dy_buf = m_layer->Backward(dy_buf);
-        dy_buf = m_im2col->Backward(dy_buf);
-        return dy_buf; 
+        return this->BackwardChain({m_im2col, m_layer, m_col2im}, dy_buf);
     }
     
 protected:
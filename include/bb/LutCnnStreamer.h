@@ -0,0 +1,462 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bb/Sequential.h"
+#include "bb/LutLayer.h"
+#include "bb/LoweringConvolution.h"
+#include "bb/MaxPooling.h"
+#include "bb/LutNetSimulator.h"
+
+
+namespace bb {
+
+
+// LUT-CNN の行ストリーミング実行
+//   ExportVerilog_LutCnnLayersAxi4s のラインバッファ構成と同じく、各層がフィルタの高さ分の
+//   行のリングバッファだけを持ち、入力画像を1行ずつ流して出力行を順に求める
+//   (LoweringConvolution のように画像全体を展開しないので、作業メモリは 幅 x フィルタ高さ 程度で済む)
+//   境界処理・stride・padding は各層の設定どおりで、net->Forward() とビット単位で一致する
+//   padding="same", BB_BORDER_CONSTANT(0) の構成なら FPGA 回路 (LutCnnSimulator) とも一致する
+//   末尾の LutLayer は最終特徴マップ全体を入力とする全結合として評価する
+//   スレッドへはフレームのブロック単位で分配し、ブロック数がスレッド数に満たない時
+//   (1枚だけの画像など)は各行の出力列をスレッドに分配する
+class LutCnnStreamer
+{
+protected:
+    struct stage_t
+    {
+        bool                                pooling = false;
+        index_t                             in_w_size  = 0;
+        index_t                             in_h_size  = 0;
+        index_t                             in_c_size  = 0;
+        index_t                             out_w_size = 0;
+        index_t                             out_h_size = 0;
+        index_t                             out_c_size = 0;
+        index_t                             filter_h_size = 1;
+        index_t                             filter_w_size = 1;
+        std::vector<index_t>                row_map;        // [out_y][fy] 参照する入力行 (-1 は固定値)
+        std::vector<index_t>                col_map;        // [out_x][fx] 参照する入力列 (-1 は固定値)
+        std::vector<index_t>                row_need;       // [out_y] 出力前に受け取っておく入力行数
+        index_t                             line_size = 1;  // リングバッファの行数
+        bool                                border_bit = false;
+        std::shared_ptr<LutNetSimulator>    mlp;
+    };
+
+    // 各スレッドの実行状態
+    struct context_t
+    {
+        index_t                                     words = 0;
+        bool                                        tile_cols = false;  // 出力列をスレッドに分配する
+        std::vector< std::vector<std::uint64_t> >   lines;      // 層毎のリングバッファ [行][c][x][words]
+        std::vector<index_t>                        received;   // 層毎の受け取り済み入力行数
+        std::vector<index_t>                        produced;   // 層毎の出力済み行数
+        std::vector<std::uint64_t>                  zeros;
+        std::vector<std::uint64_t>                  ones;
+    };
+
+    indices_t                           m_input_shape;
+    indices_t                           m_output_shape;
+    std::vector<stage_t>                m_stages;
+    std::shared_ptr<LutNetSimulator>    m_dense;            // 末尾の全結合
+    std::vector< std::shared_ptr<Model> > m_dense_layers;     // 生成中のみ使用
+    index_t                             m_block_words = 4;      // 1スレッドで同時に流すワード数 (64倍のフレーム)
+
+protected:
+    LutCnnStreamer() {}
+
+    static void MakeLineSize(stage_t &stage)
+    {
+        // 出力行毎に必要な入力行の範囲から、受け取り済みでまだ参照される行の最大数を求める
+        index_t const none = std::numeric_limits<index_t>::max();
+        std::vector<index_t> lo(stage.out_h_size, none);
+        std::vector<index_t> hi(stage.out_h_size, -1);
+        for ( index_t y = 0; y < stage.out_h_size; ++y ) {
+            for ( index_t fy = 0; fy < stage.filter_h_size; ++fy ) {
+                index_t iy = stage.row_map[y * stage.filter_h_size + fy];
+                if ( iy >= 0 ) {
+                    lo[y] = std::min(lo[y], iy);
+                    hi[y] = std::max(hi[y], iy);
+                }
+            }
+        }
+
+        stage.row_need.resize(stage.out_h_size);
+        index_t need = 0;
+        for ( index_t y = 0; y < stage.out_h_size; ++y ) {
+            need = std::max(need, hi[y] + 1);
+            stage.row_need[y] = need;
+        }
+
+        index_t keep = none;
+        stage.line_size = 1;
+        for ( index_t y = stage.out_h_size - 1; y >= 0; --y ) {
+            keep = std::min(keep, lo[y]);
+            if ( keep != none ) {
+                stage.line_size = std::max(stage.line_size, stage.row_need[y] - keep);
+            }
+        }
+    }
+
+    template <typename FT, typename BT>
+    void AddLayer(std::shared_ptr<Model> model)
+    {
+        auto seq = std::dynamic_pointer_cast<Sequential>(model);
+        auto cnv = std::dynamic_pointer_cast< LoweringConvolution<FT, BT> >(model);
+        auto pol = std::dynamic_pointer_cast< MaxPooling<FT, BT> >(model);
+        auto lut = std::dynamic_pointer_cast< LutLayer<FT, BT> >(model);
+
+        if ( seq ) {
+            for ( int i = 0; i < seq->GetSize(); ++i ) {
+                AddLayer<FT, BT>(seq->Get(i));
+            }
+            return;
+        }
+
+        if ( lut ) {
+            m_dense_layers.push_back(lut);
+            return;
+        }
+        BB_ASSERT(m_dense_layers.empty());   // 全結合の後ろに畳み込みは置けない
+
+        auto input_shape  = model->GetInputShape();
+        auto output_shape = model->GetOutputShape();
+        BB_ASSERT(input_shape.size() == 3 && output_shape.size() == 3);
+
+        stage_t stage;
+        stage.in_w_size  = input_shape[0];
+        stage.in_h_size  = input_shape[1];
+        stage.in_c_size  = input_shape[2];
+        stage.out_w_size = output_shape[0];
+        stage.out_h_size = output_shape[1];
+        stage.out_c_size = output_shape[2];
+
+        if ( cnv ) {
+            auto im2col = cnv->GetIm2Col();
+            auto net = std::dynamic_pointer_cast<Sequential>(cnv->GetLayer());
+            BB_ASSERT(net);
+
+            stage.filter_h_size = cnv->GetFilterHeight();
+            stage.filter_w_size = cnv->GetFilterWidth();
+            stage.border_bit    = (bool)Bit(im2col->GetBorderValue());
+            stage.row_map.resize(stage.out_h_size * stage.filter_h_size);
+            stage.col_map.resize(stage.out_w_size * stage.filter_w_size);
+            for ( index_t y = 0; y < stage.out_h_size; ++y ) {
+                for ( index_t fy = 0; fy < stage.filter_h_size; ++fy ) {
+                    stage.row_map[y * stage.filter_h_size + fy] = im2col->GetInputY(y, fy);
+                }
+            }
+            for ( index_t x = 0; x < stage.out_w_size; ++x ) {
+                for ( index_t fx = 0; fx < stage.filter_w_size; ++fx ) {
+                    stage.col_map[x * stage.filter_w_size + fx] = im2col->GetInputX(x, fx);
+                }
+            }
+
+            stage.mlp = LutNetSimulator::Create<FT, BT>(net);
+            BB_ASSERT(stage.mlp->GetInputNodeSize()  == stage.in_c_size * stage.filter_h_size * stage.filter_w_size);
+            BB_ASSERT(stage.mlp->GetOutputNodeSize() == stage.out_c_size);
+        }
+        else if ( pol ) {
+            // stride はフィルタサイズ、はみ出した部分は OR に影響しない 0 として扱う
+            stage.pooling       = true;
+            stage.filter_h_size = pol->GetFilterHeight();
+            stage.filter_w_size = pol->GetFilterWidth();
+            stage.row_map.resize(stage.out_h_size * stage.filter_h_size);
+            stage.col_map.resize(stage.out_w_size * stage.filter_w_size);
+            for ( index_t y = 0; y < stage.out_h_size; ++y ) {
+                for ( index_t fy = 0; fy < stage.filter_h_size; ++fy ) {
+                    index_t iy = y * stage.filter_h_size + fy;
+                    stage.row_map[y * stage.filter_h_size + fy] = (iy < stage.in_h_size) ? iy : -1;
+                }
+            }
+            for ( index_t x = 0; x < stage.out_w_size; ++x ) {
+                for ( index_t fx = 0; fx < stage.filter_w_size; ++fx ) {
+                    index_t ix = x * stage.filter_w_size + fx;
+                    stage.col_map[x * stage.filter_w_size + fx] = (ix < stage.in_w_size) ? ix : -1;
+                }
+            }
+        }
+        else {
+            BB_ASSERT(0);   // 未対応のレイヤー
+        }
+
+        MakeLineSize(stage);
+        m_stages.push_back(stage);
+    }
+
+    template <typename FT, typename BT>
+    void Setup(void)
+    {
+        BB_ASSERT(!m_stages.empty());
+        m_input_shape = indices_t({m_stages.front().in_w_size, m_stages.front().in_h_size, m_stages.front().in_c_size});
+        m_output_shape = indices_t({m_stages.back().out_w_size, m_stages.back().out_h_size, m_stages.back().out_c_size});
+        for ( size_t i = 1; i < m_stages.size(); ++i ) {
+            BB_ASSERT(m_stages[i].in_w_size == m_stages[i-1].out_w_size);
+            BB_ASSERT(m_stages[i].in_h_size == m_stages[i-1].out_h_size);
+            BB_ASSERT(m_stages[i].in_c_size == m_stages[i-1].out_c_size);
+        }
+
+        if ( !m_dense_layers.empty() ) {
+            std::vector< std::shared_ptr< LutLayer<FT, BT> > > layers;
+            for ( auto layer : m_dense_layers ) {
+                layers.push_back(std::dynamic_pointer_cast< LutLayer<FT, BT> >(layer));
+            }
+            m_dense = LutNetSimulator::Create<FT, BT>(layers);
+            BB_ASSERT(m_dense->GetInputNodeSize() == GetShapeSize(m_output_shape));
+            m_output_shape = layers.back()->GetOutputShape();
+            m_dense_layers.clear();
+        }
+    }
+
+public:
+    /**
+     * @brief  生成
+     * @param  net 入力形状設定済みのネット (LoweringConvolution, MaxPooling の並びと末尾の LutLayer)
+     */
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutCnnStreamer> Create(std::shared_ptr<Model> net)
+    {
+        auto self = std::shared_ptr<LutCnnStreamer>(new LutCnnStreamer);
+        self->AddLayer<FT, BT>(net);
+        self->Setup<FT, BT>();
+        return self;
+    }
+
+    // ExportVerilog_LutCnnLayersAxi4s と同じ層リストから生成
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutCnnStreamer> Create(std::vector< std::shared_ptr< Filter2d<FT, BT> > > const &layers)
+    {
+        auto self = std::shared_ptr<LutCnnStreamer>(new LutCnnStreamer);
+        for ( auto const &layer : layers ) {
+            self->AddLayer<FT, BT>(layer);
+        }
+        self->Setup<FT, BT>();
+        return self;
+    }
+
+    void SetBlockWords(index_t block_words)
+    {
+        BB_ASSERT(block_words > 0);
+        m_block_words = block_words;
+    }
+
+    indices_t GetInputShape(void) const  { return m_input_shape; }
+    indices_t GetOutputShape(void) const { return m_output_shape; }
+
+    index_t GetStageSize(void) const { return (index_t)m_stages.size(); }
+
+    // 層毎のリングバッファの行数 (境界処理が WRAP 以外ならフィルタの高さ以下)
+    index_t GetLineSize(index_t stage) const { return m_stages[stage].line_size; }
+
+    // 1スレッドあたりのラインバッファのバイト数
+    index_t GetWorkingMemorySize(void) const
+    {
+        index_t size = 0;
+        for ( auto const &stage : m_stages ) {
+            size += stage.line_size * stage.in_c_size * stage.in_w_size * m_block_words * (index_t)sizeof(std::uint64_t);
+        }
+        return size;
+    }
+
+    /**
+     * @brief  実行
+     * @param  x_buf 入力画像 (Bit型 {w, h, c}、1フレーム1画像)
+     * @return 出力 (Bit型)
+     */
+    FrameBuffer Forward(FrameBuffer const &x_buf)
+    {
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetNodeSize() == GetShapeSize(m_input_shape));
+
+        index_t frame_size = x_buf.GetFrameSize();
+        FrameBuffer y_buf(frame_size, m_output_shape, BB_TYPE_BIT);
+
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr   = (std::uint8_t       *)y_ptr.GetAddr();
+        auto x_stride = x_buf.GetFrameStride();
+        auto y_stride = y_buf.GetFrameStride();
+
+        index_t word_size  = (frame_size + 63) / 64;
+        index_t block_size = (word_size + m_block_words - 1) / m_block_words;
+
+        // ブロック数がスレッド数に満たなければブロックは順に処理し、列方向で並列化する
+        int  thread_size = 1;
+#ifdef _OPENMP
+        thread_size = omp_get_max_threads();
+#endif
+        bool tile_cols = (block_size < thread_size);
+
+        #pragma omp parallel for schedule(dynamic) if(!tile_cols)
+        for ( index_t block = 0; block < block_size; ++block ) {
+            index_t word_base = block * m_block_words;
+            index_t words     = std::min(m_block_words, word_size - word_base);
+
+            context_t ctx;
+            ctx.words     = words;
+            ctx.tile_cols = tile_cols;
+            ctx.zeros.assign(words, 0);
+            ctx.ones.assign(words, ~(std::uint64_t)0);
+            ctx.received.assign(m_stages.size(), 0);
+            ctx.produced.assign(m_stages.size(), 0);
+            ctx.lines.resize(m_stages.size());
+            for ( size_t i = 0; i < m_stages.size(); ++i ) {
+                auto const &stage = m_stages[i];
+                ctx.lines[i].resize(stage.line_size * stage.in_c_size * stage.in_w_size * words);
+            }
+
+            auto const &last = m_stages.back();
+            index_t last_row_size = last.out_c_size * last.out_w_size;
+            std::vector<std::uint64_t> row(last_row_size * words);
+            std::vector<std::uint64_t> map;     // 末尾に全結合がある場合の最終特徴マップ
+            if ( m_dense ) {
+                map.resize(last_row_size * last.out_h_size * words);
+            }
+
+            auto src = [&](index_t y, std::uint64_t *dst) {
+                    // 入力画像の1行を [c][x][words] に並べる
+                    for ( index_t c = 0; c < m_input_shape[2]; ++c ) {
+                        for ( index_t x = 0; x < m_input_shape[0]; ++x ) {
+                            index_t node = (c * m_input_shape[1] + y) * m_input_shape[0] + x;
+                            auto s = (std::uint64_t const *)(x_addr + x_stride * node) + word_base;
+                            std::copy(s, s + words, dst + (c * m_input_shape[0] + x) * words);
+                        }
+                    }
+                };
+
+            for ( index_t y = 0; y < last.out_h_size; ++y ) {
+                ProduceRow(ctx, (index_t)m_stages.size() - 1, &row[0], src);
+
+                for ( index_t c = 0; c < last.out_c_size; ++c ) {
+                    for ( index_t x = 0; x < last.out_w_size; ++x ) {
+                        index_t node = (c * last.out_h_size + y) * last.out_w_size + x;
+                        auto s = &row[(c * last.out_w_size + x) * words];
+                        if ( m_dense ) {
+                            std::copy(s, s + words, &map[node * words]);
+                        }
+                        else {
+                            std::copy(s, s + words, (std::uint64_t *)(y_addr + y_stride * node) + word_base);
+                        }
+                    }
+                }
+            }
+
+            if ( m_dense ) {
+                std::vector<std::uint64_t const *> in_rows(m_dense->GetInputNodeSize());
+                for ( index_t node = 0; node < m_dense->GetInputNodeSize(); ++node ) {
+                    in_rows[node] = &map[node * words];
+                }
+                std::vector<std::uint64_t *> out_rows(m_dense->GetOutputNodeSize());
+                for ( index_t node = 0; node < m_dense->GetOutputNodeSize(); ++node ) {
+                    out_rows[node] = (std::uint64_t *)(y_addr + y_stride * node) + word_base;
+                }
+                m_dense->Evaluate(in_rows, out_rows, words);
+            }
+        }
+
+        return y_buf;
+    }
+
+protected:
+    // 層 k の入力 y 行目のリングバッファ上の位置
+    std::uint64_t *GetLine(context_t &ctx, index_t k, index_t y) const
+    {
+        auto const &stage = m_stages[k];
+        return &ctx.lines[k][(y % stage.line_size) * stage.in_c_size * stage.in_w_size * ctx.words];
+    }
+
+    // 層 k の次の出力行を dst ([c][x][words]) に求める
+    template <class SrcFunc>
+    void ProduceRow(context_t &ctx, index_t k, std::uint64_t *dst, SrcFunc &src) const
+    {
+        auto const &stage = m_stages[k];
+        index_t words = ctx.words;
+        index_t y     = ctx.produced[k]++;
+
+        // 必要な入力行が揃うまで上流から受け取る
+        while ( ctx.received[k] < stage.row_need[y] ) {
+            auto line = GetLine(ctx, k, ctx.received[k]);
+            if ( k == 0 ) {
+                src(ctx.received[k], line);
+            }
+            else {
+                ProduceRow(ctx, k - 1, line, src);
+            }
+            ctx.received[k]++;
+        }
+
+        index_t fh = stage.filter_h_size;
+        index_t fw = stage.filter_w_size;
+
+        #pragma omp parallel if(ctx.tile_cols && stage.out_w_size > 1)
+        {
+            std::vector<std::uint64_t const *>  in_rows(stage.in_c_size * fh * fw);
+            std::vector<std::uint64_t *>        out_rows(stage.out_c_size);
+            std::vector<std::uint64_t>          buf[2];
+
+            #pragma omp for schedule(static)
+            for ( index_t x = 0; x < stage.out_w_size; ++x ) {
+                // ウィンドウの並びは im2col と同じ (c, fy, fx)
+                for ( index_t fy = 0; fy < fh; ++fy ) {
+                    index_t iy = stage.row_map[y * fh + fy];
+                    std::uint64_t const *line = (iy >= 0) ? GetLine(ctx, k, iy) : nullptr;
+                    for ( index_t fx = 0; fx < fw; ++fx ) {
+                        index_t ix = stage.col_map[x * fw + fx];
+                        for ( index_t c = 0; c < stage.in_c_size; ++c ) {
+                            std::uint64_t const *p;
+                            if ( line != nullptr && ix >= 0 ) {
+                                p = &line[(c * stage.in_w_size + ix) * words];
+                            }
+                            else {
+                                p = (!stage.pooling && stage.border_bit) ? &ctx.ones[0] : &ctx.zeros[0];
+                            }
+                            in_rows[(c * fh + fy) * fw + fx] = p;
+                        }
+                    }
+                }
+
+                for ( index_t c = 0; c < stage.out_c_size; ++c ) {
+                    out_rows[c] = &dst[(c * stage.out_w_size + x) * words];
+                }
+
+                if ( stage.pooling ) {
+                    // Bit の MaxPooling はウィンドウ内の OR
+                    for ( index_t c = 0; c < stage.out_c_size; ++c ) {
+                        for ( index_t w = 0; w < words; ++w ) {
+                            std::uint64_t v = 0;
+                            for ( index_t i = 0; i < fh * fw; ++i ) {
+                                v |= in_rows[c * fh * fw + i][w];
+                            }
+                            out_rows[c][w] = v;
+                        }
+                    }
+                }
+                else {
+                    stage.mlp->Evaluate(in_rows, out_rows, words, buf);
+                }
+            }
+        }
+    }
+};
+
+
+}
+
+// end of file
@@ -0,0 +1,149 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "bb/Sequential.h"
+#include "bb/LutLayer.h"
+#include "bb/LutNetSimulator.h"
+
+
+namespace bb {
+
+
+// Bit 入出力の LUT 層の並びをフレームのタイル単位でまとめて評価する実行器
+//   層毎に全フレームを処理して中間層をメモリに書き出すのではなく、
+//   キャッシュに収まるフレーム数のタイルを全層に通してから次のタイルへ進む
+//   中間層はスレッド毎の2面のバッファを交互に使うので、メモリへの読み書きは入力と出力だけになる
+//   LUT の構造と評価は LutNetSimulator の組合せ回路評価(Evaluate)をそのまま使う
+class LutNetFused
+{
+protected:
+    indices_t                           m_input_shape;
+    indices_t                           m_output_shape;
+    std::shared_ptr<LutNetSimulator>    m_net;
+    index_t                             m_tile_frames = 2048;     // 1タイルのフレーム数
+
+protected:
+    LutNetFused() {}
+
+public:
+    /**
+     * @brief  生成
+     * @param  layers 入力形状設定済みの LUT 層 (Bit 入出力、入力数6以下)
+     */
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetFused> Create(std::vector< std::shared_ptr< LutLayer<FT, BT> > > const &layers)
+    {
+        BB_ASSERT(!layers.empty());
+        for ( size_t i = 1; i < layers.size(); ++i ) {
+            BB_ASSERT(layers[i-1]->GetOutputNodeSize() == layers[i]->GetInputNodeSize());
+        }
+
+        auto self = std::shared_ptr<LutNetFused>(new LutNetFused);
+        self->m_input_shape  = layers.front()->GetInputShape();
+        self->m_output_shape = layers.back()->GetOutputShape();
+        self->m_net          = LutNetSimulator::Create<FT, BT>(layers);
+        return self;
+    }
+
+    // Sequential 中の LutLayer だけからなる区間から生成
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetFused> Create(std::shared_ptr<Sequential> net)
+    {
+        std::vector< std::shared_ptr< LutLayer<FT, BT> > > layers;
+        for (int i = 0; i < net->GetSize(); ++i) {
+            auto layer = std::dynamic_pointer_cast< LutLayer<FT, BT> >(net->Get(i));
+            BB_ASSERT(layer != nullptr);
+            layers.push_back(layer);
+        }
+        return Create<FT, BT>(layers);
+    }
+
+    /**
+     * @brief  1タイルのフレーム数設定
+     * @detail 256 の倍数に切り上げる
+     *         (中間層の最大ノード数 x フレーム数/8 x 2面 が L2 に収まる程度にする)
+     */
+    void SetTileFrames(index_t frames)
+    {
+        BB_ASSERT(frames > 0);
+        m_tile_frames = (frames + 255) / 256 * 256;
+    }
+
+    index_t GetTileFrames(void) const { return m_tile_frames; }
+
+    indices_t GetInputShape(void) const  { return m_input_shape; }
+    indices_t GetOutputShape(void) const { return m_output_shape; }
+
+    // 1スレッドあたりの中間層バッファのバイト数
+    index_t GetWorkingMemorySize(void) const
+    {
+        return 2 * m_net->GetMaxHiddenNodeSize() * (m_tile_frames / 8);
+    }
+
+    /**
+     * @brief  実行
+     * @param  x_buf 入力 (Bit型)
+     * @return 出力 (Bit型)
+     */
+    FrameBuffer Forward(FrameBuffer const &x_buf)
+    {
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetNodeSize() == m_net->GetInputNodeSize());
+
+        FrameBuffer y_buf(x_buf.GetFrameSize(), m_output_shape, BB_TYPE_BIT);
+
+        // 入力はビューで親のストライドのままのこともあるので入出力で別に持つ
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr = (std::uint8_t       *)y_ptr.GetAddr();
+        index_t x_stride = x_buf.GetFrameStride();
+        index_t y_stride = y_buf.GetFrameStride();
+
+        index_t input_node_size  = m_net->GetInputNodeSize();
+        index_t output_node_size = m_net->GetOutputNodeSize();
+        index_t word_size  = (x_buf.GetFrameSize() + 63) / 64;
+        index_t tile_words = m_tile_frames / 64;
+        index_t tile_size  = (word_size + tile_words - 1) / tile_words;
+
+        #pragma omp parallel
+        {
+            std::vector<std::uint64_t>          buf[2];
+            std::vector<std::uint64_t const *>  in_rows(input_node_size);
+            std::vector<std::uint64_t *>        out_rows(output_node_size);
+
+            #pragma omp for schedule(dynamic)
+            for ( index_t tile = 0; tile < tile_size; ++tile ) {
+                index_t offset = tile * tile_words;
+                index_t words  = std::min(tile_words, word_size - offset);
+
+                for ( index_t node = 0; node < input_node_size; ++node ) {
+                    in_rows[node] = (std::uint64_t const *)(x_addr + x_stride * node) + offset;
+                }
+                for ( index_t node = 0; node < output_node_size; ++node ) {
+                    out_rows[node] = (std::uint64_t *)(y_addr + y_stride * node) + offset;
+                }
+                m_net->Evaluate(in_rows, out_rows, words, buf);
+            }
+        }
+
+        LutNetSimulator_ClearPadding(y_buf);
+        return y_buf;
+    }
+};
+
+}
+
+// end of file
@@ -0,0 +1,467 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "bb/Sequential.h"
+#include "bb/LutLayer.h"
+#include "bb/LoweringConvolution.h"
+#include "bb/MaxPooling.h"
+#include "bb/LutNetSimulator.h"
+
+
+namespace bb {
+
+
+// 動画など連続するフレームを LUT-Network に流す時の差分評価エンジン
+//   各層のビット出力を前フレームの値として保持し、入力ビットが変化したノードから
+//   im2col の参照関係と LUT の接続を逆にたどって、影響を受ける LUT だけを再評価する
+//   対応する層は LoweringConvolution (中身は LutLayer の Sequential)、MaxPooling、LutLayer
+//   変化が少ないほど1フレームあたりの計算量が減る
+class LutNetIncremental
+{
+protected:
+    using lut_t = LutNetSimulator::lut_t;
+
+    // 1画素分の LUT 層
+    struct lut_layer_t
+    {
+        index_t                     input_node_size  = 0;
+        index_t                     output_node_size = 0;
+        std::vector<lut_t>          luts;
+        std::vector<index_t>        fanout_start;   // 入力ノード -> 参照する LUT の範囲
+        std::vector<std::int32_t>   fanout;
+        std::vector<std::uint8_t>   value;          // [pixel][node] 前フレームの出力
+    };
+
+    struct stage_t
+    {
+        bool                        pooling = false;
+        index_t                     input_node_size  = 0;
+        index_t                     output_node_size = 0;
+        indices_t                   output_shape;
+
+        // 畳み込み/全結合 (全結合は1画素の畳み込みとして扱う)
+        index_t                     pixel_size  = 1;
+        index_t                     window_size = 0;
+        std::vector<std::int32_t>   window;         // [pixel][window_size] 参照する入力ノード (-1 は固定値)
+        std::uint8_t                border_bit = 0;
+        std::vector<index_t>        window_fanout_start;    // 入力ノード -> 参照する (pixel, window) の範囲
+        std::vector<std::int32_t>   window_fanout;
+        std::vector<lut_layer_t>    mlp;
+
+        // プーリング
+        index_t                     in_w_size = 0;
+        index_t                     in_h_size = 0;
+        index_t                     out_w_size = 0;
+        index_t                     out_h_size = 0;
+        index_t                     filter_h_size = 1;
+        index_t                     filter_w_size = 1;
+
+        std::vector<std::uint8_t>   output;         // 前フレームの出力
+    };
+
+    indices_t                   m_input_shape;
+    std::vector<stage_t>        m_stages;
+    std::vector<std::uint8_t>   m_input;              // 前フレームの入力
+    bool                        m_valid = false;      // 前フレームの値を保持しているか
+    index_t                     m_evaluated = 0;      // 直前のフレームで評価した LUT 数
+    index_t                     m_lut_size  = 0;      // 1フレームを全評価した時の LUT 数
+
+protected:
+    LutNetIncremental() {}
+
+    // 逆引き表 (CSR) 作成
+    static void MakeFanout(index_t input_size, std::vector<std::int32_t> const &refs, index_t ref_width,
+                std::vector<index_t> &start, std::vector<std::int32_t> &fanout)
+    {
+        start.assign(input_size + 1, 0);
+        for ( auto r : refs ) {
+            if ( r >= 0 ) { start[r + 1]++; }
+        }
+        for ( index_t i = 0; i < input_size; ++i ) {
+            start[i + 1] += start[i];
+        }
+        fanout.resize(start[input_size]);
+        std::vector<index_t> pos(start.begin(), start.end() - 1);
+        for ( index_t i = 0; i < (index_t)refs.size(); ++i ) {
+            if ( refs[i] >= 0 ) {
+                fanout[pos[refs[i]]++] = (std::int32_t)(ref_width > 0 ? i / ref_width : i);
+            }
+        }
+    }
+
+    template <typename FT, typename BT>
+    static lut_layer_t MakeLutLayer(std::shared_ptr< LutLayer<FT, BT> > lut)
+    {
+        lut_layer_t layer;
+        layer.input_node_size  = lut->GetInputNodeSize();
+        layer.output_node_size = lut->GetOutputNodeSize();
+        layer.luts = LutNetSimulator::ExtractLuts<FT, BT>(lut);
+
+        std::vector<std::int32_t> refs(layer.output_node_size * 6, -1);
+        for ( index_t node = 0; node < layer.output_node_size; ++node ) {
+            auto const &l = layer.luts[node];
+            for ( int i = 0; i < l.n; ++i ) {
+                refs[node * 6 + i] = l.input[i];
+            }
+        }
+        MakeFanout(layer.input_node_size, refs, 6, layer.fanout_start, layer.fanout);
+        return layer;
+    }
+
+    template <typename FT, typename BT>
+    static void AddLutLayers(std::vector<lut_layer_t> &mlp, std::shared_ptr<Model> model)
+    {
+        auto seq = std::dynamic_pointer_cast<Sequential>(model);
+        if ( seq ) {
+            for ( int i = 0; i < seq->GetSize(); ++i ) {
+                AddLutLayers<FT, BT>(mlp, seq->Get(i));
+            }
+            return;
+        }
+        auto lut = std::dynamic_pointer_cast< LutLayer<FT, BT> >(model);
+        if ( lut ) {
+            mlp.push_back(MakeLutLayer<FT, BT>(lut));
+        }
+    }
+
+    template <typename FT, typename BT>
+    void AddLayer(std::shared_ptr<Model> model)
+    {
+        auto seq = std::dynamic_pointer_cast<Sequential>(model);
+        auto cnv = std::dynamic_pointer_cast< LoweringConvolution<FT, BT> >(model);
+        auto pol = std::dynamic_pointer_cast< MaxPooling<FT, BT> >(model);
+        auto lut = std::dynamic_pointer_cast< LutLayer<FT, BT> >(model);
+
+        if ( seq ) {
+            for ( int i = 0; i < seq->GetSize(); ++i ) {
+                AddLayer<FT, BT>(seq->Get(i));
+            }
+        }
+        else if ( cnv ) {
+            auto im2col = cnv->GetIm2Col();
+
+            stage_t stage;
+            stage.input_node_size = cnv->GetInputNodeSize();
+            stage.pixel_size      = im2col->GetOutputHeight() * im2col->GetOutputWidth();
+            stage.window_size     = im2col->GetOutputNodeSize();
+            stage.border_bit      = (std::uint8_t)((bool)Bit(im2col->GetBorderValue()) ? 1 : 0);
+            stage.window.resize(stage.pixel_size * stage.window_size);
+            for ( index_t pixel = 0; pixel < stage.pixel_size; ++pixel ) {
+                for ( index_t i = 0; i < stage.window_size; ++i ) {
+                    stage.window[pixel * stage.window_size + i] = (std::int32_t)im2col->GetInputNodeIndex(pixel, i);
+                }
+            }
+            MakeFanout(stage.input_node_size, stage.window, 0, stage.window_fanout_start, stage.window_fanout);
+
+            AddLutLayers<FT, BT>(stage.mlp, cnv->GetLayer());
+            BB_ASSERT(!stage.mlp.empty());
+            BB_ASSERT(stage.mlp.front().input_node_size == stage.window_size);
+
+            stage.output_shape     = cnv->GetOutputShape();
+            stage.output_node_size = stage.mlp.back().output_node_size * stage.pixel_size;
+            BB_ASSERT(stage.output_node_size == GetShapeSize(stage.output_shape));
+            m_stages.push_back(stage);
+        }
+        else if ( pol ) {
+            auto input_shape = pol->GetInputShape();
+            BB_ASSERT(input_shape.size() == 3);
+
+            stage_t stage;
+            stage.pooling          = true;
+            stage.input_node_size  = pol->GetInputNodeSize();
+            stage.output_node_size = pol->GetOutputNodeSize();
+            stage.output_shape     = pol->GetOutputShape();
+            stage.in_w_size        = input_shape[0];
+            stage.in_h_size        = input_shape[1];
+            stage.out_w_size       = stage.output_shape[0];
+            stage.out_h_size       = stage.output_shape[1];
+            stage.filter_h_size    = pol->GetFilterHeight();
+            stage.filter_w_size    = pol->GetFilterWidth();
+            m_stages.push_back(stage);
+        }
+        else if ( lut ) {
+            // 連続する LutLayer は1つの全結合段にまとめる
+            if ( m_stages.empty() || m_stages.back().pooling || m_stages.back().pixel_size != 1 ) {
+                stage_t stage;
+                stage.input_node_size = lut->GetInputNodeSize();
+                stage.pixel_size      = 1;
+                stage.window_size     = stage.input_node_size;
+                stage.window.resize(stage.window_size);
+                for ( index_t i = 0; i < stage.window_size; ++i ) {
+                    stage.window[i] = (std::int32_t)i;
+                }
+                MakeFanout(stage.input_node_size, stage.window, 0, stage.window_fanout_start, stage.window_fanout);
+                m_stages.push_back(stage);
+            }
+            auto &stage = m_stages.back();
+            stage.mlp.push_back(MakeLutLayer<FT, BT>(lut));
+            stage.output_shape     = lut->GetOutputShape();
+            stage.output_node_size = lut->GetOutputNodeSize();
+        }
+        else {
+            BB_ASSERT(0);   // 未対応のレイヤー
+        }
+    }
+
+public:
+    /**
+     * @brief  生成
+     * @param  net 入力形状設定済みのネット (LoweringConvolution, MaxPooling, LutLayer の並び)
+     */
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetIncremental> Create(std::shared_ptr<Model> net)
+    {
+        auto self = std::shared_ptr<LutNetIncremental>(new LutNetIncremental);
+        self->m_input_shape = net->GetInputShape();
+        self->AddLayer<FT, BT>(net);
+        BB_ASSERT(!self->m_stages.empty());
+
+        index_t input_node_size = GetShapeSize(self->m_input_shape);
+        for ( auto &stage : self->m_stages ) {
+            BB_ASSERT(stage.input_node_size == input_node_size);
+            input_node_size = stage.output_node_size;
+            stage.output.assign(stage.output_node_size, 0);
+            for ( auto &layer : stage.mlp ) {
+                layer.value.assign(stage.pixel_size * layer.output_node_size, 0);
+                self->m_lut_size += stage.pixel_size * layer.output_node_size;
+            }
+        }
+        return self;
+    }
+
+    indices_t GetInputShape(void) const  { return m_input_shape; }
+    indices_t GetOutputShape(void) const { return m_stages.back().output_shape; }
+
+    /**
+     * @brief  保持している前フレームの値を破棄 (次のフレームは全評価する)
+     */
+    void Reset(void)
+    {
+        m_valid = false;
+    }
+
+    // 直前のフレームで評価した LUT 数と、全評価した場合の LUT 数
+    index_t GetEvaluatedSize(void) const { return m_evaluated; }
+    index_t GetLutSize(void) const       { return m_lut_size; }
+
+    /**
+     * @brief  差分評価
+     * @detail x_buf の各フレームを連続する動画フレームとして順に評価する
+     * @param  x_buf 入力 (Bit または実数型(0.5 より大きければ 1))
+     * @return 出力 (Bit型)
+     */
+    FrameBuffer Forward(FrameBuffer const &x_buf)
+    {
+        BB_ASSERT(GetShapeSize(x_buf.GetShape()) == GetShapeSize(m_input_shape));
+
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t input_node_size = x_buf.GetNodeSize();
+        FrameBuffer y_buf(frame_size, GetOutputShape(), BB_TYPE_BIT);
+
+        m_input.resize(input_node_size, 0);
+        for ( index_t frame = 0; frame < frame_size; ++frame ) {
+            // 入力の変化を検出
+            std::vector<std::int32_t> changed;
+            for ( index_t node = 0; node < input_node_size; ++node ) {
+                std::uint8_t v = (std::uint8_t)(x_buf.GetFP32(frame, node) > 0.5f ? 1 : 0);
+                if ( !m_valid || v != m_input[node] ) {
+                    m_input[node] = v;
+                    changed.push_back((std::int32_t)node);
+                }
+            }
+
+            m_evaluated = 0;
+            std::vector<std::uint8_t> const *in = &m_input;
+            for ( auto &stage : m_stages ) {
+                if ( stage.pooling ) {
+                    changed = EvaluatePooling(stage, *in, changed);
+                }
+                else {
+                    changed = EvaluateLut(stage, *in, changed);
+                }
+                in = &stage.output;
+            }
+            m_valid = true;
+
+            for ( index_t node = 0; node < (index_t)in->size(); ++node ) {
+                y_buf.SetBit(frame, node, (*in)[node] != 0);
+            }
+        }
+
+        return y_buf;
+    }
+
+protected:
+    std::vector<std::int32_t> EvaluateLut(stage_t &stage, std::vector<std::uint8_t> const &in, std::vector<std::int32_t> const &changed)
+    {
+        // 変化した入力を参照する (画素, ウィンドウ位置) を集める
+        std::vector< std::pair<std::int32_t, std::int32_t> > dirty;
+        for ( auto node : changed ) {
+            for ( index_t i = stage.window_fanout_start[node]; i < stage.window_fanout_start[node + 1]; ++i ) {
+                std::int32_t ref = stage.window_fanout[i];
+                dirty.push_back(std::make_pair((std::int32_t)(ref / stage.window_size), (std::int32_t)(ref % stage.window_size)));
+            }
+        }
+        if ( !m_valid ) {
+            // 初回は固定値の参照も含め全て評価
+            dirty.clear();
+            for ( index_t pixel = 0; pixel < stage.pixel_size; ++pixel ) {
+                for ( index_t i = 0; i < stage.window_size; ++i ) {
+                    dirty.push_back(std::make_pair((std::int32_t)pixel, (std::int32_t)i));
+                }
+            }
+        }
+        std::sort(dirty.begin(), dirty.end());
+
+        // 画素毎の範囲
+        std::vector<index_t> pixel_start;
+        for ( index_t i = 0; i < (index_t)dirty.size(); ++i ) {
+            if ( i == 0 || dirty[i].first != dirty[i - 1].first ) {
+                pixel_start.push_back(i);
+            }
+        }
+        pixel_start.push_back((index_t)dirty.size());
+        index_t dirty_pixel_size = (index_t)pixel_start.size() - 1;
+
+        index_t max_node_size = stage.window_size;
+        for ( auto const &layer : stage.mlp ) {
+            max_node_size = std::max(max_node_size, layer.output_node_size);
+        }
+
+        std::vector<std::int32_t> out_changed;
+        index_t evaluated = 0;
+
+        #pragma omp parallel
+        {
+            std::vector<std::int32_t>   local_changed;
+            std::vector<std::int32_t>   cur, next;
+            std::vector<index_t>        mark(max_node_size, -1);
+            index_t                     stamp = 0;
+            index_t                     local_evaluated = 0;
+
+            #pragma omp for schedule(dynamic, 16)
+            for ( index_t k = 0; k < dirty_pixel_size; ++k ) {
+                index_t pixel = dirty[pixel_start[k]].first;
+
+                cur.clear();
+                for ( index_t i = pixel_start[k]; i < pixel_start[k + 1]; ++i ) {
+                    cur.push_back(dirty[i].second);
+                }
+
+                for ( index_t l = 0; l < (index_t)stage.mlp.size(); ++l ) {
+                    auto &layer = stage.mlp[l];
+
+                    // 再評価する LUT (重複を除く)
+                    ++stamp;
+                    next.clear();
+                    for ( auto input_node : cur ) {
+                        for ( index_t i = layer.fanout_start[input_node]; i < layer.fanout_start[input_node + 1]; ++i ) {
+                            auto node = layer.fanout[i];
+                            if ( mark[node] != stamp ) {
+                                mark[node] = stamp;
+                                next.push_back(node);
+                            }
+                        }
+                    }
+
+                    // 評価して変化したものだけ次へ
+                    cur.clear();
+                    std::uint8_t *value = &layer.value[pixel * layer.output_node_size];
+                    for ( auto node : next ) {
+                        auto const &lut = layer.luts[node];
+                        int index = 0;
+                        for ( int i = 0; i < lut.n; ++i ) {
+                            std::uint8_t x;
+                            if ( l == 0 ) {
+                                auto src = stage.window[pixel * stage.window_size + lut.input[i]];
+                                x = (src >= 0) ? in[src] : stage.border_bit;
+                            }
+                            else {
+                                auto const &prev = stage.mlp[l - 1];
+                                x = prev.value[pixel * prev.output_node_size + lut.input[i]];
+                            }
+                            index |= (x << i);
+                        }
+                        std::uint8_t y = (std::uint8_t)((lut.table >> index) & 1);
+                        ++local_evaluated;
+                        if ( !m_valid || y != value[node] ) {
+                            value[node] = y;
+                            cur.push_back(node);
+                        }
+                    }
+                }
+
+                // 出力ノードは (c, y, x) の並び
+                for ( auto c : cur ) {
+                    std::int32_t output_node = (std::int32_t)(c * stage.pixel_size + pixel);
+                    stage.output[output_node] = stage.mlp.back().value[pixel * stage.mlp.back().output_node_size + c];
+                    local_changed.push_back(output_node);
+                }
+            }
+
+            #pragma omp critical
+            {
+                out_changed.insert(out_changed.end(), local_changed.begin(), local_changed.end());
+                evaluated += local_evaluated;
+            }
+        }
+
+        m_evaluated += evaluated;
+        return out_changed;
+    }
+
+    std::vector<std::int32_t> EvaluatePooling(stage_t &stage, std::vector<std::uint8_t> const &in, std::vector<std::int32_t> const &changed)
+    {
+        // 変化した入力を含む出力を集める
+        std::vector<std::int32_t> dirty;
+        for ( auto node : changed ) {
+            index_t c  = node / (stage.in_h_size * stage.in_w_size);
+            index_t iy = (node / stage.in_w_size) % stage.in_h_size;
+            index_t ix = node % stage.in_w_size;
+            dirty.push_back((std::int32_t)((c * stage.out_h_size + iy / stage.filter_h_size) * stage.out_w_size + ix / stage.filter_w_size));
+        }
+        std::sort(dirty.begin(), dirty.end());
+        dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+        // ウィンドウ内の OR (Bit の MaxPooling)
+        std::vector<std::int32_t> out_changed;
+        for ( auto node : dirty ) {
+            index_t c = node / (stage.out_h_size * stage.out_w_size);
+            index_t y = (node / stage.out_w_size) % stage.out_h_size;
+            index_t x = node % stage.out_w_size;
+
+            std::uint8_t v = 0;
+            for ( index_t fy = 0; fy < stage.filter_h_size; ++fy ) {
+                index_t iy = y * stage.filter_h_size + fy;
+                if ( iy >= stage.in_h_size ) { continue; }
+                for ( index_t fx = 0; fx < stage.filter_w_size; ++fx ) {
+                    index_t ix = x * stage.filter_w_size + fx;
+                    if ( ix >= stage.in_w_size ) { continue; }
+                    v |= in[(c * stage.in_h_size + iy) * stage.in_w_size + ix];
+                }
+            }
+            if ( !m_valid || v != stage.output[node] ) {
+                stage.output[node] = v;
+                out_changed.push_back(node);
+            }
+        }
+        return out_changed;
+    }
+};
+
+
+}
+
+// end of file
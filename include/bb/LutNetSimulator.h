@@ -0,0 +1,688 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+#include "bb/Sequential.h"
+#include "bb/LutLayer.h"
+#include "bb/LoweringConvolution.h"
+#include "bb/MaxPooling.h"
+#include "bb/SimdSupport.h"
+
+
+namespace bb {
+
+
+// Bit 型 FrameBuffer の frame_size 以降のビット(最終ワードの余りとストライドの残り)を 0 にする
+//   ワード単位で評価すると余りのビットにも LUT の出力(定数1など)が書かれるので、出力前に消す
+inline void LutNetSimulator_ClearPadding(FrameBuffer &buf)
+{
+    BB_ASSERT(buf.GetType() == BB_TYPE_BIT);
+
+    index_t frame_size = buf.GetFrameSize();
+    index_t word_size  = buf.GetFrameStride() / (index_t)sizeof(std::uint64_t);
+    index_t used_words = (frame_size + 63) / 64;
+    std::uint64_t mask = (frame_size % 64 == 0) ? ~(std::uint64_t)0 : (((std::uint64_t)1 << (frame_size % 64)) - 1);
+
+    auto ptr  = buf.LockMemory();
+    auto addr = (std::uint8_t *)ptr.GetAddr();
+    #pragma omp parallel for
+    for ( index_t node = 0; node < buf.GetNodeSize(); ++node ) {
+        auto row = (std::uint64_t *)(addr + buf.GetFrameStride() * node);
+        if ( used_words > 0 ) {
+            row[used_words - 1] &= mask;
+        }
+        for ( index_t w = used_words; w < word_size; ++w ) {
+            row[w] = 0;
+        }
+    }
+}
+
+
+// LUT-Network の Verilog 出力と同じ回路構造をホスト上で評価するシミュレータ
+//   ExportVerilog_LutLayers が出力する bb_lut と各層出力の FF をそのまま持ち、
+//   1クロック毎にパイプラインを進める。各信号は 64bit ワードの各ビットを
+//   独立したテストベクタに割り当てて(ビットスライス)まとめて評価する
+class LutNetSimulator
+{
+public:
+    // シミュレーション結果
+    struct result_t
+    {
+        index_t     vector_size   = 0;      //< 評価したテストベクタ(フレーム)数
+        index_t     latency       = 0;      //< 入力の valid から出力の valid までのクロック数
+        index_t     stream_cycles = 0;      //< 1回路(cke 常時有効)で全ベクタを流し終えるまでのクロック数
+        double      throughput    = 0;      //< 1クロックあたりの出力数
+        index_t     sim_cycles    = 0;      //< シミュレーションしたサイクル数 (LutCnnSimulator では1画素1クロックとした見積り)
+        double      elapsed       = 0;      //< シミュレーション時間[sec]
+    };
+
+    // LUT 1個分の接続と真理値表 (table の bit i が入力パターン i の出力、入力 0 が LSB)
+    struct lut_t
+    {
+        int             n = 0;
+        std::int32_t    input[6];
+        std::uint64_t   table = 0;
+    };
+
+    // LutLayer の全ノードの LUT を取り出す (他の LUT-Network 実行器と共通)
+    template <typename FT = Bit, typename BT = float>
+    static std::vector<lut_t> ExtractLuts(std::shared_ptr< LutLayer<FT, BT> > const &lut)
+    {
+        index_t input_node_size  = lut->GetInputNodeSize();
+        index_t output_node_size = lut->GetOutputNodeSize();
+
+        std::vector<lut_t> luts(output_node_size);
+        for ( index_t node = 0; node < output_node_size; ++node ) {
+            auto &l = luts[node];
+            l.n = (int)lut->GetNodeInputSize(node);
+            BB_ASSERT(l.n >= 1 && l.n <= 6);
+            BB_ASSERT(lut->GetLutTableSize(node) == (1 << l.n));
+            for ( int i = 0; i < l.n; ++i ) {
+                l.input[i] = (std::int32_t)lut->GetNodeInput(node, i);
+                BB_ASSERT(l.input[i] >= 0 && l.input[i] < input_node_size);
+            }
+            for ( int bit = 0; bit < (1 << l.n); ++bit ) {
+                if ( lut->GetLutTable(node, bit) ) {
+                    l.table |= ((std::uint64_t)1 << bit);
+                }
+            }
+        }
+        return luts;
+    }
+
+protected:
+    struct layer_t
+    {
+        index_t             input_node_size  = 0;
+        index_t             output_node_size = 0;
+        indices_t           output_shape;
+        std::vector<lut_t>  luts;
+    };
+
+    std::vector<layer_t>    m_layers;
+    index_t                 m_lane_words = 64;      // 1サイクルで評価するワード数(64倍のベクタを並列評価)
+    result_t                m_result;
+
+protected:
+    LutNetSimulator() {}
+
+public:
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetSimulator> Create(std::vector< std::shared_ptr< LutLayer<FT, BT> > > const &layers)
+    {
+        auto self = std::shared_ptr<LutNetSimulator>(new LutNetSimulator);
+        for ( auto const &lut : layers ) {
+            layer_t layer;
+            layer.input_node_size  = lut->GetInputNodeSize();
+            layer.output_node_size = lut->GetOutputNodeSize();
+            layer.output_shape     = lut->GetOutputShape();
+            layer.luts             = ExtractLuts<FT, BT>(lut);
+            self->m_layers.push_back(layer);
+        }
+        return self;
+    }
+
+    // Sequential 中の LutLayer だけを取り出して生成(ExportVerilog_LutLayers と同じ規則)
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetSimulator> Create(std::shared_ptr<Sequential> net)
+    {
+        std::vector< std::shared_ptr< LutLayer<FT, BT> > > layers;
+        for (int i = 0; i < net->GetSize(); ++i) {
+            auto layer = std::dynamic_pointer_cast< LutLayer<FT, BT> >(net->Get(i));
+            if ( layer != nullptr ) {
+                layers.push_back(layer);
+            }
+        }
+        return Create<FT, BT>(layers);
+    }
+
+    void SetLaneWords(index_t lane_words)
+    {
+        BB_ASSERT(lane_words > 0);
+        m_lane_words = lane_words;
+    }
+
+    index_t GetInputNodeSize(void) const
+    {
+        BB_ASSERT(!m_layers.empty());
+        return m_layers.front().input_node_size;
+    }
+
+    index_t GetOutputNodeSize(void) const
+    {
+        BB_ASSERT(!m_layers.empty());
+        return m_layers.back().output_node_size;
+    }
+
+    indices_t GetOutputShape(void) const
+    {
+        BB_ASSERT(!m_layers.empty());
+        return m_layers.back().output_shape;
+    }
+
+    // 中間層(最終層以外の出力)の最大ノード数
+    index_t GetMaxHiddenNodeSize(void) const
+    {
+        index_t node_size = 0;
+        for ( index_t l = 0; l + 1 < (index_t)m_layers.size(); ++l ) {
+            node_size = std::max(node_size, m_layers[l].output_node_size);
+        }
+        return node_size;
+    }
+
+    // 回路上のレイテンシ(層毎に出力FFが1段)
+    index_t GetLatency(void) const
+    {
+        return (index_t)m_layers.size();
+    }
+
+    result_t const &GetResult(void) const
+    {
+        return m_result;
+    }
+
+
+    /**
+     * @brief  クロック単位のシミュレーション
+     * @detail 入力フレームを順に in_data に与え、cke 常時有効でパイプラインを動かして
+     *         out_valid が立った出力を集める。結果の統計は GetResult() で取得できる
+     * @param  x_buf 入力(Bit型)
+     * @return 出力(Bit型)
+     */
+    FrameBuffer Simulate(FrameBuffer const &x_buf)
+    {
+        BB_ASSERT(!m_layers.empty());
+
+        // 入力が無ければ出力の valid が立たず終わらないので空で返す
+        if ( x_buf.GetFrameSize() == 0 ) {
+            m_result = result_t();
+            m_result.latency = GetLatency();
+            return FrameBuffer();
+        }
+
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetNodeSize() == GetInputNodeSize());
+
+        auto start_time = std::chrono::system_clock::now();
+
+        index_t layer_size  = (index_t)m_layers.size();
+        index_t frame_size  = x_buf.GetFrameSize();
+        index_t word_size   = (frame_size + 63) / 64;
+        index_t block_size  = (word_size + m_lane_words - 1) / m_lane_words;
+
+        FrameBuffer y_buf(frame_size, GetOutputShape(), BB_TYPE_BIT);
+
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr   = (std::uint8_t       *)y_ptr.GetAddr();
+        auto x_stride = x_buf.GetFrameStride();
+        auto y_stride = y_buf.GetFrameStride();
+
+        // 各層の出力FF
+        std::vector< std::vector<std::uint64_t> >   regs(layer_size);
+        std::vector<index_t>                        valid(layer_size, -1);  // FF が保持しているブロック番号(-1 は無効)
+        for ( index_t l = 0; l < layer_size; ++l ) {
+            regs[l].resize(m_layers[l].output_node_size * m_lane_words, 0);
+        }
+
+        std::vector<std::uint64_t const *>  in_rows;
+        std::vector<std::uint64_t *>        out_rows;
+
+        index_t latency = 0;
+        index_t cycle   = 0;
+        for ( ; ; ++cycle ) {
+            // 後段から更新することで、ノンブロッキング代入と同じく前サイクルの値で評価する
+            for ( index_t l = layer_size - 1; l >= 1; --l ) {
+                valid[l] = valid[l-1];
+                if ( valid[l] >= 0 ) {
+                    MakeRows(in_rows, regs[l-1], m_layers[l].input_node_size);
+                    MakeRows(out_rows, regs[l], m_layers[l].output_node_size);
+                    EvaluateLayer(m_layers[l], in_rows, out_rows, BlockWords(valid[l], word_size));
+                }
+            }
+
+            // 入力
+            valid[0] = (cycle < block_size) ? cycle : -1;
+            if ( valid[0] >= 0 ) {
+                in_rows.resize(m_layers[0].input_node_size);
+                for ( index_t node = 0; node < m_layers[0].input_node_size; ++node ) {
+                    in_rows[node] = (std::uint64_t const *)(x_addr + x_stride * node) + valid[0] * m_lane_words;
+                }
+                MakeRows(out_rows, regs[0], m_layers[0].output_node_size);
+                EvaluateLayer(m_layers[0], in_rows, out_rows, BlockWords(valid[0], word_size));
+            }
+
+            // 出力
+            index_t out_block = valid[layer_size - 1];
+            if ( out_block >= 0 ) {
+                if ( out_block == 0 ) {
+                    latency = cycle + 1;
+                }
+                index_t words = BlockWords(out_block, word_size);
+                auto const &last = regs[layer_size - 1];
+                for ( index_t node = 0; node < GetOutputNodeSize(); ++node ) {
+                    auto dst = (std::uint64_t *)(y_addr + y_stride * node) + out_block * m_lane_words;
+                    for ( index_t w = 0; w < words; ++w ) {
+                        dst[w] = last[node * m_lane_words + w];
+                    }
+                }
+                if ( out_block == block_size - 1 ) {
+                    break;
+                }
+            }
+        }
+
+        auto end_time = std::chrono::system_clock::now();
+
+        m_result.vector_size   = frame_size;
+        m_result.latency       = latency;
+        m_result.stream_cycles = frame_size + latency - 1;
+        m_result.throughput    = (double)frame_size / (double)m_result.stream_cycles;
+        m_result.sim_cycles    = cycle + 1;
+        m_result.elapsed       = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000000.0;
+
+        LutNetSimulator_ClearPadding(y_buf);
+        return y_buf;
+    }
+
+
+    /**
+     * @brief  組合せ回路としての評価
+     * @detail FF を無視して全層をまとめて評価する (畳み込みの各画素の評価用)
+     * @param  in_rows  入力ノード毎のワード列
+     * @param  out_rows 出力ノード毎のワード列
+     * @param  words    評価するワード数
+     */
+    void Evaluate(std::vector<std::uint64_t const *> const &in_rows, std::vector<std::uint64_t *> const &out_rows, index_t words) const
+    {
+        std::vector<std::uint64_t> buf[2];
+        Evaluate(in_rows, out_rows, words, buf);
+    }
+
+    /**
+     * @brief  組合せ回路としての評価 (中間層の作業バッファ指定)
+     * @detail 繰り返し呼ぶ場合に buf を使い回すことで確保を避ける
+     *         中間層は buf[0], buf[1] を交互に使う (必要に応じて拡張する)
+     */
+    void Evaluate(std::vector<std::uint64_t const *> const &in_rows, std::vector<std::uint64_t *> const &out_rows, index_t words,
+                std::vector<std::uint64_t> (&buf)[2]) const
+    {
+        index_t layer_size = (index_t)m_layers.size();
+
+        std::vector<std::uint64_t const *>  rows = in_rows;
+        std::vector<std::uint64_t *>        dst_rows;
+        for ( index_t l = 0; l < layer_size; ++l ) {
+            auto const &layer = m_layers[l];
+            if ( l == layer_size - 1 ) {
+                dst_rows = out_rows;
+            }
+            else {
+                auto &tmp = buf[l % 2];
+                if ( (index_t)tmp.size() < layer.output_node_size * words ) {
+                    tmp.resize(layer.output_node_size * words);
+                }
+                dst_rows.resize(layer.output_node_size);
+                for ( index_t node = 0; node < layer.output_node_size; ++node ) {
+                    dst_rows[node] = &tmp[node * words];
+                }
+            }
+
+            for ( index_t node = 0; node < layer.output_node_size; ++node ) {
+                EvaluateLut(layer.luts[node], rows, dst_rows[node], words);
+            }
+
+            rows.assign(dst_rows.begin(), dst_rows.end());
+        }
+    }
+
+protected:
+    index_t BlockWords(index_t block, index_t word_size) const
+    {
+        return std::min(m_lane_words, word_size - block * m_lane_words);
+    }
+
+    void MakeRows(std::vector<std::uint64_t const *> &rows, std::vector<std::uint64_t> const &regs, index_t node_size) const
+    {
+        rows.resize(node_size);
+        for ( index_t node = 0; node < node_size; ++node ) {
+            rows[node] = &regs[node * m_lane_words];
+        }
+    }
+
+    void MakeRows(std::vector<std::uint64_t *> &rows, std::vector<std::uint64_t> &regs, index_t node_size) const
+    {
+        rows.resize(node_size);
+        for ( index_t node = 0; node < node_size; ++node ) {
+            rows[node] = &regs[node * m_lane_words];
+        }
+    }
+
+    static void EvaluateLayer(layer_t const &layer, std::vector<std::uint64_t const *> const &in_rows, std::vector<std::uint64_t *> const &out_rows, index_t words)
+    {
+        #pragma omp parallel for
+        for ( index_t node = 0; node < layer.output_node_size; ++node ) {
+            EvaluateLut(layer.luts[node], in_rows, out_rows[node], words);
+        }
+    }
+
+    // 真理値表をマルチプレクサの木として入力0から順に畳み込んで評価
+    //   1段目はテーブルの2ビットの組合せで決まる (0, ~x, x, 1)
+    //   以降は a ^ ((a ^ b) & x) で x が 1 のビットは b を選ぶ
+    static inline void EvaluateLut(lut_t const &lut, std::vector<std::uint64_t const *> const &in_rows, std::uint64_t *out, index_t words)
+    {
+        index_t w = 0;
+
+#ifdef __AVX2__
+        __m256i const zero = _mm256_setzero_si256();
+        __m256i const ones = _mm256_set1_epi8(-1);
+        for ( ; w + 4 <= words; w += 4 ) {
+            __m256i v[32];
+
+            int     size = (1 << lut.n) >> 1;
+            __m256i x    = _mm256_loadu_si256((__m256i const *)(in_rows[lut.input[0]] + w));
+            for ( int i = 0; i < size; ++i ) {
+                switch ( (lut.table >> (2*i)) & 3 ) {
+                case 0:  v[i] = zero;                           break;
+                case 1:  v[i] = _mm256_andnot_si256(x, ones);   break;
+                case 2:  v[i] = x;                              break;
+                default: v[i] = ones;                           break;
+                }
+            }
+
+            for ( int k = 1; k < lut.n; ++k ) {
+                x = _mm256_loadu_si256((__m256i const *)(in_rows[lut.input[k]] + w));
+                size >>= 1;
+                for ( int i = 0; i < size; ++i ) {
+                    __m256i a = v[2*i];
+                    __m256i b = v[2*i+1];
+                    v[i] = _mm256_xor_si256(a, _mm256_and_si256(_mm256_xor_si256(a, b), x));
+                }
+            }
+            _mm256_storeu_si256((__m256i *)(out + w), v[0]);
+        }
+#endif
+
+        for ( ; w < words; ++w ) {
+            std::uint64_t v[32];
+
+            int           size = (1 << lut.n) >> 1;
+            std::uint64_t x    = in_rows[lut.input[0]][w];
+            for ( int i = 0; i < size; ++i ) {
+                switch ( (lut.table >> (2*i)) & 3 ) {
+                case 0:  v[i] = 0;                      break;
+                case 1:  v[i] = ~x;                     break;
+                case 2:  v[i] = x;                      break;
+                default: v[i] = ~(std::uint64_t)0;      break;
+                }
+            }
+
+            for ( int k = 1; k < lut.n; ++k ) {
+                x = in_rows[lut.input[k]][w];
+                size >>= 1;
+                for ( int i = 0; i < size; ++i ) {
+                    v[i] = v[2*i] ^ ((v[2*i] ^ v[2*i+1]) & x);
+                }
+            }
+            out[w] = v[0];
+        }
+    }
+};
+
+
+
+// AXI4-Stream 版 LUT-CNN (ExportVerilog_LutCnnLayersAxi4s) のシミュレータ
+//   各層をまとめて評価する機能モデルで、tvalid/tready のハンドシェイクやラインバッファの
+//   ストールをクロック単位では動かさない (jelly 側モジュールの RTL はこのリポジトリに無い)
+//   ラインバッファ(jelly_img_blk_buffer)は中心合わせ・境界 0 埋めのウィンドウとして、
+//   MaxPooling(jelly_img_dnn_maxpol) はウィンドウ内の OR として扱い、
+//   畳み込みの中の MLP は LutNetSimulator で評価する
+//   レイテンシはウィンドウが揃うまでのライン/画素の待ちと MLP の FF 段数から見積もる
+//   (jelly 側モジュール内部の固定段数は含まない)
+class LutCnnSimulator
+{
+public:
+    using result_t = LutNetSimulator::result_t;
+
+protected:
+    struct layer_t
+    {
+        bool                                pooling = false;
+        index_t                             filter_h_size = 1;
+        index_t                             filter_w_size = 1;
+        indices_t                           input_shape;
+        indices_t                           output_shape;
+        std::shared_ptr<LutNetSimulator>    mlp;
+    };
+
+    std::vector<layer_t>    m_layers;
+    result_t                m_result;
+
+protected:
+    LutCnnSimulator() {}
+
+public:
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutCnnSimulator> Create(std::vector< std::shared_ptr< Filter2d<FT, BT> > > const &layers)
+    {
+        auto self = std::shared_ptr<LutCnnSimulator>(new LutCnnSimulator);
+        for ( auto const &filter : layers ) {
+            layer_t layer;
+            layer.filter_h_size = filter->GetFilterHeight();
+            layer.filter_w_size = filter->GetFilterWidth();
+            layer.input_shape   = filter->GetInputShape();
+            BB_ASSERT(layer.input_shape.size() == 3);
+
+            auto cnv = std::dynamic_pointer_cast< LoweringConvolution<FT, BT> >(filter);
+            auto pol = std::dynamic_pointer_cast< MaxPooling<FT, BT> >(filter);
+            if ( cnv ) {
+                auto net = std::dynamic_pointer_cast<Sequential>(cnv->GetLayer());
+                BB_ASSERT(net);
+                layer.mlp = LutNetSimulator::Create<FT, BT>(net);
+                BB_ASSERT(layer.mlp->GetInputNodeSize() == layer.filter_h_size * layer.filter_w_size * layer.input_shape[2]);
+
+                // 回路は常に入力と同じ大きさの画像を出力する
+                layer.output_shape = indices_t({layer.input_shape[0], layer.input_shape[1], layer.mlp->GetOutputNodeSize()});
+            }
+            else if ( pol ) {
+                layer.pooling      = true;
+                layer.output_shape = filter->GetOutputShape();
+            }
+            else {
+                BB_ASSERT(0);
+            }
+            self->m_layers.push_back(layer);
+        }
+        return self;
+    }
+
+    indices_t GetOutputShape(void) const
+    {
+        BB_ASSERT(!m_layers.empty());
+        return m_layers.back().output_shape;
+    }
+
+    // 1画素1クロックで入力した時の最初の入力画素から最初の出力画素までのクロック数
+    index_t GetLatency(void) const
+    {
+        index_t latency = 0;
+        for ( auto const &layer : m_layers ) {
+            index_t w = layer.input_shape[0];
+            if ( layer.pooling ) {
+                latency += (layer.filter_h_size - 1) * w + (layer.filter_w_size - 1);
+            }
+            else {
+                latency += ((layer.filter_h_size - 1) / 2) * w + (layer.filter_w_size - 1) / 2;
+                latency += layer.mlp->GetLatency();
+            }
+        }
+        return latency;
+    }
+
+    result_t const &GetResult(void) const
+    {
+        return m_result;
+    }
+
+
+    /**
+     * @brief  シミュレーション
+     * @param  x_buf 入力画像(Bit型 {w, h, c}、1フレーム1画像)
+     * @return 出力画像(Bit型)
+     */
+    FrameBuffer Simulate(FrameBuffer const &x_buf)
+    {
+        BB_ASSERT(!m_layers.empty());
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetShape() == m_layers.front().input_shape);
+
+        auto start_time = std::chrono::system_clock::now();
+
+        FrameBuffer buf = x_buf;
+        for ( auto const &layer : m_layers ) {
+            if ( layer.pooling ) {
+                buf = SimulatePooling(layer, buf);
+            }
+            else {
+                buf = SimulateConvolution(layer, buf);
+            }
+        }
+
+        auto end_time = std::chrono::system_clock::now();
+
+        // サイクル単位では回していないので、サイクル数は全て 1画素1クロック(ブランク無し)で
+        // 画像を連続入力した場合の見積り (sim_cycles は入力画素数)
+        auto    in_shape    = m_layers.front().input_shape;
+        index_t frame_size  = x_buf.GetFrameSize();
+        index_t pixel_size  = in_shape[0] * in_shape[1];
+
+        m_result.vector_size   = frame_size;
+        m_result.latency       = GetLatency();
+        m_result.stream_cycles = frame_size * pixel_size + m_result.latency;
+        m_result.throughput    = (m_result.stream_cycles > 0) ? (double)frame_size / (double)m_result.stream_cycles : 0.0;
+        m_result.sim_cycles    = frame_size * pixel_size;
+        m_result.elapsed       = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000000.0;
+
+        return buf;
+    }
+
+protected:
+    static FrameBuffer SimulateConvolution(layer_t const &layer, FrameBuffer const &x_buf)
+    {
+        index_t w_size = layer.input_shape[0];
+        index_t h_size = layer.input_shape[1];
+        index_t c_size = layer.input_shape[2];
+        index_t n      = layer.filter_h_size;
+        index_t m      = layer.filter_w_size;
+        index_t nc     = (n - 1) / 2;
+        index_t mc     = (m - 1) / 2;
+        index_t out_c_size = layer.output_shape[2];
+        index_t words  = (x_buf.GetFrameSize() + 63) / 64;
+
+        FrameBuffer y_buf(x_buf.GetFrameSize(), layer.output_shape, BB_TYPE_BIT);
+
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr   = (std::uint8_t       *)y_ptr.GetAddr();
+        auto x_stride = x_buf.GetFrameStride();
+        auto y_stride = y_buf.GetFrameStride();
+
+        std::vector<std::uint64_t> zero(words, 0);
+
+        #pragma omp parallel for
+        for ( index_t pix = 0; pix < h_size * w_size; ++pix ) {
+            index_t y = pix / w_size;
+            index_t x = pix % w_size;
+
+            // ウィンドウの並びは img_blk_data_shuffle と同じ (c, 行, 画素)
+            std::vector<std::uint64_t const *>  in_rows(c_size * n * m);
+            for ( index_t c = 0; c < c_size; ++c ) {
+                for ( index_t j = 0; j < n; ++j ) {
+                    for ( index_t k = 0; k < m; ++k ) {
+                        index_t iy = y + j - nc;
+                        index_t ix = x + k - mc;
+                        std::uint64_t const *row = &zero[0];
+                        if ( iy >= 0 && iy < h_size && ix >= 0 && ix < w_size ) {
+                            row = (std::uint64_t const *)(x_addr + x_stride * ((c * h_size + iy) * w_size + ix));
+                        }
+                        in_rows[(c * n + j) * m + k] = row;
+                    }
+                }
+            }
+
+            std::vector<std::uint64_t *> out_rows(out_c_size);
+            for ( index_t c = 0; c < out_c_size; ++c ) {
+                out_rows[c] = (std::uint64_t *)(y_addr + y_stride * ((c * h_size + y) * w_size + x));
+            }
+
+            layer.mlp->Evaluate(in_rows, out_rows, words);
+        }
+
+        LutNetSimulator_ClearPadding(y_buf);
+        return y_buf;
+    }
+
+    static FrameBuffer SimulatePooling(layer_t const &layer, FrameBuffer const &x_buf)
+    {
+        index_t in_w_size  = layer.input_shape[0];
+        index_t in_h_size  = layer.input_shape[1];
+        index_t out_w_size = layer.output_shape[0];
+        index_t out_h_size = layer.output_shape[1];
+        index_t c_size     = layer.output_shape[2];
+        index_t words      = (x_buf.GetFrameSize() + 63) / 64;
+
+        FrameBuffer y_buf(x_buf.GetFrameSize(), layer.output_shape, BB_TYPE_BIT);
+
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr   = (std::uint8_t       *)y_ptr.GetAddr();
+        auto x_stride = x_buf.GetFrameStride();
+        auto y_stride = y_buf.GetFrameStride();
+
+        #pragma omp parallel for
+        for ( index_t node = 0; node < c_size * out_h_size * out_w_size; ++node ) {
+            index_t c = node / (out_h_size * out_w_size);
+            index_t y = (node / out_w_size) % out_h_size;
+            index_t x = node % out_w_size;
+
+            auto dst = (std::uint64_t *)(y_addr + y_stride * node);
+            for ( index_t w = 0; w < words; ++w ) {
+                dst[w] = 0;
+            }
+            for ( index_t fy = 0; fy < layer.filter_h_size; ++fy ) {
+                index_t iy = y * layer.filter_h_size + fy;
+                if ( iy >= in_h_size ) { continue; }
+                for ( index_t fx = 0; fx < layer.filter_w_size; ++fx ) {
+                    index_t ix = x * layer.filter_w_size + fx;
+                    if ( ix >= in_w_size ) { continue; }
+                    auto src = (std::uint64_t const *)(x_addr + x_stride * ((c * in_h_size + iy) * in_w_size + ix));
+                    for ( index_t w = 0; w < words; ++w ) {
+                        dst[w] |= src[w];
+                    }
+                }
+            }
+        }
+
+        LutNetSimulator_ClearPadding(y_buf);
+        return y_buf;
+    }
+};
+
+
+}
+
+// end of file
@@ -0,0 +1,916 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+#include "bb/Sequential.h"
+#include "bb/LutLayer.h"
+
+
+namespace bb {
+
+
+// LUT-Network をレイヤーの区切りを外した LUT のネットリストとして保持し、
+// Verilog 出力前に論理最適化とパイプラインレジスタの再配置を行う
+//   信号番号は [0, input_size) が入力、input_size が定数0、input_size+1 が定数1、
+//   それ以降が LUT で、LUT は常に自分より小さい番号の信号だけを参照する(トポロジカル順)
+class LutNetlist
+{
+public:
+    static int const MAX_LUT_INPUT = 6;
+
+    // 最適化結果の統計
+    struct status_t
+    {
+        index_t     lut_count  = 0;     //< 生きている LUT 数
+        index_t     depth      = 0;     //< LUT の最大段数
+    };
+
+protected:
+    struct lut_t
+    {
+        int             n = 0;
+        index_t         input[MAX_LUT_INPUT];
+        std::uint64_t   table = 0;
+    };
+
+    index_t                 m_input_size = 0;
+    indices_t               m_output_shape;
+    std::vector<lut_t>      m_luts;         // 信号番号 - GetLutBase() で参照
+    std::vector<index_t>    m_replace;      // 置き換え先の信号番号(自分自身なら置換なし)
+    std::vector<index_t>    m_outputs;      // 出力ノード毎の信号番号
+
+protected:
+    LutNetlist() {}
+
+public:
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetlist> Create(std::vector< std::shared_ptr< LutLayer<FT, BT> > > const &layers)
+    {
+        BB_ASSERT(!layers.empty());
+
+        auto self = std::shared_ptr<LutNetlist>(new LutNetlist);
+        self->m_input_size   = layers[0]->GetInputNodeSize();
+        self->m_output_shape = layers.back()->GetOutputShape();
+
+        std::vector<index_t> prev(self->m_input_size);
+        for ( index_t i = 0; i < self->m_input_size; ++i ) {
+            prev[i] = i;
+        }
+
+        for ( auto const &layer : layers ) {
+            BB_ASSERT(layer->GetInputNodeSize() == (index_t)prev.size());
+            index_t node_size = layer->GetOutputNodeSize();
+            std::vector<index_t> next(node_size);
+            for ( index_t node = 0; node < node_size; ++node ) {
+                lut_t lut;
+                lut.n = (int)layer->GetNodeInputSize(node);
+                BB_ASSERT(lut.n <= MAX_LUT_INPUT);
+                for ( int k = 0; k < lut.n; ++k ) {
+                    lut.input[k] = prev[layer->GetNodeInput(node, k)];
+                }
+                int table_size = layer->GetLutTableSize(node);
+                for ( int i = 0; i < table_size; ++i ) {
+                    if ( layer->GetLutTable(node, i) ) {
+                        lut.table |= ((std::uint64_t)1 << i);
+                    }
+                }
+                next[node] = self->AddLut(lut);
+            }
+            prev.swap(next);
+        }
+        self->m_outputs = prev;
+
+        return self;
+    }
+
+    template <typename FT = Bit, typename BT = float>
+    static std::shared_ptr<LutNetlist> Create(std::shared_ptr<Sequential> net)
+    {
+        std::vector< std::shared_ptr< LutLayer<FT, BT> > > layers;
+        for (int i = 0; i < net->GetSize(); ++i) {
+            auto layer = std::dynamic_pointer_cast< LutLayer<FT, BT> >(net->Get(i));
+            if ( layer != nullptr ) {
+                layers.push_back(layer);
+            }
+        }
+        return Create<FT, BT>(layers);
+    }
+
+    index_t GetInputNodeSize(void) const  { return m_input_size; }
+    index_t GetOutputNodeSize(void) const { return (index_t)m_outputs.size(); }
+    indices_t GetOutputShape(void) const  { return m_output_shape; }
+
+
+    /**
+     * @brief  ネットリストの最適化
+     * @detail 変化がなくなるまで以下を繰り返す
+     *           - 定数入力の畳み込み、出力に影響しない入力と重複入力の除去
+     *           - 定数 LUT と恒等(バッファ) LUT の除去
+     *           - 反転(インバータ) LUT の後段テーブルへの吸収
+     *           - 同一入力・同一テーブルの LUT の共有
+     *           - 前段が単一ファンアウトで合成後の入力数が max_input 以下なら後段に併合
+     *         最後に出力から到達しない LUT を削除する
+     * @param  max_input 併合後に許す LUT の入力数
+     */
+    void Optimize(int max_input = MAX_LUT_INPUT)
+    {
+        BB_ASSERT(max_input >= 1 && max_input <= MAX_LUT_INPUT);
+
+        bool changed;
+        do {
+            changed  = false;
+            changed |= Simplify();
+            changed |= AbsorbInverter();
+            changed |= MergeDuplicate();
+            changed |= MergeChain(max_input);
+        } while ( changed );
+
+        Compact();
+    }
+
+    status_t GetStatus(void) const
+    {
+        status_t status;
+        auto live  = GetLiveFlags();
+        auto level = GetLevels();
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( live[i] ) {
+                status.lut_count++;
+                status.depth = std::max(status.depth, level[i]);
+            }
+        }
+        return status;
+    }
+
+    // register_depth 段の LUT 毎にレジスタを置いたときのレイテンシ
+    index_t GetLatency(index_t register_depth = 1) const
+    {
+        BB_ASSERT(register_depth >= 1);
+        index_t stages = (GetStatus().depth + register_depth - 1) / register_depth;
+        return std::max(stages, (index_t)1);
+    }
+
+    // register_depth 段毎に区切ったときのデータ信号の FF 数 (valid の FF は含まない)
+    index_t GetRegisterCount(index_t register_depth = 1) const
+    {
+        std::vector<index_t> stage;
+        std::vector<index_t> delay;
+        MakeStages(register_depth, stage, delay);
+
+        index_t count = 0;
+        for ( auto d : delay ) {
+            count += d;
+        }
+        return count;
+    }
+
+
+    /**
+     * @brief  組み合わせ回路として評価(検証用)
+     * @param  x_buf 入力(Bit型)
+     * @return 出力(Bit型)
+     */
+    FrameBuffer Evaluate(FrameBuffer const &x_buf) const
+    {
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetNodeSize() == m_input_size);
+
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t words      = (frame_size + 63) / 64;
+        FrameBuffer y_buf(frame_size, m_output_shape, BB_TYPE_BIT);
+
+        index_t lut_base = GetLutBase();
+        std::vector<std::uint64_t> values((lut_base + (index_t)m_luts.size()) * words);
+        {
+            auto x_ptr = x_buf.LockMemoryConst();
+            for ( index_t i = 0; i < m_input_size; ++i ) {
+                auto src = (std::uint64_t const *)((std::uint8_t const *)x_ptr.GetAddr() + x_buf.GetFrameStride() * i);
+                std::copy(src, src + words, &values[i * words]);
+            }
+            std::fill(&values[(m_input_size + 1) * words], &values[(m_input_size + 2) * words], ~(std::uint64_t)0);
+        }
+
+        auto live = GetLiveFlags();
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !live[i] ) { continue; }
+            auto const &lut = m_luts[i];
+            std::uint64_t *out = &values[(lut_base + i) * words];
+
+            #pragma omp parallel for
+            for ( index_t w = 0; w < words; ++w ) {
+                std::uint64_t x[MAX_LUT_INPUT];
+                for ( int k = 0; k < lut.n; ++k ) {
+                    x[k] = values[lut.input[k] * words + w];
+                }
+                out[w] = EvaluateWord(lut, x);
+            }
+        }
+
+        {
+            auto y_ptr = y_buf.LockMemory(true);
+            for ( index_t node = 0; node < (index_t)m_outputs.size(); ++node ) {
+                auto dst = (std::uint64_t *)((std::uint8_t *)y_ptr.GetAddr() + y_buf.GetFrameStride() * node);
+                std::copy(&values[m_outputs[node] * words], &values[(m_outputs[node] + 1) * words], dst);
+            }
+        }
+
+        return y_buf;
+    }
+
+
+    /**
+     * @brief  パイプライン回路としてのシミュレーション(検証用)
+     * @detail ExportVerilog と同じステージ分割と遅延段(FF)を1クロックずつ進めて評価する
+     *         1クロックに 64 フレームを1ワードとして投入し、レイテンシ後に出てくる値を返す
+     *         レジスタの置き方に誤りがあれば、異なるフレームの信号が混ざって Evaluate() と一致しなくなる
+     * @param  x_buf          入力(Bit型)
+     * @param  register_depth 1ステージに入れる LUT の段数
+     * @return 出力(Bit型)
+     */
+    FrameBuffer Simulate(FrameBuffer const &x_buf, index_t register_depth = 1) const
+    {
+        BB_ASSERT(register_depth >= 1);
+        BB_ASSERT(x_buf.GetType() == BB_TYPE_BIT);
+        BB_ASSERT(x_buf.GetNodeSize() == m_input_size);
+
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t words      = (frame_size + 63) / 64;
+        FrameBuffer y_buf(frame_size, m_output_shape, BB_TYPE_BIT);
+
+        index_t lut_base = GetLutBase();
+        index_t latency  = GetLatency(register_depth);
+        auto    live     = GetLiveFlags();
+
+        std::vector<index_t> stage;
+        std::vector<index_t> delay;
+        MakeStages(register_depth, stage, delay);
+
+        // 信号毎の [0]:組み合わせ出力 [d]:d 段目の FF
+        std::vector< std::vector<std::uint64_t> > regs(lut_base + m_luts.size());
+        for ( index_t id = 0; id < (index_t)regs.size(); ++id ) {
+            regs[id].assign(delay[id] + 1, 0);
+        }
+        regs[GetConst(true)][0] = ~(std::uint64_t)0;
+
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr = (std::uint8_t       *)y_ptr.GetAddr();
+
+        for ( index_t cycle = 0; cycle < words + latency; ++cycle ) {
+            // FF を1段進める (前サイクルの値を取り込む)
+            for ( auto &r : regs ) {
+                for ( index_t d = (index_t)r.size() - 1; d >= 1; --d ) {
+                    r[d] = r[d - 1];
+                }
+            }
+
+            // 入力
+            for ( index_t i = 0; i < m_input_size; ++i ) {
+                regs[i][0] = (cycle < words) ? ((std::uint64_t const *)(x_addr + x_buf.GetFrameStride() * i))[cycle] : 0;
+            }
+
+            // LUT (トポロジカル順なので同じステージ内の前段は評価済み)
+            for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+                if ( !live[i] ) { continue; }
+                auto const &lut = m_luts[i];
+                std::uint64_t x[MAX_LUT_INPUT];
+                for ( int k = 0; k < lut.n; ++k ) {
+                    index_t src = lut.input[k];
+                    x[k] = regs[src][SourceDelay(src, stage[lut_base + i], stage)];
+                }
+                regs[lut_base + i][0] = EvaluateWord(lut, x);
+            }
+
+            // 出力
+            if ( cycle >= latency ) {
+                for ( index_t node = 0; node < (index_t)m_outputs.size(); ++node ) {
+                    index_t src = m_outputs[node];
+                    auto dst = (std::uint64_t *)(y_addr + y_buf.GetFrameStride() * node);
+                    dst[cycle - latency] = regs[src][SourceDelay(src, latency + 1, stage)];
+                }
+            }
+        }
+
+        return y_buf;
+    }
+
+
+    /**
+     * @brief  Verilog 出力
+     * @detail ExportVerilog_LutLayers と同じポート構成のモジュールを1つ出力する
+     *         LUT の段数(入力からの深さ)を register_depth で区切ってステージを決め、
+     *         ステージを跨ぐ信号にだけ FF を置く。複数ステージを跨ぐ信号は
+     *         遅延段を共有してバランスを取るので、全経路のレイテンシは GetLatency() で揃う
+     * @param  os             出力先
+     * @param  module_name    モジュール名
+     * @param  register_depth 1ステージに入れる LUT の段数
+     */
+    void ExportVerilog(std::ostream& os, std::string module_name, index_t register_depth = 1) const
+    {
+        BB_ASSERT(register_depth >= 1);
+
+        index_t lut_base = GetLutBase();
+        index_t latency  = GetLatency(register_depth);
+        auto    live     = GetLiveFlags();
+
+        // 各信号のステージと必要な遅延段数
+        std::vector<index_t> stage;
+        std::vector<index_t> delay;
+        MakeStages(register_depth, stage, delay);
+
+        // モジュール出力
+        os <<
+            "\n"
+            "\n"
+            "module " << module_name << "\n"
+            "        #(\n"
+            "            parameter USER_WIDTH = 0,\n"
+            "            parameter DEVICE     = \"RTL\",\n"
+            "            \n"
+            "            parameter USER_BITS  = USER_WIDTH > 0 ? USER_WIDTH : 1\n"
+            "        )\n"
+            "        (\n"
+            "            input  wire                  reset,\n"
+            "            input  wire                  clk,\n"
+            "            input  wire                  cke,\n"
+            "            \n"
+            "            input  wire [USER_BITS-1:0]  in_user,\n"
+            "            input  wire [" << std::setw(9) << m_input_size << "-1:0]  in_data,\n"
+            "            input  wire                  in_valid,\n"
+            "            \n"
+            "            output wire [USER_BITS-1:0]  out_user,\n"
+            "            output wire [" << std::setw(9) << m_outputs.size() << "-1:0]  out_data,\n"
+            "            output wire                  out_valid\n"
+            "        );\n"
+            "\n"
+            "// LUT : " << GetStatus().lut_count << ",  latency : " << latency << "\n"
+            "\n\n";
+
+        // 入力の遅延段
+        for ( index_t i = 0; i < m_input_size; ++i ) {
+            WriteDelay(os, SignalName(i, 0), i, delay[i]);
+        }
+
+        // LUT
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !live[i] ) { continue; }
+            auto const &lut = m_luts[i];
+            index_t     id  = lut_base + i;
+            index_t     s   = stage[id];
+
+            os <<
+                "\n"
+                "// LUT : " << id << "  (stage " << s << ")\n"
+                "\n"
+                "wire lut_" << id << "_out;\n"
+                "\n"
+                "bb_lut\n"
+                "        #(\n"
+                "            .N(" << lut.n << "),\n"
+                "            .INIT(" << (1 << lut.n) << "'b";
+            for ( int bit = (1 << lut.n) - 1; bit >= 0; --bit ) {
+                os << (((lut.table >> bit) & 1) ? "1" : "0");
+            }
+            os <<
+                "),\n"
+                "            .DEVICE(DEVICE)\n"
+                "        )\n"
+                "    i_lut_" << id << "\n"
+                "        (\n"
+                "            .in_data({\n";
+            for ( int k = lut.n - 1; k >= 0; --k ) {
+                index_t src = lut.input[k];
+                os << "                         " << SignalName(src, SourceDelay(src, s, stage)) << (k > 0 ? ",\n" : "\n");
+            }
+            os <<
+                "                    }),\n"
+                "            .out_data(lut_" << id << "_out)\n"
+                "        );\n"
+                "\n";
+
+            WriteDelay(os, SignalName(id, 0), id, delay[id]);
+        }
+
+        // user / valid
+        for ( index_t s = 1; s <= latency; ++s ) {
+            os
+                << "reg   [USER_BITS-1:0]  stage" << s << "_user;\n"
+                << "reg                    stage" << s << "_valid;\n";
+        }
+        os
+            << "always @(posedge clk) begin\n"
+            << "    if ( reset ) begin\n";
+        for ( index_t s = 1; s <= latency; ++s ) {
+            os
+                << "        stage" << s << "_user  <= {USER_BITS{1'bx}};\n"
+                << "        stage" << s << "_valid <= 1'b0;\n";
+        }
+        os
+            << "    end\n"
+            << "    else if ( cke ) begin\n";
+        for ( index_t s = 1; s <= latency; ++s ) {
+            if ( s == 1 ) {
+                os
+                    << "        stage" << s << "_user  <= in_user;\n"
+                    << "        stage" << s << "_valid <= in_valid;\n";
+            }
+            else {
+                os
+                    << "        stage" << s << "_user  <= stage" << (s - 1) << "_user;\n"
+                    << "        stage" << s << "_valid <= stage" << (s - 1) << "_valid;\n";
+            }
+        }
+        os
+            << "    end\n"
+            << "end\n"
+            << "\n\n";
+
+        // 出力
+        for ( index_t node = 0; node < (index_t)m_outputs.size(); ++node ) {
+            index_t src = m_outputs[node];
+            os << "assign out_data[" << node << "] = " << SignalName(src, SourceDelay(src, latency + 1, stage)) << ";\n";
+        }
+        os
+            << "assign out_user  = stage" << latency << "_user;\n"
+            << "assign out_valid = stage" << latency << "_valid;\n"
+            << "\n"
+            << "endmodule\n"
+            << "\n\n";
+    }
+
+
+protected:
+    index_t GetLutBase(void) const { return m_input_size + 2; }
+    index_t GetConst(bool value) const { return m_input_size + (value ? 1 : 0); }
+    bool    IsLut(index_t id) const { return id >= GetLutBase(); }
+
+    index_t AddLut(lut_t const &lut)
+    {
+        index_t id = GetLutBase() + (index_t)m_luts.size();
+        m_luts.push_back(lut);
+        m_replace.push_back(id);
+        return id;
+    }
+
+    index_t Resolve(index_t id) const
+    {
+        while ( IsLut(id) && m_replace[id - GetLutBase()] != id ) {
+            id = m_replace[id - GetLutBase()];
+        }
+        return id;
+    }
+
+    void Replace(index_t lut_index, index_t id)
+    {
+        m_replace[lut_index] = id;
+    }
+
+    bool IsAlive(index_t lut_index) const
+    {
+        return m_replace[lut_index] == GetLutBase() + lut_index;
+    }
+
+
+    // ---- 真理値表操作 (入力 k は表のインデックスの bit k) ----
+
+    // 入力 k を value に固定して取り除く
+    static std::uint64_t TableCofactor(std::uint64_t table, int n, int k, bool value)
+    {
+        std::uint64_t t = 0;
+        for ( int i = 0; i < (1 << (n - 1)); ++i ) {
+            int lo  = i & ((1 << k) - 1);
+            int hi  = (i >> k) << (k + 1);
+            int src = hi | (value ? (1 << k) : 0) | lo;
+            t |= ((table >> src) & 1) << i;
+        }
+        return t;
+    }
+
+    // 入力 k を反転
+    static std::uint64_t TableInvertInput(std::uint64_t table, int n, int k)
+    {
+        std::uint64_t t = 0;
+        for ( int i = 0; i < (1 << n); ++i ) {
+            t |= ((table >> (i ^ (1 << k))) & 1) << i;
+        }
+        return t;
+    }
+
+    // 入力 j と k (j < k) が同じ信号のとき k を取り除く
+    static std::uint64_t TableMergeInput(std::uint64_t table, int n, int j, int k)
+    {
+        std::uint64_t t = 0;
+        for ( int i = 0; i < (1 << (n - 1)); ++i ) {
+            int lo  = i & ((1 << k) - 1);
+            int hi  = (i >> k) << (k + 1);
+            int src = hi | (((i >> j) & 1) << k) | lo;
+            t |= ((table >> src) & 1) << i;
+        }
+        return t;
+    }
+
+    // LUT の正規化 (定数入力・重複入力・無関係な入力の除去と入力の整列)
+    bool Normalize(lut_t &lut) const
+    {
+        bool changed = false;
+
+        for ( int k = 0; k < lut.n; ) {
+            index_t src = lut.input[k];
+            if ( src == GetConst(false) || src == GetConst(true) ) {
+                lut.table = TableCofactor(lut.table, lut.n, k, src == GetConst(true));
+                RemoveInput(lut, k);
+                changed = true;
+                continue;
+            }
+
+            int dup = -1;
+            for ( int j = 0; j < k; ++j ) {
+                if ( lut.input[j] == src ) { dup = j; break; }
+            }
+            if ( dup >= 0 ) {
+                lut.table = TableMergeInput(lut.table, lut.n, dup, k);
+                RemoveInput(lut, k);
+                changed = true;
+                continue;
+            }
+
+            if ( TableCofactor(lut.table, lut.n, k, false) == TableCofactor(lut.table, lut.n, k, true) ) {
+                lut.table = TableCofactor(lut.table, lut.n, k, false);
+                RemoveInput(lut, k);
+                changed = true;
+                continue;
+            }
+
+            ++k;
+        }
+
+        // 共有判定のため入力を信号番号順に並べる
+        int order[MAX_LUT_INPUT];
+        for ( int k = 0; k < lut.n; ++k ) { order[k] = k; }
+        std::sort(order, order + lut.n, [&](int a, int b) { return lut.input[a] < lut.input[b]; });
+        bool sorted = true;
+        for ( int k = 0; k < lut.n; ++k ) {
+            if ( order[k] != k ) { sorted = false; }
+        }
+        if ( !sorted ) {
+            lut_t tmp;
+            tmp.n = lut.n;
+            for ( int i = 0; i < (1 << lut.n); ++i ) {
+                int src = 0;
+                for ( int k = 0; k < lut.n; ++k ) {
+                    src |= ((i >> k) & 1) << order[k];
+                }
+                tmp.table |= ((lut.table >> src) & 1) << i;
+            }
+            for ( int k = 0; k < lut.n; ++k ) {
+                tmp.input[k] = lut.input[order[k]];
+            }
+            lut = tmp;
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    static void RemoveInput(lut_t &lut, int k)
+    {
+        for ( int j = k; j < lut.n - 1; ++j ) {
+            lut.input[j] = lut.input[j + 1];
+        }
+        lut.n--;
+    }
+
+    // 置換の反映と正規化、定数 LUT・恒等 LUT の除去
+    bool Simplify(void)
+    {
+        bool changed = false;
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !IsAlive(i) ) { continue; }
+            auto &lut = m_luts[i];
+            for ( int k = 0; k < lut.n; ++k ) {
+                index_t src = Resolve(lut.input[k]);
+                if ( src != lut.input[k] ) {
+                    lut.input[k] = src;
+                    changed = true;
+                }
+            }
+            changed |= Normalize(lut);
+
+            if ( lut.n == 0 ) {
+                Replace(i, GetConst((lut.table & 1) != 0));
+                changed = true;
+            }
+            else if ( lut.n == 1 && (lut.table & 3) == 2 ) {
+                Replace(i, lut.input[0]);
+                changed = true;
+            }
+        }
+
+        for ( auto &out : m_outputs ) {
+            out = Resolve(out);
+        }
+        return changed;
+    }
+
+    // インバータを後段のテーブルに吸収 (出力に直接つながるものは残る)
+    bool AbsorbInverter(void)
+    {
+        bool changed = false;
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !IsAlive(i) ) { continue; }
+            auto &lut = m_luts[i];
+            for ( int k = 0; k < lut.n; ++k ) {
+                index_t src = lut.input[k];
+                if ( !IsLut(src) ) { continue; }
+                auto const &inv = m_luts[src - GetLutBase()];
+                if ( inv.n == 1 && (inv.table & 3) == 1 ) {
+                    lut.table    = TableInvertInput(lut.table, lut.n, k);
+                    lut.input[k] = inv.input[0];
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    // 同一入力・同一テーブルの LUT を共有
+    bool MergeDuplicate(void)
+    {
+        bool changed = false;
+        std::map< std::tuple< int, std::vector<index_t>, std::uint64_t >, index_t > hash;
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !IsAlive(i) ) { continue; }
+            auto const &lut = m_luts[i];
+            auto key = std::make_tuple(lut.n, std::vector<index_t>(lut.input, lut.input + lut.n), lut.table);
+            auto it = hash.find(key);
+            if ( it != hash.end() ) {
+                Replace(i, it->second);
+                changed = true;
+            }
+            else {
+                hash[key] = GetLutBase() + i;
+            }
+        }
+        if ( changed ) {
+            Simplify();
+        }
+        return changed;
+    }
+
+    // 単一ファンアウトの前段 LUT を、入力数が max_input 以下に収まるなら後段へ併合
+    bool MergeChain(int max_input)
+    {
+        index_t lut_base = GetLutBase();
+
+        std::vector<index_t> fanout(lut_base + m_luts.size(), 0);
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !IsAlive(i) ) { continue; }
+            for ( int k = 0; k < m_luts[i].n; ++k ) {
+                fanout[m_luts[i].input[k]]++;
+            }
+        }
+        for ( auto out : m_outputs ) {
+            fanout[out]++;
+        }
+
+        bool changed = false;
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !IsAlive(i) ) { continue; }
+            auto &lut = m_luts[i];
+            for ( int k = 0; k < lut.n; ) {
+                index_t src = lut.input[k];
+                if ( !IsLut(src) || fanout[src] != 1 ) { ++k; continue; }
+                auto const &pre = m_luts[src - lut_base];
+
+                // 合成後の入力 (後段の k 以外 + 前段の入力)
+                lut_t merged;
+                merged.n = 0;
+                for ( int j = 0; j < lut.n; ++j ) {
+                    if ( j != k ) { merged.input[merged.n++] = lut.input[j]; }
+                }
+                bool fit = true;
+                for ( int j = 0; j < pre.n; ++j ) {
+                    if ( std::find(merged.input, merged.input + merged.n, pre.input[j]) == merged.input + merged.n ) {
+                        if ( merged.n >= max_input ) { fit = false; break; }
+                        merged.input[merged.n++] = pre.input[j];
+                    }
+                }
+                if ( !fit ) { ++k; continue; }
+
+                // 全入力パターンで前段を評価してから後段を引く
+                for ( int a = 0; a < (1 << merged.n); ++a ) {
+                    int pre_index = 0;
+                    for ( int j = 0; j < pre.n; ++j ) {
+                        int pos = (int)(std::find(merged.input, merged.input + merged.n, pre.input[j]) - merged.input);
+                        pre_index |= ((a >> pos) & 1) << j;
+                    }
+                    int pre_value = (int)((pre.table >> pre_index) & 1);
+
+                    int index = 0;
+                    for ( int j = 0; j < lut.n; ++j ) {
+                        int bit = (j == k) ? pre_value : (int)((a >> (int)(std::find(merged.input, merged.input + merged.n, lut.input[j]) - merged.input)) & 1);
+                        index |= bit << j;
+                    }
+                    merged.table |= ((lut.table >> index) & 1) << a;
+                }
+
+                fanout[src] = 0;
+                Replace(src - lut_base, GetConst(false));   // 参照は無くなったので消すだけ
+                lut = merged;
+                Normalize(lut);
+                changed = true;
+                k = 0;
+            }
+        }
+        if ( changed ) {
+            Simplify();
+        }
+        return changed;
+    }
+
+    // 出力から到達しない LUT を削除し、生きている LUT だけを詰め直す
+    void Compact(void)
+    {
+        index_t lut_base = GetLutBase();
+        auto    live     = GetLiveFlags();
+
+        std::vector<index_t> remap(lut_base + m_luts.size(), -1);
+        for ( index_t i = 0; i < lut_base; ++i ) {
+            remap[i] = i;
+        }
+
+        std::vector<lut_t> luts;
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !live[i] ) { continue; }
+            lut_t lut = m_luts[i];
+            for ( int k = 0; k < lut.n; ++k ) {
+                lut.input[k] = remap[lut.input[k]];
+            }
+            remap[lut_base + i] = lut_base + (index_t)luts.size();
+            luts.push_back(lut);
+        }
+
+        m_luts.swap(luts);
+        m_replace.resize(m_luts.size());
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            m_replace[i] = lut_base + i;
+        }
+        for ( auto &out : m_outputs ) {
+            out = remap[out];
+        }
+    }
+
+    std::vector<bool> GetLiveFlags(void) const
+    {
+        index_t lut_base = GetLutBase();
+        std::vector<bool> live(m_luts.size(), false);
+        for ( auto out : m_outputs ) {
+            if ( IsLut(out) ) { live[out - lut_base] = true; }
+        }
+        for ( index_t i = (index_t)m_luts.size() - 1; i >= 0; --i ) {
+            if ( !live[i] ) { continue; }
+            for ( int k = 0; k < m_luts[i].n; ++k ) {
+                if ( IsLut(m_luts[i].input[k]) ) { live[m_luts[i].input[k] - lut_base] = true; }
+            }
+        }
+        return live;
+    }
+
+    // 入力からの LUT 段数 (1 始まり)
+    std::vector<index_t> GetLevels(void) const
+    {
+        index_t lut_base = GetLutBase();
+        std::vector<index_t> level(m_luts.size(), 0);
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            index_t l = 0;
+            for ( int k = 0; k < m_luts[i].n; ++k ) {
+                if ( IsLut(m_luts[i].input[k]) ) { l = std::max(l, level[m_luts[i].input[k] - lut_base]); }
+            }
+            level[i] = l + 1;
+        }
+        return level;
+    }
+
+    // 各信号のステージ(LUT の段数を register_depth で区切ったもの)と、後段のために置く遅延段数
+    void MakeStages(index_t register_depth, std::vector<index_t> &stage, std::vector<index_t> &delay) const
+    {
+        index_t lut_base = GetLutBase();
+        index_t latency  = GetLatency(register_depth);
+        auto    live     = GetLiveFlags();
+        auto    level    = GetLevels();
+
+        stage.assign(lut_base + m_luts.size(), 0);
+        delay.assign(lut_base + m_luts.size(), 0);
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !live[i] ) { continue; }
+            stage[lut_base + i] = (level[i] + register_depth - 1) / register_depth;
+        }
+        for ( index_t i = 0; i < (index_t)m_luts.size(); ++i ) {
+            if ( !live[i] ) { continue; }
+            for ( int k = 0; k < m_luts[i].n; ++k ) {
+                index_t src = m_luts[i].input[k];
+                delay[src] = std::max(delay[src], SourceDelay(src, stage[lut_base + i], stage));
+            }
+        }
+        for ( auto src : m_outputs ) {
+            delay[src] = std::max(delay[src], SourceDelay(src, latency + 1, stage));
+        }
+    }
+
+    // 64 フレーム分の入力ワードから LUT の出力ワードを求める (入力 k で表を半分ずつ選択)
+    static std::uint64_t EvaluateWord(lut_t const &lut, std::uint64_t const x[])
+    {
+        std::uint64_t v[64];
+        int size = (1 << lut.n);
+        for ( int j = 0; j < size; ++j ) {
+            v[j] = ((lut.table >> j) & 1) ? ~(std::uint64_t)0 : (std::uint64_t)0;
+        }
+        for ( int k = 0; k < lut.n; ++k ) {
+            size >>= 1;
+            for ( int j = 0; j < size; ++j ) {
+                v[j] = (v[2*j] & ~x[k]) | (v[2*j+1] & x[k]);
+            }
+        }
+        return v[0];
+    }
+
+    // stage の LUT が信号 id を使うときに必要な遅延段数
+    //   入力はステージ1で、LUT の出力は同じステージ内なら組み合わせのまま使う
+    index_t SourceDelay(index_t id, index_t stage, std::vector<index_t> const &stages) const
+    {
+        if ( id < m_input_size ) {
+            return stage - 1;
+        }
+        if ( !IsLut(id) ) {
+            return 0;
+        }
+        return stage - stages[id];
+    }
+
+    std::string SignalName(index_t id, index_t delay) const
+    {
+        std::stringstream ss;
+        if ( id < m_input_size ) {
+            if ( delay == 0 ) { ss << "in_data[" << id << "]"; }
+            else              { ss << "in_" << id << "_d" << delay; }
+        }
+        else if ( !IsLut(id) ) {
+            ss << (id == GetConst(true) ? "1'b1" : "1'b0");
+        }
+        else {
+            if ( delay == 0 ) { ss << "lut_" << id << "_out"; }
+            else              { ss << "lut_" << id << "_d" << delay; }
+        }
+        return ss.str();
+    }
+
+    // 信号の遅延段(FF)を出力
+    void WriteDelay(std::ostream& os, std::string src_name, index_t id, index_t delay) const
+    {
+        if ( delay <= 0 ) {
+            return;
+        }
+
+        for ( index_t d = 1; d <= delay; ++d ) {
+            os << "reg   " << SignalName(id, d) << ";\n";
+        }
+        os
+            << "always @(posedge clk) begin\n"
+            << "    if ( reset ) begin\n";
+        for ( index_t d = 1; d <= delay; ++d ) {
+            os << "        " << SignalName(id, d) << " <= 1'b0;\n";
+        }
+        os
+            << "    end\n"
+            << "    else if ( cke ) begin\n";
+        for ( index_t d = 1; d <= delay; ++d ) {
+            os << "        " << SignalName(id, d) << " <= " << (d == 1 ? src_name : SignalName(id, d - 1)) << ";\n";
+        }
+        os
+            << "    end\n"
+            << "end\n"
+            << "\n";
+    }
+};
+
+
+}
+
+// end of file
@@ -6,6 +6,9 @@
 #include "bbcu/bbcu.h"
 #endif
 
+#include "bb/ThreadPool.h"
+#include "bb/Memory.h"
+
 
 namespace bb {
 
@@ -33,6 +36,56 @@ public:
     {
     }
 #endif
+
+    // ホスト側の並列実行スレッド数(呼び出し元スレッドを含む)
+    static void SetThreadCount(int thread_count)
+    {
+        ThreadPool::GetInstance().SetThreadCount(thread_count);
+    }
+
+    static int GetThreadCount(void)
+    {
+        return ThreadPool::GetInstance().GetThreadCount();
+    }
+
+    // 粒度を自動で決める際の1スレッドあたりのタスク数
+    static void SetTasksPerThread(int tasks)
+    {
+        ThreadPool::GetInstance().SetTasksPerThread(tasks);
+    }
+
+    // ワーカースレッドの CPU 固定 (Linux のみ)
+    static void SetThreadAffinity(bool enable)
+    {
+        ThreadPool::GetInstance().SetAffinity(enable);
+    }
+
+    // FrameBuffer 確保時に、ノード範囲を分担するスレッドが先にメモリに触れて(first-touch)
+    // 各ノード範囲を処理するスレッドのいる NUMA ノードに配置させる
+    // ノードループを処理するカーネルと同じく OpenMP の static 分担で触れるので、
+    // OMP_PROC_BIND / OMP_PLACES で OpenMP スレッドを固定しておくこと
+    static void SetNumaFirstTouch(bool enable)
+    {
+        NumaFirstTouch() = enable;
+    }
+
+    static bool IsNumaFirstTouch(void)
+    {
+        return NumaFirstTouch();
+    }
+
+    // この大きさ以上のホストメモリは Huge Page で確保する (0 なら使わない)
+    static void SetHugePageThreshold(size_t size)
+    {
+        Memory::SetHugePageThreshold(size);
+    }
+
+protected:
+    static bool &NumaFirstTouch(void)
+    {
+        static bool enable = false;
+        return enable;
+    }
 };
 
 
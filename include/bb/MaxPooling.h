@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <random>
+#include <algorithm>
 
 #include "bb/Filter2d.h"
 
@@ -36,6 +37,8 @@ protected:
     index_t             m_output_h_size;
     index_t             m_output_c_size;
 
+    index_t             m_bit_plane_size = 0;   // 0 以外でチャネルを k 枚のビットプレーンとして扱う (BitPlane.h)
+
     indices_t           m_input_shape;
     indices_t           m_output_shape;
 
@@ -45,8 +48,9 @@ protected:
 public:
     struct create_t
     {
-        index_t filter_h_size = 1;
-        index_t filter_w_size = 1;
+        index_t filter_h_size  = 1;
+        index_t filter_w_size  = 1;
+        index_t bit_plane_size = 0;     //< 0 以外で Bit 入力を k ビットのビットプレーンとして最大値をとる
     };
 
 
@@ -55,7 +59,8 @@ protected:
     MaxPooling(create_t const &create)
     {
         m_filter_h_size = create.filter_h_size;
-        m_filter_w_size = create.filter_w_size;
+        m_filter_w_size  = create.filter_w_size;
+        m_bit_plane_size = create.bit_plane_size;
     }
 
     /**
@@ -102,6 +107,19 @@ public:
     index_t GetFilterHeight(void) { return m_filter_h_size; }
     index_t GetFilterWidth(void)  { return m_filter_w_size; }
 
+    /**
+     * @brief  ビットプレーン入力設定
+     * @detail 0 以外を設定すると、Bit 入力のチャネルを k 枚のビットプレーン
+     *         (channel = plane * C + c) とみなし、各ビットの OR ではなく k ビット値の最大値をとる
+     * @param  bit_plane_size ビット数 k (0 で通常に戻す)
+     */
+    void SetBitPlaneSize(index_t bit_plane_size)
+    {
+        m_bit_plane_size = bit_plane_size;
+    }
+
+    index_t GetBitPlaneSize(void) const { return m_bit_plane_size; }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -120,6 +138,7 @@ public:
         m_output_w_size = (m_input_w_size + m_filter_w_size - 1) / m_filter_w_size;
         m_output_h_size = (m_input_h_size + m_filter_h_size - 1) / m_filter_h_size;
         m_output_c_size = m_input_c_size;
+        BB_ASSERT(m_bit_plane_size == 0 || m_input_c_size % m_bit_plane_size == 0);
 
         m_input_shape  = shape;
         m_output_shape = indices_t({m_output_w_size, m_output_h_size, m_output_c_size});
@@ -215,7 +234,7 @@ public:
         }
         
         // Bit CUDA版
-        if ( DataType<FT>::type == BB_TYPE_BIT && !m_host_only && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
+        if ( DataType<FT>::type == BB_TYPE_BIT && !m_host_only && m_bit_plane_size == 0 && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
             auto ptr_x = x_buf.LockDeviceMemoryConst();
             auto ptr_y = y_buf.LockDeviceMemory(true);
             bbcu_bit_MaxPooling_Forward
@@ -237,20 +256,26 @@ public:
         }
 #endif
      
+        if ( DataType<FT>::type == BB_TYPE_BIT && m_bit_plane_size > 0 ) {
+            ForwardBitPlane(x_buf, y_buf);
+            return y_buf;
+        }
+
         if ( DataType<FT>::type == BB_TYPE_BIT ) {
             // バイナリ用実装
             auto x_ptr = x_buf.LockConst<FT>();
             auto y_ptr = y_buf.Lock<FT>(true);
 
-            index_t  m256_frame_size = (int)y_buf.GetFrameStride() / 32;
-
-            #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        __m256i *y_addr = (__m256i *)y_ptr.GetAddr(GetOutputNode(c, y, x));
+            // 出力ノード x 256フレーム単位のブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_output_c_size * m_output_h_size * m_output_w_size, y_buf.GetFrameSize(),
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t node = node_start; node < node_end; ++node) {
+                        index_t c = node / (m_output_h_size * m_output_w_size);
+                        index_t y = (node / m_output_w_size) % m_output_h_size;
+                        index_t x = node % m_output_w_size;
+                        __m256i *y_addr = (__m256i *)y_ptr.GetAddr(node);
 
-                        for (index_t frame = 0; frame < m256_frame_size; ++frame) {
+                        for (index_t frame = frame_start / 256; frame < (frame_end + 255) / 256; ++frame) {
                             __m256i max_val = _mm256_set1_epi8(0);
                             for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
                                 index_t iy = y*m_filter_h_size + fy;
@@ -268,8 +293,7 @@ public:
                             _mm256_store_si256(&y_addr[frame], max_val);
                         }
                     }
-                }
-            }
+                });
 
             return y_buf;
         }
@@ -279,15 +303,16 @@ public:
             auto x_ptr = x_buf.LockConst<FT>();
             auto y_ptr = y_buf.Lock<FT>(true);
 
-            index_t  m256_frame_size = (int)y_buf.GetFrameStride() / sizeof(float);
-
-            #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        float *y_addr = (float *)y_ptr.GetAddr(GetOutputNode(c, y, x));
+            // 出力ノード x 256フレーム単位のブロックで分割
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_output_c_size * m_output_h_size * m_output_w_size, y_buf.GetFrameSize(),
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t node = node_start; node < node_end; ++node) {
+                        index_t c = node / (m_output_h_size * m_output_w_size);
+                        index_t y = (node / m_output_w_size) % m_output_h_size;
+                        index_t x = node % m_output_w_size;
+                        float *y_addr = (float *)y_ptr.GetAddr(node);
 
-                        for (index_t frame = 0; frame < m256_frame_size; frame += 8) {
+                        for (index_t frame = frame_start; frame < frame_end; frame += 8) {
                             __m256  max_val = _mm256_set1_ps(-1.0e7f);  // 前段に活性化入れるから0がminだよね？
                             for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
                                 index_t iy = y*m_filter_h_size + fy;
@@ -305,8 +330,7 @@ public:
                             _mm256_store_ps(&y_addr[frame], max_val);
                         }
                     }
-                }
-            }
+                });
 
             return y_buf;
         }
@@ -390,7 +414,7 @@ public:
 #endif
 
 #ifdef BB_WITH_CUDA
-        if ( DataType<FT>::type == BB_TYPE_BIT && DataType<BT>::type == BB_TYPE_FP32 && !m_host_only 
+        if ( DataType<FT>::type == BB_TYPE_BIT && DataType<BT>::type == BB_TYPE_FP32 && !m_host_only && m_bit_plane_size == 0
                 && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
             // CUDA版
             auto ptr_x  = x_buf.LockDeviceMemoryConst();
@@ -421,21 +445,22 @@ public:
 
         if ( DataType<BT>::type == BB_TYPE_FP32 && DataType<FT>::type == BB_TYPE_FP32 ) {
             // float用実装
-            index_t  m256_frame_size = dx_buf.GetFrameStride() / sizeof(float);
-
             auto x_ptr  = x_buf.LockConst<FT>();
             auto y_ptr  = y_buf.LockConst<FT>();
             auto dy_ptr = dy_buf.LockConst<BT>();
             auto dx_ptr = dx_buf.Lock<BT>(true);
 
-    #pragma omp parallel for
-            for (index_t n = 0; n < m_input_c_size; ++n) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        float const * y_addr  = (float const *)y_ptr.GetAddr(GetOutputNode(n, y, x));
-                        float const * dy_addr = (float const *)dy_ptr.GetAddr(GetOutputNode(n, y, x));
-
-                        for (index_t frame = 0; frame < m256_frame_size; frame += 8) {
+            // 出力ノード x 256フレーム単位のブロックで分割 (プーリング窓は重ならないので書き込み先も重ならない)
+            ThreadPool::GetInstance().ParallelForNodeFrame(m_output_c_size * m_output_h_size * m_output_w_size, dx_buf.GetFrameSize(),
+                [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                    for (index_t node = node_start; node < node_end; ++node) {
+                        index_t n = node / (m_output_h_size * m_output_w_size);
+                        index_t y = (node / m_output_w_size) % m_output_h_size;
+                        index_t x = node % m_output_w_size;
+                        float const * y_addr  = (float const *)y_ptr.GetAddr(node);
+                        float const * dy_addr = (float const *)dy_ptr.GetAddr(node);
+
+                        for (index_t frame = frame_start; frame < frame_end; frame += 8) {
                             __m256 out_sig  = _mm256_load_ps(&y_addr[frame]);
                             __m256 out_grad = _mm256_load_ps(&dy_addr[frame]);
                             for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
@@ -456,9 +481,13 @@ public:
                             }
                         }
                     }
-                }
-            }
+                });
+
+            return dx_buf;
+        }
 
+        if ( DataType<FT>::type == BB_TYPE_BIT && m_bit_plane_size > 0 ) {
+            BackwardBitPlane(x_buf, y_buf, dy_buf, dx_buf);
             return dx_buf;
         }
 
@@ -498,6 +527,101 @@ public:
             return dx_buf;
         }
     }
+
+protected:
+    // ビットプレーンの最大値 (上位プレーンから、その桁までの値が最大と一致する入力だけを残していく)
+    void ForwardBitPlane(FrameBuffer const &x_buf, FrameBuffer &y_buf)
+    {
+        auto x_ptr = x_buf.LockMemoryConst();
+        auto y_ptr = y_buf.LockMemory(true);
+        auto x_addr   = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr   = (std::uint8_t       *)y_ptr.GetAddr();
+        auto x_stride = x_buf.GetFrameStride();
+        auto y_stride = y_buf.GetFrameStride();
+
+        index_t c_size = m_output_c_size / m_bit_plane_size;
+
+        ThreadPool::GetInstance().ParallelForNodeFrame(c_size * m_output_h_size * m_output_w_size, y_buf.GetFrameSize(),
+            [&](index_t node_start, index_t node_end, index_t frame_start, index_t frame_end) {
+                std::vector<std::uint64_t const *>  in_vec;
+                std::vector<std::uint64_t>          alive;
+                for (index_t node = node_start; node < node_end; ++node) {
+                    index_t c = node / (m_output_h_size * m_output_w_size);
+                    index_t y = (node / m_output_w_size) % m_output_h_size;
+                    index_t x = node % m_output_w_size;
+
+                    in_vec.clear();
+                    for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
+                        index_t iy = y*m_filter_h_size + fy;
+                        if ( iy >= m_input_h_size ) { continue; }
+                        for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
+                            index_t ix = x*m_filter_w_size + fx;
+                            if ( ix >= m_input_w_size ) { continue; }
+                            for (index_t p = 0; p < m_bit_plane_size; ++p) {
+                                in_vec.push_back((std::uint64_t const *)(x_addr + x_stride * GetInputNode(p * c_size + c, iy, ix)));
+                            }
+                        }
+                    }
+                    index_t window_size = (index_t)in_vec.size() / m_bit_plane_size;
+                    alive.resize(window_size);
+
+                    for (index_t word = frame_start / 64; word < (frame_end + 63) / 64; ++word) {
+                        std::fill(alive.begin(), alive.end(), ~(std::uint64_t)0);
+                        for (index_t p = m_bit_plane_size - 1; p >= 0; --p) {
+                            std::uint64_t max_bit = 0;
+                            for (index_t i = 0; i < window_size; ++i) {
+                                max_bit |= alive[i] & in_vec[i * m_bit_plane_size + p][word];
+                            }
+                            for (index_t i = 0; i < window_size; ++i) {
+                                alive[i] &= ~(max_bit & ~in_vec[i * m_bit_plane_size + p][word]);
+                            }
+                            auto y_vec = (std::uint64_t *)(y_addr + y_stride * GetOutputNode(p * c_size + c, y, x));
+                            y_vec[word] = max_bit;
+                        }
+                    }
+                }
+            });
+    }
+
+    // 最大値と一致した入力の全プレーンに勾配を流す
+    void BackwardBitPlane(FrameBuffer const &x_buf, FrameBuffer const &y_buf, FrameBuffer const &dy_buf, FrameBuffer &dx_buf)
+    {
+        auto x_ptr  = x_buf.LockConst<FT>();
+        auto y_ptr  = y_buf.LockConst<FT>();
+        auto dy_ptr = dy_buf.LockConst<BT>();
+        auto dx_ptr = dx_buf.Lock<BT>(true);
+
+        auto    frame_size = x_buf.GetFrameSize();
+        index_t c_size     = m_output_c_size / m_bit_plane_size;
+
+        #pragma omp parallel for
+        for (index_t c = 0; c < c_size; ++c) {
+            for (index_t y = 0; y < m_output_h_size; ++y) {
+                for (index_t x = 0; x < m_output_w_size; ++x) {
+                    for (index_t frame = 0; frame < frame_size; ++frame) {
+                        for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
+                            index_t iy = y*m_filter_h_size + fy;
+                            if ( iy >= m_input_h_size ) { continue; }
+                            for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
+                                index_t ix = x*m_filter_w_size + fx;
+                                if ( ix >= m_input_w_size ) { continue; }
+                                bool match = true;
+                                for (index_t p = 0; p < m_bit_plane_size; ++p) {
+                                    if ( x_ptr.Get(frame, GetInputNode(p * c_size + c, iy, ix)) != y_ptr.Get(frame, GetOutputNode(p * c_size + c, y, x)) ) {
+                                        match = false;
+                                    }
+                                }
+                                for (index_t p = 0; p < m_bit_plane_size; ++p) {
+                                    BT grad = dy_ptr.Get(frame, GetOutputNode(p * c_size + c, y, x));
+                                    dx_ptr.Set(frame, GetInputNode(p * c_size + c, iy, ix), match ? grad : (BT)0);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
 };
 
 
@@ -15,6 +15,10 @@
 #include <atomic>
 #include <type_traits>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #ifdef BB_WITH_CUDA
 #include "cuda_runtime.h"
 #include "bbcu/bbcu.h"
@@ -109,6 +113,12 @@ public:
             return m_addr;
         }
 
+        // 先頭を byte_offset ずらしたポインタ(同じメモリのロックを共有する)
+        ConstPtr_ Offset(index_t byte_offset) const
+        {
+            return ConstPtr_((std::uint8_t const *)m_addr + byte_offset, m_mem);
+        }
+
         template<typename Tp>
         Tp const& At(index_t index) const {
 //          BB_DEBUG_ASSERT(m_ptr != nullptr);
@@ -181,6 +191,12 @@ public:
             return m_addr;
         }
 
+        // 先頭を byte_offset ずらしたポインタ(同じメモリのロックを共有する)
+        Ptr_ Offset(index_t byte_offset) const
+        {
+            return Ptr_((std::uint8_t *)m_addr + byte_offset, m_mem);
+        }
+
         operator ConstTp() const
         {
            return ConstTp(m_addr, m_mem);
@@ -207,6 +223,8 @@ protected:
     std::atomic<int>    m_hostRefCnt;
     bool                m_hostOnly = true;
     bool                m_hostModified = false;
+    std::atomic<int>    m_writeRefCnt;
+    std::atomic<std::uint64_t>  m_revision;
 
 #ifdef BB_WITH_CUDA
     size_t              m_mem_size = 0;
@@ -231,11 +249,17 @@ protected:
     static void RelRefDevice(Memory *self) {}
 #endif
 
+    // 書き込み用ロックは解放時にリビジョンを進める
+    static void GetWriteRef(Memory *self)       { GetRef(self); self->m_writeRefCnt++; }
+    static void RelWriteRef(Memory *self)       { self->m_revision = NewRevision(); self->m_writeRefCnt--; RelRef(self); }
+    static void GetWriteRefDevice(Memory *self) { GetRefDevice(self); self->m_writeRefCnt++; }
+    static void RelWriteRefDevice(Memory *self) { self->m_revision = NewRevision(); self->m_writeRefCnt--; RelRefDevice(self); }
+
 public:
-    using ConstPtr    = ConstPtr_<GetRef, RelRef>;                        //< 読み書き可能なHOSTメモリのポインタオブジェクト
-    using Ptr         = Ptr_<ConstPtr, GetRef, RelRef>;                   //< リードオンリーなHOSTメモリのポインタオブジェクト
-    using DevConstPtr = ConstPtr_<&GetRefDevice, &RelRefDevice>;          //< 読み書き可能なDeviceメモリのポインタオブジェクト
-    using DevPtr      = Ptr_<DevConstPtr, &GetRefDevice, &RelRefDevice>;  //< リードオンリーなDeviceTメモリのポインタオブジェクト
+    using ConstPtr    = ConstPtr_<GetRef, RelRef>;                                  //< リードオンリーなHOSTメモリのポインタオブジェクト
+    using Ptr         = Ptr_<ConstPtr, GetWriteRef, RelWriteRef>;                   //< 読み書き可能なHOSTメモリのポインタオブジェクト
+    using DevConstPtr = ConstPtr_<&GetRefDevice, &RelRefDevice>;                    //< リードオンリーなDeviceメモリのポインタオブジェクト
+    using DevPtr      = Ptr_<DevConstPtr, &GetWriteRefDevice, &RelWriteRefDevice>;  //< 読み書き可能なDeviceメモリのポインタオブジェクト
 
     friend Ptr;
     friend ConstPtr;
@@ -270,12 +294,14 @@ protected:
      *           -2     GPUは利用しない
      * @return なし
      */
-    Memory(size_t size, bool hostOnly=false) : m_hostRefCnt(0)
+    Memory(size_t size, bool hostOnly=false) : m_hostRefCnt(0), m_writeRefCnt(0), m_revision(0)
     {
         // 初期化
-        m_size       = size;
-        m_hostRefCnt = 0;
-        m_hostOnly   = hostOnly;
+        m_size        = size;
+        m_hostRefCnt  = 0;
+        m_writeRefCnt = 0;
+        m_hostOnly    = hostOnly;
+        m_revision    = NewRevision();
 
 #ifdef BB_WITH_CUDA
         m_mem_size     = m_size;
@@ -292,11 +318,11 @@ protected:
 
         // デバイスが使えなければここでホストメモリ確保
         if ( !m_devAvailable ) {
-            m_addr = aligned_memory_alloc(m_size, 32);
+            m_addr = AllocateHost(m_size);
         }
 #else
         // メモリ確保
-        m_addr = aligned_memory_alloc(m_size, 32);
+        m_addr = AllocateHost(m_size);
 #endif
     }
 
@@ -390,6 +416,8 @@ public:
      */
     void Resize(size_t size)
     {
+        m_revision = NewRevision();
+
         BB_ASSERT(m_hostRefCnt == 0);
 
 #ifdef BB_WITH_CUDA
@@ -415,18 +443,84 @@ public:
         else {
             // ホストメモリ再確保
             aligned_memory_free(m_addr);
-            m_addr = aligned_memory_alloc(size, 32);
+            m_addr = AllocateHost(size);
             m_hostModified = false;
         }
 #else
         aligned_memory_free(m_addr);
-        m_addr = aligned_memory_alloc(size, 32);
+        m_addr = AllocateHost(size);
         m_size = size;
         m_hostModified = false;
 #endif
     }
 
 
+    /**
+     * @brief  内容のリビジョン取得
+     * @detail 書き込み用のロックが解放される度に全メモリで一意な新しい値に変わる
+     *         書き込み用ロック中は書き換えられている可能性があるので毎回新しい値を返す
+     *         (読み出し専用のロックは影響しない)
+     *         計算結果のキャッシュが最新かどうかの判定に使う
+     * @return リビジョン
+     */
+    std::uint64_t GetRevision(void) const
+    {
+        if ( m_writeRefCnt > 0 ) {
+            return NewRevision();
+        }
+        return m_revision;
+    }
+
+protected:
+    static std::uint64_t NewRevision(void)
+    {
+        static std::atomic<std::uint64_t> revision(0);
+        return ++revision;
+    }
+
+    static size_t &HugePageThreshold(void)
+    {
+        static size_t threshold = 0;
+        return threshold;
+    }
+
+    // ホストメモリ確保(閾値以上の大きさなら Huge Page 境界で確保して THP を要求する)
+    static void *AllocateHost(size_t size)
+    {
+#ifdef __linux__
+        size_t const huge_page_size = 2 * 1024 * 1024;
+        size_t       threshold      = HugePageThreshold();
+        if ( threshold > 0 && size >= threshold ) {
+            size_t alloc_size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+            void *addr = aligned_memory_alloc(alloc_size, huge_page_size);
+            if ( addr != nullptr ) {
+                madvise(addr, alloc_size, MADV_HUGEPAGE);
+            }
+            return addr;
+        }
+#endif
+        return aligned_memory_alloc(size, 32);
+    }
+
+public:
+    /**
+     * @brief  Huge Page を使う大きさの設定
+     * @detail size バイト以上のホストメモリは 2MB 境界で確保し、
+     *         Transparent Huge Page を要求する (Linux のみ有効)
+     *         大きな FrameBuffer やパラメータの TLB ミスを減らす
+     * @param  size 閾値(0 なら使わない)
+     */
+    static void SetHugePageThreshold(size_t size)
+    {
+        HugePageThreshold() = size;
+    }
+
+    static size_t GetHugePageThreshold(void)
+    {
+        return HugePageThreshold();
+    }
+
+public:
     /**
      * @brief  メモリサイズの取得
      * @detail メモリサイズの取得
@@ -473,6 +567,8 @@ public:
     {
         if ( m_size == 0 ) { return; }
 
+        m_revision = NewRevision();
+
 #ifdef BB_WITH_CUDA
         // メモリ未確保なら確保
         if (m_addr == nullptr && m_devAddr == nullptr) {
@@ -680,7 +776,7 @@ public:
 
         if (hostOnly) {
             // メモリ確保
-            auto newAddr = aligned_memory_alloc(m_size, 32);
+            auto newAddr = AllocateHost(m_size);
             BB_ASSERT(m_addr != nullptr);
 
             // データがあればコピー
@@ -56,23 +56,49 @@ public:
         index_t frame_size = y.GetFrameSize();
         index_t node_size  = y.GetNodeSize();
 
-        auto y_ptr = y.LockConst<T>();
-        auto t_ptr = t.LockConst<T>();
-
-        for (index_t frame = 0; frame < frame_size; ++frame) {
+        if ( DataType<T>::type == BB_TYPE_BIT ) {
+            // Bit型は一致したビット(XNOR)をパックされたままワード単位で数える
+            auto y_ptr = y.LockMemoryConst();
+            auto t_ptr = t.LockMemoryConst();
+            auto y_addr = (std::uint8_t const *)y_ptr.GetAddr();
+            auto t_addr = (std::uint8_t const *)t_ptr.GetAddr();
+
+            index_t y_frame_stride = y.GetFrameStride();
+            index_t t_frame_stride = t.GetFrameStride();
+            index_t word_size      = frame_size / 64;
+            index_t tail_size      = frame_size % 64;
+
+            std::int64_t count = 0;
+            #pragma omp parallel for reduction(+:count)
             for (index_t node = 0; node < node_size; ++node) {
-                T   sig_val = y_ptr.Get(frame, node);
-                T   exp_val = t_ptr.Get(frame, node);
-
-                bool    sig = (y_ptr.Get(frame, node) >= (T)0.5);
-                bool    exp = (t_ptr.Get(frame, node) >= (T)0.5);
-
-//              std::cout << " " << exp << " " << sig << std::endl;
+                auto y_vec = (std::uint64_t const *)(y_addr + node * y_frame_stride);
+                auto t_vec = (std::uint64_t const *)(t_addr + node * t_frame_stride);
+                for (index_t word = 0; word < word_size; ++word) {
+                    count += bb_popcnt_u64(~(y_vec[word] ^ t_vec[word]));
+                }
+                if ( tail_size > 0 ) {
+                    std::uint64_t mask = ((std::uint64_t)1 << tail_size) - 1;
+                    count += bb_popcnt_u64(~(y_vec[word_size] ^ t_vec[word_size]) & mask);
+                }
+            }
+            m_accuracy += (double)count;
+        }
+        else {
+            auto y_ptr = y.LockConst<T>();
+            auto t_ptr = t.LockConst<T>();
 
-                if (sig == exp) {
-                    m_accuracy += 1.0;
+            std::int64_t count = 0;
+            #pragma omp parallel for reduction(+:count)
+            for (index_t node = 0; node < node_size; ++node) {
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    bool    sig = (y_ptr.Get(frame, node) >= (T)0.5);
+                    bool    exp = (t_ptr.Get(frame, node) >= (T)0.5);
+                    if (sig == exp) {
+                        count += 1;
+                    }
                 }
             }
+            m_accuracy += (double)count;
         }
 
         m_frames += frame_size;
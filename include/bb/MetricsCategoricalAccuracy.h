@@ -61,6 +61,10 @@ public:
 
 #ifdef BB_WITH_CUDA
         if ( DataType<T>::type == BB_TYPE_FP32 && y.IsDeviceAvailable() && t.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
+            // カーネルは y/t 共通のストライドで読むのでビューは詰めたコピーにする
+            if ( y.IsView() ) { y = y.Clone(); }
+            if ( t.IsView() ) { t = t.Clone(); }
+
             auto y_ptr   = y.LockDeviceMemoryConst();
             auto t_ptr   = t.LockDeviceMemoryConst();
             auto acc_ptr = m_accuracy.LockDeviceMemory();
@@ -161,6 +161,20 @@ public:
         return gradients;
     }  
 
+    /**
+     * @brief  統計量取得
+     * @detail 内部のレイヤーの統計量をまとめて取得する
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_affine    ->GetStatistics());
+        statistics.PushBack(m_batch_norm->GetStatistics());
+        statistics.PushBack(m_activation->GetStatistics());
+        return statistics;
+    }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -174,9 +188,40 @@ public:
         shape = m_affine    ->SetInputShape(shape);
         shape = m_batch_norm->SetInputShape(shape);
         shape = m_activation->SetInputShape(shape);
+        this->SetChainInputGradient({m_affine, m_batch_norm, m_activation}, this->m_input_gradient);
         return shape;
     }
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail 手前に学習対象が無い内部レイヤーは入力勾配を不要とする
+     * @param  enable 入力勾配が必要か
+     */
+    void SetInputGradient(bool enable)
+    {
+        this->m_input_gradient = enable;
+        this->SetChainInputGradient({m_affine, m_batch_norm, m_activation}, enable);
+    }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail 内部のレイヤーをまとめて固定する
+     * @param  frozen 固定するなら true
+     */
+    void SetFrozen(bool frozen)
+    {
+        this->m_frozen = frozen;
+        m_affine    ->SetFrozen(frozen);
+        m_batch_norm->SetFrozen(frozen);
+        m_activation->SetFrozen(frozen);
+        SetInputGradient(this->m_input_gradient);
+    }
+
+    bool IsTrainable(void)
+    {
+        return m_affine->IsTrainable() || m_batch_norm->IsTrainable() || m_activation->IsTrainable();
+    }
+
     /**
      * @brief  入力形状取得
      * @detail 入力形状を取得する
@@ -256,10 +301,7 @@ public:
             m_activation->SetFrameBufferX(x_buf);
         }
 
-        dy_buf = m_activation->Backward(dy_buf);
-        dy_buf = m_batch_norm->Backward(dy_buf);
-        dy_buf = m_affine    ->Backward(dy_buf);
-        return dy_buf; 
+        return this->BackwardChain({m_affine, m_batch_norm, m_activation}, dy_buf);
     }
 
 
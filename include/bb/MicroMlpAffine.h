@@ -16,6 +16,8 @@
 #include "bb/Manager.h"
 #include "bb/SparseLayer.h"
 #include "bb/ShuffleSet.h"
+#include "bb/SparseForwardTable.h"
+#include "bb/QuantizeInt8.h"
 
 namespace bb {
 
@@ -32,6 +34,9 @@ public:   // debug
     bool                    m_binary_mode = false;
     bool                    m_host_only   = false;
     bool                    m_host_simd   = true;
+    bool                    m_host_table  = true;
+    bool                    m_int8_mode      = false;
+    bool                    m_int8_calibrate = false;
     
     std::string             m_connection;
 
@@ -56,6 +61,17 @@ public:   // debug
     std::shared_ptr<Tensor> m_dW1;
     std::shared_ptr<Tensor> m_db1;
 
+    SparseForwardTable<N, T> m_forward_table;
+
+    // INT8 推論用
+    float                       m_x_int8_abs_max = 0;   // 較正した入力の max|x|
+    std::vector<float>          m_h_int8_abs_max;       // 較正した中間層(ReLU後)のノード毎の最大値
+    std::vector<std::uint64_t>  m_int8_key;
+    std::vector<std::int8_t>    m_W0_int8;              // [node][M][N]
+    std::vector<float>          m_W0_int8_scale;        // [node][M]
+    std::vector<std::int8_t>    m_W1_int8;              // [node][M]
+    std::vector<float>          m_W1_int8_scale;        // [node]
+
 public:
     FrameBuffer             m_x_buf;
 
@@ -90,6 +106,31 @@ protected:
         {
             m_host_simd = EvalBool(args[1]);
         }
+
+        // Host テーブル引きモード設定
+        if (args.size() == 2 && args[0] == "host_table")
+        {
+            m_host_table = EvalBool(args[1]);
+        }
+
+        // INT8 推論の較正 (有効にした後の Forward で入力と中間層の範囲を集計する)
+        if (args.size() == 2 && args[0] == "int8_calibrate")
+        {
+            m_int8_calibrate = EvalBool(args[1]);
+            if ( m_int8_calibrate ) {
+                m_x_int8_abs_max = 0;
+                m_h_int8_abs_max.clear();
+            }
+        }
+
+        // INT8 推論モード設定
+        if (args.size() == 2 && args[0] == "int8")
+        {
+            m_int8_mode = EvalBool(args[1]);
+            if ( m_int8_mode ) {
+                m_int8_calibrate = false;
+            }
+        }
     }
 
 public:
@@ -287,6 +328,29 @@ public:
         return (index_t)ptr(node, input_index);
     }
 
+    bool PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        BB_ASSERT((index_t)order.size() == m_output_node_size);
+        Tensor_PermuteOuter(m_input_index, order);
+        Tensor_PermuteOuter(*m_W0,  order);
+        Tensor_PermuteOuter(*m_b0,  order);
+        Tensor_PermuteOuter(*m_W1,  order);
+        Tensor_PermuteOuter(*m_b1,  order);
+        Tensor_PermuteOuter(*m_dW0, order);
+        Tensor_PermuteOuter(*m_db0, order);
+        Tensor_PermuteOuter(*m_dW1, order);
+        Tensor_PermuteOuter(*m_db1, order);
+
+        if ( !m_h_int8_abs_max.empty() ) {
+            std::vector<float> h_abs_max(m_output_node_size);
+            for ( index_t node = 0; node < m_output_node_size; ++node ) {
+                h_abs_max[node] = m_h_int8_abs_max[order[node]];
+            }
+            m_h_int8_abs_max = h_abs_max;
+        }
+        return true;
+    }
+
 
    /**
      * @brief  入力のshape設定
@@ -424,6 +488,240 @@ public:
     }
 
 
+protected:
+    // INT8 推論用に入力と中間層(ReLU後)の範囲を集計
+    void CalibrateInt8(FrameBuffer const &x_buf)
+    {
+        auto frame_size = x_buf.GetFrameSize();
+        auto x_ptr = x_buf.LockConst<FXT>();
+        auto input_index_ptr = m_input_index.LockConst();
+        auto W0_ptr = lock_W0_const();
+        auto b0_ptr = lock_b0_const();
+
+        auto x_view = x_ptr.GetView();
+
+        m_x_int8_abs_max = std::max(m_x_int8_abs_max, Int8_AbsMax<FXT>(x_buf));
+        m_h_int8_abs_max.resize(m_output_node_size, 0.0f);
+
+#pragma omp parallel for
+        for ( index_t node = 0; node < m_output_node_size; ++node ) {
+            float h_max = m_h_int8_abs_max[node];
+            for (index_t frame = 0; frame < frame_size; ++frame ) {
+                T   in_sig[N];
+                for ( int i = 0; i < N; ++i) {
+                    in_sig[i] = x_view.Get(frame, input_index_ptr(node, i));
+                }
+                for (int i = 0; i < M; ++i) {
+                    T   sum0 = b0_ptr(node, i);
+                    for (int j = 0; j < N; ++j) {
+                        sum0 += in_sig[j] * W0_ptr(node, i, j);
+                    }
+                    h_max = std::max(h_max, (float)sum0);
+                }
+            }
+            m_h_int8_abs_max[node] = h_max;
+        }
+    }
+
+    // 重みを int8 に量子化 (W0 は中間ノード毎、W1 は出力ノード毎のスケール)
+    void PackInt8Weight(void)
+    {
+        std::vector<std::uint64_t> key = { m_W0->GetRevision(), m_W1->GetRevision() };
+        if ( !m_W0_int8.empty() && key == m_int8_key ) {
+            return;
+        }
+
+        m_W0_int8.resize(m_output_node_size * M * N);
+        m_W0_int8_scale.resize(m_output_node_size * M);
+        m_W1_int8.resize(m_output_node_size * M);
+        m_W1_int8_scale.resize(m_output_node_size);
+
+        auto W0_ptr = lock_W0_const();
+        auto W1_ptr = lock_W1_const();
+
+#pragma omp parallel for
+        for ( index_t node = 0; node < m_output_node_size; ++node ) {
+            for ( int i = 0; i < M; ++i ) {
+                T w0[N];
+                float abs_max = 0;
+                for ( int j = 0; j < N; ++j ) {
+                    w0[j]   = W0_ptr(node, i, j);
+                    abs_max = std::max(abs_max, (float)std::abs(w0[j]));
+                }
+                float scale = Int8_GetScale(abs_max);
+                Int8_Quantize<T>(w0, &m_W0_int8[(node * M + i) * N], N, scale);
+                m_W0_int8_scale[node * M + i] = scale;
+            }
+
+            T w1[M];
+            float abs_max = 0;
+            for ( int i = 0; i < M; ++i ) {
+                w1[i]   = W1_ptr(node, i);
+                abs_max = std::max(abs_max, (float)std::abs(w1[i]));
+            }
+            float scale = Int8_GetScale(abs_max);
+            Int8_Quantize<T>(w1, &m_W1_int8[node * M], M, scale);
+            m_W1_int8_scale[node] = scale;
+        }
+
+        m_int8_key = key;
+    }
+
+#ifdef __AVX2__
+    /**
+     * @brief  INT8 の host 版 Forward (FP32 入出力のみ)
+     * @detail 入力を較正したスケールで int8 に量子化してから集め、int16 ペアの積和
+     *         (VNNI があれば vpdpwssd) で sub-layer0 を計算する
+     *         ReLU 後の中間値はノード毎のスケールで 0～255 に量子化し直して
+     *         sub-layer1 も整数で積和し、最後に float に戻す
+     * @param  x_buf 入力
+     * @param  y_buf 出力
+     */
+    void ForwardInt8Host(FrameBuffer const &x_buf, FrameBuffer &y_buf)
+    {
+        int const   P = (N + 1) / 2;
+        int const   Q = (M + 1) / 2;
+
+        // 入力はビューのこともあるのでストライドは入出力で別に持ち、int8 の作業領域は8フレーム単位に詰める
+        index_t const   frame_size = x_buf.GetFrameSize();
+        index_t const   x_stride   = x_buf.GetFrameStride() / sizeof(float);
+        index_t const   y_stride   = y_buf.GetFrameStride() / sizeof(float);
+        index_t const   q_stride   = (frame_size + 7) / 8 * 8;
+        float   const   x_scale    = Int8_GetScale(m_x_int8_abs_max);
+
+        PackInt8Weight();
+
+        // 入力をノード毎に int8 に量子化
+        std::vector<std::int8_t> x_int8(m_input_node_size * q_stride);
+        {
+            auto x_ptr  = x_buf.LockMemoryConst();
+            auto x_addr = (float const *)x_ptr.GetAddr();
+
+#pragma omp parallel for
+            for ( index_t node = 0; node < m_input_node_size; ++node ) {
+                Int8_Quantize<float>(&x_addr[node * x_stride], &x_int8[node * q_stride], frame_size, x_scale);
+            }
+        }
+
+        auto y_ptr = y_buf.LockMemory();
+        auto input_index_ptr = m_input_index.LockConst();
+        auto b0_ptr = lock_b0_const();
+        auto b1_ptr = lock_b1_const();
+
+        auto out_sig_buf = (float *)y_ptr.GetAddr();
+
+        auto pair = [](std::int8_t a, std::int8_t b) -> int {
+            return (int)((std::uint32_t)(std::uint16_t)(std::int16_t)a | ((std::uint32_t)(std::uint16_t)(std::int16_t)b << 16));
+        };
+
+#pragma omp parallel for
+        for ( index_t node = 0; node < m_output_node_size; ++node ) {
+            __m256i W0[M][P];
+            __m256  s0[M];
+            __m256  b0[M];
+            __m256i W1[Q];
+            for ( int i = 0; i < M; ++i ) {
+                std::int8_t const *w0 = &m_W0_int8[(node * M + i) * N];
+                for ( int k = 0; k < P; ++k ) {
+                    W0[i][k] = _mm256_set1_epi32(pair(w0[2*k], (2*k+1 < N) ? w0[2*k+1] : 0));
+                }
+                s0[i] = _mm256_set1_ps(x_scale * m_W0_int8_scale[node * M + i]);
+                b0[i] = _mm256_set1_ps(b0_ptr(node, i));
+            }
+            std::int8_t const *w1 = &m_W1_int8[node * M];
+            for ( int k = 0; k < Q; ++k ) {
+                W1[k] = _mm256_set1_epi32(pair(w1[2*k], (2*k+1 < M) ? w1[2*k+1] : 0));
+            }
+
+            float   h_scale = Int8_GetScale(m_h_int8_abs_max[node], 255.0f);
+            __m256  h_inv   = _mm256_set1_ps(1.0f / h_scale);
+            __m256  s1      = _mm256_set1_ps(h_scale * m_W1_int8_scale[node]);
+            __m256  b1      = _mm256_set1_ps(b1_ptr(node));
+            __m256  zero    = _mm256_setzero_ps();
+            __m256i h_max   = _mm256_set1_epi32(255);
+
+            std::int8_t const *in_sig_ptr[N];
+            for ( int i = 0; i < N; ++i ) {
+                in_sig_ptr[i] = &x_int8[input_index_ptr(node, i) * q_stride];
+            }
+            float *out_sig_ptr = &out_sig_buf[node * y_stride];
+
+            for ( index_t frame = 0; frame < frame_size; frame += 8 ) {
+                __m256i in_sig[N];
+                for ( int i = 0; i < N; ++i ) {
+                    in_sig[i] = _mm256_cvtepi8_epi32(_mm_loadl_epi64((__m128i const *)&in_sig_ptr[i][frame]));
+                }
+                __m256i in_pair[P];
+                for ( int k = 0; k < P; ++k ) {
+                    in_pair[k] = bb_mm256_pack_pair_epi16(in_sig[2*k], (2*k+1 < N) ? in_sig[2*k+1] : _mm256_setzero_si256());
+                }
+
+                __m256i h[M];
+                for ( int i = 0; i < M; ++i ) {
+                    // sub-layer0
+                    __m256i acc = _mm256_setzero_si256();
+                    for ( int k = 0; k < P; ++k ) {
+                        acc = bb_mm256_dpwssd_epi32(acc, in_pair[k], W0[i][k]);
+                    }
+
+                    // ReLU して再量子化
+                    __m256 v = _mm256_max_ps(_mm256_fmadd_ps(_mm256_cvtepi32_ps(acc), s0[i], b0[i]), zero);
+                    h[i] = _mm256_min_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(v, h_inv)), h_max);
+                }
+
+                // sub-layer1
+                __m256i acc = _mm256_setzero_si256();
+                for ( int k = 0; k < Q; ++k ) {
+                    acc = bb_mm256_dpwssd_epi32(acc, bb_mm256_pack_pair_epi16(h[2*k], (2*k+1 < M) ? h[2*k+1] : _mm256_setzero_si256()), W1[k]);
+                }
+
+                _mm256_store_ps(&out_sig_ptr[frame], _mm256_fmadd_ps(_mm256_cvtepi32_ps(acc), s1, b1));
+            }
+        }
+    }
+#endif
+
+    // テーブルの作り直しが必要かを判定するキー
+    std::vector<std::uint64_t> GetForwardTableKey(void) const
+    {
+        return {
+                m_W0->GetRevision(),
+                m_b0->GetRevision(),
+                m_W1->GetRevision(),
+                m_b1->GetRevision()
+            };
+    }
+
+    // 2値入力の全パターンに対する出力テーブルを作成
+    void BuildForwardTable(void)
+    {
+        auto key    = GetForwardTableKey();
+        auto W0_ptr = lock_W0_const();
+        auto b0_ptr = lock_b0_const();
+        auto W1_ptr = lock_W1_const();
+        auto b1_ptr = lock_b1_const();
+        m_forward_table.Build(m_output_node_size, key, [&](index_t node, T *table) {
+            for ( int index = 0; index < (1 << N); ++index ) {
+                T y = b1_ptr(node);
+                for ( int i = 0; i < M; ++i ) {
+                    // affine0 + ReLU
+                    T v = b0_ptr(node, i);
+                    for ( int j = 0; j < N; ++j ) {
+                        if ( (index >> j) & 1 ) {
+                            v += W0_ptr(node, i, j);
+                        }
+                    }
+                    v = std::max(v, (T)0.0);
+
+                    // affine1
+                    y += v * W1_ptr(node, i);
+                }
+                table[index] = y;
+            }
+        });
+    }
+
+public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
         BB_ASSERT(x_buf.GetType() == DataType<FXT>::type);
@@ -438,10 +736,40 @@ public:
             m_x_buf = x_buf;
         }
         
+        // INT8 推論用に範囲を集計
+        if ( m_int8_calibrate ) {
+            CalibrateInt8(x_buf);
+        }
 
         // 出力を設定
         FrameBuffer y_buf(x_buf.GetFrameSize(), m_output_shape, DataType<T>::type);
 
+#ifdef __AVX2__
+        // INT8 推論
+        if ( !train && m_int8_mode && m_x_int8_abs_max > 0 && (index_t)m_h_int8_abs_max.size() == m_output_node_size
+                && DataType<FXT>::type == BB_TYPE_FP32 && DataType<T>::type == BB_TYPE_FP32 ) {
+            ForwardInt8Host(x_buf, y_buf);
+            return y_buf;
+        }
+#endif
+
+        // 2値入力の推論はテーブル引き
+        if ( !train && m_host_table && DataType<FXT>::type == BB_TYPE_BIT
+                && (m_host_only || !x_buf.IsDeviceAvailable() || !Manager::IsDeviceAvailable()) ) {
+            m_forward_table.Update(GetForwardTableKey(), [&]() {
+                if (m_binary_mode) {
+                    m_W0->Clamp(-1.0, +1.0);
+                    m_b0->Clamp(-1.0, +1.0);
+                    m_W1->Clamp(-1.0, +1.0);
+                    m_b1->Clamp(-1.0, +1.0);
+                }
+                BuildForwardTable();
+            });
+            auto input_index_ptr = m_input_index.LockConst();
+            m_forward_table.template Forward<FXT, T>(x_buf, y_buf, input_index_ptr.GetAddr());
+            return y_buf;
+        }
+
         // バイナリモードならパラメータクリップ
         if (m_binary_mode) {
             m_W0->Clamp(-1.0, +1.0);
@@ -454,6 +782,9 @@ public:
         // FP32 CUDA版
         if ( N == 6 && M == 16 && DataType<FXT>::type == BB_TYPE_FP32 && DataType<T>::type == BB_TYPE_FP32
                 && !m_host_only && x_buf.IsDeviceAvailable() && y_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
+            // カーネルは入出力共通のストライドで読むのでビューは詰めたコピーにする
+            if ( x_buf.IsView() ) { x_buf = x_buf.Clone(); }
+
             auto input_index_ptr = m_input_index.LockDeviceMemoryConst();
             auto x_ptr  = x_buf.LockDeviceMemoryConst();
             auto y_ptr  = y_buf.LockDeviceMemory();
@@ -513,7 +844,10 @@ public:
 
         // AVX版
         if ( DataType<FXT>::type == BB_TYPE_FP32 && DataType<T>::type == BB_TYPE_FP32 && m_host_simd ) {
-            const index_t   frame_size = x_buf.GetFrameStride() / sizeof(float);
+            // 入力はビューのこともあるのでストライドは入出力で別に持つ (8フレーム単位でストライド内に収まる)
+            const index_t   frame_size = x_buf.GetFrameSize();
+            const index_t   x_stride   = x_buf.GetFrameStride() / sizeof(float);
+            const index_t   y_stride   = y_buf.GetFrameStride() / sizeof(float);
             const __m256    zero = _mm256_set1_ps(0);
 
             auto x_ptr = x_buf.LockMemoryConst();
@@ -545,9 +879,9 @@ public:
                 float const *in_sig_ptr[N];
                 float       *out_sig_ptr;
                 for (int i = 0; i < N; ++i) {
-                    in_sig_ptr[i] = &in_sig_buf[input_index_ptr(node, i) * frame_size];
+                    in_sig_ptr[i] = &in_sig_buf[input_index_ptr(node, i) * x_stride];
                 }
-                out_sig_ptr = &out_sig_buf[node * frame_size];
+                out_sig_ptr = &out_sig_buf[node * y_stride];
 
                 for (index_t frame = 0; frame < frame_size; frame += 8) {
                     __m256  in_sig[N];
@@ -587,6 +921,9 @@ public:
             auto W1_ptr = lock_W1_const();
             auto b1_ptr = lock_b1_const();
 
+            auto x_view = x_ptr.GetView();
+            auto y_view = y_ptr.GetView();
+
 #pragma omp parallel for
             for ( index_t node = 0; node < m_output_node_size; ++node ) {
                 index_t in_idx[N];
@@ -596,7 +933,7 @@ public:
                 for (index_t frame = 0; frame < frame_size; ++frame ) {
                     T   in_sig[N];
                     for ( int i = 0; i < N; ++i) {
-                        in_sig[i] = x_ptr.Get(frame, in_idx[i]);
+                        in_sig[i] = x_view.Get(frame, in_idx[i]);
                     }
 
                     T   sum1 = b1_ptr(node);
@@ -614,7 +951,7 @@ public:
                         sum1 += sum0 * W1_ptr(node, i);
                     }
 
-                    y_ptr.Set(frame, node, sum1);
+                    y_view.Set(frame, node, sum1);
                 }
             }
             return y_buf;
@@ -623,6 +960,28 @@ public:
 
 
     FrameBuffer Backward(FrameBuffer dy_buf)
+    {
+        // 入力勾配もパラメータ勾配も不要なら何もしない
+        if ( !m_input_gradient && m_frozen ) {
+            m_x_buf = FrameBuffer();
+            return FrameBuffer();
+        }
+
+        auto dx_buf = BackwardMlp(dy_buf);
+
+        // 固定時は計算された勾配を捨てる
+        if ( m_frozen ) {
+            m_dW0->FillZero();
+            m_db0->FillZero();
+            m_dW1->FillZero();
+            m_db1->FillZero();
+        }
+
+        return dx_buf;
+    }
+
+protected:
+    FrameBuffer BackwardMlp(FrameBuffer dy_buf)
     {
         BB_ASSERT(dy_buf.GetType() == DataType<T>::type);
 
@@ -639,7 +998,10 @@ public:
 #ifdef BB_WITH_CUDA
         if ( N == 6 && M == 16 && DataType<FXT>::type == BB_TYPE_FP32 && DataType<T>::type == BB_TYPE_FP32
                 && !m_host_only && x_buf.IsDeviceAvailable() && dx_buf.IsDeviceAvailable() && dy_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
-            // CUDA版
+            // CUDA版 (カーネルは x/dy/dx 共通のストライドで読むのでビューは詰めたコピーにする)
+            if ( x_buf.IsView() )  { x_buf  = x_buf.Clone(); }
+            if ( dy_buf.IsView() ) { dy_buf = dy_buf.Clone(); }
+
             auto input_index_ptr = m_input_index.LockDeviceMemoryConst();
             auto x_ptr  = x_buf.LockDeviceMemoryConst();
             auto dy_ptr = dy_buf.LockDeviceMemoryConst();
@@ -684,7 +1046,9 @@ public:
 #ifdef BB_WITH_CUDA
         if ( N == 6 && M == 16 && DataType<FXT>::type == BB_TYPE_BIT && DataType<T>::type == BB_TYPE_FP32
                 && !m_host_only && x_buf.IsDeviceAvailable() && dx_buf.IsDeviceAvailable() && dy_buf.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
-            // CUDA版
+            // CUDA版 (dx は dy のストライドで書くので dy のビューは詰めたコピーにする)
+            if ( dy_buf.IsView() ) { dy_buf = dy_buf.Clone(); }
+
             auto input_index_ptr = m_input_index.LockDeviceMemoryConst();
             auto x_ptr  = x_buf.LockDeviceMemoryConst();
             auto dy_ptr = dy_buf.LockDeviceMemoryConst();
@@ -734,8 +1098,11 @@ public:
 
         // AVX版
         if ( DataType<FXT>::type == BB_TYPE_FP32 && DataType<T>::type == BB_TYPE_FP32 ) {
-            index_t frame_size = dy_buf.GetFrameStride() / sizeof(float);
+            index_t frame_size = dy_buf.GetFrameSize();
             index_t node_size  = m_output_node_size;
+            index_t x_stride   = x_buf.GetFrameStride()  / sizeof(float);
+            index_t dy_stride  = dy_buf.GetFrameStride() / sizeof(float);
+            index_t dx_stride  = dx_buf.GetFrameStride() / sizeof(float);
 
             dx_buf.FillZero();
 
@@ -786,9 +1153,9 @@ public:
                 float const *out_err_ptr;
                 float const *in_sig_ptr[N];
                 
-                out_err_ptr = &dy_addr[frame_size * node];
+                out_err_ptr = &dy_addr[dy_stride * node];
                 for (int i = 0; i < N; ++i) {
-                    in_sig_ptr[i] = &x_addr[frame_size * input_index_ptr(node, i)];
+                    in_sig_ptr[i] = &x_addr[x_stride * input_index_ptr(node, i)];
                 }
 
                 for (int frame = 0; frame < frame_size; frame += 8) {
@@ -854,7 +1221,7 @@ public:
             for (int node = 0; node < (int)node_size; ++node) {
                 float*  in_err_ptr[N];
                 for (int i = 0; i < N; ++i) {
-                    in_err_ptr[i] = &dx_addr[frame_size * input_index_ptr(node, i)];
+                    in_err_ptr[i] = &dx_addr[dx_stride * input_index_ptr(node, i)];
                 }
 
                 #pragma omp parallel for
@@ -885,6 +1252,10 @@ public:
             auto dx_ptr = dx_buf.Lock<T>();
             auto x_ptr  = x_buf.LockConst<FXT>();
 
+            auto dy_view = dy_ptr.GetView();
+            auto dx_view = dx_ptr.GetView();
+            auto x_view  = x_ptr.GetView();
+
             auto input_index_ptr = m_input_index.Lock();
             auto W0_ptr = lock_W0_const();
             auto b0_ptr = lock_b0_const();
@@ -924,11 +1295,11 @@ public:
                     // 入力データ読み込み
                     T   x[N];
                     for ( int i = 0; i < N; ++i ) {
-                        x[i] = x_ptr.Get(frame, input_index_ptr(node, i));
+                        x[i] = x_view.Get(frame, input_index_ptr(node, i));
                     }
                     
                     // 1段目再計算して2段目逆伝播
-                    T   grad1 = dy_ptr.Get(frame, node);
+                    T   grad1 = dy_view.Get(frame, node);
                     T   grad0[M];
                     db1 += grad1;
                     for ( int i = 0; i < M; ++i ) {
@@ -965,7 +1336,7 @@ public:
                     
                     // 誤差書き込み
                     for ( int i = 0; i < N; ++i ) {
-                        dx_ptr.Add(frame, input_index_ptr(node, i), dx[i]);
+                        dx_view.Add(frame, input_index_ptr(node, i), dx[i]);
                     }
                 }
 
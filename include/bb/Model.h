@@ -10,10 +10,12 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
 #if BB_WITH_CEREAL
 #include "cereal/types/array.hpp"
@@ -34,6 +36,9 @@ class Model
 {
 protected:
     std::string     m_name;
+    bool            m_input_gradient = true;    // Backward で入力側の勾配(dx)を計算するか
+    bool            m_frozen = false;           // パラメータを固定(勾配を計算しない)するか
+    std::shared_ptr<std::mutex> m_exec_mutex = std::make_shared<std::mutex>();  // 外部からの実行の排他
 
     /**
      * @brief  コマンドを処理
@@ -42,6 +47,40 @@ protected:
      *         文字列にしておけば何でも出来るかな？
      */
     virtual void CommandProc(std::vector<std::string> args) {}
+
+    /**
+     * @brief  直列に繋がったレイヤーの入力勾配の要否を設定
+     * @detail 先頭の要否は enable に従い、以降は手前に学習対象のレイヤーがあれば必要とする
+     * @param  layers 入力側から順に並べたレイヤー
+     * @param  enable 先頭レイヤーの入力勾配が必要か
+     */
+    static void SetChainInputGradient(std::vector< std::shared_ptr<Model> > const &layers, bool enable)
+    {
+        for (auto layer : layers) {
+            layer->SetInputGradient(enable);
+            if ( layer->IsTrainable() ) {
+                enable = true;
+            }
+        }
+    }
+
+    /**
+     * @brief  直列に繋がったレイヤーの backward
+     * @detail 入力勾配が不要なレイヤーに達したら、それより手前は計算しない
+     * @param  layers 入力側から順に並べたレイヤー
+     * @param  dy_buf 逆伝播させる誤差
+     * @return backward演算結果 (入力勾配が不要なら空)
+     */
+    static FrameBuffer BackwardChain(std::vector< std::shared_ptr<Model> > const &layers, FrameBuffer dy_buf)
+    {
+        for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
+            dy_buf = (*it)->Backward(dy_buf);
+            if ( !(*it)->IsInputGradient() ) {
+                return FrameBuffer();   // これより手前に学習対象は無い
+            }
+        }
+        return dy_buf;
+    }
     
 public:
     /**
@@ -50,6 +89,19 @@ public:
      */
     virtual ~Model() {}
 
+    /**
+     * @brief  実行の排他
+     * @detail Forward/Backward は train=false でもレイヤーの状態(出力バッファ、
+     *         im2col のフレーム数、遅延構築するテーブル等)を書き換えるので、
+     *         Python バインディングなど複数スレッドから同じモデルを呼ぶ入口ではこれを取る
+     *         (モデル内部の呼び出しでは取らない)
+     * @return ミューテックス
+     */
+    std::mutex &GetExecMutex(void) const
+    {
+        return *m_exec_mutex;
+    }
+
     /**
      * @brief  クラス名取得
      * @detail クラス名取得
@@ -109,8 +161,44 @@ public:
      * @return パラメータを返す
      */
     virtual Variables GetGradients(void) { return Variables(); }
+
+    /**
+     * @brief  統計量取得
+     * @detail BatchNormalization の移動平均など、学習で更新されるが勾配を持たない状態を取得する
+     *         データ並列学習で複製間の平均をとるのに使う
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void) { return Variables(); }
     
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail false にすると Backward で入力側の勾配(dx)の計算と確保を省略し、空の FrameBuffer を返す
+     *         先頭レイヤーなど、dx を使う手前のレイヤーが無い場合に指定する
+     *         (対応していないレイヤーは従来通り dx を計算する)
+     * @param  enable dx が必要なら true
+     */
+    virtual void SetInputGradient(bool enable) { m_input_gradient = enable; }
+    virtual bool IsInputGradient(void) const   { return m_input_gradient; }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail true にすると Backward でパラメータの勾配を計算しない (勾配はゼロのまま)
+     *         学習途中で固定すると Optimizer のモーメンタムで動く場合があるので学習開始前に設定すること
+     * @param  frozen 固定するなら true
+     */
+    virtual void SetFrozen(bool frozen) { m_frozen = frozen; }
+    virtual bool IsFrozen(void) const   { return m_frozen; }
+
+    /**
+     * @brief  学習対象か
+     * @detail 固定されていない学習パラメータを持つか
+     *         手前に学習対象が無いレイヤーは入力勾配が不要になる
+     * @return 学習対象なら true
+     */
+    virtual bool IsTrainable(void) { return !IsFrozen() && GetParameters().GetSize() > 0; }
+
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
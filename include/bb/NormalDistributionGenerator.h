@@ -52,6 +52,13 @@ public:
     {
         return m_norm_dist(m_mt);
     }
+
+    void Fill(T *data, index_t size)
+    {
+        for ( index_t i = 0; i < size; ++i ) {
+            data[i] = m_norm_dist(m_mt);
+        }
+    }
 };
 
 
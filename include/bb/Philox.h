@@ -0,0 +1,86 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+
+#include "bb/SimdSupport.h"
+
+
+namespace bb {
+
+
+// カウンタベースの乱数 Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+//   (counter, key) から独立に 4x32bit の乱数が決まるので、並列に生成でき、
+//   同じ counter を与えれば同じ値を何度でも作り直せる
+
+#define BB_PHILOX_M0    0xD2511F53
+#define BB_PHILOX_M1    0xCD9E8D57
+#define BB_PHILOX_W0    0x9E3779B9
+#define BB_PHILOX_W1    0xBB67AE85
+
+
+inline void Philox4x32_10(std::uint32_t const ctr[4], std::uint32_t const key[2], std::uint32_t out[4])
+{
+    std::uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    std::uint32_t k0 = key[0], k1 = key[1];
+    for ( int round = 0; round < 10; ++round ) {
+        std::uint64_t p0 = (std::uint64_t)BB_PHILOX_M0 * c0;
+        std::uint64_t p1 = (std::uint64_t)BB_PHILOX_M1 * c2;
+        std::uint32_t n0 = (std::uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        std::uint32_t n2 = (std::uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (std::uint32_t)p1;
+        c3 = (std::uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += BB_PHILOX_W0;
+        k1 += BB_PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+
+#ifdef __AVX2__
+// 32bit x 8 の積の上位と下位
+inline void bb_mm256_mulhilo_epu32(__m256i a, __m256i m, __m256i &hi, __m256i &lo)
+{
+    lo = _mm256_mullo_epi32(a, m);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, m), 32);
+    __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    hi = _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+// Philox4x32-10 を 8 個の counter について同時に計算 (c[i] のレーン毎に1系列)
+inline void Philox4x32_10_x8(__m256i c[4], std::uint32_t const key[2])
+{
+    __m256i m0 = _mm256_set1_epi32((int)BB_PHILOX_M0);
+    __m256i m1 = _mm256_set1_epi32((int)BB_PHILOX_M1);
+    std::uint32_t k0 = key[0], k1 = key[1];
+    for ( int round = 0; round < 10; ++round ) {
+        __m256i hi0, lo0, hi1, lo1;
+        bb_mm256_mulhilo_epu32(c[0], m0, hi0, lo0);
+        bb_mm256_mulhilo_epu32(c[2], m1, hi1, lo1);
+        c[0] = _mm256_xor_si256(_mm256_xor_si256(hi1, c[1]), _mm256_set1_epi32((int)k0));
+        c[2] = _mm256_xor_si256(_mm256_xor_si256(hi0, c[3]), _mm256_set1_epi32((int)k1));
+        c[1] = lo1;
+        c[3] = lo0;
+        k0 += BB_PHILOX_W0;
+        k1 += BB_PHILOX_W1;
+    }
+}
+#endif
+
+
+}
+
+// end of file
@@ -0,0 +1,322 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <algorithm>
+
+#include "bb/DataType.h"
+#include "bb/Philox.h"
+#include "bb/SimdSupport.h"
+#include "bb/ValueGenerator.h"
+
+
+namespace bb {
+
+
+// カウンタベース(Philox4x32-10)の乱数ジェネレーター
+//   値は 32 個単位のブロックで生成し、block 番ブロックの i 番目は
+//   counter {block*8 + i%8, 0, 0} (64bit), key {seed} の出力の i/8 番目のワードから作る
+//   通し番号だけで値が決まるので Fill() はブロック毎に並列に生成でき、
+//   スレッド数によらず GetValue() を順に呼んだ場合と同じ列になる
+
+#define BB_PHILOX_GENERATOR_BLOCK   32
+
+
+// block 番ブロックの 32bit 乱数
+inline void PhiloxGenerator_RawBlock(std::uint64_t block, std::uint32_t const key[2], std::uint32_t out[BB_PHILOX_GENERATOR_BLOCK])
+{
+    std::uint64_t base = block * 8;
+#ifdef __AVX2__
+    __m256i c[4];
+    c[0] = _mm256_add_epi32(_mm256_set1_epi32((int)(std::uint32_t)base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    c[1] = _mm256_set1_epi32((int)(std::uint32_t)(base >> 32));
+    c[2] = _mm256_setzero_si256();
+    c[3] = _mm256_setzero_si256();
+    Philox4x32_10_x8(c, key);
+    for ( int k = 0; k < 4; ++k ) {
+        _mm256_storeu_si256((__m256i *)&out[k*8], c[k]);
+    }
+#else
+    for ( int l = 0; l < 8; ++l ) {
+        std::uint32_t ctr[4] = {(std::uint32_t)(base + l), (std::uint32_t)((base + l) >> 32), 0, 0};
+        std::uint32_t r[4];
+        Philox4x32_10(ctr, key, r);
+        for ( int k = 0; k < 4; ++k ) {
+            out[k*8 + l] = r[k];
+        }
+    }
+#endif
+}
+
+
+// 一様分布 [a, b) への変換 (float は上位 24bit, double は 32bit の分解能)
+//   a + u * (b - a) は a, b によっては丸めで b になるので、b 未満の最大値で抑える
+template <typename T>
+inline void PhiloxGenerator_UniformBlock(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], T a, T b, T out[BB_PHILOX_GENERATOR_BLOCK])
+{
+    double scale = (double)(b - a) / 4294967296.0;
+    T      upper = (T)std::nextafter(b, a);
+    for ( int i = 0; i < BB_PHILOX_GENERATOR_BLOCK; ++i ) {
+        out[i] = std::min((T)((double)a + ((double)raw[i] + 0.5) * scale), upper);
+    }
+}
+
+template <>
+inline void PhiloxGenerator_UniformBlock<float>(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], float a, float b, float out[BB_PHILOX_GENERATOR_BLOCK])
+{
+    // u * 2^-24 は [0, 1) で正確に表せる
+    float scale = (b - a) / 16777216.0f;
+    float upper = std::nextafter(b, a);
+#ifdef __AVX2__
+    __m256 v_a     = _mm256_set1_ps(a);
+    __m256 v_scale = _mm256_set1_ps(scale);
+    __m256 v_upper = _mm256_set1_ps(upper);
+    for ( int i = 0; i < BB_PHILOX_GENERATOR_BLOCK; i += 8 ) {
+        __m256 u = _mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_loadu_si256((__m256i const *)&raw[i]), 8));
+        _mm256_storeu_ps(&out[i], _mm256_min_ps(_mm256_fmadd_ps(u, v_scale, v_a), v_upper));
+    }
+#else
+    for ( int i = 0; i < BB_PHILOX_GENERATOR_BLOCK; ++i ) {
+        out[i] = std::min(a + (float)(raw[i] >> 8) * scale, upper);
+    }
+#endif
+}
+
+
+// 正規分布への変換 (Box-Muller)
+//   ワード 0,1 と 2,3 の組 (ブロック内 i と i+8) から cos 側と sin 側の2値を作る
+template <typename T>
+inline void PhiloxGenerator_NormalBlock(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], T mean, T stddev, T out[BB_PHILOX_GENERATOR_BLOCK])
+{
+    double const pi = 3.14159265358979323846;
+    for ( int k = 0; k < 4; k += 2 ) {
+        for ( int l = 0; l < 8; ++l ) {
+            double u1 = ((double)raw[k*8 + l] + 1.0) / 4294967296.0;          // (0, 1]
+            double u2 = ((double)raw[(k+1)*8 + l] + 0.5) / 4294967296.0;      // (0, 1)
+            double r  = std::sqrt(-2.0 * std::log(u1));
+            double th = 2.0 * pi * (u2 - 0.5);
+            out[k*8 + l]     = (T)((double)mean + (double)stddev * r * std::cos(th));
+            out[(k+1)*8 + l] = (T)((double)mean + (double)stddev * r * std::sin(th));
+        }
+    }
+}
+
+template <>
+inline void PhiloxGenerator_NormalBlock<float>(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], float mean, float stddev, float out[BB_PHILOX_GENERATOR_BLOCK])
+{
+    // 角度は半角 x = pi * (u2 - 0.5) で sin/cos を求め、倍角で 2x を得る
+    float const pi = 3.14159265358979f;
+#ifdef __AVX2__
+    __m256 v_mean   = _mm256_set1_ps(mean);
+    __m256 v_stddev = _mm256_set1_ps(stddev);
+    __m256 v_unit   = _mm256_set1_ps(1.0f / 16777216.0f);
+    for ( int k = 0; k < 4; k += 2 ) {
+        __m256 w1 = _mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_loadu_si256((__m256i const *)&raw[k*8]), 8));
+        __m256 w2 = _mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_loadu_si256((__m256i const *)&raw[(k+1)*8]), 8));
+        __m256 u1 = _mm256_mul_ps(_mm256_add_ps(w1, _mm256_set1_ps(1.0f)), v_unit);
+        __m256 x  = _mm256_mul_ps(_mm256_fmsub_ps(_mm256_add_ps(w2, _mm256_set1_ps(0.5f)), v_unit, _mm256_set1_ps(0.5f)), _mm256_set1_ps(pi));
+        __m256 r  = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), bb_mm256_log_ps(u1)));
+        __m256 s, c;
+        bb_mm256_sincos_ps(x, s, c);
+        __m256 z0 = _mm256_mul_ps(r, _mm256_fmsub_ps(c, c, _mm256_mul_ps(s, s)));
+        __m256 z1 = _mm256_mul_ps(r, _mm256_mul_ps(_mm256_add_ps(s, s), c));
+        _mm256_storeu_ps(&out[k*8],     _mm256_fmadd_ps(z0, v_stddev, v_mean));
+        _mm256_storeu_ps(&out[(k+1)*8], _mm256_fmadd_ps(z1, v_stddev, v_mean));
+    }
+#else
+    for ( int k = 0; k < 4; k += 2 ) {
+        for ( int l = 0; l < 8; ++l ) {
+            float u1 = ((float)(raw[k*8 + l] >> 8) + 1.0f) / 16777216.0f;
+            float x  = pi * (((float)(raw[(k+1)*8 + l] >> 8) + 0.5f) / 16777216.0f - 0.5f);
+            float r  = std::sqrt(-2.0f * std::log(u1));
+            float s  = std::sin(x);
+            float c  = std::cos(x);
+            out[k*8 + l]     = mean + stddev * r * (c*c - s*s);
+            out[(k+1)*8 + l] = mean + stddev * r * (2.0f*s*c);
+        }
+    }
+#endif
+}
+
+
+// Philox ジェネレーターの共通部 (Derived::Convert(raw, out) で乱数ワードを値に変換する)
+template <typename T, class Derived>
+class PhiloxGeneratorBase : public ValueGenerator<T>
+{
+protected:
+    std::uint64_t   m_seed;
+    std::uint32_t   m_key[2];
+    std::uint64_t   m_index = 0;        // 次に返す値の通し番号
+
+    std::uint64_t   m_cache_block = (std::uint64_t)-1;
+    T               m_cache[BB_PHILOX_GENERATOR_BLOCK];
+
+    PhiloxGeneratorBase(std::uint64_t seed)
+    {
+        Seed(seed);
+    }
+
+    void GenerateBlock(std::uint64_t block, T out[BB_PHILOX_GENERATOR_BLOCK])
+    {
+        std::uint32_t raw[BB_PHILOX_GENERATOR_BLOCK];
+        PhiloxGenerator_RawBlock(block, m_key, raw);
+        static_cast<Derived *>(this)->Convert(raw, out);
+    }
+
+    T const *GetBlock(std::uint64_t block)
+    {
+        if ( block != m_cache_block ) {
+            GenerateBlock(block, m_cache);
+            m_cache_block = block;
+        }
+        return m_cache;
+    }
+
+public:
+    void Seed(std::uint64_t seed)
+    {
+        m_seed        = seed;
+        m_key[0]      = (std::uint32_t)seed;
+        m_key[1]      = (std::uint32_t)(seed >> 32);
+        m_index       = 0;
+        m_cache_block = (std::uint64_t)-1;
+    }
+
+    void Reset(void)
+    {
+        m_index = 0;
+    }
+
+    /**
+     * @brief  読み出し位置の設定
+     * @detail 通し番号 index の値から生成を再開する (途中からの再現用)
+     * @param  index 通し番号
+     */
+    void SetIndex(std::uint64_t index)
+    {
+        m_index = index;
+    }
+
+    std::uint64_t GetIndex(void) const
+    {
+        return m_index;
+    }
+
+    T GetValue(void)
+    {
+        std::uint64_t index = m_index++;
+        return GetBlock(index / BB_PHILOX_GENERATOR_BLOCK)[index % BB_PHILOX_GENERATOR_BLOCK];
+    }
+
+    void Fill(T *data, index_t size)
+    {
+        if ( size <= 0 ) {
+            return;
+        }
+
+        std::uint64_t index = m_index;
+        m_index += (std::uint64_t)size;
+
+        // 先頭の端数
+        index_t head = (index_t)((BB_PHILOX_GENERATOR_BLOCK - index % BB_PHILOX_GENERATOR_BLOCK) % BB_PHILOX_GENERATOR_BLOCK);
+        head = std::min(head, size);
+        for ( index_t i = 0; i < head; ++i ) {
+            data[i] = GetBlock((index + i) / BB_PHILOX_GENERATOR_BLOCK)[(index + i) % BB_PHILOX_GENERATOR_BLOCK];
+        }
+        index += head;
+        data  += head;
+        size  -= head;
+
+        // ブロック単位 (並列)
+        std::uint64_t first_block = index / BB_PHILOX_GENERATOR_BLOCK;
+        index_t       block_size  = size / BB_PHILOX_GENERATOR_BLOCK;
+        #pragma omp parallel for
+        for ( index_t b = 0; b < block_size; ++b ) {
+            GenerateBlock(first_block + (std::uint64_t)b, &data[b * BB_PHILOX_GENERATOR_BLOCK]);
+        }
+
+        // 末尾の端数
+        index_t done = block_size * BB_PHILOX_GENERATOR_BLOCK;
+        if ( done < size ) {
+            T const *block = GetBlock(first_block + (std::uint64_t)block_size);
+            for ( index_t i = done; i < size; ++i ) {
+                data[i] = block[i - done];
+            }
+        }
+    }
+};
+
+
+/**
+ * @brief  Philox による一様分布 [a, b)
+ */
+template <typename T>
+class PhiloxUniformDistributionGenerator : public PhiloxGeneratorBase< T, PhiloxUniformDistributionGenerator<T> >
+{
+    friend class PhiloxGeneratorBase< T, PhiloxUniformDistributionGenerator<T> >;
+
+protected:
+    T   m_a;
+    T   m_b;
+
+    PhiloxUniformDistributionGenerator(T a, T b, std::uint64_t seed)
+        : PhiloxGeneratorBase< T, PhiloxUniformDistributionGenerator<T> >(seed), m_a(a), m_b(b)
+    {
+    }
+
+    void Convert(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], T out[BB_PHILOX_GENERATOR_BLOCK])
+    {
+        PhiloxGenerator_UniformBlock<T>(raw, m_a, m_b, out);
+    }
+
+public:
+    static std::shared_ptr<PhiloxUniformDistributionGenerator> Create(T a = (T)0.0, T b = (T)1.0, std::uint64_t seed = 1)
+    {
+        return std::shared_ptr<PhiloxUniformDistributionGenerator>(new PhiloxUniformDistributionGenerator(a, b, seed));
+    }
+};
+
+
+/**
+ * @brief  Philox による正規分布
+ */
+template <typename T>
+class PhiloxNormalDistributionGenerator : public PhiloxGeneratorBase< T, PhiloxNormalDistributionGenerator<T> >
+{
+    friend class PhiloxGeneratorBase< T, PhiloxNormalDistributionGenerator<T> >;
+
+protected:
+    T   m_mean;
+    T   m_stddev;
+
+    PhiloxNormalDistributionGenerator(T mean, T stddev, std::uint64_t seed)
+        : PhiloxGeneratorBase< T, PhiloxNormalDistributionGenerator<T> >(seed), m_mean(mean), m_stddev(stddev)
+    {
+    }
+
+    void Convert(std::uint32_t const raw[BB_PHILOX_GENERATOR_BLOCK], T out[BB_PHILOX_GENERATOR_BLOCK])
+    {
+        PhiloxGenerator_NormalBlock<T>(raw, m_mean, m_stddev, out);
+    }
+
+public:
+    static std::shared_ptr<PhiloxNormalDistributionGenerator> Create(T mean = (T)0.0, T stddev = (T)1.0, std::uint64_t seed = 1)
+    {
+        return std::shared_ptr<PhiloxNormalDistributionGenerator>(new PhiloxNormalDistributionGenerator(mean, stddev, seed));
+    }
+};
+
+
+}
+
+// end of file
@@ -0,0 +1,189 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "bb/DataType.h"
+#include "bb/FrameBuffer.h"
+#include "bb/SimdSupport.h"
+
+
+namespace bb {
+
+
+// INT8 推論用の対称量子化
+//   q = clamp(round(x / scale), -127, +127) で、scale は較正した max|x| / 127
+//   積和は int32 で行い、出力で scale_x * scale_w を掛けて float に戻す
+
+
+// max|x| からスケールを求める
+inline float Int8_GetScale(float abs_max, float q_max = 127.0f)
+{
+    return (abs_max > 0) ? (abs_max / q_max) : 1.0f;
+}
+
+
+// FrameBuffer の max|x| (較正用)
+template <typename Tp>
+inline float Int8_AbsMax(FrameBuffer const &buf)
+{
+    auto frame_size = buf.GetFrameSize();
+    auto node_size  = buf.GetNodeSize();
+    auto ptr        = buf.LockConst<Tp>();
+
+    float abs_max = 0;
+    for ( index_t node = 0; node < node_size; ++node ) {
+        for ( index_t frame = 0; frame < frame_size; ++frame ) {
+            abs_max = std::max(abs_max, std::abs((float)ptr.Get(frame, node)));
+        }
+    }
+    return abs_max;
+}
+
+
+// 量子化
+template <typename Tp>
+inline void Int8_Quantize(Tp const *src, std::int8_t *dst, index_t size, float scale)
+{
+    float inv = 1.0f / scale;
+    for ( index_t i = 0; i < size; ++i ) {
+        float q = std::nearbyint((float)src[i] * inv);
+        dst[i] = (std::int8_t)std::min(127.0f, std::max(-127.0f, q));
+    }
+}
+
+#ifdef __AVX2__
+template <>
+inline void Int8_Quantize<float>(float const *src, std::int8_t *dst, index_t size, float scale)
+{
+    float   inv = 1.0f / scale;
+    index_t i   = 0;
+
+    __m256  v_inv  = _mm256_set1_ps(inv);
+    __m256i v_min  = _mm256_set1_epi8(-127);
+    __m256i v_perm = _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0);
+    for ( ; i + 16 <= size; i += 16 ) {
+        __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 0]), v_inv));
+        __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 8]), v_inv));
+        __m256i q = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_setzero_si256());
+        q = _mm256_max_epi8(q, v_min);
+        q = _mm256_permutevar8x32_epi32(q, v_perm);
+        _mm_storeu_si128((__m128i *)&dst[i], _mm256_castsi256_si128(q));
+    }
+    for ( ; i < size; ++i ) {
+        float q = std::nearbyint(src[i] * inv);
+        dst[i] = (std::int8_t)std::min(127.0f, std::max(-127.0f, q));
+    }
+}
+#endif
+
+
+// 積和用に int8 の長さを 32 の倍数にそろえる
+inline index_t Int8_GetStride(index_t size)
+{
+    return (size + 31) & ~(index_t)31;
+}
+
+
+#ifdef __AVX2__
+inline std::int32_t bb_mm256_hsum_epi32(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+#endif
+
+
+/**
+ * @brief  int8 の内積
+ * @detail VNNI があれば vpdpbusd (u8 x s8) を使うため x を +128 して符号無しにし、
+ *         w_sum * 128 を差し引く
+ *         AVX2 の maddubs は u8 x s8 の2要素和が int16 で飽和するので、
+ *         int16 に符号拡張して madd で積和する
+ * @param  x     入力 (size は Int8_GetStride() で 0 詰めしてあること)
+ * @param  w     重み (同上)
+ * @param  size  要素数 (32 の倍数)
+ * @param  w_sum 重みの総和
+ * @return 内積
+ */
+inline std::int32_t Int8_Dot(std::int8_t const *x, std::int8_t const *w, index_t size, std::int32_t w_sum)
+{
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    __m256i acc    = _mm256_setzero_si256();
+    __m256i offset = _mm256_set1_epi8((char)0x80);
+    for ( index_t i = 0; i < size; i += 32 ) {
+        __m256i xv = _mm256_xor_si256(_mm256_loadu_si256((__m256i const *)&x[i]), offset);
+        __m256i wv = _mm256_loadu_si256((__m256i const *)&w[i]);
+        acc = _mm256_dpbusd_epi32(acc, xv, wv);
+    }
+    return bb_mm256_hsum_epi32(acc) - 128 * w_sum;
+#elif defined(__AVXVNNI__)
+    __m256i acc    = _mm256_setzero_si256();
+    __m256i offset = _mm256_set1_epi8((char)0x80);
+    for ( index_t i = 0; i < size; i += 32 ) {
+        __m256i xv = _mm256_xor_si256(_mm256_loadu_si256((__m256i const *)&x[i]), offset);
+        __m256i wv = _mm256_loadu_si256((__m256i const *)&w[i]);
+        acc = _mm256_dpbusd_avx_epi32(acc, xv, wv);
+    }
+    return bb_mm256_hsum_epi32(acc) - 128 * w_sum;
+#elif defined(__AVX2__)
+    (void)w_sum;
+    __m256i acc = _mm256_setzero_si256();
+    for ( index_t i = 0; i < size; i += 32 ) {
+        __m256i xv = _mm256_loadu_si256((__m256i const *)&x[i]);
+        __m256i wv = _mm256_loadu_si256((__m256i const *)&w[i]);
+        __m256i x0 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(xv));
+        __m256i x1 = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(xv, 1));
+        __m256i w0 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(wv));
+        __m256i w1 = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(wv, 1));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x0, w0));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x1, w1));
+    }
+    return bb_mm256_hsum_epi32(acc);
+#else
+    (void)w_sum;
+    std::int32_t sum = 0;
+    for ( index_t i = 0; i < size; ++i ) {
+        sum += (std::int32_t)x[i] * (std::int32_t)w[i];
+    }
+    return sum;
+#endif
+}
+
+
+#ifdef __AVX2__
+// 8レーンの int16 ペア積和 acc + (a.lo * b.lo + a.hi * b.hi)
+inline __m256i bb_mm256_dpwssd_epi32(__m256i acc, __m256i a, __m256i b)
+{
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, a, b);
+#elif defined(__AVXVNNI__)
+    return _mm256_dpwssd_avx_epi32(acc, a, b);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+#endif
+}
+
+// int32 レーンの下位 16bit に a, 上位 16bit に b を詰める
+inline __m256i bb_mm256_pack_pair_epi16(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_and_si256(a, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(b, 16));
+}
+#endif
+
+
+}
+
+// end of file
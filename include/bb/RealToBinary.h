@@ -10,10 +10,15 @@
 
 #pragma once
 
+#include <vector>
 #include <random>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
 
 #include "bb/Model.h"
 #include "bb/ValueGenerator.h"
+#include "bb/BitPlane.h"
 
 
 namespace bb {
@@ -39,9 +44,16 @@ protected:
     indices_t                                   m_node_shape;
     index_t                                     m_modulation_size;
     std::shared_ptr< ValueGenerator<RealType> > m_value_generator;
+    std::shared_ptr<std::mutex>                 m_value_generator_mutex = std::make_shared<std::mutex>();
     bool                                        m_framewise;
     RealType                                    m_input_range_lo;
     RealType                                    m_input_range_hi;
+
+    index_t                                     m_phase_total = 0;  // 固定閾値の分割数 (0 なら m_modulation_size)
+    index_t                                     m_phase_start = 0;  // 先頭フレームの閾値番号
+    index_t                                     m_phase_step  = 1;  // フレーム毎の閾値番号の間隔
+
+    index_t                                     m_bit_plane_size = 0;   // 0 以外でビットプレーンに量子化 (BitPlane.h)
     
 
 public:
@@ -52,6 +64,7 @@ public:
         bool                                        framewise = false;          //< true でフレーム単位で閾値、falseでデータ単位
         RealType                                    input_range_lo = (RealType)0.0;  //< 入力データの下限値
         RealType                                    input_range_hi = (RealType)1.0;  //< 入力データの上限値
+        index_t                                     bit_plane_size = 0;         //< 0 以外で変調せず k ビットのビットプレーンに量子化
     };
 
 protected:
@@ -62,6 +75,7 @@ protected:
         m_framewise       = create.framewise;
         m_input_range_lo  = create.input_range_lo;
         m_input_range_hi  = create.input_range_hi;
+        m_bit_plane_size  = create.bit_plane_size;
     }
 
     /**
@@ -115,6 +129,35 @@ public:
         m_value_generator = value_generator;
     }
 
+    /**
+     * @brief  固定閾値の割り当て設定
+     * @detail ジェネレーター無しの場合に、入力範囲を total 分割した閾値のうち
+     *         frame 番目の変調に start + frame * step 番目を使う
+     *         変調を複数回に分けて評価する場合に使う (total = 0 で通常に戻す)
+     * @param  total 分割数
+     * @param  start 先頭の閾値番号
+     * @param  step  閾値番号の間隔
+     */
+    void SetModulationPhase(index_t total, index_t start=0, index_t step=1)
+    {
+        m_phase_total = total;
+        m_phase_start = start;
+        m_phase_step  = step;
+    }
+
+    /**
+     * @brief  ビットプレーン出力設定
+     * @detail 0 以外を設定すると、閾値変調の代わりに入力範囲を k ビットに量子化して
+     *         ビットプレーン (出力形状の最上位の次元が k 倍) で出力する
+     * @param  bit_plane_size ビット数 k (0 で通常の変調に戻す)
+     */
+    void SetBitPlaneSize(index_t bit_plane_size)
+    {
+        m_bit_plane_size = bit_plane_size;
+    }
+
+    index_t GetBitPlaneSize(void) const { return m_bit_plane_size; }
+
     /**
      * @brief  入力のshape設定
      * @detail 入力のshape設定
@@ -125,7 +168,7 @@ public:
     {
         // 形状設定
         m_node_shape = shape;
-        return m_node_shape;
+        return GetOutputShape();
     }
 
     /**
@@ -145,6 +188,9 @@ public:
      */
     indices_t GetOutputShape(void) const
     {
+        if ( m_bit_plane_size > 0 ) {
+            return BitPlane_GetShape(m_node_shape, m_bit_plane_size);
+        }
         return m_node_shape;
     }
     
@@ -162,6 +208,10 @@ public:
             SetInputShape(x_buf.GetShape());
         }
 
+        if ( m_bit_plane_size > 0 ) {
+            return ForwardBitPlane(x_buf);
+        }
+
         // 戻り値の型を設定
         FrameBuffer y_buf(x_buf.GetFrameSize() * m_modulation_size, m_node_shape, DataType<BinType>::type);
 
@@ -171,21 +221,42 @@ public:
         auto x_ptr = x_buf.LockConst<RealType>();
         auto y_ptr = y_buf.Lock<BinType>();
 
-        RealType th_step = (m_input_range_hi - m_input_range_lo) / (RealType)(m_modulation_size + 1);
+        // ジェネレーターは内部状態を持つので、推論が複数スレッドから呼ばれた場合は排他する
+        std::unique_lock<std::mutex> lock(*m_value_generator_mutex, std::defer_lock);
+        if ( m_value_generator != nullptr ) {
+            lock.lock();
+        }
+
+        index_t  th_total = (m_phase_total > 0) ? m_phase_total : m_modulation_size;
+        index_t  th_start = (m_phase_total > 0) ? m_phase_start : 0;
+        index_t  th_index = (m_phase_total > 0) ? m_phase_step  : 1;
+        RealType th_step  = (m_input_range_hi - m_input_range_lo) / (RealType)(th_total + 1);
+
+        // 乱数閾値は出力フレーム毎に GetValue() を順に呼んだ場合と同じ並びで生成する
+        // (全フレーム分をまとめて持たないよう、1出力フレーム分のバッファを使い回す)
+        std::vector<RealType> th_buf;
+        if ( m_value_generator != nullptr ) {
+            th_buf.resize(m_framewise ? 1 : node_size);
+        }
+
         for ( index_t input_frame = 0; input_frame < input_frame_size; ++input_frame) {
             for ( index_t i = 0; i < m_modulation_size; ++i ) {
                 index_t output_frame = input_frame * m_modulation_size + i;
 
+                if ( m_value_generator != nullptr ) {
+                    m_value_generator->Fill(th_buf.data(), (index_t)th_buf.size());
+                }
+
                 if ( m_framewise || m_value_generator == nullptr ) {
                     // frame毎に閾値変調
                     RealType th;
                     if ( m_value_generator != nullptr ) {
-                        th = m_value_generator->GetValue();
+                        th = th_buf[0];
                         th = std::max(th, m_input_range_lo);
                         th = std::min(th, m_input_range_hi);
                     }
                     else {
-                        th = m_input_range_lo + (th_step * (RealType)(i + 1));
+                        th = m_input_range_lo + (th_step * (RealType)(th_start + i * th_index + 1));
                     }
 
                     #pragma omp parallel for
@@ -197,8 +268,10 @@ public:
                 }
                 else {
                     // データ毎に閾値変調
+                    RealType const *th_ptr = th_buf.data();
+                    #pragma omp parallel for
                     for (index_t node = 0; node < node_size; ++node) {
-                        RealType th = m_value_generator->GetValue();
+                        RealType th = th_ptr[node];
                         RealType x = x_ptr.Get(input_frame, node);
                         BinType  y  = (x > th) ? (BinType)1 : (BinType)0;
                         y_ptr.Set(output_frame, node, y);
@@ -213,6 +286,14 @@ public:
 
     FrameBuffer Backward(FrameBuffer dy_buf)
     {
+        if ( !m_input_gradient ) {
+            return FrameBuffer();
+        }
+
+        if ( m_binary_mode && m_bit_plane_size > 0 ) {
+            return BackwardBitPlane(dy_buf);
+        }
+
         if (!m_binary_mode || m_modulation_size == 1) {
             return dy_buf;
         }
@@ -242,6 +323,66 @@ public:
         }
 #endif
 
+        return dx_buf;
+    }
+
+protected:
+    FrameBuffer ForwardBitPlane(FrameBuffer const &x_buf)
+    {
+        if ( DataType<BinType>::type == BB_TYPE_BIT ) {
+            return BitPlane_Encode<RealType>(x_buf, m_bit_plane_size, m_input_range_lo, m_input_range_hi);
+        }
+
+        // 汎用版
+        index_t frame_size = x_buf.GetFrameSize();
+        index_t node_size  = x_buf.GetNodeSize();
+        FrameBuffer y_buf(frame_size, GetOutputShape(), DataType<BinType>::type);
+
+        auto x_ptr = x_buf.LockConst<RealType>();
+        auto y_ptr = y_buf.Lock<BinType>();
+
+        int      level_max = (1 << m_bit_plane_size) - 1;
+        RealType scale     = (RealType)level_max / (m_input_range_hi - m_input_range_lo);
+
+        #pragma omp parallel for
+        for (index_t node = 0; node < node_size; ++node) {
+            for (index_t frame = 0; frame < frame_size; ++frame) {
+                int q = (int)std::floor((x_ptr.Get(frame, node) - m_input_range_lo) * scale + (RealType)0.5);
+                q = std::max(0, std::min(level_max, q));
+                for (index_t p = 0; p < m_bit_plane_size; ++p) {
+                    y_ptr.Set(frame, p * node_size + node, ((q >> p) & 1) ? (BinType)1 : (BinType)0);
+                }
+            }
+        }
+
+        return y_buf;
+    }
+
+    // 各プレーンの勾配を桁の重みで足し込む (straight-through)
+    FrameBuffer BackwardBitPlane(FrameBuffer const &dy_buf)
+    {
+        BB_ASSERT(dy_buf.GetType() == DataType<RealType>::type);
+
+        index_t frame_size = dy_buf.GetFrameSize();
+        index_t node_size  = GetShapeSize(m_node_shape);
+        FrameBuffer dx_buf(frame_size, m_node_shape, DataType<RealType>::type);
+
+        auto dy_ptr = dy_buf.LockConst<RealType>();
+        auto dx_ptr = dx_buf.Lock<RealType>(true);
+
+        RealType level_max = (RealType)((1 << m_bit_plane_size) - 1);
+
+        #pragma omp parallel for
+        for (index_t node = 0; node < node_size; ++node) {
+            for (index_t frame = 0; frame < frame_size; ++frame) {
+                RealType dx = 0;
+                for (index_t p = 0; p < m_bit_plane_size; ++p) {
+                    dx += dy_ptr.Get(frame, p * node_size + node) * (RealType)(1 << p) / level_max;
+                }
+                dx_ptr.Set(frame, node, dx);
+            }
+        }
+
         return dx_buf;
     }
 };
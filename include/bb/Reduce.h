@@ -26,6 +26,8 @@ namespace bb {
  * 
  * @tparam FT   foward入力型 (x, y)
  * @tparam BT   backward型 (dy, dx)
+ *
+ * 入力には FT の他に Bit 型も受け付け、その場合はパックされたまま集計する
  */
 template <typename FT = float, typename BT = float>
 class Reduce : public Model
@@ -133,7 +135,7 @@ public:
 
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
-        BB_ASSERT(x_buf.GetType() == DataType<FT>::type);
+        BB_ASSERT(x_buf.GetType() == DataType<FT>::type || x_buf.GetType() == BB_TYPE_BIT);
 
         // SetInputShpaeされていなければ初回に設定
         if (x_buf.GetShape() != m_input_shape) {
@@ -165,6 +167,58 @@ public:
         }
 #endif
 
+        if ( x_buf.GetType() == BB_TYPE_BIT && DataType<FT>::type != BB_TYPE_BIT ) {
+            // Bit入力版
+            //   64フレーム分のワード単位で、多重化された入力ノードをビットプレーンの
+            //   カウンタに桁上げ加算してから、フレーム毎の個数に展開する
+            auto x_ptr = x_buf.LockMemoryConst();
+            auto y_ptr = y_buf.LockMemory(true);
+            auto x_addr = (std::uint8_t const *)x_ptr.GetAddr();
+            auto y_addr = (std::uint8_t       *)y_ptr.GetAddr();
+
+            index_t input_node_size   = GetInputNodeSize();
+            index_t output_node_size  = GetOutputNodeSize();
+            index_t frame_size        = y_buf.GetFrameSize();
+            index_t x_frame_stride    = x_buf.GetFrameStride();
+            index_t y_frame_stride    = y_buf.GetFrameStride();
+
+            index_t mux_size          = input_node_size / output_node_size;
+            index_t word_size         = (frame_size + 63) / 64;
+
+            int plane_size = 1;
+            while ( ((index_t)1 << plane_size) <= mux_size ) {
+                ++plane_size;
+            }
+
+            #pragma omp parallel for
+            for (index_t output_node = 0; output_node < output_node_size; ++output_node) {
+                auto y_vec = (FT *)(y_addr + output_node * y_frame_stride);
+                for (index_t word = 0; word < word_size; ++word) {
+                    std::uint64_t plane[64] = {0};
+                    for (index_t i = 0; i < mux_size; ++i) {
+                        auto x_vec = (std::uint64_t const *)(x_addr + (output_node_size * i + output_node) * x_frame_stride);
+                        std::uint64_t carry = x_vec[word];
+                        for (int p = 0; carry != 0 && p < plane_size; ++p) {
+                            std::uint64_t next = plane[p] & carry;
+                            plane[p] ^= carry;
+                            carry = next;
+                        }
+                    }
+
+                    index_t bit_size = std::min((index_t)64, frame_size - word * 64);
+                    for (index_t bit = 0; bit < bit_size; ++bit) {
+                        int count = 0;
+                        for (int p = 0; p < plane_size; ++p) {
+                            count |= (int)((plane[p] >> bit) & 1) << p;
+                        }
+                        y_vec[word * 64 + bit] = (FT)count / (FT)mux_size;
+                    }
+                }
+            }
+
+            return y_buf;
+        }
+
         {
             // 汎用版
             auto x_ptr = x_buf.LockConst<FT>();
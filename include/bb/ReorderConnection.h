@@ -0,0 +1,94 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "bb/Sequential.h"
+#include "bb/SparseLayer.h"
+
+
+namespace bb {
+
+
+// 直列接続された疎結合レイヤーの結線並べ替え
+//   後段から順に、各レイヤーが入力を参照する順番に前段の出力ノードを並べ替え
+//   (Cuthill-McKee 的な初出順の番号付け)、Forward/Backward 時のアクセスを局所化する
+//   最前段の入力と最後段の出力の並びは変わらないので、ネット全体の入出力は不変
+//   Optimizer が保持する状態(Adam の m/v 等)は並べ替わらないため、Optimizer の生成
+//   (SetVariables) より前に呼ぶか、呼んだ後に SetVariables() で状態を作り直すこと
+inline void ReorderConnection_SparseLayers(std::vector< std::shared_ptr<SparseLayer> > layers)
+{
+    for ( int i = (int)layers.size() - 1; i > 0; --i ) {
+        auto cur  = layers[i];
+        auto prev = layers[i-1];
+
+        index_t input_node_size  = cur->GetInputNodeSize();
+        index_t output_node_size = cur->GetOutputNodeSize();
+        BB_ASSERT(prev->GetOutputNodeSize() == input_node_size);
+
+        // 参照順に番号付け
+        std::vector<index_t>    order;
+        std::vector<index_t>    input_map(input_node_size, -1);
+        order.reserve(input_node_size);
+        for ( index_t node = 0; node < output_node_size; ++node ) {
+            index_t input_size = cur->GetNodeInputSize(node);
+            for ( index_t j = 0; j < input_size; ++j ) {
+                index_t input_node = cur->GetNodeInput(node, j);
+                if ( input_map[input_node] < 0 ) {
+                    input_map[input_node] = (index_t)order.size();
+                    order.push_back(input_node);
+                }
+            }
+        }
+
+        // 参照されないノードは末尾へ
+        for ( index_t input_node = 0; input_node < input_node_size; ++input_node ) {
+            if ( input_map[input_node] < 0 ) {
+                input_map[input_node] = (index_t)order.size();
+                order.push_back(input_node);
+            }
+        }
+
+        if ( prev->PermuteOutputNode(order) ) {
+            cur->RemapNodeInput(input_map);
+        }
+    }
+}
+
+
+// Sequential 内で直接連続する疎結合レイヤーの結線並べ替え
+inline void ReorderConnection_Sequential(std::shared_ptr<Sequential> net)
+{
+    std::vector< std::shared_ptr<SparseLayer> > layers;
+    for (int i = 0; i < net->GetSize(); ++i) {
+        auto layer = std::dynamic_pointer_cast<SparseLayer>(net->Get(i));
+        if ( layer != nullptr ) {
+            layers.push_back(layer);
+            continue;
+        }
+
+        // 疎結合以外のレイヤーを挟むと並べ替えられないので区切る
+        ReorderConnection_SparseLayers(layers);
+        layers.clear();
+
+        auto seq = std::dynamic_pointer_cast<Sequential>(net->Get(i));
+        if ( seq != nullptr ) {
+            ReorderConnection_Sequential(seq);
+        }
+    }
+    ReorderConnection_SparseLayers(layers);
+}
+
+
+}
+
+// end of file
@@ -19,10 +19,12 @@
 #include <assert.h>
 #include <string>
 
+#include "bb/Manager.h"
 #include "bb/Model.h"
 #include "bb/LossFunction.h"
 #include "bb/MetricsFunction.h"
 #include "bb/Optimizer.h"
+#include "bb/DataParallel.h"
 #include "bb/Utility.h"
 
 
@@ -132,6 +134,7 @@ protected:
     std::shared_ptr<MetricsFunction>    m_metricsFunc;
     std::shared_ptr<LossFunction>       m_lossFunc;
     std::shared_ptr<Optimizer>          m_optimizer;
+    std::shared_ptr<DataParallel>       m_data_parallel;
 
     bool                                m_print_progress          = true;
     bool                                m_print_progress_loss     = true;     //< 途中経過で損失を表示するか
@@ -157,6 +160,7 @@ public:
         std::shared_ptr<LossFunction>       lossFunc;                           //< 損失関数オブジェクト
         std::shared_ptr<MetricsFunction>    metricsFunc;                        //< 評価関数オブジェクト
         std::shared_ptr<Optimizer>          optimizer;                          //< オプティマイザ
+        std::vector< std::shared_ptr<Model> > replicas;                         //< データ並列学習用の複製ネット(net と同じ構成)
         index_t                             max_run_size = 0;                   //< 最大実行バッチ数
         bool                                print_progress = true;              //< 途中経過を表示するか
         bool                                print_progress_loss = true;         //< 途中経過で損失を表示するか
@@ -202,6 +206,10 @@ protected:
         
         m_mt.seed(create.seed);
 
+        if ( !create.replicas.empty() ) {
+            m_data_parallel = DataParallel::Create(m_net, create.replicas);
+        }
+
         if ( m_name.empty() ) {
             m_name = m_net->GetName();
         }
@@ -448,9 +456,26 @@ public:
             // 開始メッセージ
             log_stream << "fitting start : " << m_name << std::endl;
 
+            // 入力データに対する勾配は使わないので、先頭側のレイヤーの dx 計算を省く
+            // (ネットは外でも使われるので、終了時に元の設定へ戻す)
+            std::vector<bool> prev_input_gradient;
+            prev_input_gradient.push_back(m_net->IsInputGradient());
+            m_net->SetInputGradient(false);
+            if ( m_data_parallel != nullptr ) {
+                for ( index_t i = 1; i < m_data_parallel->GetSize(); ++i ) {
+                    prev_input_gradient.push_back(m_data_parallel->GetNet(i)->IsInputGradient());
+                    m_data_parallel->GetNet(i)->SetInputGradient(false);
+                }
+            }
+
             // オプティマイザ設定
             m_optimizer->SetVariables(m_net->GetParameters(), m_net->GetGradients());
 
+            // データ並列時は複製へ状態を配る
+            if ( m_data_parallel != nullptr ) {
+                m_data_parallel->Broadcast();
+            }
+
             // 初期評価
             if (m_initial_evaluation) {
                 auto test_metrics  = Calculation(td.x_test,  td.x_shape, td.t_test,  td.t_shape, batch_size, 0, m_metricsFunc, nullptr, nullptr, false, m_print_progress);
@@ -532,6 +557,14 @@ public:
                 ShuffleDataSet(m_mt(), td.x_train, td.t_train);
             }
 
+            // 入力勾配の設定を戻す
+            m_net->SetInputGradient(prev_input_gradient[0]);
+            if ( m_data_parallel != nullptr ) {
+                for ( index_t i = 1; i < m_data_parallel->GetSize(); ++i ) {
+                    m_data_parallel->GetNet(i)->SetInputGradient(prev_input_gradient[(size_t)i]);
+                }
+            }
+
             // 終了メッセージ
             log_stream << "fitting end\n" << std::endl;
         }
@@ -548,6 +581,51 @@ public:
 
     
 protected:
+    // ミニバッチを複製数に分けて並列に Forward/Backward し、勾配と統計量を集約する
+    void CalculationDataParallel(
+                FrameBuffer                         x_batch,
+                FrameBuffer                         t_batch,
+                index_t                             mini_batch_size,
+                std::shared_ptr< MetricsFunction >  metricsFunc,
+                std::shared_ptr< LossFunction >     lossFunc
+            )
+    {
+        // 分割サイズは 256bit 境界にあわせてビューで切り出せるようにする
+        index_t unit       = std::max<index_t>(1, 256 / DataType_GetBitSize(DataType<T>::type));
+        index_t split_size = (mini_batch_size + m_data_parallel->GetSize() - 1) / m_data_parallel->GetSize();
+        split_size = (split_size + unit - 1) / unit * unit;
+
+        std::vector<FrameBuffer> x_bufs;
+        std::vector<FrameBuffer> t_bufs;
+        for ( index_t start = 0; start < mini_batch_size; start += split_size ) {
+            index_t size = std::min(split_size, mini_batch_size - start);
+            // CUDA カーネルの多くは入出力共通のストライドを前提にするのでデバイス使用時は詰めたコピーを渡す
+            if ( !Manager::IsDeviceAvailable() && x_batch.IsFrameRangeViewable(start, size) && t_batch.IsFrameRangeViewable(start, size) ) {
+                x_bufs.push_back(x_batch.GetFrameRangeView(start, size));
+                t_bufs.push_back(t_batch.GetFrameRangeView(start, size));
+            }
+            else {
+                x_bufs.push_back(x_batch.GetRange(start, size));
+                t_bufs.push_back(t_batch.GetRange(start, size));
+            }
+        }
+
+        auto y_bufs = m_data_parallel->Forward(x_bufs, true);
+
+        // 損失関数と評価関数は状態を持つので順に処理
+        std::vector<FrameBuffer> dy_bufs;
+        for ( size_t i = 0; i < y_bufs.size(); ++i ) {
+            dy_bufs.push_back(lossFunc->CalculateLoss(y_bufs[i], t_bufs[i], mini_batch_size));
+            if ( metricsFunc != nullptr ) {
+                metricsFunc->CalculateMetrics(y_bufs[i], t_bufs[i]);
+            }
+        }
+
+        m_data_parallel->Backward(dy_bufs);
+        m_data_parallel->ReduceGradients();
+        m_data_parallel->ReduceStatistics((index_t)y_bufs.size());
+    }
+
     double Calculation(
                 std::vector< std::vector<T> > const &x,
                 indices_t x_shape,
@@ -576,8 +654,8 @@ protected:
         
         index_t frame_size = (index_t)x.size();
         
-        FrameBuffer x_buf;
-        FrameBuffer t_buf;
+        FrameBuffer x_batch;
+        FrameBuffer t_batch;
 
         index_t index = 0;
         while ( index < frame_size )
@@ -590,44 +668,65 @@ protected:
                 break;
             }
 
-            index_t i = 0;
-            while ( i < mini_batch_size ) {
-                index_t  run_size = mini_batch_size - i;
-                if (m_max_run_size > 0 && run_size > m_max_run_size) {
-                    run_size = m_max_run_size;
-                }
+            // ミニバッチ単位でデータセット
+            x_batch.Resize(mini_batch_size, x_shape, DataType<T>::type);
+            x_batch.SetVector(x, index);
+            t_batch.Resize(mini_batch_size, t_shape, DataType<T>::type);
+            t_batch.SetVector(t, index);
 
-                // 学習データセット
-                x_buf.Resize(run_size, x_shape, DataType<T>::type);
-                x_buf.SetVector(x, index + i);
+            if ( train && lossFunc != nullptr && m_data_parallel != nullptr ) {
+                // データ並列学習
+                CalculationDataParallel(x_batch, t_batch, mini_batch_size, metricsFunc, lossFunc);
+            }
+            else {
+                index_t i = 0;
+                while ( i < mini_batch_size ) {
+                    index_t  run_size = mini_batch_size - i;
+                    if (m_max_run_size > 0 && run_size > m_max_run_size) {
+                        run_size = m_max_run_size;
+                    }
 
-                // Forward
-                auto y_buf = m_net->Forward(x_buf, train);
+                    // 分割実行時はミニバッチのビューで切り出す(境界が合わない場合とデバイス使用時はコピー)
+                    FrameBuffer x_buf = x_batch;
+                    FrameBuffer t_buf = t_batch;
+                    if ( run_size < mini_batch_size ) {
+                        if ( !Manager::IsDeviceAvailable() && x_batch.IsFrameRangeViewable(i, run_size) && t_batch.IsFrameRangeViewable(i, run_size) ) {
+                            x_buf = x_batch.GetFrameRangeView(i, run_size);
+                            t_buf = t_batch.GetFrameRangeView(i, run_size);
+                        }
+                        else {
+                            x_buf = x_batch.GetRange(i, run_size);
+                            t_buf = t_batch.GetRange(i, run_size);
+                        }
+                    }
 
-                // 期待値データセット
-                t_buf.Resize(run_size, t_shape, DataType<T>::type);
-                t_buf.SetVector(t, index + i);
+                    // Forward
+                    auto y_buf = m_net->Forward(x_buf, train);
                 
-                FrameBuffer dy_buf;
-                if ( lossFunc != nullptr ) {
-                    dy_buf = lossFunc->CalculateLoss(y_buf, t_buf, mini_batch_size);
-                }
+                    FrameBuffer dy_buf;
+                    if ( lossFunc != nullptr ) {
+                        dy_buf = lossFunc->CalculateLoss(y_buf, t_buf, mini_batch_size);
+                    }
 
-                if ( metricsFunc != nullptr ) {
-                    metricsFunc->CalculateMetrics(y_buf, t_buf);
-                }
+                    if ( metricsFunc != nullptr ) {
+                        metricsFunc->CalculateMetrics(y_buf, t_buf);
+                    }
 
-                if ( train && lossFunc != nullptr ) {
-                    auto dx = m_net->Backward(dy_buf);
-                }
+                    if ( train && lossFunc != nullptr ) {
+                        auto dx = m_net->Backward(dy_buf);
+                    }
 
-                i += run_size;
+                    i += run_size;
+                }
             }
 
             if ( train && lossFunc != nullptr ) {
                 if ( optimizer != nullptr ) {
                     optimizer->Update();
                 }
+                if ( m_data_parallel != nullptr ) {
+                    m_data_parallel->SyncParameters();
+                }
             }
 
             // print progress
@@ -107,6 +107,20 @@ public:
         return gradients;
     }  
 
+    /**
+     * @brief  統計量取得
+     * @detail 内部のレイヤーの統計量をまとめて取得する
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void)
+    {
+        Variables statistics;
+        for (auto layer : m_layers) {
+            statistics.PushBack(layer->GetStatistics());
+        }
+        return statistics;
+    }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -120,9 +134,46 @@ public:
         for (auto layer : m_layers) {
             shape = layer->SetInputShape(shape);
         }
+        SetChainInputGradient(m_layers, m_input_gradient);
         return shape;
     }
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail 手前に学習対象のレイヤーが無いレイヤーは入力勾配を不要とする
+     *         内部レイヤーを個別に固定した場合は、その後で呼び直すこと
+     * @param  enable 先頭レイヤーの入力勾配が必要か
+     */
+    void SetInputGradient(bool enable)
+    {
+        m_input_gradient = enable;
+        SetChainInputGradient(m_layers, enable);
+    }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail 内部の全レイヤーを固定する
+     * @param  frozen 固定するなら true
+     */
+    void SetFrozen(bool frozen)
+    {
+        m_frozen = frozen;
+        for (auto layer : m_layers) {
+            layer->SetFrozen(frozen);
+        }
+        SetChainInputGradient(m_layers, m_input_gradient);
+    }
+
+    bool IsTrainable(void)
+    {
+        for (auto layer : m_layers) {
+            if ( layer->IsTrainable() ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * @brief  入力形状取得
      * @detail 入力形状を取得する
@@ -169,10 +220,7 @@ public:
      */
     FrameBuffer Backward(FrameBuffer dy)
     {
-        for (auto it = m_layers.rbegin(); it != m_layers.rend(); ++it) {
-            dy = (*it)->Backward(dy);
-        }
-        return dy; 
+        return BackwardChain(m_layers, dy);
     }
     
 protected:
@@ -10,7 +10,6 @@
 #pragma once
 
 #include <vector>
-#include <list>
 #include <random>
 #include <algorithm>
 
@@ -23,13 +22,16 @@ namespace bb {
 // 特定の値がずっと出なかったり、同じものが出続けることを防止する
 
 // シャッフルクラス
+// 大規模ネットの結線生成でも高速に動くよう std::list を使わず配列で管理する
 template <typename INDEX>
 class ShuffleSet
 {
 protected:
     std::mt19937_64     m_mt;
-    std::list<INDEX>    m_heap;
-    std::list<INDEX>    m_reserve;
+    std::vector<INDEX>  m_heap;
+    size_t              m_heap_pos = 0;
+    std::vector<INDEX>  m_reserve;
+    std::vector<INDEX>  m_stash;
 
 public:
     ShuffleSet()
@@ -46,57 +48,51 @@ public:
         // 初期化
         m_mt.seed(seed);
         m_heap.clear();
+        m_heap_pos = 0;
         m_reserve.clear();
 
         // シャッフル
-        std::vector<INDEX> heap(size);
+        m_heap.resize(size);
         for (INDEX i = 0; i < size; i++) {
-            heap[i] = i;
+            m_heap[i] = i;
         }
-        std::shuffle(heap.begin(), heap.end(), m_mt);
-
-        // 設定
-        m_heap.assign(heap.begin(), heap.end());
+        std::shuffle(m_heap.begin(), m_heap.end(), m_mt);
     }
     
     std::vector<INDEX> GetRandomSet(INDEX n)
     {
         std::vector<INDEX>  set;
-        std::vector<INDEX>  stash;
+        set.reserve(n);
+        m_stash.clear();
 
         // 指定個数取り出す
         for (INDEX i = 0; i < n; i++) {
-            if (m_heap.empty()) {
+            if (m_heap_pos >= m_heap.size()) {
                 // 一通り割り当てたら利用済みを再利用
-                std::vector<INDEX> heap(m_reserve.size());
-                heap.assign(m_reserve.begin(), m_reserve.end());
-                std::shuffle(heap.begin(), heap.end(), m_mt);
-                m_heap.assign(heap.begin(), heap.end());
+                m_heap.swap(m_reserve);
                 m_reserve.clear();
+                m_heap_pos = 0;
+                std::shuffle(m_heap.begin(), m_heap.end(), m_mt);
             }
             
             // reserveで不足する場合は stash から回す
-            if (m_heap.empty()) {
-                std::vector<INDEX> heap(stash.size());
-                heap.assign(stash.begin(), stash.end());
-                std::shuffle(heap.begin(), heap.end(), m_mt);
-                m_heap.assign(heap.begin(), heap.end());
-                stash.clear();
+            if (m_heap_pos >= m_heap.size()) {
+                m_heap.swap(m_stash);
+                m_stash.clear();
+                m_heap_pos = 0;
+                std::shuffle(m_heap.begin(), m_heap.end(), m_mt);
             }
 
             // 先頭から取り出す
-            auto item = m_heap.front();
+            auto item = m_heap[m_heap_pos++];
             set.push_back(item);
 
             // 使ったものはstashに移す
-            m_heap.pop_front();
-            stash.push_back(item);
+            m_stash.push_back(item);
         }
 
         // stashに残っているものはリザーブに回す
-        for (auto item : stash) {
-            m_reserve.push_back(item);
-        }
+        m_reserve.insert(m_reserve.end(), m_stash.begin(), m_stash.end());
 
         return set;
     }
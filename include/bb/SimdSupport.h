@@ -10,6 +10,9 @@
 #pragma once
 
 #include <assert.h>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
 
 
 #ifdef _MSC_VER
@@ -100,6 +103,309 @@ inline __m256 bb_mm256_hsum_ps(__m256 r)
     return _mm256_hadd_ps(r, r);
 }
 
+
+// 64bit ポピュレーションカウント
+inline int bb_popcnt_u64(std::uint64_t x)
+{
+#if defined(__POPCNT__)
+    return (int)_mm_popcnt_u64(x);
+#elif defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+#ifdef __AVX2__
+// 64bit レーン毎のポピュレーションカウント (ニブル単位のテーブル引き)
+inline __m256i bb_mm256_popcnt_epi64(__m256i v)
+{
+    __m256i const lut      = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                              0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i const low_mask = _mm256_set1_epi8(0x0f);
+    __m256i lo  = _mm256_and_si256(v, low_mask);
+    __m256i hi  = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+    return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+#endif
+
+// LSB 詰めのビット列 p の [begin, begin+size) にある 1 の数
+inline std::int64_t bb_popcnt_bits(std::uint64_t const *p, std::int64_t begin, std::int64_t size)
+{
+    std::int64_t count = 0;
+
+    // 先頭の端数
+    std::int64_t shift = begin & 63;
+    p += (begin >> 6);
+    if ( shift != 0 && size > 0 ) {
+        std::int64_t  len  = std::min<std::int64_t>(size, 64 - shift);
+        std::uint64_t mask = (len >= 64) ? ~(std::uint64_t)0 : (((std::uint64_t)1 << len) - 1);
+        count += bb_popcnt_u64((*p++ >> shift) & mask);
+        size  -= len;
+    }
+
+#ifdef __AVX2__
+    if ( size >= 256 ) {
+        __m256i acc = _mm256_setzero_si256();
+        for ( ; size >= 256; size -= 256, p += 4 ) {
+            acc = _mm256_add_epi64(acc, bb_mm256_popcnt_epi64(_mm256_loadu_si256((__m256i const *)p)));
+        }
+        alignas(32) std::int64_t tmp[4];
+        _mm256_store_si256((__m256i *)tmp, acc);
+        count += tmp[0] + tmp[1] + tmp[2] + tmp[3];
+    }
+#endif
+
+    for ( ; size >= 64; size -= 64 ) {
+        count += bb_popcnt_u64(*p++);
+    }
+
+    // 末尾の端数
+    if ( size > 0 ) {
+        count += bb_popcnt_u64(*p & (((std::uint64_t)1 << size) - 1));
+    }
+
+    return count;
+}
+
+// 2本のビット列 a, b を words ワード分 XNOR した結果の 1 の数
+inline std::int64_t bb_popcnt_xnor(std::uint64_t const *a, std::uint64_t const *b, std::int64_t words)
+{
+    std::int64_t count = 0;
+    std::int64_t i     = 0;
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    if ( words >= 8 ) {
+        __m512i acc = _mm512_setzero_si512();
+        for ( ; i + 8 <= words; i += 8 ) {
+            __m512i x = _mm512_xor_si512(_mm512_loadu_si512((void const *)(a + i)), _mm512_loadu_si512((void const *)(b + i)));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_ternarylogic_epi64(x, x, x, 0x55)));
+        }
+        count += _mm512_reduce_add_epi64(acc);
+    }
+#elif defined(__AVX2__)
+    if ( words >= 4 ) {
+        __m256i const ones = _mm256_set1_epi64x(-1);
+        __m256i acc = _mm256_setzero_si256();
+        for ( ; i + 4 <= words; i += 4 ) {
+            __m256i x = _mm256_xor_si256(_mm256_loadu_si256((__m256i const *)(a + i)), _mm256_loadu_si256((__m256i const *)(b + i)));
+            acc = _mm256_add_epi64(acc, bb_mm256_popcnt_epi64(_mm256_xor_si256(x, ones)));
+        }
+        alignas(32) std::int64_t tmp[4];
+        _mm256_store_si256((__m256i *)tmp, acc);
+        count += tmp[0] + tmp[1] + tmp[2] + tmp[3];
+    }
+#endif
+
+    for ( ; i < words; ++i ) {
+        count += bb_popcnt_u64(~(a[i] ^ b[i]));
+    }
+
+    return count;
+}
+
+
+
+// -------------------------------------
+//  半精度 (FP16/BF16) の変換
+//    メモリ上は 16bit で持ち、演算はロード/ストア段で float に変換して行う
+// -------------------------------------
+
+// binary16 -> float
+inline float bb_cvtsh_ss(std::uint16_t h)
+{
+#ifdef __F16C__
+    return _cvtsh_ss(h);
+#else
+    std::uint32_t o   = (std::uint32_t)(h & 0x7fff) << 13;
+    std::uint32_t exp = o & 0x0f800000;
+    o += (127 - 15) << 23;
+    if ( exp == 0x0f800000 ) {
+        o += (128 - 16) << 23;      // Inf/NaN
+    }
+    else if ( exp == 0 ) {
+        // 非正規化数
+        o += 1 << 23;
+        float f, magic;
+        std::uint32_t magic_bits = 113 << 23;
+        std::memcpy(&f, &o, 4);
+        std::memcpy(&magic, &magic_bits, 4);
+        f -= magic;
+        std::memcpy(&o, &f, 4);
+    }
+    o |= (std::uint32_t)(h & 0x8000) << 16;
+    float f;
+    std::memcpy(&f, &o, 4);
+    return f;
+#endif
+}
+
+// float -> binary16 (最近接偶数丸め)
+inline std::uint16_t bb_cvtss_sh(float f)
+{
+#ifdef __F16C__
+    return (std::uint16_t)_cvtss_sh(f, 0);
+#else
+    std::uint32_t x;
+    std::memcpy(&x, &f, 4);
+    std::uint16_t sign = (std::uint16_t)((x >> 16) & 0x8000);
+    std::uint32_t a    = x & 0x7fffffff;
+
+    if ( a >= 0x7f800000 ) {
+        return sign | ((a > 0x7f800000) ? 0x7e00 : 0x7c00);     // NaN/Inf
+    }
+    if ( a >= 0x477ff000 ) {
+        return sign | 0x7c00;   // オーバーフロー
+    }
+    if ( a < 0x38800000 ) {
+        // 非正規化数 (0.5 を足して仮数部の丸めを FPU に任せる)
+        float t;
+        std::memcpy(&t, &a, 4);
+        t += 0.5f;
+        std::uint32_t r;
+        std::memcpy(&r, &t, 4);
+        return sign | (std::uint16_t)(r - 0x3f000000);
+    }
+    std::uint32_t odd = (a >> 13) & 1;
+    a += 0xc8000fff + odd;
+    return sign | (std::uint16_t)(a >> 13);
+#endif
+}
+
+// bfloat16 -> float
+inline float bb_cvtbf16_ss(std::uint16_t h)
+{
+    std::uint32_t x = (std::uint32_t)h << 16;
+    float f;
+    std::memcpy(&f, &x, 4);
+    return f;
+}
+
+// float -> bfloat16 (最近接偶数丸め)
+inline std::uint16_t bb_cvtss_bf16(float f)
+{
+    std::uint32_t x;
+    std::memcpy(&x, &f, 4);
+    if ( (x & 0x7fffffff) > 0x7f800000 ) {
+        return (std::uint16_t)((x >> 16) | 0x0040);     // quiet NaN
+    }
+    x += 0x7fff + ((x >> 16) & 1);
+    return (std::uint16_t)(x >> 16);
+}
+
+
+#ifdef __AVX2__
+// binary16 x8 を float x8 で読み込み
+inline __m256 bb_mm256_loadu_ph_ps(std::uint16_t const *p)
+{
+#ifdef __F16C__
+    return _mm256_cvtph_ps(_mm_loadu_si128((__m128i const *)p));
+#else
+    alignas(32) float f[8];
+    for ( int i = 0; i < 8; ++i ) {
+        f[i] = bb_cvtsh_ss(p[i]);
+    }
+    return _mm256_load_ps(f);
+#endif
+}
+
+// float x8 を binary16 x8 で書き込み
+inline void bb_mm256_storeu_ps_ph(std::uint16_t *p, __m256 v)
+{
+#ifdef __F16C__
+    _mm_storeu_si128((__m128i *)p, _mm256_cvtps_ph(v, 0));
+#else
+    alignas(32) float f[8];
+    _mm256_store_ps(f, v);
+    for ( int i = 0; i < 8; ++i ) {
+        p[i] = bb_cvtss_sh(f[i]);
+    }
+#endif
+}
+
+// bfloat16 x8 を float x8 で読み込み
+inline __m256 bb_mm256_loadu_bf16_ps(std::uint16_t const *p)
+{
+    __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const *)p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+}
+
+// float x8 を bfloat16 x8 で書き込み
+inline void bb_mm256_storeu_ps_bf16(std::uint16_t *p, __m256 v)
+{
+#if defined(__AVX512BF16__) && defined(__AVX512VL__)
+    _mm_storeu_si128((__m128i *)p, (__m128i)_mm256_cvtneps_pbh(v));
+#else
+    __m256i x   = _mm256_castps_si256(v);
+    __m256i hi  = _mm256_srli_epi32(x, 16);
+    __m256i lsb = _mm256_and_si256(hi, _mm256_set1_epi32(1));
+    __m256i r   = _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_add_epi32(_mm256_set1_epi32(0x7fff), lsb)), 16);
+    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    r = _mm256_blendv_epi8(r, _mm256_or_si256(hi, _mm256_set1_epi32(0x0040)), nan);
+    r = _mm256_permute4x64_epi64(_mm256_packus_epi32(r, r), 0x08);
+    _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(r));
+#endif
+}
+#endif
+
+
+// -------------------------------------
+//  乱数変換用の初等関数 (float x8)
+// -------------------------------------
+
+#ifdef __AVX2__
+// 自然対数 (x > 0 の正規化数のみ, Cephes logf と同じ多項式)
+inline __m256 bb_mm256_log_ps(__m256 x)
+{
+    __m256i bits = _mm256_castps_si256(x);
+    __m256  e    = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+    __m256  m    = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)));
+
+    // m を [sqrt(0.5), sqrt(2)) に寄せて m - 1 を多項式近似
+    __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(small, _mm256_set1_ps(1.0f)));
+    m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(small, m)), _mm256_set1_ps(1.0f));
+
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.1514610310e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(+1.1676998740e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.2420140846e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(+1.4249322787e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.6668057665e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(+2.0000714765e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-2.4999993993e-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(+3.3333331174e-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+    y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+}
+
+// sin と cos (|x| <= pi/2 のみ, テイラー展開)
+inline void bb_mm256_sincos_ps(__m256 x, __m256 &s, __m256 &c)
+{
+    __m256 x2 = _mm256_mul_ps(x, x);
+
+    s = _mm256_set1_ps(-1.0f / 39916800.0f);
+    s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(+1.0f / 362880.0f));
+    s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(-1.0f / 5040.0f));
+    s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(+1.0f / 120.0f));
+    s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(-1.0f / 6.0f));
+    s = _mm256_fmadd_ps(_mm256_mul_ps(s, x2), x, x);
+
+    c = _mm256_set1_ps(-1.0f / 87178291200.0f);
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(+1.0f / 479001600.0f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(-1.0f / 3628800.0f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(+1.0f / 40320.0f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(-1.0f / 720.0f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(+1.0f / 24.0f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(-0.5f));
+    c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(1.0f));
+}
+#endif
+
 }
 
 
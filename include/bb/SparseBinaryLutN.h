@@ -15,6 +15,7 @@
 
 #include "bb/SparseLayer.h"
 #include "bb/Tensor.h"
+#include "bb/SparseForwardTable.h"
 
 
 namespace bb {
@@ -29,6 +30,7 @@ class SparseBinaryLutN : public SparseLayer
 protected:
     bool                    m_lut_binarize = true;
     bool                    m_host_only    = false;
+    bool                    m_host_table   = true;
 
     RealType                m_unbinarize_bias = (RealType)0.2;
 
@@ -61,6 +63,8 @@ protected:
     
     std::mt19937_64         m_mt;
 
+    SparseForwardTable<N, RealType> m_forward_table;
+
 public:
     struct create_t
     {
@@ -102,6 +106,12 @@ protected:
         {
             m_host_only = EvalBool(args[1]);
         }
+
+        // Host テーブル引きモード設定
+        if (args.size() == 2 && args[0] == "host_table")
+        {
+            m_host_table = EvalBool(args[1]);
+        }
     }
 
 public:
@@ -246,6 +256,20 @@ public:
         return (index_t)ptr(node, input_index);
     }
 
+    bool PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        BB_ASSERT((index_t)order.size() == GetShapeSize(m_output_shape));
+        Tensor_PermuteOuter(m_input_index,  order);
+        Tensor_PermuteOuter(*m_W,           order);
+        Tensor_PermuteOuter(*m_dW,          order);
+        Tensor_PermuteOuter(m_mean,         order);
+        Tensor_PermuteOuter(m_rstd,         order);
+        Tensor_PermuteOuter(m_running_mean, order);
+        Tensor_PermuteOuter(m_running_var,  order);
+        m_reverse_index_dirty = true;
+        return true;
+    }
+
 
    /**
      * @brief  入力のshape設定
@@ -313,6 +337,14 @@ public:
         gradients.PushBack(m_dW);
         return gradients;
     }
+
+    Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_running_mean);
+        statistics.PushBack(m_running_var);
+        return statistics;
+    }
     
     void        SetFrameBufferX(FrameBuffer x) { m_x_buf = x; }
     FrameBuffer GetFrameBufferX(void)          { return m_x_buf; }
@@ -372,6 +404,70 @@ public:
     }
 
 
+protected:
+    // テーブルの作り直しが必要かを判定するキー
+    std::vector<std::uint64_t> GetForwardTableKey(void) const
+    {
+        return {
+                m_W->GetRevision(),
+                m_running_mean.GetRevision(),
+                m_running_var.GetRevision(),
+                (std::uint64_t)m_lut_binarize,
+                SparseForwardTable<N, RealType>::KeyOf((double)m_gamma),
+                SparseForwardTable<N, RealType>::KeyOf((double)m_beta),
+                SparseForwardTable<N, RealType>::KeyOf((double)m_unbinarize_bias)
+            };
+    }
+
+    // 2値入力の全パターンに対する出力テーブルを作成 (BatchNormalization は推論時の統計を使う)
+    void BuildForwardTable(void)
+    {
+        auto key              = GetForwardTableKey();
+        auto W_ptr            = lock_W_const();
+        auto running_mean_ptr = m_running_mean.LockConst();
+        auto running_var_ptr  = m_running_var.LockConst();
+        m_forward_table.Build(GetOutputNodeSize(), key, [&](index_t node, RealType *table) {
+            RealType W[NN];
+            for ( int i = 0; i < NN; ++i) {
+                W[i] = W_ptr(node, i);
+                if ( m_lut_binarize ) {
+                    W[i] = W[i] > (RealType)0.5 ? (RealType)1.0 : (RealType)0.0;
+                }
+            }
+
+            for ( int index = 0; index < NN; ++index ) {
+                RealType   x[N][2];
+                for ( int i = 0; i < N; ++i) {
+                    RealType in_sig = (RealType)0.5 + (((index >> i) & 1) ? +m_unbinarize_bias : -m_unbinarize_bias);
+                    x[i][0] = (RealType)1.0 - in_sig;
+                    x[i][1] = in_sig;
+                }
+
+                RealType y = (RealType)0;
+                for (int i = 0; i < NN; ++i) {
+                    RealType w = W[i];
+                    for (int j = 0; j < N; ++j) {
+                        w *= x[j][(i >> j) & 1];
+                    }
+                    y += w;
+                }
+
+                // clip
+                y = std::max((RealType)0.0, y);
+                y = std::min((RealType)1.0, y);
+
+                // batch_noerm
+                y -= running_mean_ptr(node);
+                y /= (RealType)sqrt(running_var_ptr(node)) + (RealType)1.0e-7;
+                y  = y * m_gamma + m_beta;
+
+                // binary
+                table[index] = (y > (RealType)0.5) ? (RealType)1.0 : (RealType)0.0;
+            }
+        });
+    }
+
+public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
         BB_ASSERT(x_buf.GetType() == DataType<BinType>::type);
@@ -389,6 +485,18 @@ public:
             m_x_buf = x_buf;
         }
 
+        // 2値入力の推論はテーブル引き
+        if ( !train && m_host_table
+                && (m_host_only || !x_buf.IsDeviceAvailable() || !Manager::IsDeviceAvailable()) ) {
+            m_forward_table.Update(GetForwardTableKey(), [&]() {
+                m_W->Clamp((RealType)0.0, (RealType)1.0);
+                BuildForwardTable();
+            });
+            auto input_index_ptr = m_input_index.LockConst();
+            m_forward_table.template Forward<BinType, BinType>(x_buf, y_buf, input_index_ptr.GetAddr());
+            return y_buf;
+        }
+
         // パラメータクリップ
         m_W->Clamp((RealType)0.0, (RealType)1.0);
 
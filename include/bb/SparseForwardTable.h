@@ -0,0 +1,183 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                 Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                 https://github.com/ryuz
+//                                 ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "bb/DataType.h"
+#include "bb/FrameBuffer.h"
+
+
+namespace bb {
+
+
+// 入力が2値の疎結合レイヤーの Forward を、ノード毎に 2^N 通りの入力パターンに対する
+// 出力を事前計算したテーブルの表引きで行う
+//   テーブルは作成時のキー(パラメータのリビジョンや設定値)と共に保持し、
+//   キーが変わったら作り直す
+template <int N, typename RealType = float>
+class SparseForwardTable
+{
+    static int const NN = (1 << N);
+    static int const BIT_WORDS = (NN + 63) / 64;
+
+protected:
+    std::vector<std::uint64_t>  m_key;
+    index_t                     m_node_size = 0;
+    std::vector<RealType>       m_table;        // [node][NN]
+    std::vector<std::uint64_t>  m_bit_table;    // [node][BIT_WORDS] Bit 出力用
+    std::shared_ptr<std::mutex> m_mutex = std::make_shared<std::mutex>();  // 遅延作成の排他用 (レイヤーをコピー可能にするため共有)
+
+public:
+    // キー用に実数値をビット列として取り込む
+    static std::uint64_t KeyOf(double v)
+    {
+        std::uint64_t key;
+        std::memcpy(&key, &v, sizeof(key));
+        return key;
+    }
+
+    void Clear(void)
+    {
+        m_key.clear();
+        m_node_size = 0;
+        m_table.clear();
+        m_bit_table.clear();
+    }
+
+    bool IsValid(std::vector<std::uint64_t> const &key) const
+    {
+        return m_node_size > 0 && key == m_key;
+    }
+
+    /**
+     * @brief  キーが変わっていればテーブルを作り直す
+     * @detail 複数スレッドから同時に Forward されても作成は排他して1回だけ行う
+     * @param  key   現在のキー
+     * @param  build テーブルが無効な時に呼ばれる (中で Build() を呼ぶ)
+     */
+    template <class BuildFunc>
+    void Update(std::vector<std::uint64_t> const &key, BuildFunc build)
+    {
+        std::lock_guard<std::mutex> lock(*m_mutex);
+        if ( !IsValid(key) ) {
+            build();
+        }
+    }
+
+    /**
+     * @brief  テーブル作成
+     * @param  node_size 出力ノード数
+     * @param  key       作成時のキー
+     * @param  func      func(node, RealType table[NN]) でノードのテーブルを埋める
+     *                   table のインデックスは入力 i が bit i (入力 0 が LSB)
+     */
+    template <class Func>
+    void Build(index_t node_size, std::vector<std::uint64_t> const &key, Func func)
+    {
+        m_key       = key;
+        m_node_size = node_size;
+        m_table.resize(node_size * NN);
+        m_bit_table.assign(node_size * BIT_WORDS, 0);
+
+        #pragma omp parallel for
+        for ( index_t node = 0; node < node_size; ++node ) {
+            RealType *table = &m_table[node * NN];
+            func(node, table);
+            for ( int i = 0; i < NN; ++i ) {
+                if ( table[i] > (RealType)0 ) {
+                    m_bit_table[node * BIT_WORDS + i / 64] |= ((std::uint64_t)1 << (i % 64));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief  表引きによる Forward
+     * @param  x_buf       入力 (Bit 以外は 0.5 より大きければ 1 とみなす)
+     * @param  y_buf       出力 (Bit なら表の値が正かどうか)
+     * @param  input_index ノード毎の N 個の入力ノード番号 [node][N]
+     */
+    template <typename InType, typename OutType>
+    void Forward(FrameBuffer const &x_buf, FrameBuffer &y_buf, std::int32_t const *input_index) const
+    {
+        BB_ASSERT(x_buf.GetType() == DataType<InType>::type);
+        BB_ASSERT(y_buf.GetType() == DataType<OutType>::type);
+        BB_ASSERT(y_buf.GetNodeSize() == m_node_size);
+
+        index_t frame_size     = y_buf.GetFrameSize();
+        index_t x_frame_stride = x_buf.GetFrameStride();
+        index_t y_frame_stride = y_buf.GetFrameStride();
+
+        auto x_ptr  = x_buf.LockMemoryConst();
+        auto y_ptr  = y_buf.LockMemory(true);
+        auto x_addr = (std::uint8_t const *)x_ptr.GetAddr();
+        auto y_addr = (std::uint8_t       *)y_ptr.GetAddr();
+
+        if ( DataType<InType>::type == BB_TYPE_BIT && DataType<OutType>::type == BB_TYPE_BIT ) {
+            // Bit → Bit はテーブルをマルチプレクサの木として 64 フレームずつ評価
+            index_t word_size = (frame_size + 63) / 64;
+
+            #pragma omp parallel for
+            for ( index_t node = 0; node < m_node_size; ++node ) {
+                std::uint64_t const *x_vec[N];
+                for ( int i = 0; i < N; ++i ) {
+                    x_vec[i] = (std::uint64_t const *)(x_addr + input_index[node * N + i] * x_frame_stride);
+                }
+                auto y_vec = (std::uint64_t *)(y_addr + node * y_frame_stride);
+                auto table = &m_bit_table[node * BIT_WORDS];
+
+                for ( index_t word = 0; word < word_size; ++word ) {
+                    std::uint64_t v[NN];
+                    for ( int i = 0; i < NN; ++i ) {
+                        v[i] = ((table[i / 64] >> (i % 64)) & 1) ? ~(std::uint64_t)0 : (std::uint64_t)0;
+                    }
+                    int size = NN;
+                    for ( int k = 0; k < N; ++k ) {
+                        std::uint64_t x = x_vec[k][word];
+                        size >>= 1;
+                        for ( int i = 0; i < size; ++i ) {
+                            v[i] = (v[2*i] & ~x) | (v[2*i+1] & x);
+                        }
+                    }
+                    y_vec[word] = v[0];
+                }
+            }
+            return;
+        }
+
+        #pragma omp parallel for
+        for ( index_t node = 0; node < m_node_size; ++node ) {
+            void const *x_vec[N];
+            for ( int i = 0; i < N; ++i ) {
+                x_vec[i] = x_addr + input_index[node * N + i] * x_frame_stride;
+            }
+            auto y_vec = y_addr + node * y_frame_stride;
+            auto table = &m_table[node * NN];
+
+            for ( index_t frame = 0; frame < frame_size; ++frame ) {
+                int index = 0;
+                for ( int i = 0; i < N; ++i ) {
+                    RealType x = (RealType)DataType_Read<InType>(x_vec[i], frame);
+                    index |= ((x > (RealType)0.5) ? (1 << i) : 0);
+                }
+                DataType_Write<OutType>(y_vec, frame, (OutType)table[index]);
+            }
+        }
+    }
+};
+
+
+}
+
+// end of file
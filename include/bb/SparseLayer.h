@@ -50,6 +50,38 @@ public:
         return GetShapeIndices(input_node, this->GetInputShape());
     }
 
+    /**
+     * @brief  出力ノードの並べ替え
+     * @detail 後段の参照順に出力ノードを並べ替えてキャッシュの局所性を上げるためのもの
+     *         新しい i 番目のノードは元の order[i] 番目のノードとなる
+     *         並べ替えに対応しないレイヤーは false を返す
+     *         重みは並べ替えるが Optimizer の状態(Adam のモーメント等)はそのままなので、
+     *         学習途中で並べ替えた場合は Optimizer の SetVariables() をやり直すこと
+     * @param  order 並べ替え順
+     * @return 並べ替えを行えば true
+     */
+    virtual bool PermuteOutputNode(std::vector<index_t> const &/*order*/)
+    {
+        return false;
+    }
+
+    /**
+     * @brief  入力ノード番号の付け替え
+     * @detail 前段の出力ノードの並べ替えに合わせて接続先を付け替える
+     * @param  input_map 元の入力ノード番号から新しい番号への対応表
+     */
+    virtual void RemapNodeInput(std::vector<index_t> const &input_map)
+    {
+        BB_ASSERT((index_t)input_map.size() == this->GetInputNodeSize());
+        auto output_node_size = this->GetOutputNodeSize();
+        for ( index_t node = 0; node < output_node_size; ++node ) {
+            index_t input_size = GetNodeInputSize(node);
+            for ( index_t i = 0; i < input_size; ++i ) {
+                SetNodeInput(node, i, input_map[GetNodeInput(node, i)]);
+            }
+        }
+    }
+
 protected:
     
     /*
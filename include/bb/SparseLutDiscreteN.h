@@ -163,6 +163,19 @@ public:
         return gradients;
     }  
 
+    /**
+     * @brief  統計量取得
+     * @detail 内部のレイヤーの統計量をまとめて取得する
+     * @return 統計量を返す
+     */
+    virtual Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_lut       ->GetStatistics());
+        statistics.PushBack(m_batch_norm->GetStatistics());
+        return statistics;
+    }
+
     /**
      * @brief  入力形状設定
      * @detail 入力形状を設定する
@@ -176,9 +189,40 @@ public:
         shape = m_lut       ->SetInputShape(shape);
         shape = m_batch_norm->SetInputShape(shape);
         shape = m_activation->SetInputShape(shape);
+        this->SetChainInputGradient({m_lut, m_batch_norm, m_activation}, this->m_input_gradient);
         return shape;
     }
 
+    /**
+     * @brief  入力勾配の要否設定
+     * @detail 手前に学習対象が無い内部レイヤーは入力勾配を不要とする
+     * @param  enable 入力勾配が必要か
+     */
+    void SetInputGradient(bool enable)
+    {
+        this->m_input_gradient = enable;
+        this->SetChainInputGradient({m_lut, m_batch_norm, m_activation}, enable);
+    }
+
+    /**
+     * @brief  パラメータ固定設定
+     * @detail 内部のレイヤーをまとめて固定する
+     * @param  frozen 固定するなら true
+     */
+    void SetFrozen(bool frozen)
+    {
+        this->m_frozen = frozen;
+        m_lut       ->SetFrozen(frozen);
+        m_batch_norm->SetFrozen(frozen);
+        m_activation->SetFrozen(frozen);
+        SetInputGradient(this->m_input_gradient);
+    }
+
+    bool IsTrainable(void)
+    {
+        return m_lut->IsTrainable() || m_batch_norm->IsTrainable() || m_activation->IsTrainable();
+    }
+
     /**
      * @brief  入力形状取得
      * @detail 入力形状を取得する
@@ -265,10 +309,7 @@ public:
             m_activation->SetFrameBufferX(x_buf);
         }
 
-        dy_buf = m_activation->Backward(dy_buf);
-        dy_buf = m_batch_norm->Backward(dy_buf);
-        dy_buf = m_lut       ->Backward(dy_buf);
-        return dy_buf; 
+        return this->BackwardChain({m_lut, m_batch_norm, m_activation}, dy_buf);
     }
 
 protected:
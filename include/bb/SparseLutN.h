@@ -17,6 +17,8 @@
 #include "bb/Tensor.h"
 #include "bb/FixedSizeConnectionTable.h"
 #include "bb/StochasticOperation.h"
+#include "bb/StochasticLutSimd.h"
+#include "bb/SparseForwardTable.h"
 
 
 namespace bb {
@@ -31,6 +33,8 @@ class SparseLutN : public SparseLayer
 
 protected:
     bool                        m_host_only    = false;
+    bool                        m_host_table   = true;
+    bool                        m_host_simd    = true;
     bool                        m_lut_binarize = false;
     bool                        m_binary_mode  = true;
     bool                        m_batch_norm   = true;
@@ -66,6 +70,8 @@ protected:
     
     std::mt19937_64             m_mt;
 
+    SparseForwardTable<N, RealType> m_forward_table;
+
 public:
     struct create_t
     {
@@ -121,6 +127,18 @@ protected:
         {
             m_host_only = EvalBool(args[1]);
         }
+
+        // Host テーブル引きモード設定
+        if (args.size() == 2 && args[0] == "host_table")
+        {
+            m_host_table = EvalBool(args[1]);
+        }
+
+        // Host SIMDモード設定
+        if (args.size() == 2 && args[0] == "host_simd")
+        {
+            m_host_simd = EvalBool(args[1]);
+        }
     }
     
     virtual void PrintInfoText(std::ostream& os, std::string indent, int columns, int nest, int depth)
@@ -308,6 +326,23 @@ public:
         return m_connection_table.GetInputConnection(node, input_index);
     }
 
+    bool PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        m_connection_table.PermuteOutputNode(order);
+        Tensor_PermuteOuter(*m_W,  order);
+        Tensor_PermuteOuter(*m_dW, order);
+        Tensor_PermuteOuter(m_mean,         order);
+        Tensor_PermuteOuter(m_rstd,         order);
+        Tensor_PermuteOuter(m_running_mean, order);
+        Tensor_PermuteOuter(m_running_var,  order);
+        return true;
+    }
+
+    void RemapNodeInput(std::vector<index_t> const &input_map)
+    {
+        m_connection_table.RemapInputNode(input_map);
+    }
+
 
    /**
      * @brief  入力のshape設定
@@ -350,6 +385,14 @@ public:
         gradients.PushBack(m_dW);
         return gradients;
     }
+
+    Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_running_mean);
+        statistics.PushBack(m_running_var);
+        return statistics;
+    }
     
     void        SetFrameBufferX(FrameBuffer x) { m_x_buf = x; }
     FrameBuffer GetFrameBufferX(void)          { return m_x_buf; }
@@ -417,6 +460,63 @@ public:
     }
 
 
+protected:
+    // テーブルの作り直しが必要かを判定するキー
+    std::vector<std::uint64_t> GetForwardTableKey(void) const
+    {
+        return {
+                m_W->GetRevision(),
+                m_running_mean.GetRevision(),
+                m_running_var.GetRevision(),
+                (std::uint64_t)m_lut_binarize,
+                (std::uint64_t)m_batch_norm,
+                SparseForwardTable<N, RealType>::KeyOf((double)m_gamma),
+                SparseForwardTable<N, RealType>::KeyOf((double)m_beta),
+                SparseForwardTable<N, RealType>::KeyOf((double)m_unbinarize_bias)
+            };
+    }
+
+    // 2値入力の全パターンに対する出力テーブルを作成 (BatchNormalization は推論時の統計を使う)
+    void BuildForwardTable(void)
+    {
+        auto key              = GetForwardTableKey();
+        auto W_ptr            = lock_W_const();
+        auto running_mean_ptr = m_running_mean.LockConst();
+        auto running_var_ptr  = m_running_var.LockConst();
+        m_forward_table.Build(GetOutputNodeSize(), key, [&](index_t node, RealType *table) {
+            RealType W[(1 << N)];
+            for ( int i = 0; i < (1 << N); ++i) {
+                W[i] = W_ptr(node, i);
+                if ( m_lut_binarize ) {
+                    W[i] = ((W[i] > (RealType)0.5) ? (RealType)1.0 : (RealType)0.0);
+                }
+            }
+
+            RealType mean = running_mean_ptr[node];
+            RealType var  = running_var_ptr[node];
+            RealType rstd = (RealType)1.0 / std::sqrt(var);
+
+            for ( int index = 0; index < (1 << N); ++index ) {
+                RealType x[N];
+                for ( int i = 0; i < N; ++i) {
+                    x[i] = (RealType)0.5 + (((index >> i) & 1) ? +m_unbinarize_bias : -m_unbinarize_bias);
+                }
+
+                RealType y;
+                StochasticOperation_Lut_Forward<RealType>(x, &y, W, N);
+
+                if ( m_batch_norm ) {
+                    y = (y - mean) * rstd;
+                    y = y * m_gamma + m_beta;
+                }
+
+                // binarize
+                table[index] = ((y > (RealType)0.5) ? (RealType)1.0 : (RealType)0.0);
+            }
+        });
+    }
+
+public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
         BB_ASSERT(x_buf.GetType() == DataType<BinType>::type);
@@ -439,6 +539,15 @@ public:
             m_W->Clamp((RealType)0.0, (RealType)1.0);
             m_flagClamp = false;
         }
+
+        // 2値入力の推論はテーブル引き
+        if ( !train && m_host_table && m_binary_mode
+                && (m_host_only || !x_buf.IsDeviceAvailable() || !Manager::IsDeviceAvailable()) ) {
+            m_forward_table.Update(GetForwardTableKey(), [&]() { BuildForwardTable(); });
+            auto input_table_ptr = m_connection_table.LockConst_InputTable();
+            m_forward_table.template Forward<BinType, BinType>(x_buf, y_buf, input_table_ptr.GetAddr());
+            return y_buf;
+        }
         
         if ( m_batch_norm ) {
             // with BatchNormalization
@@ -716,6 +825,9 @@ public:
                     auto running_mean_ptr = m_running_mean.Lock();
                     auto running_var_ptr  = m_running_var.Lock();
 
+                    auto x_view = x_ptr.GetView();
+                    auto y_view = y_ptr.GetView();
+
                     #pragma omp parallel for
                     for ( index_t node = 0; node < node_size; ++node ) {
                         RealType W[(1 << N)];
@@ -732,7 +844,7 @@ public:
                         for ( index_t frame = 0; frame < frame_size; ++frame ) {
                             RealType   x[N];
                             for ( int i = 0; i < N; ++i) {
-                                x[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                                x[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                                 if ( m_binary_mode ) {
                                     x[i] = (RealType)0.5 + ((x[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                                 }
@@ -771,7 +883,7 @@ public:
                             // Forward計算
                             RealType x[N];
                             for ( int i = 0; i < N; ++i) {
-                                x[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                                x[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                                 if ( m_binary_mode ) {
                                     x[i] = (RealType)0.5 + ((x[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                                 }
@@ -796,7 +908,7 @@ public:
                                 y = std::max(y, (RealType)0.0);
                             }
 
-                            y_ptr.Set(frame, node, y);
+                            y_view.Set(frame, node, y);
                         }
                     }
                 }
@@ -808,6 +920,9 @@ public:
                     auto running_mean_ptr = m_running_mean.LockConst();
                     auto running_var_ptr  = m_running_var.LockConst();
 
+                    auto x_view = x_ptr.GetView();
+                    auto y_view = y_ptr.GetView();
+
                     #pragma omp parallel for
                     for ( index_t node = 0; node < node_size; ++node ) {
                         RealType W[(1 << N)];
@@ -826,7 +941,7 @@ public:
                         for ( index_t frame = 0; frame < frame_size; ++frame ) {
                             RealType x[N];
                             for ( int i = 0; i < N; ++i) {
-                                x[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                                x[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                                 if ( m_binary_mode ) {
                                     x[i] = (RealType)0.5 + ((x[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                                 }
@@ -851,7 +966,7 @@ public:
                                 y = std::max(y, (RealType)0.0);
                             }
 
-                            y_ptr.Set(frame, node, y);
+                            y_view.Set(frame, node, y);
                         }
                     }
                 }
@@ -962,6 +1077,14 @@ public:
 #endif
 #endif
 
+            // LUT6 SIMD (FP16/BF16 はロード/ストア段で float に変換)
+            if ( N == 6 && simd_StochasticLut6_IsSupportedType(DataType<BinType>::type) && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
+                    && y_buf.GetFrameSize() % 8 == 0 ) {
+                auto input_table_ptr = m_connection_table.LockConst_InputTable();
+                simd_StochasticLut6_Forward(x_buf, y_buf, input_table_ptr.GetAddr(), m_W, m_binary_mode, m_lut_binarize, (float)m_unbinarize_bias, m_binary_mode);
+                return y_buf;
+            }
+
             {
                 // generic
                 auto node_size        = y_buf.GetNodeSize();
@@ -971,6 +1094,9 @@ public:
                 auto input_table_ptr  = m_connection_table.LockConst_InputTable();
                 auto W_ptr            = lock_W_const();
 
+                auto x_view = x_ptr.GetView();
+                auto y_view = y_ptr.GetView();
+
                 #pragma omp parallel for
                 for ( index_t node = 0; node < node_size; ++node ) {
                     RealType W[(1 << N)];
@@ -985,7 +1111,7 @@ public:
                     for ( index_t frame = 0; frame < frame_size; ++frame ) {
                         RealType x[N];
                         for ( int i = 0; i < N; ++i) {
-                            x[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                            x[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                             if ( m_binary_mode ) {
                                 x[i] = (RealType)0.5 + ((x[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                             }
@@ -1007,7 +1133,7 @@ public:
                             y = std::max(y, (RealType)0.0);
                         }
 
-                        y_ptr.Set(frame, node, y);
+                        y_view.Set(frame, node, y);
                     }
                 }
                 return y_buf;
@@ -1017,6 +1143,25 @@ public:
 
 
     FrameBuffer Backward(FrameBuffer dy_buf)
+    {
+        // 入力勾配もパラメータ勾配も不要なら何もしない
+        if ( !m_input_gradient && m_frozen ) {
+            m_x_buf = FrameBuffer();
+            return FrameBuffer();
+        }
+
+        auto dx_buf = BackwardLut(dy_buf);
+
+        // 固定時は CUDA 版などで計算された勾配を捨てる
+        if ( m_frozen ) {
+            m_dW->FillZero();
+        }
+
+        return dx_buf;
+    }
+
+protected:
+    FrameBuffer BackwardLut(FrameBuffer dy_buf)
     {
         BB_ASSERT(dy_buf.GetType() == DataType<RealType>::type);
 
@@ -1025,7 +1170,11 @@ public:
         FrameBuffer x_buf = m_x_buf;
         m_x_buf = FrameBuffer();
 
-        FrameBuffer dx_buf(dy_buf.GetFrameSize(), this->GetInputShape(), DataType<RealType>::type);
+        // 入力勾配が不要なら host 版では dx を確保しない (CUDA 版は従来通り確保して捨てる)
+        FrameBuffer dx_buf;
+        if ( m_input_gradient || (!m_host_only && Manager::IsDeviceAvailable()) ) {
+            dx_buf.Resize(dy_buf.GetFrameSize(), this->GetInputShape(), DataType<RealType>::type);
+        }
 
         auto input_shape      = this->GetInputShape();
         auto output_shape     = this->GetOutputShape();
@@ -1263,6 +1412,10 @@ public:
                 auto mean_ptr        = m_mean.LockConst();
                 auto rstd_ptr        = m_rstd.LockConst();
 
+                auto x_view  = x_ptr.GetView();
+                auto dy_view = dy_ptr.GetView();
+                auto dx_view = dx_ptr.GetView();
+
                 for ( index_t node = 0; node < node_size; ++node ) {
                     RealType W[(1 << N)];
                     for ( int i = 0; i < (1 << N); ++i) {
@@ -1283,7 +1436,7 @@ public:
                         // x を再計算
                         RealType   x_vec[N];
                         for ( int i = 0; i < N; ++i) {
-                            x_vec[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                            x_vec[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                             if ( m_binary_mode ) {
                                 x_vec[i] = (RealType)0.5 + ((x_vec[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                             }
@@ -1298,7 +1451,7 @@ public:
                         RealType tanh_x = ((x - mean) * rstd) * m_gamma + m_beta;
 
                         // hard-tanh
-                        RealType   dy = dy_ptr.Get(frame, node);
+                        RealType   dy = dy_view.Get(frame, node);
                         if (tanh_x <= 0.0) { dy = 0.0; }
                         if (tanh_x >= 1.0) { dy = 0.0; }
 
@@ -1318,7 +1471,7 @@ public:
                         // x を再計算
                         RealType   x_vec[N];
                         for ( int i = 0; i < N; ++i) {
-                            x_vec[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                            x_vec[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                             if ( m_binary_mode ) {
                                 x_vec[i] = (RealType)0.5 + ((x_vec[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                             }
@@ -1333,7 +1486,7 @@ public:
                         RealType tanh_x = ((x - mean) * rstd) * m_gamma + m_beta;
 
                         // hard-tanh
-                        RealType   dy = dy_ptr.Get(frame, node);
+                        RealType   dy = dy_view.Get(frame, node);
                         if (tanh_x <= 0.0) { dy = 0.0; }
                         if (tanh_x >= 1.0) { dy = 0.0; }
 
@@ -1344,8 +1497,10 @@ public:
                         RealType   dx_vec[N];
                         StochasticOperation_Lut_Backward<RealType>(x_vec, dx_vec, &dx, W, dW, N);
 
-                        for ( int i = 0; i < N; ++i) {
-                            dx_ptr.Add(frame, input_table_ptr(node, i), dx_vec[i]);
+                        if ( m_input_gradient ) {
+                            for ( int i = 0; i < N; ++i) {
+                                dx_view.Add(frame, input_table_ptr(node, i), dx_vec[i]);
+                            }
                         }
                     }
 
@@ -1506,6 +1661,14 @@ public:
 #endif
 #endif
 
+            // LUT6 SIMD (FP16/BF16 はロード/ストア段で float に変換)
+            if ( N == 6 && simd_StochasticLut6_IsSupportedType(DataType<BinType>::type) && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
+                    && m_input_gradient && dy_buf.GetFrameSize() % 8 == 0 ) {
+                auto input_table_ptr = m_connection_table.LockConst_InputTable();
+                simd_StochasticLut6_Backward(x_buf, dy_buf, dx_buf, input_table_ptr.GetAddr(), m_W, m_dW, (float)m_unbinarize_bias, m_binary_mode, m_lut_binarize);
+                return dx_buf;
+            }
+
             {
                 // generic
                 dx_buf.FillZero();
@@ -1521,6 +1684,10 @@ public:
                 auto W_ptr           = lock_W_const();
                 auto dW_ptr          = lock_dW();
 
+                auto x_view  = x_ptr.GetView();
+                auto dy_view = dy_ptr.GetView();
+                auto dx_view = dx_ptr.GetView();
+
                 for ( index_t node = 0; node < node_size; ++node ) {
                     RealType W[(1 << N)];
                     for ( int i = 0; i < (1 << N); ++i) {
@@ -1534,7 +1701,7 @@ public:
                     for ( index_t frame = 0; frame < frame_size; ++frame ) {
                         RealType   x_vec[N];
                         for ( int i = 0; i < N; ++i) {
-                            x_vec[i] = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                            x_vec[i] = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                             if ( m_binary_mode ) {
                                 x_vec[i] = (RealType)0.5 + ((x_vec[i] > (RealType)0.5) ? +m_unbinarize_bias : -m_unbinarize_bias);
                             }
@@ -1543,13 +1710,15 @@ public:
                             }
                         }
 
-                        RealType   dy = dy_ptr.Get(frame, node);
+                        RealType   dy = dy_view.Get(frame, node);
 
                         RealType   dx_vec[N];
                         StochasticOperation_Lut_Backward<RealType>(x_vec, dx_vec, &dy, W, dW, N);
 
-                        for ( int i = 0; i < N; ++i) {
-                            dx_ptr.Add(frame, input_table_ptr(node, i), dx_vec[i]);
+                        if ( m_input_gradient ) {
+                            for ( int i = 0; i < N; ++i) {
+                                dx_view.Add(frame, input_table_ptr(node, i), dx_vec[i]);
+                            }
                         }
                     }
 
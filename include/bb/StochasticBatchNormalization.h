@@ -251,6 +251,19 @@ public:
         Variables gradients;
         return gradients;
     }
+
+    /**
+     * @brief  統計量取得
+     * @detail 移動平均と移動分散を取得する
+     * @return 統計量を返す
+     */
+    Variables GetStatistics(void)
+    {
+        Variables statistics;
+        statistics.PushBack(m_running_mean);
+        statistics.PushBack(m_running_var);
+        return statistics;
+    }
     
     T GetNormalizeGain(index_t node)
     {
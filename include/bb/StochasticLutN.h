@@ -17,6 +17,7 @@
 #include "bb/FixedSizeConnectionTable.h"
 #include "bb/StochasticOperation.h"
 #include "bb/StochasticLutSimd.h"
+#include "bb/SparseForwardTable.h"
 
 
 namespace bb {
@@ -36,6 +37,7 @@ protected:
     bool                        m_y_binarize = false;
     bool                        m_host_only = false;
     bool                        m_host_simd = true;
+    bool                        m_host_table = true;
 
     index_t                     m_max_tmp_mem_size = 256 * 1024 * 1024;
 
@@ -55,6 +57,8 @@ protected:
 
     std::mt19937_64             m_mt;
 
+    SparseForwardTable<N, RealType> m_forward_table;
+
 public:
     struct create_t
     {
@@ -109,6 +113,12 @@ protected:
         {
             m_host_simd = EvalBool(args[1]);
         }
+
+        // Host テーブル引きモード設定
+        if (args.size() == 2 && args[0] == "host_table")
+        {
+            m_host_table = EvalBool(args[1]);
+        }
     }
 
 public:
@@ -224,6 +234,19 @@ public:
         return m_connection_table.GetInputConnection(node, input_index);
     }
 
+    bool PermuteOutputNode(std::vector<index_t> const &order)
+    {
+        m_connection_table.PermuteOutputNode(order);
+        Tensor_PermuteOuter(*m_W,  order);
+        Tensor_PermuteOuter(*m_dW, order);
+        return true;
+    }
+
+    void RemapNodeInput(std::vector<index_t> const &input_map)
+    {
+        m_connection_table.RemapInputNode(input_map);
+    }
+
 
    /**
      * @brief  入力のshape設定
@@ -345,6 +368,50 @@ public:
     }
 
 
+protected:
+    // テーブルの作り直しが必要かを判定するキー
+    std::vector<std::uint64_t> GetForwardTableKey(void) const
+    {
+        return {
+                m_W->GetRevision(),
+                (std::uint64_t)m_lut_binarize,
+                SparseForwardTable<N, RealType>::KeyOf((double)m_unbinarize_bias)
+            };
+    }
+
+    // 2値入力の全パターンに対する出力テーブルを作成
+    void BuildForwardTable(void)
+    {
+        auto key   = GetForwardTableKey();
+        auto W_ptr = lock_W_const();
+        m_forward_table.Build(GetOutputNodeSize(), key, [&](index_t node, RealType *table) {
+            RealType W[(1 << N)];
+            for ( int i = 0; i < (1 << N); ++i) {
+                W[i] = W_ptr(node, i);
+                if ( m_lut_binarize ) {
+                    W[i] = W[i] > (RealType)0.5 ? (RealType)1.0 : (RealType)0.0;   // binarize
+                }
+            }
+
+            for ( int index = 0; index < (1 << N); ++index ) {
+                RealType    x[N];
+                for ( int i = 0; i < N; ++i) {
+                    x[i] = (RealType)0.5 + (((index >> i) & 1) ? +m_unbinarize_bias : -m_unbinarize_bias);   // unbinarize
+                }
+
+                RealType    y;
+                StochasticOperation_Lut_Forward<RealType>(x, &y, W, N);
+
+                // clip
+                y = std::max((RealType)0.0, y);
+                y = std::min((RealType)1.0, y);
+
+                table[index] = y;
+            }
+        });
+    }
+
+public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
         BB_ASSERT(x_buf.GetType() == DataType<BinType>::type);
@@ -363,6 +430,18 @@ public:
         }
 
 
+        // 2値入力の推論はテーブル引き
+        if ( !train && m_host_table && (m_binary_mode || DataType<BinType>::type == BB_TYPE_BIT)
+                && (m_host_only || !x_buf.IsDeviceAvailable() || !Manager::IsDeviceAvailable()) ) {
+            m_forward_table.Update(GetForwardTableKey(), [&]() {
+                m_W->Clamp((RealType)0.0, (RealType)1.0);
+                BuildForwardTable();
+            });
+            auto input_table_ptr = m_connection_table.LockConst_InputTable();
+            m_forward_table.template Forward<BinType, RealType>(x_buf, y_buf, input_table_ptr.GetAddr());
+            return y_buf;
+        }
+
         // パラメータクリップ
         m_W->Clamp((RealType)0.0, (RealType)1.0);
 
@@ -418,10 +497,10 @@ public:
 #endif
 
         // LUT6 SIMD
-        if ( N == 6 && DataType<BinType>::type == BB_TYPE_FP32 && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
+        if ( N == 6 && simd_StochasticLut6_IsSupportedType(DataType<BinType>::type) && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
                 && y_buf.GetFrameSize() % 8 == 0 ) {
             auto input_table_ptr = m_connection_table.LockConst_InputTable();
-            simd_fp32_StochasticLut6_Forward(x_buf, y_buf, input_table_ptr.GetAddr(), m_W, m_binary_mode, m_lut_binarize, m_unbinarize_bias);
+            simd_StochasticLut6_Forward(x_buf, y_buf, input_table_ptr.GetAddr(), m_W, m_binary_mode, m_lut_binarize, m_unbinarize_bias);
             return y_buf;
         }
 
@@ -435,6 +514,9 @@ public:
             auto input_table_ptr = m_connection_table.LockConst_InputTable();
             auto W_ptr           = lock_W_const();
 
+            auto x_view = x_ptr.GetView();
+            auto y_view = y_ptr.GetView();
+
             #pragma omp parallel for
             for ( index_t node = 0; node < node_size; ++node ) {
                 // read W
@@ -450,7 +532,7 @@ public:
                     // read x
                     RealType    x[N];
                     for ( int i = 0; i < N; ++i) {
-                        RealType x_tmp = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                        RealType x_tmp = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                         if ( m_binary_mode || DataType<BinType>::type == BB_TYPE_BIT ) {
                             x[i] = (RealType)0.5 + (x_tmp > (RealType)0.5 ? +m_unbinarize_bias : -m_unbinarize_bias);   // unbinarize
                         }
@@ -467,7 +549,7 @@ public:
                     y = std::max((RealType)0.0, y);
                     y = std::min((RealType)1.0, y);
 
-                    y_ptr.Set(frame, node, y);
+                    y_view.Set(frame, node, y);
                 }
             }
 
@@ -477,13 +559,36 @@ public:
 
 
     FrameBuffer Backward(FrameBuffer dy_buf)
+    {
+        // 入力勾配もパラメータ勾配も不要なら何もしない
+        if ( !m_input_gradient && m_frozen ) {
+            m_x_buf = FrameBuffer();
+            return FrameBuffer();
+        }
+
+        auto dx_buf = BackwardLut(dy_buf);
+
+        // 固定時は CUDA/SIMD 版で計算された勾配を捨てる
+        if ( m_frozen ) {
+            m_dW->FillZero();
+        }
+
+        return dx_buf;
+    }
+
+protected:
+    FrameBuffer BackwardLut(FrameBuffer dy_buf)
     {
         BB_ASSERT(dy_buf.GetType() == DataType<RealType>::type);
 
         FrameBuffer x_buf = m_x_buf;
         m_x_buf = FrameBuffer();
 
-        FrameBuffer dx_buf(dy_buf.GetFrameSize(), m_input_shape, DataType<RealType>::type);
+        // 入力勾配が不要なら generic 版では dx を確保しない (LUT6 の CUDA/SIMD 版は常に dx を書くので確保する)
+        FrameBuffer dx_buf;
+        if ( m_input_gradient || N == 6 ) {
+            dx_buf.Resize(dy_buf.GetFrameSize(), m_input_shape, DataType<RealType>::type);
+        }
      
 
 #ifdef BB_WITH_CUDA
@@ -577,18 +682,19 @@ public:
 #endif
 
         // LUT6 SIMD
-        if ( N == 6 && DataType<BinType>::type == BB_TYPE_FP32 && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
+        if ( N == 6 && simd_StochasticLut6_IsSupportedType(DataType<BinType>::type) && DataType<RealType>::type == BB_TYPE_FP32 && m_host_simd
                 && dy_buf.GetFrameSize() % 8 == 0 ) {
             auto input_table_ptr = m_connection_table.LockConst_InputTable();
-            simd_fp32_StochasticLut6_Backward(x_buf, dy_buf, dx_buf, input_table_ptr.GetAddr(), m_W, m_dW, m_unbinarize_bias, m_binary_mode, m_lut_binarize);
+            simd_StochasticLut6_Backward(x_buf, dy_buf, dx_buf, input_table_ptr.GetAddr(), m_W, m_dW, m_unbinarize_bias, m_binary_mode, m_lut_binarize);
             return dx_buf;
         }
 
         {
-            FrameBuffer tmp_buf(dy_buf.GetFrameSize(), {GetShapeSize(m_output_shape)*N}, DataType<RealType>::type);
-
             // generic
-            dx_buf.FillZero();
+            FrameBuffer tmp_buf;
+            if ( m_input_gradient ) {
+                tmp_buf.Resize(dy_buf.GetFrameSize(), {GetShapeSize(m_output_shape)*N}, DataType<RealType>::type);
+            }
 
             auto node_size  = dy_buf.GetNodeSize();
             auto frame_size = dy_buf.GetFrameSize();
@@ -599,6 +705,10 @@ public:
             auto input_table_ptr = m_connection_table.LockConst_InputTable();
             auto W_ptr           = lock_W_const();
             auto dW_ptr          = lock_dW();
+
+            auto x_view   = x_ptr.GetView();
+            auto dy_view  = dy_ptr.GetView();
+            auto tmp_view = tmp_ptr.GetView();
             
             #pragma omp parallel for
             for ( index_t node = 0; node < node_size; ++node ) {
@@ -618,7 +728,7 @@ public:
                     // read x
                     RealType    x[N];
                     for ( int i = 0; i < N; ++i) {
-                        RealType x_tmp = (RealType)x_ptr.Get(frame, input_table_ptr(node, i));
+                        RealType x_tmp = (RealType)x_view.Get(frame, input_table_ptr(node, i));
                         if ( m_binary_mode || DataType<BinType>::type == BB_TYPE_BIT ) {
                             x[i] = (RealType)0.5 + (x_tmp > (RealType)0.5 ? +m_unbinarize_bias : -m_unbinarize_bias);   // unbinarize
                         }
@@ -628,15 +738,17 @@ public:
                     }
 
                     // read dy
-                    RealType dy = dy_ptr.Get(frame, node);
+                    RealType dy = dy_view.Get(frame, node);
 
                     // calculate
                     RealType    dx[N];
                     StochasticOperation_Lut_Backward<RealType>(x, dx, &dy, W, dW, N);
 
                     // write dx
-                    for (int i = 0; i < N; ++i) {
-                        tmp_ptr.Set(frame, node * N + i, dx[i]);
+                    if ( m_input_gradient ) {
+                        for (int i = 0; i < N; ++i) {
+                            tmp_view.Set(frame, node * N + i, dx[i]);
+                        }
                     }
                 }
 
@@ -646,15 +758,22 @@ public:
                 }
             }
 
+            if ( !m_input_gradient ) {
+                return FrameBuffer();
+            }
+
             // integrate dx
+            dx_buf.FillZero();
             auto dx_ptr = dx_buf.Lock<RealType>();
+
+            auto dx_view = dx_ptr.GetView();
             #pragma omp parallel for
             for ( index_t frame = 0; frame < frame_size; ++frame ) {
                 for ( index_t node = 0; node < node_size; ++node ) {
                     for (int i = 0; i < N; ++i) {
-                        RealType dx = tmp_ptr.Get(frame, node * N + i);
+                        RealType dx = tmp_view.Get(frame, node * N + i);
                         auto input_node = input_table_ptr(node, i);
-                        dx_ptr.Add(frame, input_node, dx);
+                        dx_view.Add(frame, input_node, dx);
                     }
                 }
             }
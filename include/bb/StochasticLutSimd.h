@@ -22,7 +22,9 @@
 namespace bb {
 
 
-inline void simd_fp32_StochasticLut6_Forward
+// x, y は float/Float16/BFloat16 (半精度はロード/ストア段で変換し、演算と W は float)
+template <typename XType, typename YType>
+inline void simd_StochasticLut6_Forward_
     (
         FrameBuffer                         x_buf,
         FrameBuffer                         y_buf,
@@ -30,17 +32,19 @@ inline void simd_fp32_StochasticLut6_Forward
         std::shared_ptr<Tensor>             W,
         bool                                binary_mode,
         bool                                lut_binarize,
-        float                               unbinarize_bias
+        float                               unbinarize_bias,
+        bool                                y_binarize = false
     )
 {
-    auto x_ptr           = x_buf.LockConst<float>();
-    auto y_ptr           = y_buf.Lock<float>(true);
+    auto x_ptr           = x_buf.LockConst<XType>();
+    auto y_ptr           = y_buf.Lock<YType>(true);
     auto W_ptr           = W->LockConst<float>();
 
     auto node_size  = y_buf.GetNodeSize();
-    auto frame_size = y_buf.GetFrameStride() / (index_t)sizeof(float);
+    auto frame_size = (y_buf.GetFrameSize() + 7) / 8 * 8;
 
-    #pragma omp parallel for
+    // ノードの分担を固定して(static)、NUMA の first-touch で配置された行を同じスレッドが処理する
+    #pragma omp parallel for schedule(static)
     for ( index_t node = 0; node < node_size; ++node ) {
         // read W
         __m256   W[64];
@@ -51,18 +55,18 @@ inline void simd_fp32_StochasticLut6_Forward
             }
             W[i] = _mm256_set1_ps(W_val);
         }
-        
+    
         // read input index
-        float const  *x_addr[6];
+        XType const  *x_addr[6];
         for ( int i = 0; i < 6; ++i ) {
             x_addr[i] = x_ptr.GetAddr(input_table[node*6 + i]);
         }
-        float *y_addr = y_ptr.GetAddr(node);
+        YType *y_addr = y_ptr.GetAddr(node);
 
         for ( index_t frame = 0; frame < frame_size; frame += 8) {
             __m256   xp[6], xn[6];
             for ( int i = 0; i < 6; ++i) {
-                xp[i] = _mm256_loadu_ps(&x_addr[i][frame]);
+                xp[i] = bb_mm256_loadu_ps(&x_addr[i][frame]);
                if ( binary_mode ) {
                     __m256 mask =  _mm256_cmp_ps(xp[i], _mm256_set1_ps(0.5f), _CMP_GT_OS);
                     xp[i] = _mm256_blendv_ps(_mm256_set1_ps(0.5f - unbinarize_bias), _mm256_set1_ps(0.5f + unbinarize_bias), mask);
@@ -153,17 +157,26 @@ inline void simd_fp32_StochasticLut6_Forward
             y = _mm256_fmadd_ps(W[62], _mm256_mul_ps(x2_11, _mm256_mul_ps(x1_11, x0_10)), y);
             y = _mm256_fmadd_ps(W[63], _mm256_mul_ps(x2_11, _mm256_mul_ps(x1_11, x0_11)), y);
 
-            // clamp
-            y = _mm256_max_ps(y, _mm256_set1_ps(0.0f));
-            y = _mm256_min_ps(y, _mm256_set1_ps(1.0f));
+            if ( y_binarize ) {
+                // binarize
+                __m256 mask = _mm256_cmp_ps(y, _mm256_set1_ps(0.5f), _CMP_GT_OS);
+                y = _mm256_and_ps(mask, _mm256_set1_ps(1.0f));
+            }
+            else {
+                // clamp
+                y = _mm256_max_ps(y, _mm256_set1_ps(0.0f));
+                y = _mm256_min_ps(y, _mm256_set1_ps(1.0f));
+            }
 
-            _mm256_storeu_ps(&y_addr[frame], y);
+            bb_mm256_storeu_ps(&y_addr[frame], y);
         }
     }
 }
 
 
-inline void simd_fp32_StochasticLut6_Backward
+// x は float/Float16/BFloat16 (dy, dx, W, dW は float)
+template <typename XType>
+inline void simd_StochasticLut6_Backward_
     (
         FrameBuffer                 x_buf,
         FrameBuffer                 dy_buf,
@@ -180,12 +193,12 @@ inline void simd_fp32_StochasticLut6_Backward
 
 //  index_t input_node_size  = x_buf.GetNodeSize();
     index_t output_node_size = dy_buf.GetNodeSize();
-    index_t frame_size       = dy_buf.GetFrameStride() / sizeof(float);
+    index_t frame_size       = (dy_buf.GetFrameSize() + 7) / 8 * 8;
 
     // 並列化用tmpバッファ確保
     FrameBuffer dx_tmp(dy_buf.GetFrameSize(), {output_node_size * 6}, BB_TYPE_FP32);
 
-    auto x_ptr           = x_buf.LockConst<float>();
+    auto x_ptr           = x_buf.LockConst<XType>();
     auto dy_ptr          = dy_buf.LockConst<float>();
     auto dx_ptr          = dx_buf.Lock<float>(true);
     auto dx_tmp_ptr      = dx_tmp.Lock<float>();
@@ -208,24 +221,24 @@ inline void simd_fp32_StochasticLut6_Backward
             }
             W[i] = _mm256_set1_ps(W_val);
         }
-    
+
         // read input index
-        float const  *x_addr[6];
+        XType const  *x_addr[6];
         for ( int i = 0; i < 6; ++i ) {
             x_addr[i] = x_ptr.GetAddr(input_table[node*6+ i]);
         }
-        
+    
         float const *dy_addr = dy_ptr.GetAddr(node);
 
         float   *dx_addr[6];
         for ( int i = 0; i < 6; ++i ) {
             dx_addr[i] = dx_tmp_ptr.GetAddr(node*6 + i);
         }
-        
+    
         for ( index_t frame = 0; frame < frame_size; frame += 8 ) {
             __m256   xp[6], xn[6];
             for ( int i = 0; i < 6; ++i) {
-                xp[i] = _mm256_loadu_ps(&x_addr[i][frame]);
+                xp[i] = bb_mm256_loadu_ps(&x_addr[i][frame]);
                 if ( binary_mode ) {
                     __m256 mask =  _mm256_cmp_ps(xp[i], _mm256_set1_ps(0.5f), _CMP_GT_OS);
                     xp[i] = _mm256_blendv_ps(_mm256_set1_ps(0.5f - unbinarize_bias), _mm256_set1_ps(0.5f + unbinarize_bias), mask);
@@ -393,7 +406,7 @@ inline void simd_fp32_StochasticLut6_Backward
             dxi = _mm256_mul_ps(W[61], grad);  dx0_01 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x1_11), dx0_01);  dx1_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x0_01), dx1_11);  dx2_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x1_11, x0_01), dx2_11);
             dxi = _mm256_mul_ps(W[62], grad);  dx0_10 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x1_11), dx0_10);  dx1_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x0_10), dx1_11);  dx2_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x1_11, x0_10), dx2_11);
             dxi = _mm256_mul_ps(W[63], grad);  dx0_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x1_11), dx0_11);  dx1_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x2_11, x0_11), dx1_11);  dx2_11 = _mm256_fmadd_ps(dxi, _mm256_mul_ps(x1_11, x0_11), dx2_11);
-            
+        
             __m256  dxn;
             __m256  dxp;
             dxn = _mm256_mul_ps  (dx0_00, xn[1]);
@@ -432,7 +445,7 @@ inline void simd_fp32_StochasticLut6_Backward
             dxp = _mm256_fmadd_ps(dx2_11, xp[4], dxp);
             _mm256_store_ps(&dx_addr[5][frame], _mm256_sub_ps(dxp, dxn));
         }
-        
+    
         // dW水平加算
         for ( int i = 0; i < 64; ++i) {
             dW_ptr(node, i) += bb_mm256_cvtss_f32(bb_mm256_hsum_ps(dW[i]));
@@ -456,4 +469,75 @@ inline void simd_fp32_StochasticLut6_Backward
 
 
 
+// SIMD 版が扱える格納型か
+inline bool simd_StochasticLut6_IsSupportedType(int type)
+{
+    return type == BB_TYPE_FP32 || type == BB_TYPE_FP16 || type == BB_TYPE_BF16;
+}
+
+template <typename XType>
+inline void simd_StochasticLut6_Forward_X
+    (
+        FrameBuffer                         x_buf,
+        FrameBuffer                         y_buf,
+        std::int32_t    const               *input_table,
+        std::shared_ptr<Tensor>             W,
+        bool                                binary_mode,
+        bool                                lut_binarize,
+        float                               unbinarize_bias,
+        bool                                y_binarize
+    )
+{
+    switch ( y_buf.GetType() ) {
+    case BB_TYPE_FP32: simd_StochasticLut6_Forward_<XType, float   >(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    case BB_TYPE_FP16: simd_StochasticLut6_Forward_<XType, Float16 >(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    case BB_TYPE_BF16: simd_StochasticLut6_Forward_<XType, BFloat16>(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    default: BB_ASSERT(0); break;
+    }
+}
+
+// x_buf, y_buf の型で振り分け
+inline void simd_StochasticLut6_Forward
+    (
+        FrameBuffer                         x_buf,
+        FrameBuffer                         y_buf,
+        std::int32_t    const               *input_table,
+        std::shared_ptr<Tensor>             W,
+        bool                                binary_mode,
+        bool                                lut_binarize,
+        float                               unbinarize_bias,
+        bool                                y_binarize = false
+    )
+{
+    switch ( x_buf.GetType() ) {
+    case BB_TYPE_FP32: simd_StochasticLut6_Forward_X<float   >(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    case BB_TYPE_FP16: simd_StochasticLut6_Forward_X<Float16 >(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    case BB_TYPE_BF16: simd_StochasticLut6_Forward_X<BFloat16>(x_buf, y_buf, input_table, W, binary_mode, lut_binarize, unbinarize_bias, y_binarize); break;
+    default: BB_ASSERT(0); break;
+    }
+}
+
+// x_buf の型で振り分け
+inline void simd_StochasticLut6_Backward
+    (
+        FrameBuffer                 x_buf,
+        FrameBuffer                 dy_buf,
+        FrameBuffer                 dx_buf,
+        std::int32_t    const       *input_table,
+        std::shared_ptr<Tensor>     W,
+        std::shared_ptr<Tensor>     dW,
+        float                       unbinarize_bias,
+        bool                        binary_mode,
+        bool                        lut_binarize
+    )
+{
+    switch ( x_buf.GetType() ) {
+    case BB_TYPE_FP32: simd_StochasticLut6_Backward_<float   >(x_buf, dy_buf, dx_buf, input_table, W, dW, unbinarize_bias, binary_mode, lut_binarize); break;
+    case BB_TYPE_FP16: simd_StochasticLut6_Backward_<Float16 >(x_buf, dy_buf, dx_buf, input_table, W, dW, unbinarize_bias, binary_mode, lut_binarize); break;
+    case BB_TYPE_BF16: simd_StochasticLut6_Backward_<BFloat16>(x_buf, dy_buf, dx_buf, input_table, W, dW, unbinarize_bias, binary_mode, lut_binarize); break;
+    default: BB_ASSERT(0); break;
+    }
+}
+
+
 }
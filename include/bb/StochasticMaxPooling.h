@@ -44,7 +44,7 @@ protected:
     FrameBuffer         m_dx_buf;
 
 protected:
-    StochasticMaxPooling() {}
+    StochasticMaxPooling() { m_host_only = false; }
 
     /**
      * @brief  コマンド処理
@@ -152,155 +152,52 @@ protected:
 public:
     FrameBuffer Forward(FrameBuffer x_buf, bool train = true)
     {
-        BB_ASSERT(x.GetType() == DataType<FT>::type);
+        BB_ASSERT(x_buf.GetType() == DataType<FT>::type);
 
         // backwardの為に保存
         m_x_buf = x_buf;
 
         // SetInputShpaeされていなければ初回に設定
-        if (m_x.GetShape() != m_input_shape) {
-            SetInputShape(m_x.GetShape());
+        if (m_x_buf.GetShape() != m_input_shape) {
+            SetInputShape(m_x_buf.GetShape());
         }
 
         // 出力を設定
-        m_y_buf.Resize(DataType<FT>::type, m_x_buf.GetFrameSize(), m_output_shape);
-        
-
-#if 0 // #ifdef BB_WITH_CUDA
-        // CUDA版
-        if ( DataType<FT>::type == BB_TYPE_FP32 && !m_host_only && m_x.IsDeviceAvailable() && m_y.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
-            auto ptr_x = x.LockDeviceMemoryConst();
-            auto ptr_y = m_y.LockDeviceMemory(true);
-            bbcu_fp32_MaxPooling_Forward
-                (
-                    (float const *)ptr_x.GetAddr(),
-                    (float*       )ptr_y.GetAddr(),
-                    (int          )m_filter_h_size,
-                    (int          )m_filter_w_size,
-                    (int          )m_input_w_size,
-                    (int          )m_input_h_size,
-                    (int          )m_output_w_size,
-                    (int          )m_output_h_size,
-                    (int          )m_output_c_size,
-                    (int          )m_y.GetFrameSize(),
-                    (int          )(m_y.GetFrameStride() / sizeof(float))
-                );
-
-            return m_y;
-        }
-#endif
-     
-#if 0
-        if ( DataType<FT>::type == BB_TYPE_BIT ) {
-            // バイナリ用実装
-            auto x_ptr = m_x_buf.LockConst<FT>();
-            auto y_ptr = m_y_buf.Lock<FT>(true);
-
-            index_t  m256_frame_size = (int)m_y.GetFrameStride() / 32;
-
-            #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        __m256i *y_addr = (__m256i *)y_ptr.GetAddr(GetOutputNode(c, y, x));
-
-                        for (index_t frame = 0; frame < m256_frame_size; ++frame) {
-                            __m256i max_val = _mm256_set1_epi8(0);
-                            for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                                index_t iy = y*m_filter_h_size + fy;
-                                if ( iy < m_input_h_size ) {
-                                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                                        index_t ix = x*m_filter_w_size + fx;
-                                        if ( ix < m_input_w_size ) {
-                                            __m256i const *x_addr = (__m256i const *)x_ptr.GetAddr(GetInputNode(c, iy, ix));
-                                            __m256i in_sig = _mm256_load_si256(&x_addr[frame]);
-                                            max_val = _mm256_or_si256(max_val, in_sig);
-                                        }
-                                    }
-                                }
-                            }
-                            _mm256_store_si256(&y_addr[frame], max_val);
-                        }
-                    }
-                }
-            }
-
-            return m_y_buf;
-        }
-#endif
-
-#if 0
-        // float用実装
-        if ( DataType<FT>::type == BB_TYPE_FP32 ) {
-            auto x_ptr = m_x.LockConst<FT>();
-            auto y_ptr = m_y.Lock<FT>(true);
-
-            index_t  m256_frame_size = (int)m_y.GetFrameStride() / sizeof(float);
-
-            #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        float *y_addr = (float *)y_ptr.GetAddr(GetOutputNode(c, y, x));
-
-                        for (index_t frame = 0; frame < m256_frame_size; frame += 8) {
-                            __m256  max_val = _mm256_set1_ps(-1.0e7f);  // 前段に活性化入れるから0がminだよね？
-                            for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                                index_t iy = y*m_filter_h_size + fy;
-                                if ( iy < m_input_h_size ) {
-                                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                                        index_t ix = x*m_filter_w_size + fx;
-                                        if ( ix < m_input_w_size ) {
-                                            float const *x_addr = (float const *)x_ptr.GetAddr(GetInputNode(c, iy, ix));
-                                            __m256 in_sig = _mm256_load_ps(&x_addr[frame]);
-                                            max_val = _mm256_max_ps(max_val, in_sig);
-                                        }
-                                    }
-                                }
-                            }
-                            _mm256_store_ps(&y_addr[frame], max_val);
-                        }
-                    }
-                }
-            }
-
-            return m_y;
-        }
-#endif
+        m_y_buf.Resize(m_x_buf.GetFrameSize(), m_output_shape, DataType<FT>::type);
 
-        // 汎用版実装
+        // 汎用版実装 (入力はビューのこともあるのでノード毎のアクセサ経由で入出力のストライドを別に扱う)
         {
             auto x_ptr = m_x_buf.LockConst<FT>();
             auto y_ptr = m_y_buf.Lock<FT>(true);
 
-            auto frame_size = m_x.GetFrameSize();
+            index_t node_size  = m_output_c_size * m_output_h_size * m_output_w_size;
+            index_t frame_size = m_x_buf.GetFrameSize();
 
             #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        for (index_t frame = 0; frame < frame_size; ++frame) {
-                            // OR演算を実施(反転してANDを取って、出力反転)
-                            FT out_sig = (FT)1.0;
-                            for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                                index_t iy = y*m_filter_h_size + fy;
-                                if ( iy < m_input_h_size ) {
-                                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                                        index_t ix = x*m_filter_w_size + fx;
-                                        if ( ix < m_input_w_size ) {
-                                            FT in_sig = x_ptr.Get(frame, {ix, iy, c});
-                                            out_sig *= ((FT)1.0 - in_sig);
-                                        }
-                                    }
+            for (index_t node = 0; node < node_size; ++node) {
+                index_t c = node / (m_output_h_size * m_output_w_size);
+                index_t y = (node / m_output_w_size) % m_output_h_size;
+                index_t x = node % m_output_w_size;
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    // OR演算を実施(反転してANDを取って、出力反転)
+                    FT out_sig = (FT)1.0;
+                    for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
+                        index_t iy = y*m_filter_h_size + fy;
+                        if ( iy < m_input_h_size ) {
+                            for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
+                                index_t ix = x*m_filter_w_size + fx;
+                                if ( ix < m_input_w_size ) {
+                                    FT in_sig = x_ptr.Get(frame, GetInputNode(c, iy, ix));
+                                    out_sig *= ((FT)1.0 - in_sig);
                                 }
                             }
-                            y_ptr.Set(frame, {x, y, c}, ((FT)1.0 - out_sig));
                         }
                     }
+                    y_ptr.Set(frame, node, ((FT)1.0 - out_sig));
                 }
             }
 
-            return m_y;
+            return m_y_buf;
         }
     }
     
@@ -308,116 +205,49 @@ public:
     {
         BB_ASSERT(dy_buf.GetType() == DataType<BT>::type);
 
-        m_dx_buf.Resize(DataType<BT>::type, dy_buf.GetFrameSize(), m_input_shape);
-
-#if 0 // #ifdef BB_WITH_CUDA
-        if ( DataType<BT>::type == BB_TYPE_FP32 && DataType<FT>::type == BB_TYPE_FP32 && !m_host_only 
-                && m_x.IsDeviceAvailable() && m_y.IsDeviceAvailable() && Manager::IsDeviceAvailable() ) {
-            // CUDA版
-            auto ptr_x  = m_x.LockDeviceMemoryConst();
-            auto ptr_y  = m_y.LockDeviceMemoryConst();
-            auto ptr_dy = dy.LockDeviceMemoryConst();
-            auto ptr_dx = m_dx.LockDeviceMemory(true);
-            bbcu_fp32_MaxPooling_Backward
-                (
-                    (float const *)ptr_x.GetAddr(),
-                    (float const *)ptr_y.GetAddr(),
-                    (float const *)ptr_dy.GetAddr(),
-                    (float*       )ptr_dx.GetAddr(),
-                    (int          )m_filter_h_size,
-                    (int          )m_filter_w_size,
-                    (int          )m_input_w_size,
-                    (int          )m_input_h_size,
-                    (int          )m_output_w_size,
-                    (int          )m_output_h_size,
-                    (int          )m_output_c_size,
-                    (int          )m_y.GetFrameSize(),
-                    (int          )(m_y.GetFrameStride() / sizeof(float))
-                );
-
-            return m_dx;
-        }
-#endif
-
-#if 0
-        if ( DataType<BT>::type == BB_TYPE_FP32 && DataType<FT>::type == BB_TYPE_FP32 ) {
-            // float用実装
-            index_t  m256_frame_size = m_dx.GetFrameStride() / sizeof(float);
-
-            auto x_ptr  = m_x.LockConst<FT>();
-            auto y_ptr  = m_y.LockConst<FT>();
-            auto dy_ptr = dy.LockConst<BT>();
-            auto dx_ptr = m_dx.Lock<BT>(true);
-
-    #pragma omp parallel for
-            for (index_t n = 0; n < m_input_c_size; ++n) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        float const * y_addr  = (float const *)y_ptr.GetAddr(GetOutputNode(n, y, x));
-                        float const * dy_addr = (float const *)dy_ptr.GetAddr(GetOutputNode(n, y, x));
-
-                        for (index_t frame = 0; frame < m256_frame_size; frame += 8) {
-                            __m256 out_sig  = _mm256_load_ps(&y_addr[frame]);
-                            __m256 out_grad = _mm256_load_ps(&dy_addr[frame]);
-                            for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                                index_t iy = y*m_filter_h_size + fy;
-                                if ( iy < m_input_h_size ) {
-                                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                                        index_t ix = x*m_filter_w_size + fx;
-                                        if ( ix < m_input_w_size ) {
-                                            float const *x_addr  = (float const *)x_ptr.GetAddr(GetInputNode(n, iy, ix));
-                                            float       *dx_addr = (float       *)dx_ptr.GetAddr(GetInputNode(n, iy, ix));
-                                            __m256 in_sig  = _mm256_load_ps(&x_addr[frame]);
-                                            __m256 mask    = _mm256_cmp_ps(in_sig, out_sig, _CMP_EQ_OQ);
-                                            __m256 in_grad = _mm256_and_ps(mask, out_grad);
-                                            _mm256_store_ps(&dx_addr[frame], in_grad);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-
-            return m_dx;
-        }
-#endif
+        m_dx_buf.Resize(dy_buf.GetFrameSize(), m_input_shape, DataType<BT>::type);
 
         // 汎用版実装
         {
             auto x_ptr  = m_x_buf.LockConst<FT>();
-            auto y_ptr  = m_y_buf.LockConst<FT>();
             auto dy_ptr = dy_buf.LockConst<BT>();
             auto dx_ptr = m_dx_buf.Lock<BT>(true);
 
-            auto frame_size = m_x_buf.GetFrameSize();
+            index_t node_size  = m_output_c_size * m_output_h_size * m_output_w_size;
+            index_t frame_size = dy_buf.GetFrameSize();
 
+            // y = 1 - Π(1 - x_j) なので dy/dx_i = Π_{j≠i}(1 - x_j)
             #pragma omp parallel for
-            for (index_t c = 0; c < m_input_c_size; ++c) {
-                for (index_t y = 0; y < m_output_h_size; ++y) {
-                    for (index_t x = 0; x < m_output_w_size; ++x) {
-                        for (index_t frame = 0; frame < frame_size; ++frame) {
-                            FT out_sig = y_ptr.Get(frame, c, y, x);
-                            BT grad    = dy_ptr.Get(frame, c, y, x);
-                            for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
-                                index_t iy = y*m_filter_h_size + fy;
-                                if ( iy < m_input_h_size ) {
-                                    for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
-                                        index_t ix = x*m_filter_w_size + fx;
-                                        if ( ix < m_input_w_size ) {
-                                            FT in_sig  = x_ptr.Get(frame, c, iy, ix);
-                                            dx_ptr.Set(frame, c, iy, ix, (in_sig == out_sig) ? grad : (BT)0);
-                                        }
-                                    }
+            for (index_t node = 0; node < node_size; ++node) {
+                index_t c = node / (m_output_h_size * m_output_w_size);
+                index_t y = (node / m_output_w_size) % m_output_h_size;
+                index_t x = node % m_output_w_size;
+                for (index_t frame = 0; frame < frame_size; ++frame) {
+                    BT out_grad = dy_ptr.Get(frame, node);
+                    for (index_t fy = 0; fy < m_filter_h_size; ++fy) {
+                        index_t iy = y*m_filter_h_size + fy;
+                        if ( iy >= m_input_h_size ) { continue; }
+                        for (index_t fx = 0; fx < m_filter_w_size; ++fx) {
+                            index_t ix = x*m_filter_w_size + fx;
+                            if ( ix >= m_input_w_size ) { continue; }
+
+                            BT in_grad = out_grad;
+                            for (index_t gy = 0; gy < m_filter_h_size; ++gy) {
+                                index_t jy = y*m_filter_h_size + gy;
+                                if ( jy >= m_input_h_size ) { continue; }
+                                for (index_t gx = 0; gx < m_filter_w_size; ++gx) {
+                                    index_t jx = x*m_filter_w_size + gx;
+                                    if ( jx >= m_input_w_size || (gy == fy && gx == fx) ) { continue; }
+                                    in_grad *= (BT)(1.0 - x_ptr.Get(frame, GetInputNode(c, jy, jx)));
                                 }
                             }
+                            dx_ptr.Set(frame, GetInputNode(c, iy, ix), in_grad);
                         }
                     }
                 }
             }
 
-            return m_dx;
+            return m_dx_buf;
         }
     }
 };
@@ -16,6 +16,7 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <type_traits>
 #include <malloc.h>
 
 #include "bb/Manager.h"
@@ -23,6 +24,7 @@
 #include "bb/Utility.h"
 #include "bb/Memory.h"
 #include "bb/TensorOperator.h"
+#include "bb/PhiloxDistributionGenerator.h"
 
 #ifdef BB_WITH_CUDA
 #include "bbcu/bbcu.h"
@@ -352,6 +354,11 @@ public:
         return m_mem->IsDeviceAvailable();
     }
 
+    std::uint64_t GetRevision(void) const
+    {
+        return m_mem->GetRevision();
+    }
+
     index_t GetMemorySize(void) const
     {
         return m_mem->GetSize();
@@ -462,16 +469,34 @@ public:
         memset(ptr.GetAddr(), 0, m_mem->GetSize());
     }
 
+protected:
+    // 乱数の生成型 (double 以外は float で生成する)
+    typedef typename std::conditional<std::is_same<T, double>::value, double, float>::type   RandomType;
+
+    static void FillValue(ValueGenerator<T> &gen, T *addr, index_t size)
+    {
+        gen.Fill(addr, size);
+    }
+
+    template <typename GT>
+    static void FillValue(ValueGenerator<GT> &gen, T *addr, index_t size)
+    {
+        std::vector<GT> buf(size);
+        gen.Fill(buf.data(), size);
+        for (index_t i = 0; i < size; ++i) {
+            addr[i] = (T)buf[i];
+        }
+    }
+
+public:
+    // 乱数での初期化は Philox でブロック毎に並列生成するので、スレッド数によらず同じ値になる
     void InitNormalDistribution(double mean = 0.0, double stddev = 1.0, std::uint64_t seed=1)
     {
         auto ptr  = m_mem->Lock(true);
         auto addr = (T *)ptr.GetAddr();
 
-        std::mt19937_64 mt(seed);
-        std::normal_distribution<double> dist(mean, stddev);
-        for (index_t i = 0; i < m_size; ++i) {
-            addr[i] = (T)dist(mt);
-        }
+        auto gen = PhiloxNormalDistributionGenerator<RandomType>::Create((RandomType)mean, (RandomType)stddev, seed);
+        FillValue(*gen, addr, m_size);
     }
     
     void InitUniformDistribution(double _Min0 = 0.0, double _Max0 = 1.0, std::uint64_t seed=1)
@@ -479,11 +504,8 @@ public:
         auto ptr  = m_mem->Lock(true);
         auto addr = (T *)ptr.GetAddr();
 
-        std::mt19937_64 mt(seed);
-        std::uniform_real_distribution<double> dist(_Min0, _Max0);
-        for (index_t i = 0; i < m_size; ++i) {
-            addr[i] = (T)dist(mt);
-        }
+        auto gen = PhiloxUniformDistributionGenerator<RandomType>::Create((RandomType)_Min0, (RandomType)_Max0, seed);
+        FillValue(*gen, addr, m_size);
     }
 
 
@@ -1535,6 +1557,16 @@ public:
         return m_mem->IsDeviceAvailable();
     }
 
+   /**
+     * @brief  内容のリビジョン取得
+     * @detail 書き込み用にロックされる度に変わる値を返す
+     * @return リビジョン
+     */
+    std::uint64_t GetRevision(void) const
+    {
+        return m_mem->GetRevision();
+    }
+
     void Resize(indices_t shape, int type)
     {
         // 設定保存
@@ -2359,4 +2391,28 @@ inline std::ostream& operator<<(std::ostream& os, Tensor const &t)
 
 
 
+// 最外側(ノード)の次元を並べ替える (新しい i 番目 = 元の order[i] 番目)
+template <class TensorType>
+inline void Tensor_PermuteOuter(TensorType &tensor, std::vector<index_t> const &order)
+{
+    index_t size = tensor.GetSize();
+    index_t n    = (index_t)order.size();
+    if ( size == 0 || n == 0 ) {
+        return;
+    }
+    BB_ASSERT(size % n == 0);
+
+    index_t row_bytes = (size / n) * DataType_GetByteSize(tensor.GetType());
+    std::vector<std::uint8_t>   tmp(size * DataType_GetByteSize(tensor.GetType()));
+
+    auto ptr  = tensor.LockMemory();
+    auto addr = (std::uint8_t *)ptr.GetAddr();
+    memcpy(&tmp[0], addr, tmp.size());
+    for ( index_t i = 0; i < n; ++i ) {
+        BB_ASSERT(order[i] >= 0 && order[i] < n);
+        memcpy(addr + i * row_bytes, &tmp[order[i] * row_bytes], row_bytes);
+    }
+}
+
+
 }
\ No newline at end of file
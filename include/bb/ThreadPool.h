@@ -0,0 +1,595 @@
+﻿// --------------------------------------------------------------------------
+//  Binary Brain  -- binary neural net framework
+//
+//                                Copyright (C) 2018-2019 by Ryuji Fuchikami
+//                                https://github.com/ryuz
+//                                ryuji.fuchikami@nifty.com
+// --------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <array>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <cstdio>
+#endif
+
+#include "bb/DataType.h"
+
+
+namespace bb {
+
+
+// 常駐ワーカーによるワークスティーリング方式のスレッドプール
+//   ワーカー毎にタスクキューを持ち、自分のキューは末尾から、他のキューは先頭から取り出す
+//   ParallelFor の呼び出し元も完了待ちの間はタスクを実行するので、入れ子で呼んでもよい
+//   ParallelForStatic は分担を固定するので、レイヤーをまたいで同じノード範囲を同じスレッドが扱う
+//   Create() で作った独立したワーカー群は Scope の間だけ GetInstance() の返すプールになる
+class ThreadPool
+{
+protected:
+    struct TaskQueue
+    {
+        std::mutex                          mtx;
+        std::deque< std::function<void()> > tasks;
+        std::deque< std::function<void()> > bound;      // このワーカー専用(盗まれない)
+        std::atomic<index_t>                bound_count;
+
+        TaskQueue() : bound_count(0) {}
+    };
+
+    std::vector< std::unique_ptr<TaskQueue> >   m_queues;
+    std::vector<std::thread>                    m_threads;
+    std::mutex                                  m_mtx;
+    std::condition_variable                     m_cv;
+    std::atomic<index_t>                        m_stealable;    // 盗めるタスクの数
+    std::atomic<unsigned int>                   m_round;
+    bool                                        m_exit = false;
+    int                                         m_tasks_per_thread = 4;
+    bool                                        m_affinity = false;
+
+#ifdef __linux__
+    cpu_set_t                                   m_process_cpus;         // 起動時に許可されていた CPU (taskset やコンテナの制限)
+    std::vector<int>                            m_allowed_cpus;         // ソケット・コア順に並べた許可 CPU
+    bool                                        m_caller_pinned = false;
+    pthread_t                                   m_caller;               // SetAffinity(true) を呼んだスレッド
+    cpu_set_t                                   m_caller_cpus;          // その固定前の CPU セット
+#endif
+
+    // 1回の並列実行の完了待ちと例外の受け渡し
+    //   タスク内の例外(BB_ASSERT_EXCEPTION 時の BB_ASSERT など)はここで捕まえ、
+    //   全タスクの完了後に呼び出し元で投げ直す
+    //   (ワーカー上で投げると std::terminate、呼び出し元で巻き戻すとキュー内のタスクが
+    //    破棄済みのスタックを参照するため)
+    struct TaskGroup
+    {
+        std::atomic<index_t>    remain;
+        std::mutex              mtx;
+        std::exception_ptr      error;
+
+        explicit TaskGroup(index_t size) : remain(size) {}
+
+        template <class Func>
+        void Run(Func &func, index_t start, index_t stop)
+        {
+            try {
+                func(start, stop);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if ( !error ) {
+                    error = std::current_exception();
+                }
+            }
+            remain--;
+        }
+    };
+
+    // グループの完了まで他のタスクを手伝い、例外があれば投げ直す
+    void Wait(TaskGroup &group)
+    {
+        int self = WorkerIndex();
+        while ( group.remain > 0 ) {
+            if ( !TryRun(self) ) {
+                std::this_thread::yield();
+            }
+        }
+        if ( group.error ) {
+            std::rethrow_exception(group.error);
+        }
+    }
+
+    // 実行中スレッドが属するプールとワーカー番号
+    struct WorkerId
+    {
+        ThreadPool  *pool  = nullptr;
+        int         index  = -1;
+    };
+
+    static WorkerId &CurrentWorker(void)
+    {
+        static thread_local WorkerId id;
+        return id;
+    }
+
+    // このプールでのワーカー番号(このプールのワーカー以外は -1)
+    int WorkerIndex(void) const
+    {
+        auto const &id = CurrentWorker();
+        return (id.pool == this) ? id.index : -1;
+    }
+
+    // このスレッドで GetInstance() が返すプール (nullptr なら全体共通のもの)
+    static ThreadPool *&CurrentPool(void)
+    {
+        static thread_local ThreadPool *pool = nullptr;
+        return pool;
+    }
+
+    ThreadPool() : ThreadPool((int)std::thread::hardware_concurrency()) {}
+
+    explicit ThreadPool(int thread_count)
+    {
+        m_stealable = 0;
+        m_round     = 0;
+
+#ifdef __linux__
+        CPU_ZERO(&m_process_cpus);
+        if ( sched_getaffinity(0, sizeof(m_process_cpus), &m_process_cpus) == 0 ) {
+            for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+                if ( CPU_ISSET(cpu, &m_process_cpus) ) {
+                    m_allowed_cpus.push_back(cpu);
+                }
+            }
+        }
+        SortCpuTopology(m_allowed_cpus);
+#endif
+
+        Start(thread_count > 0 ? thread_count : 1);
+    }
+
+    void Start(int thread_count)
+    {
+        // 呼び出し元も実行に加わるのでワーカーは1つ少なく起動
+        int worker_count = std::max(thread_count - 1, 0);
+        m_exit = false;
+        m_queues.clear();
+        for ( int i = 0; i < worker_count; ++i ) {
+            m_queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+        }
+        for ( int i = 0; i < worker_count; ++i ) {
+            m_threads.push_back(std::thread([this, i]() { WorkerMain(i); }));
+        }
+        ApplyAffinity();
+    }
+
+#ifdef __linux__
+    // sysfs の CPU トポロジー値 (読めなければ -1)
+    static int ReadCpuTopology(int cpu, char const *name)
+    {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+        std::FILE *fp = std::fopen(path, "r");
+        if ( fp == nullptr ) {
+            return -1;
+        }
+        int value = -1;
+        if ( std::fscanf(fp, "%d", &value) != 1 ) {
+            value = -1;
+        }
+        std::fclose(fp);
+        return value;
+    }
+
+    // CPU 番号はソケットを交互に振られることもあるので、ソケット(physical_package_id)、
+    // コア(core_id) の順に並べ直し、連続したワーカー番号が同じソケットに並ぶようにする
+    // (sysfs が読めない CPU は -1 として先頭側に番号順で並ぶ)
+    static void SortCpuTopology(std::vector<int> &cpus)
+    {
+        std::vector< std::array<int, 3> > keys;
+        for ( int cpu : cpus ) {
+            keys.push_back({{ReadCpuTopology(cpu, "physical_package_id"), ReadCpuTopology(cpu, "core_id"), cpu}});
+        }
+        std::sort(keys.begin(), keys.end());
+        for ( size_t i = 0; i < keys.size(); ++i ) {
+            cpus[i] = keys[i][2];
+        }
+    }
+#endif
+
+    // 固定時はワーカー i をソケット・コア順に並べた許可 CPU の i 番目に、SetAffinity(true) を
+    // 呼んだスレッドをその次の CPU に固定する。解除時はワーカーを起動時の CPU セットに戻す
+    void ApplyAffinity(void)
+    {
+#ifdef __linux__
+        if ( m_allowed_cpus.empty() ) {
+            return;
+        }
+
+        int cpu_count = (int)m_allowed_cpus.size();
+        for ( int i = 0; i < (int)m_threads.size(); ++i ) {
+            cpu_set_t cpu_set;
+            if ( m_affinity ) {
+                CPU_ZERO(&cpu_set);
+                CPU_SET(m_allowed_cpus[i % cpu_count], &cpu_set);
+            }
+            else {
+                cpu_set = m_process_cpus;
+            }
+            pthread_setaffinity_np(m_threads[i].native_handle(), sizeof(cpu_set), &cpu_set);
+        }
+
+        // 呼び出し元は終了しているかもしれないので、同じスレッドから呼ばれた場合だけ固定し直す
+        if ( m_affinity && m_caller_pinned && pthread_equal(m_caller, pthread_self()) ) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(m_allowed_cpus[m_threads.size() % cpu_count], &cpu_set);
+            pthread_setaffinity_np(m_caller, sizeof(cpu_set), &cpu_set);
+        }
+#endif
+    }
+
+    void Stop(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        for ( auto &th : m_threads ) {
+            th.join();
+        }
+        m_threads.clear();
+        m_queues.clear();
+    }
+
+    void WorkerMain(int index)
+    {
+        CurrentWorker().pool  = this;
+        CurrentWorker().index = index;
+        CurrentPool() = this;
+        auto &q = *m_queues[index];
+        for ( ; ; ) {
+            if ( TryRun(index) ) {
+                continue;
+            }
+
+            // 自分が実行できるタスク(盗めるタスクか自分専用のタスク)が来るまで待つ
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [&]() { return m_exit || m_stealable > 0 || q.bound_count > 0; });
+            if ( m_exit && m_stealable == 0 && q.bound_count == 0 ) {
+                return;
+            }
+        }
+    }
+
+    void Push(std::function<void()> task)
+    {
+        int    self  = WorkerIndex();
+        size_t index = (self >= 0) ? (size_t)self : (size_t)(m_round++ % m_queues.size());
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mtx);
+            m_queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_stealable++;
+        }
+        m_cv.notify_one();
+    }
+
+    void PushBound(int index, std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mtx);
+            m_queues[index]->bound.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_queues[index]->bound_count++;
+        }
+        m_cv.notify_all();
+    }
+
+    // タスクを1つ取り出して実行(無ければ false)
+    bool TryRun(int self)
+    {
+        std::function<void()> task;
+
+        if ( self >= 0 ) {
+            auto &q = *m_queues[self];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if ( !q.bound.empty() ) {
+                task = std::move(q.bound.front());
+                q.bound.pop_front();
+                q.bound_count--;
+            }
+            else if ( !q.tasks.empty() ) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                m_stealable--;
+            }
+        }
+
+        if ( !task ) {
+            size_t n     = m_queues.size();
+            size_t start = (self >= 0) ? (size_t)self + 1 : (size_t)m_round.load();
+            for ( size_t k = 0; k < n && !task; ++k ) {
+                auto &q = *m_queues[(start + k) % n];
+                std::lock_guard<std::mutex> lock(q.mtx);
+                if ( !q.tasks.empty() ) {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                    m_stealable--;
+                }
+            }
+        }
+
+        if ( !task ) {
+            return false;
+        }
+
+        task();
+        return true;
+    }
+
+public:
+    ~ThreadPool()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief  実行中のプール取得
+     * @detail Scope で切り替えていればそのプール(とそのワーカー)、それ以外は全体共通のプール
+     */
+    static ThreadPool &GetInstance(void)
+    {
+        if ( CurrentPool() != nullptr ) {
+            return *CurrentPool();
+        }
+        static ThreadPool instance;
+        return instance;
+    }
+
+    /**
+     * @brief  独立したワーカー群の生成
+     * @detail 全体共通のプールとはワーカーもキューも共有しない
+     *         データ並列の複製毎にコアを分けて使う場合などに Scope と組み合わせる
+     * @param  thread_count 呼び出し元を含めたスレッド数
+     */
+    static std::shared_ptr<ThreadPool> Create(int thread_count)
+    {
+        return std::shared_ptr<ThreadPool>(new ThreadPool(std::max(thread_count, 1)));
+    }
+
+    // 生存期間中、このスレッドの GetInstance() を指定のプールに切り替える
+    class Scope
+    {
+    protected:
+        ThreadPool  *m_prev;
+
+    public:
+        explicit Scope(ThreadPool &pool) : m_prev(CurrentPool()) { CurrentPool() = &pool; }
+        ~Scope() { CurrentPool() = m_prev; }
+
+        Scope(Scope const &) = delete;
+        Scope &operator=(Scope const &) = delete;
+    };
+
+    /**
+     * @brief  スレッド数設定
+     * @detail 呼び出し元スレッドを含めた数で指定する (1 なら逐次実行)
+     *         実行中のタスクが無いときに呼ぶこと
+     * @param  thread_count スレッド数
+     */
+    void SetThreadCount(int thread_count)
+    {
+        BB_ASSERT(thread_count >= 1);
+        if ( thread_count == GetThreadCount() ) {
+            return;
+        }
+        Stop();
+        Start(thread_count);
+    }
+
+    int GetThreadCount(void) const
+    {
+        return (int)m_threads.size() + 1;
+    }
+
+    // 粒度を自動で決める際の1スレッドあたりのタスク数
+    void SetTasksPerThread(int tasks)
+    {
+        BB_ASSERT(tasks >= 1);
+        m_tasks_per_thread = tasks;
+    }
+
+    int GetTasksPerThread(void) const
+    {
+        return m_tasks_per_thread;
+    }
+
+    /**
+     * @brief  スレッドの CPU 固定
+     * @detail プロセスに許可された CPU (sched_getaffinity) を sysfs のソケット・コア番号順に
+     *         並べた i 番目にワーカー i を、この関数を呼んだスレッドをその次の CPU に固定する
+     *         (Linux のみ有効)
+     *         false で解除すると、ワーカーは起動時の CPU セットに、呼び出し元は固定前に戻す
+     *         ParallelForStatic と組み合わせると、ノード範囲と CPU(ソケット)の対応が固定される
+     * @param  enable 固定するなら true
+     */
+    void SetAffinity(bool enable)
+    {
+#ifdef __linux__
+        if ( enable && !m_caller_pinned ) {
+            m_caller = pthread_self();
+            CPU_ZERO(&m_caller_cpus);
+            m_caller_pinned = (pthread_getaffinity_np(m_caller, sizeof(m_caller_cpus), &m_caller_cpus) == 0);
+        }
+        m_affinity = enable;
+        ApplyAffinity();
+        if ( !enable && m_caller_pinned ) {
+            pthread_setaffinity_np(m_caller, sizeof(m_caller_cpus), &m_caller_cpus);
+            m_caller_pinned = false;
+        }
+#else
+        m_affinity = enable;
+#endif
+    }
+
+    bool GetAffinity(void) const
+    {
+        return m_affinity;
+    }
+
+    // 固定に使う CPU の並び (i 番目がワーカー i、Linux 以外は空)
+    std::vector<int> GetAffinityCpus(void) const
+    {
+#ifdef __linux__
+        return m_allowed_cpus;
+#else
+        return std::vector<int>();
+#endif
+    }
+
+
+    /**
+     * @brief  範囲を分割して並列実行
+     * @param  begin 開始
+     * @param  end   終了
+     * @param  grain 1タスクあたりの大きさ (0 以下ならスレッド数から決める)
+     * @param  func  func(start, end) で [start, end) を処理する
+     */
+    template <class Func>
+    void ParallelFor(index_t begin, index_t end, index_t grain, Func func)
+    {
+        index_t size = end - begin;
+        if ( size <= 0 ) {
+            return;
+        }
+
+        int thread_count = GetThreadCount();
+        if ( grain <= 0 ) {
+            grain = std::max<index_t>(1, size / (thread_count * m_tasks_per_thread));
+        }
+
+        index_t task_size = (size + grain - 1) / grain;
+        if ( thread_count <= 1 || task_size <= 1 ) {
+            func(begin, end);
+            return;
+        }
+
+        TaskGroup group(task_size);
+        for ( index_t t = 1; t < task_size; ++t ) {
+            index_t start = begin + t * grain;
+            index_t stop  = std::min(start + grain, end);
+            Push([&func, &group, start, stop]() { group.Run(func, start, stop); });
+        }
+
+        // 先頭は自分で処理し、残りは完了まで手伝う
+        group.Run(func, begin, std::min(begin + grain, end));
+        Wait(group);
+    }
+
+    /**
+     * @brief  範囲をスレッド数で等分し、分担を固定して並列実行
+     * @detail k 番目の区間は常にワーカー k が処理する(最後の区間は呼び出し元)
+     *         同じサイズで呼べば毎回同じスレッドが同じ区間を処理するので、
+     *         first-touch で確保したメモリを同じ NUMA ノードのスレッドが扱える
+     * @param  begin 開始
+     * @param  end   終了
+     * @param  func  func(start, end) で [start, end) を処理する
+     */
+    template <class Func>
+    void ParallelForStatic(index_t begin, index_t end, Func func)
+    {
+        index_t size = end - begin;
+        if ( size <= 0 ) {
+            return;
+        }
+
+        int thread_count = GetThreadCount();
+        if ( thread_count <= 1 || size <= 1 ) {
+            func(begin, end);
+            return;
+        }
+
+        TaskGroup group(thread_count);
+        for ( int k = 0; k < thread_count - 1; ++k ) {
+            index_t start = begin + size * k / thread_count;
+            index_t stop  = begin + size * (k + 1) / thread_count;
+            PushBound(k, [&func, &group, start, stop]() {
+                    if ( start < stop ) {
+                        group.Run(func, start, stop);
+                    }
+                    else {
+                        group.remain--;
+                    }
+                });
+        }
+
+        index_t start = begin + size * (thread_count - 1) / thread_count;
+        group.Run(func, start, end);
+        Wait(group);
+    }
+
+    /**
+     * @brief  ノード x フレームブロックの2次元に分割して並列実行
+     * @detail フレーム方向は 256 フレーム単位で区切るので、Bit 型でも
+     *         同じバイトや SIMD ワードを複数タスクで共有しない
+     * @param  node_size   ノード数
+     * @param  frame_size  フレーム数
+     * @param  func        func(node_start, node_end, frame_start, frame_end)
+     * @param  node_grain  1タスクあたりのノード数 (0 以下なら自動)
+     * @param  frame_block 1タスクあたりのフレーム数 (0 以下なら自動)
+     */
+    template <class Func>
+    void ParallelForNodeFrame(index_t node_size, index_t frame_size, Func func, index_t node_grain = 0, index_t frame_block = 0)
+    {
+        if ( node_size <= 0 || frame_size <= 0 ) {
+            return;
+        }
+
+        index_t target_tasks = GetThreadCount() * m_tasks_per_thread;
+        if ( node_grain <= 0 ) {
+            node_grain = std::max<index_t>(1, node_size / target_tasks);
+        }
+        index_t node_tasks = (node_size + node_grain - 1) / node_grain;
+
+        // ノードだけで足りなければフレーム方向にも分ける
+        if ( frame_block <= 0 ) {
+            index_t frame_tasks = std::max<index_t>(1, (target_tasks + node_tasks - 1) / node_tasks);
+            frame_block = (frame_size + frame_tasks - 1) / frame_tasks;
+        }
+        frame_block = (frame_block + 255) / 256 * 256;
+        index_t frame_tasks = (frame_size + frame_block - 1) / frame_block;
+
+        ParallelFor(0, node_tasks * frame_tasks, 1, [&](index_t start, index_t end) {
+                for ( index_t t = start; t < end; ++t ) {
+                    index_t node_start  = (t / frame_tasks) * node_grain;
+                    index_t frame_start = (t % frame_tasks) * frame_block;
+                    func(node_start,  std::min(node_start  + node_grain,  node_size),
+                         frame_start, std::min(frame_start + frame_block, frame_size));
+                }
+            });
+    }
+};
+
+
+}
+
+// end of file
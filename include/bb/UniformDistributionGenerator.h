@@ -53,6 +53,13 @@ public:
     {
         return m_uniform_dist(m_mt);
     }
+
+    void Fill(T *data, index_t size)
+    {
+        for ( index_t i = 0; i < size; ++i ) {
+            data[i] = m_uniform_dist(m_mt);
+        }
+    }
 };
 
 
@@ -92,6 +99,13 @@ public:
     {
         return m_uniform_dist(m_mt);
     }
+
+    void Fill(Bit *data, index_t size)
+    {
+        for ( index_t i = 0; i < size; ++i ) {
+            data[i] = m_uniform_dist(m_mt);
+        }
+    }
 };
 
 
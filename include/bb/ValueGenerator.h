@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "bb/DataType.h"
+
 namespace bb {
 
 template <typename T>
@@ -18,6 +20,20 @@ public:
     virtual ~ValueGenerator(){}
     virtual void Reset(void)    = 0;
     virtual T    GetValue(void) = 0;
+
+    /**
+     * @brief  まとめて生成
+     * @detail GetValue() を size 回呼んだのと同じ列を data に書き込む
+     *         派生クラスは仮想呼び出しを省いた版やブロック並列版で上書きする
+     * @param  data 出力先
+     * @param  size 個数
+     */
+    virtual void Fill(T *data, index_t size)
+    {
+        for ( index_t i = 0; i < size; ++i ) {
+            data[i] = GetValue();
+        }
+    }
 };
 
 
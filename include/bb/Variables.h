@@ -178,6 +178,15 @@ public:
 #endif
     }
 
+    // Tensor_ を同じメモリを参照する Tensor として追加
+    template <typename Tp>
+    void PushBack(Tensor_<Tp> const &t)
+    {
+        auto tensor = std::make_shared<Tensor>();
+        *tensor = t;
+        PushBack(tensor);
+    }
+
     void PushBack(Variables const &v)
     {
         for ( auto& t : v.m_tensors ) {
@@ -3,6 +3,9 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
+
+#include <mutex>
 
 #define BB_ASSERT_EXCEPTION
 
@@ -40,6 +43,7 @@
 #include "bb/ValueGenerator.h"
 #include "bb/NormalDistributionGenerator.h"
 #include "bb/UniformDistributionGenerator.h"
+#include "bb/PhiloxDistributionGenerator.h"
 
 #include "bb/Runner.h"
 #include "bb/LoadMnist.h"
@@ -100,6 +104,8 @@ using OptimizerAdaGrad             = bb::OptimizerAdaGrad<float>;
 using ValueGenerator               = bb::ValueGenerator<float>;
 using NormalDistributionGenerator  = bb::NormalDistributionGenerator<float>;
 using UniformDistributionGenerator = bb::UniformDistributionGenerator<float>;
+using PhiloxNormalDistributionGenerator  = bb::PhiloxNormalDistributionGenerator<float>;
+using PhiloxUniformDistributionGenerator = bb::PhiloxUniformDistributionGenerator<float>;
 
 using TrainData                    = bb::TrainData<float>;
 using LoadMnist                    = bb::LoadMnist<float>;
@@ -124,6 +130,21 @@ std::string GetVerilog_FromLutBit(std::string module_name, std::vector< std::sha
 }
 
 
+std::string GetVerilogOptimized_FromLut(std::string module_name, std::vector< std::shared_ptr< bb::LutLayer<float, float> > > layers, bb::index_t register_depth)
+{
+    std::stringstream ss;
+    bb::ExportVerilog_LutLayersOptimized<float, float>(ss, module_name, layers, register_depth);
+    return ss.str();
+}
+
+std::string GetVerilogOptimized_FromLutBit(std::string module_name, std::vector< std::shared_ptr< bb::LutLayer<bb::Bit, float> > > layers, bb::index_t register_depth)
+{
+    std::stringstream ss;
+    bb::ExportVerilog_LutLayersOptimized<bb::Bit, float>(ss, module_name, layers, register_depth);
+    return ss.str();
+}
+
+
 std::string GetVerilogAxi4s_FromLutFilter2d(std::string module_name, std::vector< std::shared_ptr< bb::Filter2d<float, float> > > layers)
 {
     std::stringstream ss;
@@ -140,6 +161,409 @@ std::string GetVerilogAxi4s_FromLutFilter2dBit(std::string module_name, std::vec
 
 
 namespace py = pybind11;
+
+
+// -------------------------------------
+//  numpy 連携
+// -------------------------------------
+
+// データ型に対応する numpy の dtype
+py::dtype GetNumpyDtype(int type)
+{
+    switch ( type ) {
+    case BB_TYPE_FP32:   return py::dtype::of<float        >();
+    case BB_TYPE_FP64:   return py::dtype::of<double       >();
+    case BB_TYPE_INT8:   return py::dtype::of<std::int8_t  >();
+    case BB_TYPE_INT16:  return py::dtype::of<std::int16_t >();
+    case BB_TYPE_INT32:  return py::dtype::of<std::int32_t >();
+    case BB_TYPE_INT64:  return py::dtype::of<std::int64_t >();
+    case BB_TYPE_UINT8:  return py::dtype::of<std::uint8_t >();
+    case BB_TYPE_UINT16: return py::dtype::of<std::uint16_t>();
+    case BB_TYPE_UINT32: return py::dtype::of<std::uint32_t>();
+    case BB_TYPE_UINT64: return py::dtype::of<std::uint64_t>();
+    }
+    throw std::invalid_argument("data type has no numpy dtype");
+}
+
+// numpy 側で参照している間、メモリを確保したままにするための保持オブジェクト
+//   書き込みロックを保持している間はリビジョンが毎回更新されたものとして扱われ、
+//   テーブル等のキャッシュが Forward 毎に作り直されるので、既定は読み出し専用で参照する
+template <class BufferType>
+struct NumpyHolder
+{
+    BufferType              buf;
+    bb::Memory::ConstPtr    const_ptr;
+    bb::Memory::Ptr         ptr;
+    void                    *addr = nullptr;
+
+    NumpyHolder(BufferType const &b, bool writable) : buf(b)
+    {
+        if ( writable ) {
+            ptr  = b.LockMemory();
+            addr = ptr.GetAddr();
+        }
+        else {
+            const_ptr = b.LockMemoryConst();
+            addr      = const_cast<void *>(const_ptr.GetAddr());
+        }
+    }
+
+    py::capsule MakeCapsule(void)
+    {
+        return py::capsule(this, [](void *p) { delete reinterpret_cast<NumpyHolder *>(p); });
+    }
+};
+
+// 保持オブジェクトのメモリを参照する numpy 配列を生成
+template <class BufferType>
+py::array MakeNumpyView(BufferType const &buf, bool writable, py::dtype dtype, std::vector<py::ssize_t> const &shape, std::vector<py::ssize_t> const &strides)
+{
+    auto holder = new NumpyHolder<BufferType>(buf, writable);
+    auto base   = holder->MakeCapsule();
+    py::array array(dtype, shape, strides, holder->addr, base);
+    if ( !writable ) {
+        array.attr("flags").attr("writeable") = false;
+    }
+    return array;
+}
+
+// node の shape は先頭が最も速く変化するので numpy の次元とは逆順になる
+void AppendNodeAxes(std::vector<py::ssize_t> &shape, std::vector<py::ssize_t> &strides, bb::indices_t const &node_shape, py::ssize_t stride)
+{
+    std::vector<py::ssize_t> node_strides(node_shape.size());
+    for ( size_t i = 0; i < node_shape.size(); ++i ) {
+        node_strides[i] = stride;
+        stride *= (py::ssize_t)node_shape[i];
+    }
+    for ( size_t i = node_shape.size(); i > 0; --i ) {
+        shape.push_back((py::ssize_t)node_shape[i-1]);
+        strides.push_back(node_strides[i-1]);
+    }
+}
+
+// FrameBuffer のホストメモリを (frame, node...) の numpy 配列としてコピー無しで参照
+py::array FrameBuffer_GetNumpyView(FrameBuffer const &buf, bool writable)
+{
+    if ( buf.GetType() == BB_TYPE_BIT ) {
+        throw std::invalid_argument("Bit FrameBuffer is packed. use packed_view()");
+    }
+
+    auto dtype  = GetNumpyDtype(buf.GetType());
+
+    std::vector<py::ssize_t> shape;
+    std::vector<py::ssize_t> strides;
+    shape.push_back((py::ssize_t)buf.GetFrameSize());
+    strides.push_back((py::ssize_t)dtype.itemsize());
+    AppendNodeAxes(shape, strides, buf.GetShape(), (py::ssize_t)buf.GetFrameStride());
+
+    return MakeNumpyView(buf, writable, dtype, shape, strides);
+}
+
+// Bit 型 FrameBuffer のパッキングされたメモリを (node..., frame_stride) の uint8 配列として参照
+// frame 番目のビットは frame/8 バイト目の (frame%8) ビット目
+py::array FrameBuffer_GetPackedView(FrameBuffer const &buf, bool writable)
+{
+    if ( buf.GetType() != BB_TYPE_BIT ) {
+        throw std::invalid_argument("packed_view() is only for Bit FrameBuffer");
+    }
+
+    std::vector<py::ssize_t> shape;
+    std::vector<py::ssize_t> strides;
+    AppendNodeAxes(shape, strides, buf.GetShape(), (py::ssize_t)buf.GetFrameStride());
+    shape.push_back((py::ssize_t)buf.GetFrameStride());
+    strides.push_back(1);
+
+    return MakeNumpyView(buf, writable, py::dtype::of<std::uint8_t>(), shape, strides);
+}
+
+// numpy 配列(先頭次元が frame)から offset フレーム目以降を設定
+void FrameBuffer_SetNumpy(FrameBuffer &buf, py::array_t<float, py::array::c_style | py::array::forcecast> data, bb::index_t offset)
+{
+    auto info = data.request();
+    if ( info.ndim < 1 || offset < 0 || offset + buf.GetFrameSize() > (bb::index_t)info.shape[0] ) {
+        throw std::out_of_range("frame size mismatch");
+    }
+    if ( (bb::index_t)(info.size / std::max(info.shape[0], (py::ssize_t)1)) != buf.GetNodeSize() ) {
+        throw std::invalid_argument("node size mismatch");
+    }
+
+    buf.SetArray<float>((float const *)info.ptr + offset * buf.GetNodeSize());
+}
+
+// numpy 配列(先頭次元が frame)へのコピー
+py::array_t<float> FrameBuffer_GetNumpy(FrameBuffer const &buf)
+{
+    std::vector<py::ssize_t> shape;
+    shape.push_back((py::ssize_t)buf.GetFrameSize());
+    auto node_shape = buf.GetShape();
+    for ( size_t i = node_shape.size(); i > 0; --i ) {
+        shape.push_back((py::ssize_t)node_shape[i-1]);
+    }
+
+    py::array_t<float> data(shape);
+    buf.GetArray<float>(data.mutable_data());
+    return data;
+}
+
+// numpy 配列(先頭次元が frame)から FrameBuffer を生成
+FrameBuffer FrameBuffer_FromNumpy(py::array_t<float, py::array::c_style | py::array::forcecast> data, int data_type, bool host_only)
+{
+    auto info = data.request();
+    if ( info.ndim < 1 ) {
+        throw std::invalid_argument("array must have frame axis");
+    }
+
+    bb::indices_t node_shape;
+    for ( py::ssize_t i = info.ndim - 1; i > 0; --i ) {
+        node_shape.push_back((bb::index_t)info.shape[i]);
+    }
+    if ( node_shape.empty() ) {
+        node_shape.push_back(1);
+    }
+
+    FrameBuffer buf((bb::index_t)info.shape[0], node_shape, data_type, host_only);
+    buf.SetArray<float>((float const *)info.ptr);
+    return buf;
+}
+
+// Tensor のホストメモリを numpy 配列としてコピー無しで参照
+py::array Tensor_GetNumpyView(Tensor const &tensor, bool writable)
+{
+    auto dtype  = GetNumpyDtype(tensor.GetType());
+
+    std::vector<py::ssize_t> shape;
+    std::vector<py::ssize_t> strides;
+    AppendNodeAxes(shape, strides, tensor.GetShape(), (py::ssize_t)dtype.itemsize());
+
+    return MakeNumpyView(tensor, writable, dtype, shape, strides);
+}
+
+
+using NumpyFloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+// numpy 配列(先頭次元がデータ数)を TrainData の形式に変換
+std::vector< std::vector<float> > NumpyToVectors(py::array_t<float, py::array::c_style | py::array::forcecast> data, bb::indices_t &shape)
+{
+    auto info = data.request();
+    if ( info.ndim < 1 ) {
+        throw std::invalid_argument("array must have sample axis");
+    }
+
+    shape.clear();
+    for ( py::ssize_t i = info.ndim - 1; i > 0; --i ) {
+        shape.push_back((bb::index_t)info.shape[i]);
+    }
+    if ( shape.empty() ) {
+        shape.push_back(1);
+    }
+
+    auto    n    = (bb::index_t)info.shape[0];
+    auto    size = bb::GetShapeSize(shape);
+    auto    src  = (float const *)info.ptr;
+    std::vector< std::vector<float> > vec(n);
+    #pragma omp parallel for
+    for ( bb::index_t i = 0; i < n; ++i ) {
+        vec[i].assign(src + i * size, src + (i + 1) * size);
+    }
+    return vec;
+}
+
+py::array_t<float> VectorsToNumpy(std::vector< std::vector<float> > const &vec, bb::indices_t const &shape)
+{
+    std::vector<py::ssize_t> np_shape;
+    np_shape.push_back((py::ssize_t)vec.size());
+    for ( size_t i = shape.size(); i > 0; --i ) {
+        np_shape.push_back((py::ssize_t)shape[i-1]);
+    }
+
+    auto    size = bb::GetShapeSize(shape);
+    for ( auto const &v : vec ) {
+        if ( (bb::index_t)v.size() != size ) {
+            throw std::invalid_argument("data size mismatch");
+        }
+    }
+
+    py::array_t<float> data(np_shape);
+    auto    dst  = data.mutable_data();
+    #pragma omp parallel for
+    for ( bb::index_t i = 0; i < (bb::index_t)vec.size(); ++i ) {
+        std::copy(vec[i].begin(), vec[i].end(), dst + i * size);
+    }
+    return data;
+}
+
+// TrainData の numpy 配列
+//   from_numpy で生成した TrainData は配列をコピーせずに Python 側の属性として保持し、
+//   vector 形式はそれを必要とする C++ の Runner に渡す時に初めて作る
+//   vector 形式の TrainData は最初の to_numpy で変換した配列を保持して使い回す
+static char const * const TRAIN_DATA_NUMPY_ATTR = "_numpy_arrays";
+
+bool TrainData_HasNumpy(py::object const &self)
+{
+    return py::hasattr(self, TRAIN_DATA_NUMPY_ATTR) && !self.attr(TRAIN_DATA_NUMPY_ATTR).is_none();
+}
+
+py::tuple TrainData_ToNumpy(py::object self)
+{
+    if ( !TrainData_HasNumpy(self) ) {
+        auto &td = self.cast<TrainData &>();
+        self.attr(TRAIN_DATA_NUMPY_ATTR) = py::make_tuple(
+                    VectorsToNumpy(td.x_train, td.x_shape),
+                    VectorsToNumpy(td.t_train, td.t_shape),
+                    VectorsToNumpy(td.x_test,  td.x_shape),
+                    VectorsToNumpy(td.t_test,  td.t_shape));
+    }
+    return self.attr(TRAIN_DATA_NUMPY_ATTR).cast<py::tuple>();
+}
+
+// numpy 配列だけを持つ TrainData に vector 形式のデータを用意する
+TrainData &TrainData_Materialize(py::object self)
+{
+    auto &td = self.cast<TrainData &>();
+    if ( TrainData_HasNumpy(self) && td.x_train.empty() ) {
+        auto arrays = self.attr(TRAIN_DATA_NUMPY_ATTR).cast<py::tuple>();
+        bb::indices_t shape;
+        td.x_train = NumpyToVectors(arrays[0].cast<NumpyFloatArray>(), shape);
+        td.t_train = NumpyToVectors(arrays[1].cast<NumpyFloatArray>(), shape);
+        td.x_test  = NumpyToVectors(arrays[2].cast<NumpyFloatArray>(), shape);
+        td.t_test  = NumpyToVectors(arrays[3].cast<NumpyFloatArray>(), shape);
+    }
+    return td;
+}
+
+// データ数の配列の形状 (numpy の次元の逆順)
+bb::indices_t NumpyNodeShape(py::buffer_info const &info)
+{
+    bb::indices_t shape;
+    for ( py::ssize_t i = info.ndim - 1; i > 0; --i ) {
+        shape.push_back((bb::index_t)info.shape[i]);
+    }
+    if ( shape.empty() ) {
+        shape.push_back(1);
+    }
+    return shape;
+}
+
+py::object TrainData_FromNumpy(
+            py::array_t<float, py::array::c_style | py::array::forcecast> x_train,
+            py::array_t<float, py::array::c_style | py::array::forcecast> t_train,
+            py::array_t<float, py::array::c_style | py::array::forcecast> x_test,
+            py::array_t<float, py::array::c_style | py::array::forcecast> t_test)
+{
+    for ( auto const &a : {x_train, t_train, x_test, t_test} ) {
+        if ( a.ndim() < 1 ) {
+            throw std::invalid_argument("array must have sample axis");
+        }
+    }
+
+    TrainData   td;
+    td.x_shape = NumpyNodeShape(x_train.request());
+    td.t_shape = NumpyNodeShape(t_train.request());
+    if ( NumpyNodeShape(x_test.request()) != td.x_shape || NumpyNodeShape(t_test.request()) != td.t_shape ) {
+        throw std::invalid_argument("train and test shape mismatch");
+    }
+
+    // float32 の C 配列ならそのまま保持される (forcecast は必要な時だけ変換する)
+    py::object self = py::cast(std::move(td));
+    self.attr(TRAIN_DATA_NUMPY_ATTR) = py::make_tuple(x_train, t_train, x_test, t_test);
+    return self;
+}
+
+// vector 形式のデータの取得と設定 (設定すると保持している numpy 配列は破棄する)
+template <std::vector< std::vector<float> > TrainData::*member, int index>
+py::object TrainData_GetData(py::object self)
+{
+    auto &td = self.cast<TrainData &>();
+    if ( (td.*member).empty() && TrainData_HasNumpy(self) ) {
+        return self.attr(TRAIN_DATA_NUMPY_ATTR).cast<py::tuple>()[index];
+    }
+    return py::cast(td.*member);
+}
+
+template <std::vector< std::vector<float> > TrainData::*member>
+void TrainData_SetData(py::object self, std::vector< std::vector<float> > const &data)
+{
+    auto &td = TrainData_Materialize(self);
+    td.*member = data;
+    self.attr(TRAIN_DATA_NUMPY_ATTR) = py::none();
+}
+
+bool TrainData_Empty(py::object self)
+{
+    if ( TrainData_HasNumpy(self) ) {
+        auto arrays = self.attr(TRAIN_DATA_NUMPY_ATTR).cast<py::tuple>();
+        for ( auto a : arrays ) {
+            if ( py::len(a) == 0 ) { return true; }
+        }
+        return false;
+    }
+    return self.cast<TrainData &>().empty();
+}
+
+void Runner_Fitting(Runner &runner, py::object td, bb::index_t epoch_size, bb::index_t batch_size)
+{
+    auto &data = TrainData_Materialize(td);
+    py::gil_scoped_release release;
+    runner.Fitting(data, epoch_size, batch_size);
+}
+
+
+// 学習・推論の呼び出し
+//   レイヤーは train=false の Forward でも状態を書き換えるので、モデルの排他を取ってから実行する
+//   GIL を持ったまま排他を待つと、排他を持つ側が GIL を待ってデッドロックするので先に解放する
+FrameBuffer Model_Forward(Model &model, FrameBuffer x_buf, bool train)
+{
+    py::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(model.GetExecMutex());
+    return model.Forward(x_buf, train);
+}
+
+FrameBuffer Model_Backward(Model &model, FrameBuffer dy_buf)
+{
+    py::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(model.GetExecMutex());
+    return model.Backward(dy_buf);
+}
+
+// 推論専用の呼び出し
+//   train=false で Forward し、その間は GIL を解放する
+//   forward/backward と同じモデルの排他を取るので同じネットへの呼び出しは直列化される
+//   (並列に処理したい場合はスレッド毎にネットを用意する。別々のネットは並列に実行できる)
+py::array_t<float> Model_Predict(std::shared_ptr<Model> model, py::array_t<float, py::array::c_style | py::array::forcecast> x, int data_type)
+{
+    auto x_buf = FrameBuffer_FromNumpy(x, data_type, false);
+
+    // 出力バッファはネットが使い回すので、排他中にコピーしておく
+    std::vector<py::ssize_t> shape;
+    std::vector<float>       y_vec;
+    {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(model->GetExecMutex());
+
+        if ( model->GetInputShape().empty() ) {
+            model->SetInputShape(x_buf.GetShape());
+        }
+        if ( bb::GetShapeSize(model->GetInputShape()) != x_buf.GetNodeSize() ) {
+            throw std::invalid_argument("input shape mismatch");
+        }
+
+        auto y_buf = model->Forward(x_buf, false);
+
+        shape.push_back((py::ssize_t)y_buf.GetFrameSize());
+        auto node_shape = y_buf.GetShape();
+        for ( size_t i = node_shape.size(); i > 0; --i ) {
+            shape.push_back((py::ssize_t)node_shape[i-1]);
+        }
+        y_vec.resize((size_t)(y_buf.GetFrameSize() * y_buf.GetNodeSize()));
+        y_buf.GetArray<float>(y_vec.data());
+    }
+
+    py::array_t<float> y(shape);
+    std::copy(y_vec.begin(), y_vec.end(), y.mutable_data());
+    return y;
+}
+
+
 PYBIND11_MODULE(core, m) {
     m.doc() = "binarybrain plugin";
 
@@ -165,7 +589,12 @@ PYBIND11_MODULE(core, m) {
     m.attr("BB_BORDER_WRAP")        = BB_BORDER_WRAP;
 
 
-    py::class_< Tensor >(m, "Tensor");
+    py::class_< Tensor >(m, "Tensor")
+        .def("get_type",  &Tensor::GetType)
+        .def("get_shape", &Tensor::GetShape)
+        .def("numpy",     &Tensor_GetNumpyView,
+                "zero-copy numpy view of host memory (read-only unless writable=True)",
+                py::arg("writable") = false);
 
     py::class_< FrameBuffer >(m, "FrameBuffer")
         .def(py::init< bool >(),
@@ -184,9 +613,33 @@ PYBIND11_MODULE(core, m) {
         .def("set_data",  (void (FrameBuffer::*)(std::vector< std::vector<float> > const &, bb::index_t))&FrameBuffer::SetVector<float>,
                 "set data",
                 py::arg("data"),
-                py::arg("offset") = 0);
+                py::arg("offset") = 0)
+        .def("get_type",       &FrameBuffer::GetType)
+        .def("get_frame_size", &FrameBuffer::GetFrameSize)
+        .def("get_node_size",  &FrameBuffer::GetNodeSize)
+        .def("get_shape",      &FrameBuffer::GetShape)
+        .def("set_numpy",      &FrameBuffer_SetNumpy,
+                "set data from numpy array (frame, node...)",
+                py::arg("data"),
+                py::arg("offset") = 0)
+        .def("get_numpy",      &FrameBuffer_GetNumpy,
+                "copy to numpy array (frame, node...)")
+        .def("numpy",          &FrameBuffer_GetNumpyView,
+                "zero-copy numpy view (frame, node...) of host memory (read-only unless writable=True)",
+                py::arg("writable") = false)
+        .def("packed_view",    &FrameBuffer_GetPackedView,
+                "zero-copy uint8 view (node..., frame_stride) of packed Bit data (read-only unless writable=True)",
+                py::arg("writable") = false)
+        .def_static("from_numpy", &FrameBuffer_FromNumpy,
+                "create from numpy array (frame, node...)",
+                py::arg("data"),
+                py::arg("data_type") = BB_TYPE_FP32,
+                py::arg("host_only") = false);
 
-    py::class_< Variables, std::shared_ptr<Variables> >(m, "Variables");
+    py::class_< Variables, std::shared_ptr<Variables> >(m, "Variables")
+        .def("__len__",     &Variables::GetSize)
+        .def("__getitem__", (Tensor &(Variables::*)(bb::index_t))&Variables::operator[],
+                py::return_value_policy::reference_internal);
 
     // Models
     py::class_< Model, std::shared_ptr<Model> >(m, "Model")
@@ -199,10 +652,13 @@ PYBIND11_MODULE(core, m) {
         .def("get_output_shape", &Model::GetOutputShape)
         .def("get_parameters", &Model::GetParameters)
         .def("get_gradients", &Model::GetGradients)
-        .def("forward",  &Model::Forward, "Forward",
+        .def("forward",  &Model_Forward, "Forward",
                 py::arg("x_buf"),
                 py::arg("train") = true)
-        .def("backward", &Model::Backward, "Backward")
+        .def("backward", &Model_Backward, "Backward")
+        .def("predict",  &Model_Predict, "inference from numpy array (frame, node...), serialized per model",
+                py::arg("x"),
+                py::arg("data_type") = BB_TYPE_FP32)
         .def("send_command",  &Model::SendCommand, "SendCommand",
                 py::arg("command"),
                 py::arg("send_to") = "all");
@@ -421,16 +877,36 @@ Returns
             py::arg("b")    = 1.0f,
             py::arg("seed") = 1);
 
+    py::class_< PhiloxNormalDistributionGenerator, ValueGenerator, std::shared_ptr<PhiloxNormalDistributionGenerator> >(m, "PhiloxNormalDistributionGenerator")
+        .def_static("create", &PhiloxNormalDistributionGenerator::Create,
+            py::arg("mean")   = 0.0f,
+            py::arg("stddev") = 1.0f,
+            py::arg("seed")   = 1);
+    
+    py::class_< PhiloxUniformDistributionGenerator, ValueGenerator, std::shared_ptr<PhiloxUniformDistributionGenerator> >(m, "PhiloxUniformDistributionGenerator")
+        .def_static("create", &PhiloxUniformDistributionGenerator::Create,
+            py::arg("a")    = 0.0f,
+            py::arg("b")    = 1.0f,
+            py::arg("seed") = 1);
+
 
     // TrainData
-    py::class_< TrainData >(m, "TrainData")
+    py::class_< TrainData >(m, "TrainData", py::dynamic_attr())
         .def_readwrite("x_shape", &TrainData::x_shape)
         .def_readwrite("t_shape", &TrainData::t_shape)
-        .def_readwrite("x_train", &TrainData::x_train)
-        .def_readwrite("t_train", &TrainData::t_train)
-        .def_readwrite("x_test",  &TrainData::x_test)
-        .def_readwrite("t_test",  &TrainData::t_test)
-        .def("empty", &TrainData::empty);
+        .def_property("x_train", &TrainData_GetData<&TrainData::x_train, 0>, &TrainData_SetData<&TrainData::x_train>)
+        .def_property("t_train", &TrainData_GetData<&TrainData::t_train, 1>, &TrainData_SetData<&TrainData::t_train>)
+        .def_property("x_test",  &TrainData_GetData<&TrainData::x_test,  2>, &TrainData_SetData<&TrainData::x_test>)
+        .def_property("t_test",  &TrainData_GetData<&TrainData::t_test,  3>, &TrainData_SetData<&TrainData::t_test>)
+        .def("empty", &TrainData_Empty)
+        .def("to_numpy", &TrainData_ToNumpy,
+            "numpy arrays (x_train, t_train, x_test, t_test). converted once and kept")
+        .def_static("from_numpy", &TrainData_FromNumpy,
+            "hold numpy arrays without copy",
+            py::arg("x_train"),
+            py::arg("t_train"),
+            py::arg("x_test"),
+            py::arg("t_test"));
 
     // LoadMNIST
     py::class_< LoadMnist >(m, "LoadMnist")
@@ -470,16 +946,18 @@ Returns
             py::arg("write_serial") = false,
             py::arg("initial_evaluation") = false,
             py::arg("seed") = 1)
-        .def("fitting", &Runner::Fitting,
+        .def("fitting", &Runner_Fitting,
             py::arg("td"),
             py::arg("epoch_size"),
             py::arg("batch_size"));
 
     // verilog
-    m.def("get_verilog_from_lut", &GetVerilog_FromLut);
-    m.def("get_verilog_from_lut_bit", &GetVerilog_FromLutBit);
-    m.def("get_verilog_axi4s_from_lut_cnn", &GetVerilogAxi4s_FromLutFilter2d);
-    m.def("get_verilog_axi4s_from_lut_cnn_bit", &GetVerilogAxi4s_FromLutFilter2dBit);
+    m.def("get_verilog_from_lut",               &GetVerilog_FromLut,                 py::call_guard<py::gil_scoped_release>());
+    m.def("get_verilog_from_lut_bit",           &GetVerilog_FromLutBit,              py::call_guard<py::gil_scoped_release>());
+    m.def("get_verilog_optimized_from_lut",     &GetVerilogOptimized_FromLut,        py::arg("module_name"), py::arg("layers"), py::arg("register_depth") = 1, py::call_guard<py::gil_scoped_release>());
+    m.def("get_verilog_optimized_from_lut_bit", &GetVerilogOptimized_FromLutBit,     py::arg("module_name"), py::arg("layers"), py::arg("register_depth") = 1, py::call_guard<py::gil_scoped_release>());
+    m.def("get_verilog_axi4s_from_lut_cnn",     &GetVerilogAxi4s_FromLutFilter2d,    py::call_guard<py::gil_scoped_release>());
+    m.def("get_verilog_axi4s_from_lut_cnn_bit", &GetVerilogAxi4s_FromLutFilter2dBit, py::call_guard<py::gil_scoped_release>());
 }
 
 
@@ -7,6 +7,7 @@ import urllib.request
 import tarfile
 import gzip
 import shutil
+import numpy as np
 
 if 'ipykernel' in sys.modules:
    from tqdm import tqdm_notebook as tqdm
@@ -69,14 +70,20 @@ def calculation(net, x, x_shape, t, t_shape, max_batch_size, min_batch_size=1,
             
             # setup x
             x_buf.resize(mini_batch_size, x_shape)
-            x_buf.set_data(x[index:index+mini_batch_size])
+            if isinstance(x, np.ndarray):
+                x_buf.set_numpy(x, index)
+            else:
+                x_buf.set_data(x[index:index+mini_batch_size])
             
             # forward
             y_buf = net.forward(x_buf, train)
             
             # setup t
             t_buf.resize(mini_batch_size, t_shape)
-            t_buf.set_data(t[index:index+mini_batch_size])
+            if isinstance(t, np.ndarray):
+                t_buf.set_numpy(t, index)
+            else:
+                t_buf.set_data(t[index:index+mini_batch_size])
             
             # calc loss
             if loss is not None:
@@ -139,6 +146,9 @@ class Runner:
             mini_batch_size (int): mini batch size
         """
         
+        # numpy arrays held by td (no copy for TrainData.from_numpy, converted once otherwise)
+        x_train, t_train, x_test, t_test = td.to_numpy()
+        
         log_file_name  = self.name + '_log.txt'
         json_file_name = self.name + '_net.json'
         epoch = 0
@@ -155,7 +165,7 @@ class Runner:
         with open(log_file_name, 'a') as log_file:
             # initial evaluation
             if init_eval:
-                calculation(self.net, td.x_test, td.x_shape, td.t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
+                calculation(self.net, x_test, td.x_shape, t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
                 print('[initial] %s=%f loss=%f' % (self.metrics.get_metrics_string(), self.metrics.get_metrics(), self.loss.get_loss()))
             
             # loop
@@ -164,7 +174,7 @@ class Runner:
                 epoch = epoch + 1
                 
                 # train
-                calculation(self.net, td.x_train, td.x_shape, td.t_train, td.t_shape, mini_batch_size, mini_batch_size,
+                calculation(self.net, x_train, td.x_shape, t_train, td.t_shape, mini_batch_size, mini_batch_size,
                             self.metrics, self.loss, self.optimizer, train=True, print_loss=True, print_metrics=True)
                 
                 # write file
@@ -174,7 +184,7 @@ class Runner:
                         print('[write error] %s'% json_file_name)
                 
                 # evaluation
-                calculation(self.net, td.x_test, td.x_shape, td.t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
+                calculation(self.net, x_test, td.x_shape, t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
                 output_text = 'epoch=%d %s=%f loss=%f' % (epoch, self.metrics.get_metrics_string(), self.metrics.get_metrics(), self.loss.get_loss())
                 print(output_text)
                 print(output_text, file=log_file)
@@ -187,5 +197,6 @@ class Runner:
             mini_batch_size (int): mini batch size
         """
         
-        calculation(self.net, td.x_test, td.x_shape, td.t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
+        _, _, x_test, t_test = td.to_numpy()
+        calculation(self.net, x_test, td.x_shape, t_test, td.t_shape, mini_batch_size, 1, self.metrics, self.loss)
         print('%s=%f loss=%f' % (self.metrics.get_metrics_string(), self.metrics.get_metrics(), self.loss.get_loss()))
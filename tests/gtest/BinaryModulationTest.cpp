@@ -0,0 +1,55 @@
+﻿#include <stdio.h>
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "bb/BinaryModulation.h"
+#include "bb/DenseAffine.h"
+
+
+TEST(BinaryModulationTest, testBinaryModulation_Anytime)
+{
+    int const frame_size      = 10;
+    int const input_size      = 4;
+    int const output_size     = 3;
+    int const modulation_size = 16;
+
+    auto affine = bb::DenseAffine<>::Create(output_size);
+    auto mod    = bb::BinaryModulation<float, float>::Create(affine, modulation_size, modulation_size);
+    mod->SetInputShape({input_size});
+
+    bb::FrameBuffer x_buf(frame_size, {input_size}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < input_size; ++node ) {
+            x_buf.SetFP32(frame, node, (float)((frame * 7 + node * 3) % 11) / 10.0f);
+        }
+    }
+
+    auto y_exp = mod->Forward(x_buf, false);
+
+    // 打ち切らなければ通常の推論と一致
+    std::vector<bb::index_t> used;
+    auto y_full = mod->ForwardAnytime(x_buf, 4, 1.0e9f, &used);
+    ASSERT_EQ(frame_size, (int)used.size());
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        EXPECT_EQ(modulation_size, used[frame]);
+        for ( int node = 0; node < output_size; ++node ) {
+            EXPECT_NEAR(y_exp.GetFP32(frame, node), y_full.GetFP32(frame, node), 1.0e-4);
+        }
+    }
+
+    // confidence 0 なら1回目で打ち切り
+    mod->ForwardAnytime(x_buf, 4, 0.0f, &used);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        EXPECT_EQ(4, used[frame]);
+    }
+
+    // 通常の推論は元に戻っている
+    auto y_after = mod->Forward(x_buf, false);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < output_size; ++node ) {
+            EXPECT_EQ(y_exp.GetFP32(frame, node), y_after.GetFP32(frame, node));
+        }
+    }
+}
+
@@ -1,5 +1,6 @@
 ﻿#include <stdio.h>
 #include <iostream>
+#include <random>
 #include "gtest/gtest.h"
 #include "bb/BinaryToReal.h"
 #include "bb/NormalDistributionGenerator.h"
@@ -116,6 +117,97 @@ TEST(BinaryToRealTest, testBinaryToReal_fp32)
 #endif
 
 
+void BinaryToRealTest_Bit(int node_mux_size, int modulation_size, int y_node_size, int y_frame_size)
+{
+    int const x_node_size  = y_node_size  * node_mux_size;
+    int const x_frame_size = y_frame_size * modulation_size;
+
+    auto bin2real_bit  = bb::BinaryToReal<bb::Bit, float>::Create(modulation_size, bb::indices_t({y_node_size}));
+    auto bin2real_fp32 = bb::BinaryToReal<float, float>::Create(modulation_size, bb::indices_t({y_node_size}));
+
+    bb::FrameBuffer x_bit (x_frame_size, {x_node_size}, BB_TYPE_BIT);
+    bb::FrameBuffer x_fp32(x_frame_size, {x_node_size}, BB_TYPE_FP32);
+
+    std::mt19937_64 mt(1);
+    for ( int frame = 0; frame < x_frame_size; ++frame) {
+        for ( int node = 0; node < x_node_size; ++node ) {
+            bool v = (mt() % 3 == 0);
+            x_bit.SetBit(frame, node, v);
+            x_fp32.SetFP32(frame, node, v ? 1.0f : 0.0f);
+        }
+    }
+
+    auto y_bit  = bin2real_bit->Forward(x_bit);
+    auto y_fp32 = bin2real_fp32->Forward(x_fp32);
+
+    EXPECT_EQ(y_frame_size, y_bit.GetFrameSize());
+    for ( int frame = 0; frame < y_frame_size; ++frame) {
+        for ( int node = 0; node < y_node_size; ++node ) {
+            EXPECT_FLOAT_EQ(y_fp32.GetFP32(frame, node), y_bit.GetFP32(frame, node));
+        }
+    }
+}
+
+TEST(BinaryToRealTest, testBinaryToReal_BitPopcnt)
+{
+    BinaryToRealTest_Bit(3, 7,   5, 37);
+    BinaryToRealTest_Bit(1, 64,  3, 5);
+    BinaryToRealTest_Bit(2, 300, 4, 3);
+}
+
+TEST(BinaryToRealTest, testBinaryToReal_BitWideOutput)
+{
+    // 出力ノードが入力ノードより多い場合、入力の無い出力は 0
+    int const x_node_size     = 3;
+    int const y_node_size     = 5;
+    int const modulation_size = 7;
+    int const y_frame_size    = 9;
+    int const x_frame_size    = y_frame_size * modulation_size;
+
+    auto bin2real_bit  = bb::BinaryToReal<bb::Bit, float>::Create(modulation_size, bb::indices_t({y_node_size}));
+    auto bin2real_fp32 = bb::BinaryToReal<float, float>::Create(modulation_size, bb::indices_t({y_node_size}));
+
+    bb::FrameBuffer x_bit (x_frame_size, {x_node_size}, BB_TYPE_BIT);
+    bb::FrameBuffer x_fp32(x_frame_size, {x_node_size}, BB_TYPE_FP32);
+
+    std::mt19937_64 mt(2);
+    for ( int frame = 0; frame < x_frame_size; ++frame) {
+        for ( int node = 0; node < x_node_size; ++node ) {
+            bool v = (mt() % 2 == 0);
+            x_bit.SetBit(frame, node, v);
+            x_fp32.SetFP32(frame, node, v ? 1.0f : 0.0f);
+        }
+    }
+
+    auto y_bit  = bin2real_bit->Forward(x_bit);
+    auto y_fp32 = bin2real_fp32->Forward(x_fp32);
+
+    for ( int frame = 0; frame < y_frame_size; ++frame) {
+        for ( int node = 0; node < y_node_size; ++node ) {
+            EXPECT_FLOAT_EQ(y_fp32.GetFP32(frame, node), y_bit.GetFP32(frame, node));
+            if ( node >= x_node_size ) {
+                EXPECT_EQ(0.0f, y_bit.GetFP32(frame, node));
+                EXPECT_EQ(0.0f, y_fp32.GetFP32(frame, node));
+            }
+        }
+    }
+
+    // 入力は 1対1 で対応するので勾配は変調数で割るだけ
+    bb::FrameBuffer dy_buf(y_frame_size, {y_node_size}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < y_frame_size; ++frame) {
+        for ( int node = 0; node < y_node_size; ++node ) {
+            dy_buf.SetFP32(frame, node, (float)(frame * y_node_size + node + 1));
+        }
+    }
+    auto dx_buf = bin2real_fp32->Backward(dy_buf);
+    for ( int frame = 0; frame < x_frame_size; ++frame) {
+        for ( int node = 0; node < x_node_size; ++node ) {
+            EXPECT_FLOAT_EQ(dy_buf.GetFP32(frame / modulation_size, node) / modulation_size, dx_buf.GetFP32(frame, node));
+        }
+    }
+}
+
+
 #ifdef BB_WITH_CUDA
 
 TEST(BinaryToRealTest, testBinaryToRealTest_cmp)
@@ -0,0 +1,119 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "bb/BitPlane.h"
+#include "bb/RealToBinary.h"
+#include "bb/BinaryToReal.h"
+#include "bb/MaxPooling.h"
+
+
+TEST(BitPlaneTest, testBitPlane_EncodeDecode)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const node_size  = 7;
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(-0.2f, 1.2f);
+
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    auto b_buf = bb::BitPlane_Encode<float>(x_buf, 3, 0.0f, 1.0f);
+    EXPECT_EQ(BB_TYPE_BIT, b_buf.GetType());
+    EXPECT_EQ(bb::indices_t({node_size * 3}), b_buf.GetShape());
+
+    auto y_buf = bb::BitPlane_Decode<float>(b_buf, 3, 0.0f, 1.0f);
+    EXPECT_EQ(bb::indices_t({node_size}), y_buf.GetShape());
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            float x = std::min(1.0f, std::max(0.0f, x_buf.GetFP32(frame, node)));
+            int   q = (int)std::floor(x * 7.0f + 0.5f);
+            EXPECT_NEAR((float)q / 7.0f, y_buf.GetFP32(frame, node), 1.0e-6f);
+
+            // プレーンは LSB から
+            for ( int p = 0; p < 3; ++p ) {
+                EXPECT_EQ(((q >> p) & 1) != 0, (bool)b_buf.GetBit(frame, p * node_size + node));
+            }
+        }
+    }
+}
+
+
+TEST(BitPlaneTest, testBitPlane_MaxPooling)
+{
+    bb::index_t const frame_size = 260;
+    bb::index_t const w = 5, h = 4, c = 2;
+
+    std::mt19937_64 mt(2);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    bb::FrameBuffer x_buf(frame_size, {w, h, c}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < w * h * c; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    bb::RealToBinary<bb::Bit, float>::create_t r2b_create;
+    r2b_create.bit_plane_size = 4;
+    auto r2b = bb::RealToBinary<bb::Bit, float>::Create(r2b_create);
+
+    bb::MaxPooling<bb::Bit, float>::create_t pol_create;
+    pol_create.filter_h_size  = 2;
+    pol_create.filter_w_size  = 2;
+    pol_create.bit_plane_size = 4;
+    auto pol = bb::MaxPooling<bb::Bit, float>::Create(pol_create);
+
+    bb::BinaryToReal<bb::Bit, float>::create_t b2r_create;
+    b2r_create.bit_plane_size = 4;
+    auto b2r = bb::BinaryToReal<bb::Bit, float>::Create(b2r_create);
+
+    EXPECT_EQ(bb::indices_t({w, h, 4 * c}), r2b->SetInputShape({w, h, c}));
+    EXPECT_EQ(bb::indices_t({3, 2, 4 * c}), pol->SetInputShape({w, h, 4 * c}));
+    EXPECT_EQ(bb::indices_t({3, 2, c}),     b2r->SetInputShape({3, 2, 4 * c}));
+
+    auto b_buf = r2b->Forward(x_buf);
+    EXPECT_EQ(BB_TYPE_BIT, b_buf.GetType());
+    EXPECT_EQ(frame_size, b_buf.GetFrameSize());
+
+    auto p_buf = pol->Forward(b_buf);
+    auto y_buf = b2r->Forward(p_buf);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t cc = 0; cc < c; ++cc ) {
+            for ( bb::index_t y = 0; y < 2; ++y ) {
+                for ( bb::index_t x = 0; x < 3; ++x ) {
+                    int q_max = 0;
+                    for ( bb::index_t iy = y * 2; iy < std::min(h, y * 2 + 2); ++iy ) {
+                        for ( bb::index_t ix = x * 2; ix < std::min(w, x * 2 + 2); ++ix ) {
+                            float v = x_buf.GetFP32(frame, (cc * h + iy) * w + ix);
+                            q_max = std::max(q_max, (int)std::floor(v * 15.0f + 0.5f));
+                        }
+                    }
+                    EXPECT_NEAR((float)q_max / 15.0f, y_buf.GetFP32(frame, (cc * 2 + y) * 3 + x), 1.0e-6f);
+                }
+            }
+        }
+    }
+
+    // 勾配は最大値の入力の全プレーンへ
+    bb::FrameBuffer dy_buf(frame_size, {3, 2, c}, BB_TYPE_FP32);
+    dy_buf.FillZero();
+    dy_buf.SetFP32(0, 0, 1.0f);
+    auto dp_buf = b2r->Backward(dy_buf);
+    EXPECT_EQ(bb::indices_t({3, 2, 4 * c}), dp_buf.GetShape());
+    EXPECT_NEAR(8.0f / 15.0f, dp_buf.GetFP32(0, 3 * (3 * 2 * c)), 1.0e-6f);
+    auto db_buf = pol->Backward(dp_buf);
+    auto dx_buf = r2b->Backward(db_buf);
+    EXPECT_EQ(bb::indices_t({w, h, c}), dx_buf.GetShape());
+}
+
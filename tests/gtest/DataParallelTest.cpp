@@ -0,0 +1,207 @@
+﻿#include <stdio.h>
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "bb/DenseAffine.h"
+#include "bb/BatchNormalization.h"
+#include "bb/DataParallel.h"
+#include "bb/Manager.h"
+
+
+TEST(DataParallelTest, testDataParallel_Gradients)
+{
+    int const frame_size = 32;
+    int const input_size = 5;
+
+    auto net0 = bb::DenseAffine<>::Create(3);
+    auto net1 = bb::DenseAffine<>::Create(3);
+    auto ref  = bb::DenseAffine<>::Create(3);
+    net0->SetInputShape({input_size});
+    net1->SetInputShape({input_size});
+    ref->SetInputShape({input_size});
+
+    auto dp = bb::DataParallel::Create(net0, {net1});
+    dp->Broadcast();
+
+    {
+        std::stringstream ss;
+        net0->Save(ss);
+        ref->Load(ss);
+    }
+
+    std::mt19937_64 mt(1);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {input_size}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < input_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    // 前半/後半を複製に分けて計算
+    auto y_bufs = dp->Forward({x_buf.GetFrameRangeView(0, frame_size/2), x_buf.GetFrameRangeView(frame_size/2, frame_size/2)});
+    ASSERT_EQ(2, (int)y_bufs.size());
+    dp->Backward(y_bufs);
+    dp->ReduceGradients();
+
+    // 全フレームを1つのネットで計算
+    auto y_buf = ref->Forward(x_buf);
+    ref->Backward(y_buf);
+
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < 3; ++node ) {
+            EXPECT_NEAR(y_buf.GetFP32(frame, node), y_bufs[frame / (frame_size/2)].GetFP32(frame % (frame_size/2), node), 1.0e-5);
+        }
+    }
+
+    {
+        auto dW_exp = ref->lock_dW_const();
+        auto db_exp = ref->lock_db_const();
+        auto dW0    = net0->lock_dW_const();
+        auto db0    = net0->lock_db_const();
+        auto dW1    = net1->lock_dW_const();
+        auto db1    = net1->lock_db_const();
+        for ( int i = 0; i < 3; ++i ) {
+            for ( int j = 0; j < input_size; ++j ) {
+                EXPECT_NEAR(dW_exp(i, j), dW0(i, j), 1.0e-4);
+                EXPECT_EQ(0.0f, dW1(i, j));
+            }
+            EXPECT_NEAR(db_exp(i), db0(i), 1.0e-4);
+            EXPECT_EQ(0.0f, db1(i));
+        }
+    }
+
+    // パラメータ同期
+    {
+        auto W0 = net0->lock_W();
+        W0(1, 2) = 123.0f;
+    }
+    dp->SyncParameters();
+    {
+        auto W1 = net1->lock_W_const();
+        EXPECT_EQ(123.0f, W1(1, 2));
+    }
+}
+
+
+TEST(DataParallelTest, testDataParallel_Statistics)
+{
+    int const frame_size = 16;
+
+    bb::BatchNormalization<float>::create_t create;
+    auto bn0 = bb::BatchNormalization<float>::Create(create);
+    auto bn1 = bb::BatchNormalization<float>::Create(create);
+    bn0->SetInputShape({2});
+    bn1->SetInputShape({2});
+
+    auto dp = bb::DataParallel::Create(bn0, {bn1});
+    dp->Broadcast();
+
+    bb::FrameBuffer x0_buf(frame_size, {2}, BB_TYPE_FP32);
+    bb::FrameBuffer x1_buf(frame_size, {2}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        x0_buf.SetFP32(frame, 0, (float)(frame % 2) + 1.0f);
+        x0_buf.SetFP32(frame, 1, (float)(frame % 2) + 5.0f);
+        x1_buf.SetFP32(frame, 0, (float)(frame % 2) + 3.0f);
+        x1_buf.SetFP32(frame, 1, (float)(frame % 2) - 1.0f);
+    }
+
+    dp->Forward({x0_buf, x1_buf});
+
+    float mean0_0, mean0_1, mean1_0, mean1_1;
+    {
+        auto m0 = bn0->lock_mean_const();
+        auto m1 = bn1->lock_mean_const();
+        mean0_0 = m0(0); mean0_1 = m0(1);
+        mean1_0 = m1(0); mean1_1 = m1(1);
+    }
+    EXPECT_NE(mean0_0, mean1_0);
+
+    float var0_0, var0_1, var1_0, var1_1;
+    {
+        auto v0 = bn0->lock_var_const();
+        auto v1 = bn1->lock_var_const();
+        var0_0 = v0(0); var0_1 = v0(1);
+        var1_0 = v1(0); var1_1 = v1(1);
+    }
+
+    dp->ReduceStatistics(2);
+
+    {
+        auto m0 = bn0->lock_mean_const();
+        auto m1 = bn1->lock_mean_const();
+        EXPECT_NEAR((mean0_0 + mean1_0) / 2, m0(0), 1.0e-5);
+        EXPECT_NEAR((mean0_1 + mean1_1) / 2, m0(1), 1.0e-5);
+        EXPECT_EQ(m0(0), m1(0));
+        EXPECT_EQ(m0(1), m1(1));
+
+        // 分散は複製内の分散の平均 + 複製間の平均のばらつき
+        float mean_0 = (mean0_0 + mean1_0) / 2;
+        float mean_1 = (mean0_1 + mean1_1) / 2;
+        float exp_0  = (var0_0 + var1_0) / 2 + ((mean0_0 - mean_0) * (mean0_0 - mean_0) + (mean1_0 - mean_0) * (mean1_0 - mean_0)) / 2;
+        float exp_1  = (var0_1 + var1_1) / 2 + ((mean0_1 - mean_1) * (mean0_1 - mean_1) + (mean1_1 - mean_1) * (mean1_1 - mean_1)) / 2;
+        auto v0 = bn0->lock_var_const();
+        auto v1 = bn1->lock_var_const();
+        EXPECT_NEAR(exp_0, v0(0), 1.0e-5);
+        EXPECT_NEAR(exp_1, v0(1), 1.0e-5);
+        EXPECT_GT(v0(0), (var0_0 + var1_0) / 2);
+        EXPECT_EQ(v0(0), v1(0));
+        EXPECT_EQ(v0(1), v1(1));
+    }
+}
+
+
+// Forward 内の ThreadPool の並列処理を実行したスレッドを記録する
+class DataParallelTest_ThreadProbe : public bb::Model
+{
+public:
+    std::mutex                  m_mtx;
+    std::set<std::thread::id>   m_threads;
+
+    std::string     GetClassName(void) const { return "DataParallelTest_ThreadProbe"; }
+    bb::indices_t   GetInputShape(void) const  { return {1}; }
+    bb::indices_t   GetOutputShape(void) const { return {1}; }
+
+    bb::FrameBuffer Forward(bb::FrameBuffer x_buf, bool train=true)
+    {
+        bb::ThreadPool::GetInstance().ParallelFor(0, 64, 1, [&](bb::index_t start, bb::index_t end) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_threads.insert(std::this_thread::get_id());
+            });
+        return x_buf;
+    }
+
+    bb::FrameBuffer Backward(bb::FrameBuffer dy_buf) { return dy_buf; }
+};
+
+TEST(DataParallelTest, testDataParallel_WorkerGroups)
+{
+    int org = bb::Manager::GetThreadCount();
+    bb::Manager::SetThreadCount(4);
+
+    auto probe0 = std::make_shared<DataParallelTest_ThreadProbe>();
+    auto probe1 = std::make_shared<DataParallelTest_ThreadProbe>();
+    auto dp = bb::DataParallel::Create(probe0, {probe1});
+
+    bb::FrameBuffer x_buf(8, {1}, BB_TYPE_FP32);
+    for ( int loop = 0; loop < 3; ++loop ) {
+        dp->Forward({x_buf, x_buf});
+    }
+
+    // 複製毎に 4/2 本のスレッドだけを使い、互いに重ならない
+    EXPECT_LE(probe0->m_threads.size(), (size_t)2);
+    EXPECT_LE(probe1->m_threads.size(), (size_t)2);
+    for ( auto id : probe0->m_threads ) {
+        EXPECT_EQ(0, (int)probe1->m_threads.count(id));
+    }
+
+    bb::Manager::SetThreadCount(org);
+}
+
@@ -1,9 +1,16 @@
 ﻿
 #include <stdio.h>
 #include <iostream>
+#include <random>
+#include <cmath>
 
 #include "gtest/gtest.h"
 #include "bb/DenseAffine.h"
+#include "bb/Sequential.h"
+#include "bb/Runner.h"
+#include "bb/LossMeanSquaredError.h"
+#include "bb/MetricsMeanSquaredError.h"
+#include "bb/OptimizerSgd.h"
 
 
 TEST(DenseAffineTest, testAffine)
@@ -66,6 +73,309 @@ TEST(DenseAffineTest, testAffine)
     }
 }
 
+
+TEST(DenseAffineTest, testAffine_InputGradient)
+{
+    int const frame_size = 8;
+
+    auto affine0 = bb::DenseAffine<>::Create(4);
+    auto affine1 = bb::DenseAffine<>::Create(2);
+    auto net = bb::Sequential::Create();
+    net->Add(affine0);
+    net->Add(affine1);
+    net->SetInputShape({3});
+
+    bb::FrameBuffer x_buf(frame_size, {3}, BB_TYPE_FP32);
+    bb::FrameBuffer dy_buf(frame_size, {2}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < 3; ++node ) {
+            x_buf.SetFP32(frame, node, (float)(frame + node) * 0.1f);
+        }
+        for ( int node = 0; node < 2; ++node ) {
+            dy_buf.SetFP32(frame, node, (float)(frame - node) * 0.2f);
+        }
+    }
+
+    // 通常の backward
+    net->Forward(x_buf);
+    auto dx_buf = net->Backward(dy_buf);
+    EXPECT_EQ(frame_size, dx_buf.GetFrameSize());
+
+    std::vector<float> dW0_exp(4*3);
+    {
+        auto dW0 = affine0->lock_dW();
+        for ( int i = 0; i < 4*3; ++i ) {
+            dW0_exp[i] = dW0(i / 3, i % 3);
+            dW0(i / 3, i % 3) = 0;
+        }
+        auto dW1 = affine1->lock_dW();
+        for ( int i = 0; i < 2*4; ++i ) {
+            dW1(i / 4, i % 4) = 0;
+        }
+    }
+
+    // 入力勾配不要
+    net->SetInputGradient(false);
+    EXPECT_FALSE(affine0->IsInputGradient());
+    EXPECT_TRUE(affine1->IsInputGradient());
+
+    net->Forward(x_buf);
+    dx_buf = net->Backward(dy_buf);
+    EXPECT_EQ(0, dx_buf.GetFrameSize());
+    {
+        auto dW0 = affine0->lock_dW();
+        for ( int i = 0; i < 4*3; ++i ) {
+            EXPECT_FLOAT_EQ(dW0_exp[i], dW0(i / 3, i % 3));
+            dW0(i / 3, i % 3) = 0;
+        }
+    }
+
+    // 先頭レイヤーを固定すると、その次のレイヤーも入力勾配不要
+    affine0->SetFrozen(true);
+    net->SetInputGradient(false);
+    EXPECT_FALSE(affine0->IsInputGradient());
+    EXPECT_FALSE(affine1->IsInputGradient());
+
+    net->Forward(x_buf);
+    dx_buf = net->Backward(dy_buf);
+    EXPECT_EQ(0, dx_buf.GetFrameSize());
+    {
+        auto dW0 = affine0->lock_dW_const();
+        for ( int i = 0; i < 4*3; ++i ) {
+            EXPECT_EQ(0.0f, dW0(i / 3, i % 3));
+        }
+        auto dW1 = affine1->lock_dW_const();
+        float sum = 0;
+        for ( int i = 0; i < 2*4; ++i ) {
+            sum += std::abs(dW1(i / 4, i % 4));
+        }
+        EXPECT_GT(sum, 0.0f);
+    }
+}
+
+
+TEST(DenseAffineTest, testAffine_InputGradientRunner)
+{
+    auto affine0 = bb::DenseAffine<>::Create(4);
+    auto affine1 = bb::DenseAffine<>::Create(2);
+    auto net = bb::Sequential::Create();
+    net->Add(affine0);
+    net->Add(affine1);
+    net->SetInputShape({3});
+
+    bb::TrainData<float> td;
+    td.x_shape = bb::indices_t({3});
+    td.t_shape = bb::indices_t({2});
+    for ( int i = 0; i < 16; ++i ) {
+        td.x_train.push_back({(float)i * 0.1f, 0.5f, -(float)i * 0.05f});
+        td.t_train.push_back({(float)(i % 2), (float)((i + 1) % 2)});
+    }
+    td.x_test = td.x_train;
+    td.t_test = td.t_train;
+
+    bb::Runner<float>::create_t runner_create;
+    runner_create.name           = "DenseAffineTest_InputGradientRunner";
+    runner_create.net            = net;
+    runner_create.lossFunc       = bb::LossMeanSquaredError<float>::Create();
+    runner_create.metricsFunc    = bb::MetricsMeanSquaredError<float>::Create();
+    runner_create.optimizer      = bb::OptimizerSgd<float>::Create(0.01f);
+    runner_create.print_progress = false;
+    runner_create.log_write      = false;
+    auto runner = bb::Runner<float>::Create(runner_create);
+
+    // Fitting 中は入力勾配を省くが、終了後は元の設定に戻ること
+    runner->Fitting(td, 1, 8);
+    EXPECT_TRUE(net->IsInputGradient());
+    EXPECT_TRUE(affine0->IsInputGradient());
+
+    net->SetInputGradient(false);
+    runner->Fitting(td, 1, 8);
+    EXPECT_FALSE(net->IsInputGradient());
+    EXPECT_FALSE(affine0->IsInputGradient());
+}
+
+
+TEST(DenseAffineTest, testAffine_Binary)
+{
+    bb::index_t const frame_size  = 37;
+    bb::index_t const input_size  = 300;
+    bb::index_t const output_size = 11;
+
+    auto affine = bb::DenseAffine<>::Create(output_size);
+    affine->SetInputShape({input_size});
+    affine->SendCommand("xnor true");
+
+    std::mt19937_64 mt(1);
+    bb::FrameBuffer x_buf(frame_size, {input_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_size; ++node ) {
+            x_buf.SetFP32(frame, node, (mt() & 1) ? +1.0f : -1.0f);
+        }
+    }
+    // ±1 以外の入力も x > 0 で2値化される
+    x_buf.SetFP32(0, 0, 0.5f);
+    x_buf.SetFP32(0, 1, -0.25f);
+    x_buf.SetFP32(1, 0, 0.0f);
+
+    auto sign_x = [&](bb::index_t frame, bb::index_t node) { return x_buf.GetFP32(frame, node) > 0 ? +1 : -1; };
+
+    // 行毎のスケールと実効重み
+    std::vector<float> scale(output_size, 0);
+    {
+        auto W = affine->lock_W_const();
+        for ( bb::index_t output_node = 0; output_node < output_size; ++output_node ) {
+            for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                scale[output_node] += std::abs(W(output_node, input_node));
+            }
+            scale[output_node] /= input_size;
+        }
+    }
+    auto sign_w = [&](bb::index_t output_node, bb::index_t input_node) {
+        auto W = affine->lock_W_const();
+        return W(output_node, input_node) > 0 ? +1 : -1;
+    };
+
+    // 推論・学習とも重みの符号と行毎のスケールで計算した値と一致する
+    for ( bool train : {false, true} ) {
+        auto y_buf = affine->Forward(x_buf, train);
+        auto b = affine->lock_b_const();
+        for ( bb::index_t output_node = 0; output_node < output_size; ++output_node ) {
+            for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+                int dot = 0;
+                for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                    dot += sign_w(output_node, input_node) * sign_x(frame, input_node);
+                }
+                EXPECT_NEAR(scale[output_node] * dot + b(output_node), y_buf.GetFP32(frame, output_node), 1.0e-4);
+            }
+        }
+    }
+
+    // Backward は実効重みと保存した2値化入力で求める
+    bb::FrameBuffer dy_buf(frame_size, {output_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_size; ++node ) {
+            dy_buf.SetFP32(frame, node, (float)((int)(mt() % 21) - 10) / 10.0f);
+        }
+    }
+    auto dx_buf = affine->Backward(dy_buf);
+    {
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                float dx = 0;
+                for ( bb::index_t output_node = 0; output_node < output_size; ++output_node ) {
+                    dx += scale[output_node] * sign_w(output_node, input_node) * dy_buf.GetFP32(frame, output_node);
+                }
+                EXPECT_NEAR(dx, dx_buf.GetFP32(frame, input_node), 1.0e-4);
+            }
+        }
+
+        auto dW = affine->lock_dW_const();
+        auto db = affine->lock_db_const();
+        for ( bb::index_t output_node = 0; output_node < output_size; ++output_node ) {
+            float sum = 0;
+            for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+                sum += dy_buf.GetFP32(frame, output_node);
+            }
+            EXPECT_NEAR(sum, db(output_node), 1.0e-4);
+
+            for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                float dw = 0;
+                for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+                    dw += dy_buf.GetFP32(frame, output_node) * sign_x(frame, input_node);
+                }
+                EXPECT_NEAR(dw, dW(output_node, input_node), 1.0e-4);
+            }
+        }
+    }
+
+    // "binary true" だけでは XNOR 演算にならない
+    {
+        auto affine2 = bb::DenseAffine<>::Create(output_size);
+        affine2->SetInputShape({input_size});
+        affine2->SendCommand("binary true");
+        auto u_buf = affine2->Forward(x_buf, false);
+        auto W = affine2->lock_W_const();
+        auto b = affine2->lock_b_const();
+        float y = b(0);
+        for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+            y += x_buf.GetFP32(0, input_node) * W(0, input_node);
+        }
+        EXPECT_NEAR(y, u_buf.GetFP32(0, 0), 1.0e-4);
+    }
+}
+
+
+TEST(DenseAffineTest, testAffine_Int8)
+{
+    bb::index_t const frame_size  = 37;
+    bb::index_t const input_size  = 300;
+    bb::index_t const output_size = 11;
+
+    auto affine = bb::DenseAffine<>::Create(output_size);
+    affine->SetInputShape({input_size});
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {input_size}, BB_TYPE_FP32);
+    float x_abs_max = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_size; ++node ) {
+            float x = dist(mt);
+            x_buf.SetFP32(frame, node, x);
+            x_abs_max = std::max(x_abs_max, std::abs(x));
+        }
+    }
+
+    // 較正
+    affine->SendCommand("int8_calibrate true");
+    auto y_buf = affine->Forward(x_buf, false);
+    EXPECT_EQ(x_abs_max, affine->GetInt8InputAbsMax());
+
+    // INT8 推論
+    affine->SendCommand("int8 true");
+    auto z_buf = affine->Forward(x_buf, false);
+
+    float y_abs_max = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_size; ++node ) {
+            y_abs_max = std::max(y_abs_max, std::abs(y_buf.GetFP32(frame, node)));
+        }
+    }
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_size; ++node ) {
+            EXPECT_NEAR(y_buf.GetFP32(frame, node), z_buf.GetFP32(frame, node), y_abs_max * 0.02f);
+        }
+    }
+
+    // 量子化した値での整数演算と一致すること
+    {
+        auto  W = affine->lock_W_const();
+        auto  b = affine->lock_b_const();
+        float x_scale = x_abs_max / 127.0f;
+        for ( bb::index_t output_node = 0; output_node < output_size; ++output_node ) {
+            float w_abs_max = 0;
+            for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                w_abs_max = std::max(w_abs_max, std::abs(W(output_node, input_node)));
+            }
+            float w_scale = w_abs_max / 127.0f;
+            for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+                int dot = 0;
+                for ( bb::index_t input_node = 0; input_node < input_size; ++input_node ) {
+                    int xq = (int)std::nearbyint(x_buf.GetFP32(frame, input_node) * (1.0f / x_scale));
+                    int wq = (int)std::nearbyint(W(output_node, input_node) * (1.0f / w_scale));
+                    dot += xq * wq;
+                }
+                EXPECT_NEAR((float)dot * x_scale * w_scale + b(output_node), z_buf.GetFP32(frame, output_node), y_abs_max * 1.0e-3f);
+            }
+        }
+    }
+
+    // 学習時は FP32
+    auto t_buf = affine->Forward(x_buf, true);
+    EXPECT_EQ(y_buf.GetFP32(3, 4), t_buf.GetFP32(3, 4));
+}
+
+
 #ifdef BB_WITH_CUDA
 TEST(DenseAffineTest, testAffine_cudaBlas1)
 {
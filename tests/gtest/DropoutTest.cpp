@@ -0,0 +1,200 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/Philox.h"
+#include "bb/Dropout.h"
+
+
+TEST(DropoutTest, testPhilox)
+{
+    // Random123 の Known Answer
+    std::uint32_t ctr0[4] = {0, 0, 0, 0};
+    std::uint32_t key0[2] = {0, 0};
+    std::uint32_t out[4];
+    bb::Philox4x32_10(ctr0, key0, out);
+    EXPECT_EQ(0x6627e8d5u, out[0]);
+    EXPECT_EQ(0xe169c58du, out[1]);
+    EXPECT_EQ(0xbc57ac4cu, out[2]);
+    EXPECT_EQ(0x9b00dbd8u, out[3]);
+
+    std::uint32_t ctr1[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+    std::uint32_t key1[2] = {0xa4093822, 0x299f31d0};
+    bb::Philox4x32_10(ctr1, key1, out);
+    EXPECT_EQ(0xd16cfe09u, out[0]);
+    EXPECT_EQ(0x94fdccebu, out[1]);
+    EXPECT_EQ(0x5001e420u, out[2]);
+    EXPECT_EQ(0x24126ea1u, out[3]);
+
+#ifdef __AVX2__
+    // 8並列版はレーン毎にスカラー版と一致すること
+    alignas(32) std::uint32_t c[4][8];
+    for ( int i = 0; i < 4; ++i ) {
+        for ( int l = 0; l < 8; ++l ) {
+            c[i][l] = (std::uint32_t)(l * 0x12345 + i * 0x9876543 + 1);
+        }
+    }
+    __m256i v[4];
+    for ( int i = 0; i < 4; ++i ) {
+        v[i] = _mm256_load_si256((__m256i const *)c[i]);
+    }
+    bb::Philox4x32_10_x8(v, key1);
+    alignas(32) std::uint32_t r[4][8];
+    for ( int i = 0; i < 4; ++i ) {
+        _mm256_store_si256((__m256i *)r[i], v[i]);
+    }
+    for ( int l = 0; l < 8; ++l ) {
+        std::uint32_t ctr[4] = {c[0][l], c[1][l], c[2][l], c[3][l]};
+        bb::Philox4x32_10(ctr, key1, out);
+        for ( int i = 0; i < 4; ++i ) {
+            EXPECT_EQ(out[i], r[i][l]);
+        }
+    }
+#endif
+}
+
+
+TEST(DropoutTest, testDropout_Element)
+{
+    bb::index_t const frame_size = 1000;
+    bb::index_t const node_size  = 50;
+    double      const rate       = 0.3;
+
+    auto dropout = bb::Dropout<>::Create(rate, 123, true);
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(0.5f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    auto y_buf    = dropout->Forward(x_buf, true);
+    auto mask_buf = dropout->GetMask();
+
+    bb::FrameBuffer dy_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            dy_buf.SetFP32(frame, node, 1.0f);
+        }
+    }
+    auto dx_buf = dropout->Backward(dy_buf);
+
+    bb::index_t keep_count = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            bool keep = mask_buf.GetBit(frame, node);
+            EXPECT_EQ(keep ? x_buf.GetFP32(frame, node) : 0.0f, y_buf.GetFP32(frame, node));
+            EXPECT_EQ(keep ? 1.0f : 0.0f, dx_buf.GetFP32(frame, node));
+            keep_count += keep ? 1 : 0;
+        }
+    }
+    EXPECT_NEAR(1.0 - rate, (double)keep_count / (double)(frame_size * node_size), 0.01);
+
+    // 同じ種なら同じマスク、次の step では別のマスク
+    auto dropout2 = bb::Dropout<>::Create(rate, 123, true);
+    auto y2_buf   = dropout2->Forward(x_buf, true).Clone();
+    auto y3_buf   = dropout2->Forward(x_buf, true);
+    int  diff     = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(y_buf.GetFP32(frame, node), y2_buf.GetFP32(frame, node));
+            diff += (y2_buf.GetFP32(frame, node) != y3_buf.GetFP32(frame, node)) ? 1 : 0;
+        }
+    }
+    EXPECT_GT(diff, 0);
+
+    // double 版 (汎用版) と同じマスク
+    auto dropout_fp64 = bb::Dropout<double, double>::Create(rate, 123, true);
+    bb::FrameBuffer x64_buf(frame_size, {node_size}, BB_TYPE_FP64);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x64_buf.SetFP64(frame, node, 1.0);
+        }
+    }
+    auto y64_buf = dropout_fp64->Forward(x64_buf, true);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(mask_buf.GetBit(frame, node) ? 1.0 : 0.0, y64_buf.GetFP64(frame, node));
+        }
+    }
+}
+
+
+TEST(DropoutTest, testDropout_Node)
+{
+    bb::index_t const frame_size = 100;
+    bb::index_t const node_size  = 1000;
+    double      const rate       = 0.5;
+
+    auto dropout = bb::Dropout<>::Create(rate, 1);
+
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, 2.0f);
+        }
+    }
+
+    auto y_buf  = dropout->Forward(x_buf, true);
+    auto dx_buf = dropout->Backward(x_buf);
+
+    bb::index_t keep_count = 0;
+    for ( bb::index_t node = 0; node < node_size; ++node ) {
+        float y = y_buf.GetFP32(0, node);
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            EXPECT_EQ(y, y_buf.GetFP32(frame, node));
+            EXPECT_EQ(y, dx_buf.GetFP32(frame, node));
+        }
+        keep_count += (y != 0) ? 1 : 0;
+    }
+    EXPECT_NEAR(1.0 - rate, (double)keep_count / (double)node_size, 0.05);
+
+    // 推論時はスケールのみ
+    auto z_buf = dropout->Forward(x_buf, false);
+    EXPECT_EQ(1.0f, z_buf.GetFP32(3, 5));
+}
+
+
+TEST(DropoutTest, testDropout_View)
+{
+    bb::index_t const frame_size = 1000;
+    bb::index_t const node_size  = 20;
+
+    std::mt19937_64 mt(2);
+    std::uniform_real_distribution<float> dist(0.5f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    // ビュー入力 (参照元のストライド) と詰めたコピーの入力で同じ結果になること
+    for ( int per_element = 0; per_element < 2; ++per_element ) {
+        for ( bb::index_t start : {256, 768} ) {
+            bb::index_t size   = (start == 256) ? 256 : frame_size - start;
+            auto        x_view = x_buf.GetFrameRangeView(start, size);
+            auto        x_copy = x_view.Clone();
+
+            auto dropout0 = bb::Dropout<>::Create(0.4, 7, per_element != 0);
+            auto dropout1 = bb::Dropout<>::Create(0.4, 7, per_element != 0);
+            auto y0_buf   = dropout0->Forward(x_view, true);
+            auto y1_buf   = dropout1->Forward(x_copy, true);
+            auto dx0_buf  = dropout0->Backward(x_view);
+            auto dx1_buf  = dropout1->Backward(x_copy);
+
+            EXPECT_EQ(size, y0_buf.GetFrameSize());
+            for ( bb::index_t frame = 0; frame < size; ++frame ) {
+                for ( bb::index_t node = 0; node < node_size; ++node ) {
+                    EXPECT_EQ(y1_buf.GetFP32(frame, node),  y0_buf.GetFP32(frame, node));
+                    EXPECT_EQ(dx1_buf.GetFP32(frame, node), dx0_buf.GetFP32(frame, node));
+                }
+            }
+        }
+    }
+}
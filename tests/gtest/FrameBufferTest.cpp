@@ -144,6 +144,80 @@ TEST(FrameBufferTest, FrameBuffer_Range)
 }
 
 
+TEST(FrameBufferTest, FrameBuffer_RangeView)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const node_size  = 5;
+
+    bb::FrameBuffer buf(frame_size, {node_size}, BB_TYPE_FP32);
+    bb::FrameBuffer bit_buf(frame_size, {node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            buf.SetFP32(frame, node, (float)(frame*10 + node));
+            bit_buf.SetBit(frame, node, ((frame ^ node) & 1) != 0);
+        }
+    }
+
+    // 境界条件
+    EXPECT_TRUE(buf.IsFrameRangeViewable(8, 16));
+    EXPECT_TRUE(buf.IsFrameRangeViewable(296, 4));
+    EXPECT_FALSE(buf.IsFrameRangeViewable(4, 8));
+    EXPECT_FALSE(buf.IsFrameRangeViewable(8, 4));
+    EXPECT_TRUE(bit_buf.IsFrameRangeViewable(256, 44));
+    EXPECT_FALSE(bit_buf.IsFrameRangeViewable(32, 32));
+
+    // フレーム範囲 (メモリを共有する)
+    auto view = buf.GetFrameRangeView(256, 44);
+    EXPECT_TRUE(view.IsView());
+    EXPECT_EQ(44, view.GetFrameSize());
+    for ( bb::index_t frame = 0; frame < view.GetFrameSize(); ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ((float)((frame+256)*10 + node), view.GetFP32(frame, node));
+        }
+    }
+    view.SetFP32(1, 2, -1.0f);
+    EXPECT_EQ(-1.0f, buf.GetFP32(257, 2));
+
+    // 全体演算は範囲内だけに作用する
+    view *= 2.0;
+    EXPECT_EQ(-2.0f, buf.GetFP32(257, 2));
+    EXPECT_EQ((float)(258*10 + 3) * 2.0f, buf.GetFP32(258, 3));
+    EXPECT_EQ((float)(255*10 + 3), buf.GetFP32(255, 3));
+
+    auto clone = view.Clone();
+    EXPECT_FALSE(clone.IsView());
+    EXPECT_EQ(-2.0f, clone.GetFP32(1, 2));
+    auto sum = view + clone;
+    EXPECT_EQ(-4.0f, sum.GetFP32(1, 2));
+
+    view.FillZero();
+    EXPECT_EQ(0.0f, buf.GetFP32(299, 4));
+    EXPECT_EQ((float)(255*10 + 4), buf.GetFP32(255, 4));
+
+    // ノード範囲
+    auto node_view = buf.GetNodeRangeView(1, 3);
+    EXPECT_EQ(3, node_view.GetNodeSize());
+    EXPECT_EQ((float)(7*10 + 2), node_view.GetFP32(7, 1));
+
+    // Bit
+    auto bit_view = bit_buf.GetFrameRangeView(256, 44).GetNodeRangeView(2, 3);
+    auto vec = bit_view.GetVector<float>();
+    for ( bb::index_t frame = 0; frame < bit_view.GetFrameSize(); ++frame ) {
+        for ( bb::index_t node = 0; node < bit_view.GetNodeSize(); ++node ) {
+            bool expect = (((frame + 256) ^ (node + 2)) & 1) != 0;
+            EXPECT_EQ(expect, (bool)bit_view.GetBit(frame, node));
+            EXPECT_EQ(expect ? 1.0f : 0.0f, vec[frame][node]);
+        }
+    }
+
+    // Resize するとビューは切り離される
+    view.Resize(8, {node_size}, BB_TYPE_FP32);
+    EXPECT_FALSE(view.IsView());
+    view.FillZero();
+    EXPECT_EQ((float)(10*10 + 1), buf.GetFP32(10, 1));
+}
+
+
 
 TEST(FrameBufferTest, FrameBuffer_SetGetTensor)
 {
@@ -234,6 +308,145 @@ TEST(FrameBufferTest, FrameBuffer_SetVector)
 
 
 
+TEST(FrameBufferTest, FrameBuffer_SetGetArray)
+{
+    bb::index_t const frame_size = 67;
+    bb::index_t const node_size  = 5;
+
+    std::vector<float> src(frame_size * node_size);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            src[frame * node_size + node] = (float)((frame * 7 + node * 3) % 5) - 2.0f;
+        }
+    }
+
+    bb::FrameBuffer buf_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+    buf_fp32.SetArray(&src[0]);
+
+    bb::FrameBuffer buf_bit(frame_size, {node_size}, BB_TYPE_BIT);
+    buf_bit.SetArray(&src[0]);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(src[frame * node_size + node], buf_fp32.GetFP32(frame, node));
+            EXPECT_EQ(src[frame * node_size + node] > 0, (bool)buf_bit.GetBit(frame, node));
+        }
+    }
+
+    std::vector<float> dst_fp32(frame_size * node_size);
+    std::vector<float> dst_bit(frame_size * node_size);
+    buf_fp32.GetArray(&dst_fp32[0]);
+    buf_bit.GetArray(&dst_bit[0]);
+    for ( size_t i = 0; i < src.size(); ++i ) {
+        EXPECT_EQ(src[i], dst_fp32[i]);
+        EXPECT_EQ(src[i] > 0 ? 1.0f : 0.0f, dst_bit[i]);
+    }
+
+    // 型の異なるバッファは値を変換して格納・取得する
+    for ( int data_type : {BB_TYPE_FP16, BB_TYPE_FP64, BB_TYPE_INT8, BB_TYPE_INT32} ) {
+        bb::FrameBuffer buf(frame_size, {node_size}, data_type);
+        buf.SetArray(&src[0]);
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            for ( bb::index_t node = 0; node < node_size; ++node ) {
+                EXPECT_EQ(src[frame * node_size + node], buf.GetValue<float>(frame, node));
+            }
+        }
+
+        std::vector<float> dst(frame_size * node_size);
+        buf.GetArray(&dst[0]);
+        for ( size_t i = 0; i < src.size(); ++i ) {
+            EXPECT_EQ(src[i], dst[i]);
+        }
+    }
+}
+
+
+TEST(FrameBufferTest, FrameBuffer_BitTranspose)
+{
+    bb::index_t const frame_size = 200;
+    bb::index_t const node_size  = 131;
+
+    std::mt19937_64 mt(1);
+    std::vector< std::vector<float> >   src_fp32(frame_size, std::vector<float>(node_size));
+    std::vector<std::uint8_t>           src_u8(frame_size * node_size);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            src_fp32[frame][node] = (float)(mt() % 5) - 2.0f;
+            src_u8[frame * node_size + node] = (std::uint8_t)(mt() % 3);
+        }
+    }
+
+    bb::FrameBuffer buf0(frame_size, {node_size}, BB_TYPE_BIT);
+    bb::FrameBuffer buf1(frame_size, {node_size}, BB_TYPE_BIT);
+    buf0.SetVector(src_fp32);
+    buf1.SetArray(&src_u8[0]);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(src_fp32[frame][node] > 0, (bool)buf0.GetBit(frame, node));
+            EXPECT_EQ(src_u8[frame * node_size + node] != 0, (bool)buf1.GetBit(frame, node));
+        }
+    }
+
+    auto dst_fp32 = buf0.GetVector<float>();
+    std::vector<std::uint8_t> dst_u8(frame_size * node_size);
+    buf1.GetArray(&dst_u8[0]);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(src_fp32[frame][node] > 0 ? 1.0f : 0.0f, dst_fp32[frame][node]);
+            EXPECT_EQ(src_u8[frame * node_size + node] != 0 ? 1 : 0, dst_u8[frame * node_size + node]);
+        }
+    }
+
+    // オフセット付き
+    bb::FrameBuffer buf2(70, {node_size}, BB_TYPE_BIT);
+    buf2.SetVector(src_fp32, 100);
+    for ( bb::index_t frame = 0; frame < 70; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(src_fp32[frame + 100][node] > 0, (bool)buf2.GetBit(frame, node));
+        }
+    }
+}
+
+
+TEST(FrameBufferTest, FrameBuffer_View)
+{
+    bb::index_t const frame_size = 70;
+    bb::index_t const node_size  = 3;
+
+    bb::FrameBuffer buf_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+    bb::FrameBuffer buf_bit(frame_size, {node_size}, BB_TYPE_BIT);
+    {
+        auto fp32_ptr  = buf_fp32.Lock<float>(true);
+        auto bit_ptr   = buf_bit.Lock<bb::Bit>(true);
+        auto fp32_view = fp32_ptr.GetView();
+        auto bit_view  = bit_ptr.GetView();
+        EXPECT_EQ(frame_size, fp32_view.GetFrameSize());
+        EXPECT_EQ(node_size,  fp32_view.GetNodeSize());
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            for ( bb::index_t node = 0; node < node_size; ++node ) {
+                fp32_view.Set(frame, node, (float)(frame * 10 + node));
+                fp32_view.Add(frame, node, 0.5f);
+                bit_view.Set(frame, node, ((frame + node) % 3) == 0);
+            }
+        }
+        EXPECT_EQ(fp32_ptr.GetAddr(1), fp32_view.GetRow(1));
+    }
+
+    auto fp32_ptr  = buf_fp32.LockConst<float>();
+    auto bit_ptr   = buf_bit.LockConst<bb::Bit>();
+    auto fp32_view = fp32_ptr.GetView();
+    auto bit_view  = bit_ptr.GetView();
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ((float)(frame * 10 + node) + 0.5f, fp32_view.Get(frame, node));
+            EXPECT_EQ((float)(frame * 10 + node) + 0.5f, buf_fp32.GetFP32(frame, node));
+            EXPECT_EQ(((frame + node) % 3) == 0, (bool)bit_view.Get(frame, node));
+            EXPECT_EQ(((frame + node) % 3) == 0, (bool)buf_bit.GetBit(frame, node));
+        }
+    }
+}
+
+
 TEST(FrameBufferTest, testFrameBuffer_Json)
 {
     bb::index_t const frame_size = 32;
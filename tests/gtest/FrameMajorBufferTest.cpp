@@ -0,0 +1,50 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/FrameMajorBuffer.h"
+
+
+TEST(FrameMajorBufferTest, testFrameMajorBuffer_Transpose)
+{
+    bb::index_t const frame_size = 77;
+    bb::index_t const node_size  = 45;
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    bb::FrameBuffer buf_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+    bb::FrameBuffer buf_fp64(frame_size, {node_size}, BB_TYPE_FP64);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            buf_fp32.SetFP32(frame, node, dist(mt));
+            buf_fp64.SetFP64(frame, node, dist(mt));
+        }
+    }
+
+    bb::FrameMajorBuffer<float>  fm_fp32(buf_fp32);
+    bb::FrameMajorBuffer<double> fm_fp64(buf_fp64);
+    EXPECT_EQ(frame_size, fm_fp32.GetFrameSize());
+    EXPECT_EQ(node_size,  fm_fp32.GetNodeSize());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(buf_fp32.GetFP32(frame, node), fm_fp32.GetRow(frame)[node]);
+            EXPECT_EQ(buf_fp64.GetFP64(frame, node), fm_fp64.Get(frame, node));
+        }
+    }
+
+    // 書き戻し
+    bb::FrameBuffer dst_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+    bb::FrameBuffer dst_fp64(frame_size, {node_size}, BB_TYPE_FP64);
+    fm_fp32.ToFrameBuffer(dst_fp32);
+    fm_fp64.ToFrameBuffer(dst_fp64);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_EQ(buf_fp32.GetFP32(frame, node), dst_fp32.GetFP32(frame, node));
+            EXPECT_EQ(buf_fp64.GetFP64(frame, node), dst_fp64.GetFP64(frame, node));
+        }
+    }
+}
+
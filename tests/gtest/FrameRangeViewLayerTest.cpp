@@ -0,0 +1,248 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/DenseAffine.h"
+#include "bb/MicroMlpAffine.h"
+#include "bb/MicroMlp.h"
+#include "bb/BatchNormalization.h"
+#include "bb/StochasticBatchNormalization.h"
+#include "bb/ReLU.h"
+#include "bb/Sigmoid.h"
+#include "bb/HardTanh.h"
+#include "bb/Binarize.h"
+#include "bb/RealToBinary.h"
+#include "bb/BinaryToReal.h"
+#include "bb/StochasticLutN.h"
+#include "bb/SparseLutN.h"
+#include "bb/BinaryLutN.h"
+#include "bb/Reduce.h"
+#include "bb/MaxPooling.h"
+#include "bb/AveragePooling.h"
+#include "bb/StochasticMaxPooling.h"
+#include "bb/StochasticMaxPooling2x2.h"
+#include "bb/UpSampling.h"
+#include "bb/ConvolutionIm2Col.h"
+#include "bb/ConvolutionCol2Im.h"
+#include "bb/LutNetFused.h"
+#include "bb/LossSoftmaxCrossEntropy.h"
+#include "bb/LossMeanSquaredError.h"
+#include "bb/MetricsCategoricalAccuracy.h"
+#include "bb/MetricsBinaryAccuracy.h"
+#include "bb/MetricsMeanSquaredError.h"
+
+
+// Runner はミニバッチをフレーム範囲のビューで切り出して渡すので、
+// 親バッファのストライドのままの入力でも詰めたコピーと同じ結果になること
+
+static bb::FrameBuffer FrameRangeViewLayerTest_MakeParent(int type, bb::indices_t shape, bb::index_t frame_size, std::uint64_t seed)
+{
+    std::mt19937_64 mt(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    bb::FrameBuffer buf(frame_size, shape, type);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < buf.GetNodeSize(); ++node ) {
+            if ( type == BB_TYPE_BIT ) {
+                buf.SetBit(frame, node, (mt() & 1) != 0);
+            }
+            else {
+                buf.SetFP32(frame, node, dist(mt));
+            }
+        }
+    }
+    return buf;
+}
+
+static void FrameRangeViewLayerTest_Compare(bb::FrameBuffer const &a, bb::FrameBuffer const &b)
+{
+    ASSERT_EQ(a.GetFrameSize(), b.GetFrameSize());
+    ASSERT_EQ(a.GetNodeSize(),  b.GetNodeSize());
+    for ( bb::index_t frame = 0; frame < a.GetFrameSize(); ++frame ) {
+        for ( bb::index_t node = 0; node < a.GetNodeSize(); ++node ) {
+            EXPECT_NEAR(a.GetValue<double>(frame, node), b.GetValue<double>(frame, node), 1.0e-5);
+        }
+    }
+}
+
+// 同じ入力のビュー版と詰めた版で Forward (と Backward) の結果を比べる
+static void FrameRangeViewLayerTest_Model(std::shared_ptr<bb::Model> layer, bb::FrameBuffer const &parent, bb::index_t start, bb::index_t size, bool train, bool backward)
+{
+    auto x_view = parent.GetFrameRangeView(start, size);
+    auto x_copy = x_view.Clone();
+    ASSERT_TRUE(x_view.IsView());
+    ASSERT_FALSE(x_copy.IsView());
+    ASSERT_NE(x_view.GetFrameStride(), x_copy.GetFrameStride());
+
+    layer->SetInputShape(parent.GetShape());
+
+    auto y_copy = layer->Forward(x_copy, train);
+    bb::FrameBuffer dx_copy;
+    if ( backward ) {
+        dx_copy = layer->Backward(y_copy.Clone());
+    }
+
+    auto y_view = layer->Forward(x_view, train);
+    bb::FrameBuffer dx_view;
+    if ( backward ) {
+        dx_view = layer->Backward(y_copy.Clone());
+    }
+
+    FrameRangeViewLayerTest_Compare(y_copy, y_view);
+    if ( backward ) {
+        FrameRangeViewLayerTest_Compare(dx_copy, dx_view);
+    }
+}
+
+
+TEST(FrameRangeViewLayerTest, testFrameRangeView_Fp32Layers)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const start      = 64;
+    bb::index_t const size       = 104;
+    bb::index_t const node_size  = 32;
+
+    auto x_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_FP32, {node_size}, frame_size, 1);
+
+    FrameRangeViewLayerTest_Model(bb::DenseAffine<>::Create(10),                          x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::MicroMlpAffine<6, 16, float, float>::Create(20),    x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::MicroMlp<6, 16, float, float>::Create(20),          x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::BatchNormalization<>::Create(),                      x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::StochasticBatchNormalization<>::Create(),            x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::ReLU<>::Create(),                                    x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::Sigmoid<>::Create(),                                 x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::HardTanh<>::Create(),                                x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::Binarize<>::Create(),                                x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::StochasticLutN<6, float, float>::Create(20),         x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::SparseLutN<6, float, float>::Create(20),             x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::Reduce<>::Create(8),                                 x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::BinaryToReal<float, float>::Create(4, {8}),          x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::RealToBinary<float, float>::Create(1),               x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::ConvolutionCol2Im<>::Create(2, 2),                   x_buf, start, size, true,  true);
+}
+
+
+TEST(FrameRangeViewLayerTest, testFrameRangeView_Fp32Filters)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const start      = 64;
+    bb::index_t const size       = 104;
+
+    auto x_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_FP32, {8, 6, 3}, frame_size, 2);
+
+    FrameRangeViewLayerTest_Model(bb::MaxPooling<>::Create(2, 2),                          x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::AveragePooling<>::Create(2, 2),                      x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::StochasticMaxPooling<>::Create(2, 2),                x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::StochasticMaxPooling2x2<>::Create(),                 x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::UpSampling<>::Create(2, 2),                          x_buf, start, size, true,  true);
+    FrameRangeViewLayerTest_Model(bb::ConvolutionIm2Col<>::Create(3, 3),                   x_buf, start, size, true,  true);
+
+    // 2x2 の StochasticMaxPooling は専用版と一致すること
+    auto x_view = x_buf.GetFrameRangeView(start, size);
+    auto smp    = bb::StochasticMaxPooling<>::Create(2, 2);
+    auto smp2x2 = bb::StochasticMaxPooling2x2<>::Create();
+    auto y0 = smp->Forward(x_view, true);
+    auto y1 = smp2x2->Forward(x_view.Clone(), true);
+    FrameRangeViewLayerTest_Compare(y0, y1);
+    FrameRangeViewLayerTest_Compare(smp->Backward(y1.Clone()), smp2x2->Backward(y1.Clone()));
+
+    // AveragePooling は窓内平均
+    auto ap = bb::AveragePooling<>::Create(2, 2);
+    auto y2 = ap->Forward(x_view, true);
+    EXPECT_NEAR(y2.GetFP32(5, 0), (x_view.GetFP32(5, 0) + x_view.GetFP32(5, 1) + x_view.GetFP32(5, 8) + x_view.GetFP32(5, 9)) / 4.0f, 1.0e-5);
+}
+
+
+TEST(FrameRangeViewLayerTest, testFrameRangeView_BitLayers)
+{
+    bb::index_t const frame_size = 700;
+    bb::index_t const start      = 256;
+    bb::index_t const size       = 444;     // 256 境界でない終わりは親の末尾まで
+    bb::index_t const node_size  = 32;
+
+    auto x_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_BIT, {node_size}, frame_size, 3);
+
+    FrameRangeViewLayerTest_Model(bb::BinaryLutN<6, bb::Bit, float>::Create(20),           x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::SparseLutN<6, bb::Bit, float>::Create(20),           x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::StochasticLutN<6, bb::Bit, float>::Create(20),       x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::MicroMlpAffine<6, 16, bb::Bit, float>::Create(20),   x_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::BinaryToReal<bb::Bit, float>::Create(4, {8}),        x_buf, start, 256, false, false);
+
+    auto img_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_BIT, {8, 6, 3}, frame_size, 4);
+    FrameRangeViewLayerTest_Model(bb::MaxPooling<bb::Bit, float>::Create(2, 2),            img_buf, start, size, false, false);
+    FrameRangeViewLayerTest_Model(bb::ConvolutionIm2Col<bb::Bit, float>::Create(3, 3),     img_buf, start, size, false, false);
+}
+
+
+TEST(FrameRangeViewLayerTest, testFrameRangeView_LutNetFused)
+{
+    bb::index_t const frame_size = 700;
+    bb::index_t const start      = 256;
+    bb::index_t const size       = 444;
+
+    std::vector< std::shared_ptr< bb::LutLayer<bb::Bit, float> > > layers;
+    layers.push_back(bb::BinaryLutN<6>::Create(24, 1));
+    layers.push_back(bb::BinaryLutN<6>::Create(10, 2));
+    layers[0]->SetInputShape({32});
+    layers[1]->SetInputShape({24});
+    auto fused = bb::LutNetFused::Create<bb::Bit, float>(layers);
+
+    auto x_buf  = FrameRangeViewLayerTest_MakeParent(BB_TYPE_BIT, {32}, frame_size, 5);
+    auto x_view = x_buf.GetFrameRangeView(start, size);
+    FrameRangeViewLayerTest_Compare(fused->Forward(x_view.Clone()), fused->Forward(x_view));
+}
+
+
+TEST(FrameRangeViewLayerTest, testFrameRangeView_LossMetrics)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const start      = 64;
+    bb::index_t const size       = 104;
+    bb::index_t const node_size  = 10;
+
+    auto y_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_FP32, {node_size}, frame_size, 6);
+    auto t_buf = FrameRangeViewLayerTest_MakeParent(BB_TYPE_FP32, {node_size}, frame_size, 7);
+    auto y_view = y_buf.GetFrameRangeView(start, size);
+    auto t_view = t_buf.GetFrameRangeView(start, size);
+    auto y_copy = y_view.Clone();
+    auto t_copy = t_view.Clone();
+
+    // Runner と同じく y は詰めたバッファ、t はビューの組み合わせも含めて比べる
+    std::vector< std::shared_ptr<bb::LossFunction> > losses;
+    losses.push_back(bb::LossSoftmaxCrossEntropy<>::Create());
+    losses.push_back(bb::LossMeanSquaredError<>::Create());
+    for ( auto loss : losses ) {
+        loss->Clear();
+        auto dy_copy = loss->CalculateLoss(y_copy, t_copy, size);
+        double loss_copy = loss->GetLoss();
+
+        loss->Clear();
+        auto dy_view = loss->CalculateLoss(y_copy, t_view, size);
+        EXPECT_NEAR(loss_copy, loss->GetLoss(), 1.0e-5);
+        FrameRangeViewLayerTest_Compare(dy_copy, dy_view);
+
+        loss->Clear();
+        dy_view = loss->CalculateLoss(y_view, t_view, size);
+        EXPECT_NEAR(loss_copy, loss->GetLoss(), 1.0e-5);
+        FrameRangeViewLayerTest_Compare(dy_copy, dy_view);
+    }
+
+    std::vector< std::shared_ptr<bb::MetricsFunction> > metrics;
+    metrics.push_back(bb::MetricsCategoricalAccuracy<>::Create());
+    metrics.push_back(bb::MetricsBinaryAccuracy<>::Create());
+    metrics.push_back(bb::MetricsMeanSquaredError<>::Create());
+    for ( auto metric : metrics ) {
+        metric->Clear();
+        metric->CalculateMetrics(y_copy, t_copy);
+        double metrics_copy = metric->GetMetrics();
+
+        metric->Clear();
+        metric->CalculateMetrics(y_copy, t_view);
+        EXPECT_NEAR(metrics_copy, metric->GetMetrics(), 1.0e-5);
+
+        metric->Clear();
+        metric->CalculateMetrics(y_view, t_view);
+        EXPECT_NEAR(metrics_copy, metric->GetMetrics(), 1.0e-5);
+    }
+}
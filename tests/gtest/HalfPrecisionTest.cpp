@@ -0,0 +1,288 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+#include <cmath>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+#include "bb/DataType.h"
+#include "bb/FrameBuffer.h"
+#include "bb/SparseLutN.h"
+#include "bb/StochasticLutN.h"
+
+
+TEST(HalfPrecisionTest, testFloat16_Scalar)
+{
+    EXPECT_EQ(0x3c00, bb::Float16(1.0f).GetBits());
+    EXPECT_EQ(0xc000, bb::Float16(-2.0f).GetBits());
+    EXPECT_EQ(0x7bff, bb::Float16(65504.0f).GetBits());
+    EXPECT_EQ(0x7c00, bb::Float16(65520.0f).GetBits());     // 丸めでオーバーフロー
+    EXPECT_EQ(0x0001, bb::Float16(std::ldexp(1.0f, -24)).GetBits());
+    EXPECT_EQ(0x3c00, bb::Float16(1.0f + std::ldexp(1.0f, -11)).GetBits());     // 偶数丸め
+    EXPECT_EQ(0x3c02, bb::Float16(1.0f + 3.0f * std::ldexp(1.0f, -11)).GetBits());
+
+    EXPECT_EQ(1.0f,    (float)bb::Float16::FromBits(0x3c00));
+    EXPECT_EQ(65504.0f,(float)bb::Float16::FromBits(0x7bff));
+    EXPECT_EQ(std::ldexp(1.0f, -24), (float)bb::Float16::FromBits(0x0001));
+    EXPECT_TRUE(std::isinf((float)bb::Float16::FromBits(0x7c00)));
+    EXPECT_TRUE(std::isnan((float)bb::Float16(std::numeric_limits<float>::quiet_NaN())));
+
+    EXPECT_EQ(0x3f80, bb::BFloat16(1.0f).GetBits());
+    EXPECT_EQ(0x3f80, bb::BFloat16(1.0f + std::ldexp(1.0f, -8)).GetBits());     // 偶数丸め
+    EXPECT_EQ(0x3f82, bb::BFloat16(1.0f + 3.0f * std::ldexp(1.0f, -8)).GetBits());
+    EXPECT_NEAR(1.0e30f, (float)bb::BFloat16(1.0e30f), 1.0e30f / 128);
+    EXPECT_TRUE(std::isnan((float)bb::BFloat16(std::numeric_limits<float>::quiet_NaN())));
+}
+
+
+TEST(HalfPrecisionTest, testHalfPrecision_Convert)
+{
+    bb::index_t const size = 1000;
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+
+    std::vector<float> src(size);
+    for ( auto &v : src ) { v = dist(mt); }
+    src[3] = 0.0f;
+    src[5] = 1.0e-6f;
+    src[7] = std::numeric_limits<float>::quiet_NaN();
+
+    // 一括変換はスカラー変換と一致すること
+    std::vector<bb::Float16>  h(size);
+    std::vector<bb::BFloat16> b(size);
+    std::vector<float>        h_f(size);
+    std::vector<float>        b_f(size);
+    bb::DataType_Convert(&src[0], &h[0], size);
+    bb::DataType_Convert(&src[0], &b[0], size);
+    bb::DataType_Convert(&h[0], &h_f[0], size);
+    bb::DataType_Convert(&b[0], &b_f[0], size);
+    for ( bb::index_t i = 0; i < size; ++i ) {
+        EXPECT_EQ(bb::Float16(src[i]).GetBits(),  h[i].GetBits());
+        EXPECT_EQ(bb::BFloat16(src[i]).GetBits(), b[i].GetBits());
+        if ( i == 7 ) {
+            EXPECT_TRUE(std::isnan(h_f[i]));
+            EXPECT_TRUE(std::isnan(b_f[i]));
+            continue;
+        }
+        EXPECT_EQ((float)h[i], h_f[i]);
+        EXPECT_EQ((float)b[i], b_f[i]);
+        EXPECT_NEAR(src[i], h_f[i], std::abs(src[i]) / 1024 + 1.0e-7f);
+        EXPECT_NEAR(src[i], b_f[i], std::abs(src[i]) / 128);
+    }
+}
+
+
+TEST(HalfPrecisionTest, testHalfPrecision_FrameBuffer)
+{
+    bb::index_t const frame_size = 300;
+    bb::index_t const node_size  = 5;
+
+    std::mt19937_64 mt(2);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    auto h_buf = x_buf.ConvertType(BB_TYPE_FP16);
+    auto b_buf = x_buf.ConvertType(BB_TYPE_BF16);
+    EXPECT_EQ(BB_TYPE_FP16, h_buf.GetType());
+    EXPECT_EQ(BB_TYPE_BF16, b_buf.GetType());
+    EXPECT_EQ(x_buf.GetFrameStride() / 2, h_buf.GetFrameStride());
+
+    auto h_f_buf = h_buf.ConvertType(BB_TYPE_FP32);
+    auto b_f_buf = b_buf.ConvertType(BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            float x = x_buf.GetFP32(frame, node);
+            EXPECT_EQ((float)bb::Float16(x),  h_buf.GetFP32(frame, node));
+            EXPECT_EQ((float)bb::BFloat16(x), b_buf.GetFP32(frame, node));
+            EXPECT_EQ((float)bb::Float16(x),  h_f_buf.GetFP32(frame, node));
+            EXPECT_EQ((float)bb::BFloat16(x), b_f_buf.GetFP32(frame, node));
+        }
+    }
+
+    // Set/Add
+    h_buf.SetFP32(1, 2, 0.25f);
+    {
+        auto h_ptr = h_buf.Lock<bb::Float16>();
+        h_ptr.Add(1, 2, bb::Float16(0.5f));
+    }
+    EXPECT_EQ(0.75f, h_buf.GetFP32(1, 2));
+    b_buf.SetFP32(3, 4, 2.0f);
+    EXPECT_EQ(2.0f, b_buf.GetFP32(3, 4));
+}
+
+
+// 入力と出力を FP16 で持ち演算は FP32 で行う SparseLutN が FP32 版と一致すること
+TEST(HalfPrecisionTest, testHalfPrecision_SparseLutN)
+{
+    int const N                = 6;
+    int const input_node_size  = 32;
+    int const output_node_size = 16;
+    int const frame_size       = 64;
+
+    auto lut0 = bb::SparseLutN<N, float,       float>::Create(output_node_size);
+    auto lut1 = bb::SparseLutN<N, bb::Float16, float>::Create(output_node_size);
+    lut0->SendCommand("binary false");
+    lut1->SendCommand("binary false");
+    lut0->SendCommand("lut_binarize false");
+    lut1->SendCommand("lut_binarize false");
+    lut0->SendCommand("host_only true");
+    lut1->SendCommand("host_only true");
+
+    bb::FrameBuffer x_buf0(frame_size, {input_node_size}, BB_TYPE_FP32);
+    lut0->SetInputShape(x_buf0.GetShape());
+    lut1->SetInputShape(x_buf0.GetShape());
+
+    for ( int node = 0; node < output_node_size; ++node ) {
+        for ( int i = 0; i < N; ++i ) {
+            lut1->SetNodeInput(node, i, lut0->GetNodeInput(node, i));
+        }
+    }
+    {
+        auto W_ptr0 = lut0->lock_W_const();
+        auto W_ptr1 = lut1->lock_W();
+        for ( int node = 0; node < output_node_size; ++node ) {
+            for ( int i = 0; i < (1 << N); ++i ) {
+                W_ptr1(node, i) = W_ptr0(node, i);
+            }
+        }
+    }
+
+    // 係数(マスター)は FP32 のまま
+    EXPECT_EQ(BB_TYPE_FP32, lut1->W().GetType());
+
+    // FP16 で表現可能な入力にそろえる
+    std::mt19937_64 mt(3);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf0.SetFP32(frame, node, (float)bb::Float16(dist(mt)));
+        }
+    }
+    auto x_buf1 = x_buf0.ConvertType(BB_TYPE_FP16);
+
+    auto y_buf0 = lut0->Forward(x_buf0);
+    auto y_buf1 = lut1->Forward(x_buf1);
+    EXPECT_EQ(BB_TYPE_FP16, y_buf1.GetType());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_node_size; ++node ) {
+            EXPECT_NEAR(y_buf0.GetFP32(frame, node), y_buf1.GetFP32(frame, node), 1.0e-3f);
+        }
+    }
+
+    bb::FrameBuffer dy_buf(frame_size, {output_node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_node_size; ++node ) {
+            dy_buf.SetFP32(frame, node, dist(mt) - 0.5f);
+        }
+    }
+    auto dx_buf0 = lut0->Backward(dy_buf);
+    auto dx_buf1 = lut1->Backward(dy_buf);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            EXPECT_NEAR(dx_buf0.GetFP32(frame, node), dx_buf1.GetFP32(frame, node), 1.0e-4f);
+        }
+    }
+}
+
+
+// FP16/BF16 入力の LUT6 SIMD 版が FP32 の generic 版と一致すること
+template <class Layer0, class Layer1>
+void HalfPrecision_Lut6SimdCmp(std::shared_ptr<Layer0> lut0, std::shared_ptr<Layer1> lut1, int bin_type, bool binary)
+{
+    int const N                = 6;
+    int const input_node_size  = 32;
+    int const output_node_size = 16;
+    int const frame_size       = 72;
+
+    lut0->SendCommand(binary ? "binary true" : "binary false");
+    lut1->SendCommand(binary ? "binary true" : "binary false");
+    lut0->SendCommand("host_only true");
+    lut1->SendCommand("host_only true");
+    lut0->SendCommand("host_simd false");
+    lut1->SendCommand("host_simd true");
+
+    bb::FrameBuffer x_buf0(frame_size, {input_node_size}, BB_TYPE_FP32);
+    lut0->SetInputShape(x_buf0.GetShape());
+    lut1->SetInputShape(x_buf0.GetShape());
+
+    for ( int node = 0; node < output_node_size; ++node ) {
+        for ( int i = 0; i < N; ++i ) {
+            lut1->SetNodeInput(node, i, lut0->GetNodeInput(node, i));
+        }
+    }
+    {
+        auto W_ptr0 = lut0->lock_W_const();
+        auto W_ptr1 = lut1->lock_W();
+        for ( int node = 0; node < output_node_size; ++node ) {
+            for ( int i = 0; i < (1 << N); ++i ) {
+                W_ptr1(node, i) = W_ptr0(node, i);
+            }
+        }
+    }
+
+    // 半精度で表現可能な入力にそろえる
+    std::mt19937_64 mt(5);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    auto x_buf1 = x_buf0.ConvertType(bin_type);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf1.SetFP32(frame, node, dist(mt));
+            x_buf0.SetFP32(frame, node, x_buf1.GetFP32(frame, node));
+        }
+    }
+
+    auto y_buf0 = lut0->Forward(x_buf0);
+    auto y_buf1 = lut1->Forward(x_buf1);
+    float y_eps = (y_buf1.GetType() == BB_TYPE_FP32) ? 1.0e-5f : 1.0e-2f;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_node_size; ++node ) {
+            EXPECT_NEAR(y_buf0.GetFP32(frame, node), y_buf1.GetFP32(frame, node), y_eps);
+        }
+    }
+
+    bb::FrameBuffer dy_buf(frame_size, {output_node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < output_node_size; ++node ) {
+            dy_buf.SetFP32(frame, node, dist(mt) - 0.5f);
+        }
+    }
+    auto dx_buf0 = lut0->Backward(dy_buf);
+    auto dx_buf1 = lut1->Backward(dy_buf);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            EXPECT_NEAR(dx_buf0.GetFP32(frame, node), dx_buf1.GetFP32(frame, node), 1.0e-4f);
+        }
+    }
+    {
+        auto dW_ptr0 = lut0->lock_dW_const();
+        auto dW_ptr1 = lut1->lock_dW_const();
+        for ( int node = 0; node < output_node_size; ++node ) {
+            for ( int i = 0; i < (1 << N); ++i ) {
+                EXPECT_NEAR(dW_ptr0(node, i), dW_ptr1(node, i), 1.0e-4f);
+            }
+        }
+    }
+}
+
+TEST(HalfPrecisionTest, testHalfPrecision_Lut6Simd)
+{
+    for ( bool binary : {false, true} ) {
+        HalfPrecision_Lut6SimdCmp(bb::StochasticLutN<6, float,        float>::Create(16),
+                                  bb::StochasticLutN<6, bb::Float16,  float>::Create(16), BB_TYPE_FP16, binary);
+        HalfPrecision_Lut6SimdCmp(bb::StochasticLutN<6, float,        float>::Create(16),
+                                  bb::StochasticLutN<6, bb::BFloat16, float>::Create(16), BB_TYPE_BF16, binary);
+        HalfPrecision_Lut6SimdCmp(bb::SparseLutN<6, float,        float>::Create(16, false),
+                                  bb::SparseLutN<6, bb::Float16,  float>::Create(16, false), BB_TYPE_FP16, binary);
+        HalfPrecision_Lut6SimdCmp(bb::SparseLutN<6, float,        float>::Create(16, false),
+                                  bb::SparseLutN<6, bb::BFloat16, float>::Create(16, false), BB_TYPE_BF16, binary);
+    }
+}
+
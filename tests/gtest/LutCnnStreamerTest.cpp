@@ -0,0 +1,133 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gtest/gtest.h"
+
+#include "bb/LutCnnStreamer.h"
+#include "bb/BinaryLutN.h"
+
+
+static bb::FrameBuffer LutCnnStreamerTest_MakeInput(bb::index_t frame_size, bb::indices_t shape, std::uint64_t seed)
+{
+    std::mt19937_64 mt(seed);
+    bb::FrameBuffer x_buf(frame_size, shape, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < x_buf.GetNodeSize(); ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+    return x_buf;
+}
+
+
+TEST(LutCnnStreamerTest, testLutCnnStreamer_Forward)
+{
+    bb::index_t const frame_size = 70;
+
+    auto cnv0_sub = bb::Sequential::Create();
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(24, 1));
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 2));
+
+    auto cnv1_sub = bb::Sequential::Create();
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(12, 3));
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 4));
+
+    auto cnv2_sub = bb::Sequential::Create();
+    cnv2_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(12, 5));
+    cnv2_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(2, 6));
+
+    auto net = bb::Sequential::Create();
+    net->Add(bb::LoweringConvolution<bb::Bit>::Create(cnv0_sub, 3, 3, 1, 1, "same"));
+    net->Add(bb::MaxPooling<bb::Bit>::Create(2, 2));
+    net->Add(bb::LoweringConvolution<bb::Bit>::Create(cnv1_sub, 3, 3, 2, 2, "valid"));
+    net->Add(bb::LoweringConvolution<bb::Bit>::CreateEx(cnv2_sub, 3, 3, 1, 1, "same", BB_BORDER_REPLICATE));
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(8, 7));
+    net->SetInputShape({13, 11, 3});
+
+    auto x_buf = LutCnnStreamerTest_MakeInput(frame_size, {13, 11, 3}, 1);
+    auto y_buf = net->Forward(x_buf, false);
+
+    auto streamer = bb::LutCnnStreamer::Create<bb::Bit, float>(net);
+    streamer->SetBlockWords(1);
+    auto s_buf = streamer->Forward(x_buf);
+
+    EXPECT_EQ(y_buf.GetShape(), s_buf.GetShape());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)s_buf.GetBit(frame, node));
+        }
+    }
+
+    // ブロック数がスレッド数以上 (ブロック単位の並列) でも同じ結果
+#ifdef _OPENMP
+    int org_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    auto s1_buf = streamer->Forward(x_buf);
+    omp_set_num_threads(org_threads);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)s1_buf.GetBit(frame, node));
+        }
+    }
+#endif
+
+    // ラインバッファはフィルタの高さ以下
+    EXPECT_EQ(4, streamer->GetStageSize());
+    for ( bb::index_t i = 0; i < streamer->GetStageSize(); ++i ) {
+        EXPECT_LE(streamer->GetLineSize(i), 3);
+    }
+    EXPECT_EQ(2, streamer->GetLineSize(1));
+}
+
+
+TEST(LutCnnStreamerTest, testLutCnnStreamer_Axi4s)
+{
+    bb::index_t const frame_size = 3;
+
+    auto cnv0_sub = bb::Sequential::Create();
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(18, 1));
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(3, 2));
+
+    auto cnv1_sub = bb::Sequential::Create();
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(24, 3));
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 4));
+
+    // FPGA 回路と同じ構成 (中心合わせ、境界 0)
+    auto cnv0 = bb::LoweringConvolution<bb::Bit>::CreateEx(cnv0_sub, 3, 3, 1, 1, "same", BB_BORDER_CONSTANT);
+    auto pol0 = bb::MaxPooling<bb::Bit>::Create(2, 2);
+    auto cnv1 = bb::LoweringConvolution<bb::Bit>::CreateEx(cnv1_sub, 5, 5, 1, 1, "same", BB_BORDER_CONSTANT);
+
+    auto net = bb::Sequential::Create();
+    net->Add(cnv0);
+    net->Add(pol0);
+    net->Add(cnv1);
+    net->SetInputShape({32, 20, 2});
+
+    std::vector< std::shared_ptr< bb::Filter2d<bb::Bit> > > layers;
+    layers.push_back(cnv0);
+    layers.push_back(pol0);
+    layers.push_back(cnv1);
+
+    auto x_buf = LutCnnStreamerTest_MakeInput(frame_size, {32, 20, 2}, 2);
+
+    auto sim = bb::LutCnnSimulator::Create<bb::Bit, float>(layers);
+    auto e_buf = sim->Simulate(x_buf);
+
+    auto streamer = bb::LutCnnStreamer::Create<bb::Bit, float>(layers);
+    auto s_buf = streamer->Forward(x_buf);
+
+    EXPECT_EQ(e_buf.GetShape(), s_buf.GetShape());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < e_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)e_buf.GetBit(frame, node), (bool)s_buf.GetBit(frame, node));
+        }
+    }
+
+    EXPECT_EQ(5, streamer->GetLineSize(2));
+}
+
@@ -0,0 +1,50 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/LutNetFused.h"
+#include "bb/BinaryLutN.h"
+
+
+TEST(LutNetFusedTest, testLutNetFused_Forward)
+{
+    bb::index_t const frame_size      = 1000;
+    bb::index_t const input_node_size = 120;
+
+    auto net = bb::Sequential::Create();
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(360, 1));
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(60, 2));
+    net->Add(bb::BinaryLutN<4, bb::Bit>::Create(30, 3));
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(5, 4));
+    net->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(1);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    auto y_buf = net->Forward(x_buf, false);
+
+    auto fused = bb::LutNetFused::Create<bb::Bit, float>(net);
+    EXPECT_EQ(y_buf.GetShape(), fused->GetOutputShape());
+
+    for ( bb::index_t tile_frames : {256, 300, 4096} ) {
+        fused->SetTileFrames(tile_frames);
+        EXPECT_EQ(0, fused->GetTileFrames() % 256);
+
+        auto f_buf = fused->Forward(x_buf);
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            for ( bb::index_t node = 0; node < 5; ++node ) {
+                EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)f_buf.GetBit(frame, node));
+            }
+        }
+    }
+
+    EXPECT_EQ(2 * 360 * 4096 / 8, fused->GetWorkingMemorySize());
+}
+
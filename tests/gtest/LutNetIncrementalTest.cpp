@@ -0,0 +1,85 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/LutNetIncremental.h"
+#include "bb/BinaryLutN.h"
+
+
+TEST(LutNetIncrementalTest, testLutNetIncremental_Cnn)
+{
+    bb::index_t const frame_size = 6;
+    bb::index_t const c_size     = 3;
+    bb::index_t const h_size     = 12;
+    bb::index_t const w_size     = 12;
+
+    auto cnv0_sub = bb::Sequential::Create();
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(24, 1));
+    cnv0_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 2));
+
+    auto cnv1_sub = bb::Sequential::Create();
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(12, 3));
+    cnv1_sub->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 4));
+
+    auto net = bb::Sequential::Create();
+    net->Add(bb::LoweringConvolution<bb::Bit>::Create(cnv0_sub, 3, 3, 1, 1, "same"));
+    net->Add(bb::MaxPooling<bb::Bit>::Create(2, 2));
+    net->Add(bb::LoweringConvolution<bb::Bit>::Create(cnv1_sub, 3, 3));
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(16, 5));
+    net->Add(bb::BinaryLutN<6, bb::Bit>::Create(4, 6));
+    net->SetInputShape({w_size, h_size, c_size});
+
+    // 少しずつ変化する連続フレーム (frame 2 は frame 1 と同じ)
+    std::mt19937_64 mt(1);
+    bb::index_t node_size = c_size * h_size * w_size;
+    bb::FrameBuffer x_buf(frame_size, {w_size, h_size, c_size}, BB_TYPE_BIT);
+    for ( bb::index_t node = 0; node < node_size; ++node ) {
+        x_buf.SetBit(0, node, (mt() & 1) != 0);
+    }
+    for ( bb::index_t frame = 1; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            bool v = (bool)x_buf.GetBit(frame - 1, node);
+            if ( frame != 2 && mt() % 64 == 0 ) { v = !v; }
+            x_buf.SetBit(frame, node, v);
+        }
+    }
+
+    auto y_buf = net->Forward(x_buf, false);
+
+    auto inc = bb::LutNetIncremental::Create<bb::Bit, float>(net);
+    EXPECT_EQ(y_buf.GetNodeSize(), bb::GetShapeSize(inc->GetOutputShape()));
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        bb::FrameBuffer f_buf(1, {w_size, h_size, c_size}, BB_TYPE_BIT);
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            f_buf.SetBit(0, node, x_buf.GetBit(frame, node));
+        }
+        auto i_buf = inc->Forward(f_buf);
+
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)i_buf.GetBit(0, node));
+        }
+
+        if ( frame == 0 ) {
+            EXPECT_EQ(inc->GetLutSize(), inc->GetEvaluatedSize());
+        }
+        else if ( frame == 2 ) {
+            EXPECT_EQ(0, inc->GetEvaluatedSize());
+        }
+        else {
+            EXPECT_LT(inc->GetEvaluatedSize(), inc->GetLutSize());
+        }
+    }
+
+    // まとめて流しても同じ結果
+    inc->Reset();
+    auto i_buf = inc->Forward(x_buf);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)i_buf.GetBit(frame, node));
+        }
+    }
+}
+
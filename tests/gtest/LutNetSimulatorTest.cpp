@@ -0,0 +1,141 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/LutNetSimulator.h"
+#include "bb/BinaryLutN.h"
+
+
+// frame_size 以降のビット(最終ワードの余りとストライドの残り)が 0 であること
+static void CheckPaddingZero(bb::FrameBuffer const &buf)
+{
+    bb::index_t frame_size = buf.GetFrameSize();
+    bb::index_t word_size  = buf.GetFrameStride() / (bb::index_t)sizeof(std::uint64_t);
+
+    auto ptr  = buf.LockMemoryConst();
+    auto addr = (std::uint8_t const *)ptr.GetAddr();
+    for ( bb::index_t node = 0; node < buf.GetNodeSize(); ++node ) {
+        auto row = (std::uint64_t const *)(addr + buf.GetFrameStride() * node);
+        for ( bb::index_t w = 0; w < word_size; ++w ) {
+            std::uint64_t pad = ~(std::uint64_t)0;
+            if ( w * 64 < frame_size ) {
+                pad = (frame_size - w * 64 >= 64) ? 0 : (~(std::uint64_t)0 << (frame_size - w * 64));
+            }
+            EXPECT_EQ(0u, row[w] & pad);
+        }
+    }
+}
+
+
+TEST(LutNetSimulatorTest, testLutNetSimulator_Layers)
+{
+    bb::index_t const frame_size      = 300;
+    bb::index_t const input_node_size = 64;
+
+    auto lut0 = bb::BinaryLutN<6>::Create(48, 1);
+    auto lut1 = bb::BinaryLutN<6>::Create(32, 2);
+    auto lut2 = bb::BinaryLutN<6>::Create(10, 3);
+
+    auto net = bb::Sequential::Create();
+    net->Add(lut0);
+    net->Add(lut1);
+    net->Add(lut2);
+    net->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(1);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    auto y_buf = net->Forward(x_buf, false);
+
+    auto sim = bb::LutNetSimulator::Create<bb::Bit, float>(net);
+    sim->SetLaneWords(2);
+    auto s_buf = sim->Simulate(x_buf);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 10; ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)s_buf.GetBit(frame, node));
+        }
+    }
+    CheckPaddingZero(s_buf);
+
+    auto result = sim->GetResult();
+    EXPECT_EQ(3, result.latency);
+    EXPECT_EQ(frame_size, result.vector_size);
+    EXPECT_EQ(frame_size + 2, result.stream_cycles);
+    EXPECT_EQ(5, result.sim_cycles);    // 3 ブロック + パイプライン 2 段
+}
+
+
+TEST(LutNetSimulatorTest, testLutNetSimulator_Empty)
+{
+    auto net = bb::Sequential::Create();
+    net->Add(bb::BinaryLutN<6>::Create(16, 1));
+    net->Add(bb::BinaryLutN<6>::Create(8, 2));
+    net->SetInputShape({32});
+
+    // フレームが無くても止まること
+    auto sim = bb::LutNetSimulator::Create<bb::Bit, float>(net);
+    auto y_buf = sim->Simulate(bb::FrameBuffer());
+    EXPECT_EQ(0, y_buf.GetFrameSize());
+
+    auto result = sim->GetResult();
+    EXPECT_EQ(0, result.vector_size);
+    EXPECT_EQ(0, result.sim_cycles);
+    EXPECT_EQ(2, result.latency);
+}
+
+
+TEST(LutNetSimulatorTest, testLutCnnSimulator)
+{
+    bb::index_t const frame_size = 70;
+    bb::index_t const w = 7;
+    bb::index_t const h = 5;
+    bb::index_t const c = 2;
+
+    auto mlp = bb::Sequential::Create();
+    mlp->Add(bb::BinaryLutN<6>::Create(12, 1));
+    mlp->Add(bb::BinaryLutN<6>::Create(3,  2));
+
+    auto cnv = bb::LoweringConvolution<bb::Bit>::CreateEx(mlp, 3, 3, 1, 1, "same", BB_BORDER_CONSTANT, (bb::Bit)0);
+    auto pol = bb::MaxPooling<bb::Bit>::Create(2, 2);
+
+    auto net = bb::Sequential::Create();
+    net->Add(cnv);
+    net->Add(pol);
+    net->SetInputShape({w, h, c});
+
+    std::mt19937_64 mt(2);
+    bb::FrameBuffer x_buf(frame_size, {w, h, c}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < w*h*c; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    auto y_buf = net->Forward(x_buf, false);
+
+    std::vector< std::shared_ptr< bb::Filter2d<bb::Bit, float> > > layers;
+    layers.push_back(cnv);
+    layers.push_back(pol);
+    auto sim = bb::LutCnnSimulator::Create<bb::Bit, float>(layers);
+    auto s_buf = sim->Simulate(x_buf);
+
+    EXPECT_EQ(y_buf.GetShape(), s_buf.GetShape());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)s_buf.GetBit(frame, node));
+        }
+    }
+    CheckPaddingZero(s_buf);
+
+    // (1行 + 1画素) + MLP 2段 + (1行 + 1画素)
+    EXPECT_EQ((w + 1) + 2 + (w + 1), sim->GetLatency());
+}
+
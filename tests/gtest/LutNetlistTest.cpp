@@ -0,0 +1,236 @@
+﻿#include <string>
+#include <sstream>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/LutNetlist.h"
+#include "bb/LutNetSimulator.h"
+#include "bb/ExportVerilog.h"
+#include "bb/BinaryLutN.h"
+
+
+static void LutNetlistTest_Compare(std::shared_ptr<bb::Sequential> net, std::shared_ptr<bb::LutNetlist> netlist, bb::index_t input_node_size, std::uint64_t seed)
+{
+    bb::index_t const frame_size = 200;
+
+    std::mt19937_64 mt(seed);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    auto y_buf = net->Forward(x_buf, false);
+    auto z_buf = netlist->Evaluate(x_buf);
+    EXPECT_EQ(y_buf.GetShape(), z_buf.GetShape());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < y_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)y_buf.GetBit(frame, node), (bool)z_buf.GetBit(frame, node));
+        }
+    }
+}
+
+
+TEST(LutNetlistTest, testLutNetlist_Random)
+{
+    bb::index_t const input_node_size = 64;
+
+    auto net = bb::Sequential::Create();
+    net->Add(bb::BinaryLutN<6>::Create(48, 1));
+    net->Add(bb::BinaryLutN<6>::Create(32, 2));
+    net->Add(bb::BinaryLutN<6>::Create(10, 3));
+    net->SetInputShape({input_node_size});
+
+    auto netlist = bb::LutNetlist::Create<bb::Bit, float>(net);
+    EXPECT_EQ(90, netlist->GetStatus().lut_count);
+    EXPECT_EQ(3,  netlist->GetStatus().depth);
+    EXPECT_EQ(48 + 32 + 10, netlist->GetRegisterCount(1));
+
+    // 乱数テーブルの 6入力 LUT は縮約できないので構成は変わらない
+    netlist->Optimize();
+    EXPECT_EQ(90, netlist->GetStatus().lut_count);
+    EXPECT_EQ(3,  netlist->GetStatus().depth);
+    EXPECT_EQ(48 + 32 + 10, netlist->GetRegisterCount(1));
+    LutNetlistTest_Compare(net, netlist, input_node_size, 1);
+}
+
+
+TEST(LutNetlistTest, testLutNetlist_Simplify)
+{
+    bb::index_t const input_node_size = 8;
+
+    auto lut0 = bb::BinaryLutN<2>::Create(8, 1);
+    auto lut1 = bb::BinaryLutN<2>::Create(4, 2);
+    auto lut2 = bb::BinaryLutN<2>::Create(2, 3);
+    auto net = bb::Sequential::Create();
+    net->Add(lut0);
+    net->Add(lut1);
+    net->Add(lut2);
+    net->SetInputShape({input_node_size});
+
+    // 2分木に結線
+    for ( bb::index_t node = 0; node < 8; ++node ) {
+        lut0->SetNodeInput(node, 0, node);
+        lut0->SetNodeInput(node, 1, (node + 1) % 8);
+    }
+    for ( bb::index_t node = 0; node < 4; ++node ) {
+        lut1->SetNodeInput(node, 0, node*2 + 0);
+        lut1->SetNodeInput(node, 1, node*2 + 1);
+    }
+    for ( bb::index_t node = 0; node < 2; ++node ) {
+        lut2->SetNodeInput(node, 0, node*2 + 0);
+        lut2->SetNodeInput(node, 1, node*2 + 1);
+    }
+
+    // テーブル (bit = in1*2 + in0)
+    auto set_table = [](std::shared_ptr< bb::BinaryLutN<2> > lut, bb::index_t node, int table) {
+        for ( int i = 0; i < 4; ++i ) {
+            lut->SetLutTable(node, i, ((table >> i) & 1) != 0);
+        }
+    };
+    set_table(lut0, 0, 0x0);    // 定数0
+    set_table(lut0, 1, 0x6);    // XOR
+    set_table(lut0, 2, 0xa);    // in0 のバッファ
+    set_table(lut0, 3, 0x5);    // in0 の反転
+    set_table(lut0, 4, 0x8);    // AND
+    set_table(lut0, 5, 0x8);    // AND
+    set_table(lut0, 6, 0xe);    // OR
+    set_table(lut0, 7, 0x6);    // XOR
+    set_table(lut1, 0, 0xe);    // 定数0 OR XOR → XOR のバッファ
+    set_table(lut1, 1, 0x6);
+    set_table(lut1, 2, 0x8);
+    set_table(lut1, 3, 0x6);
+    set_table(lut2, 0, 0x6);
+    set_table(lut2, 1, 0x9);
+
+    auto netlist = bb::LutNetlist::Create<bb::Bit, float>(net);
+    EXPECT_EQ(14, netlist->GetStatus().lut_count);
+
+    netlist->Optimize();
+
+    // 出力2本はそれぞれ入力 4～5 本の関数なので 6入力 LUT 1個ずつに収まる
+    EXPECT_EQ(2, netlist->GetStatus().lut_count);
+    EXPECT_EQ(1, netlist->GetStatus().depth);
+    EXPECT_EQ(1, netlist->GetLatency(1));
+    LutNetlistTest_Compare(net, netlist, input_node_size, 2);
+}
+
+
+TEST(LutNetlistTest, testLutNetlist_ExportVerilog)
+{
+    bb::index_t const input_node_size = 64;
+
+    std::vector< std::shared_ptr< bb::LutLayer<bb::Bit, float> > > layers;
+    layers.push_back(bb::BinaryLutN<6>::Create(256, 1));
+    layers.push_back(bb::BinaryLutN<6>::Create(128, 2));
+    layers.push_back(bb::BinaryLutN<6>::Create(64,  3));
+    layers.push_back(bb::BinaryLutN<6>::Create(32,  4));
+    auto net = bb::Sequential::Create();
+    for ( auto layer : layers ) {
+        net->Add(layer);
+    }
+    net->SetInputShape({input_node_size});
+
+    auto netlist = bb::LutNetlist::Create<bb::Bit, float>(layers);
+    netlist->Optimize();
+    EXPECT_EQ(4, netlist->GetStatus().depth);
+    EXPECT_EQ(4, netlist->GetLatency(1));
+    EXPECT_EQ(2, netlist->GetLatency(2));
+    EXPECT_EQ(1, netlist->GetLatency(4));
+
+    std::stringstream ss;
+    netlist->ExportVerilog(ss, "test_net", 2);
+    std::string verilog = ss.str();
+    EXPECT_NE(std::string::npos, verilog.find("module test_net"));
+    EXPECT_NE(std::string::npos, verilog.find("assign out_valid = stage2_valid;"));
+    EXPECT_EQ(std::string::npos, verilog.find("stage3_valid"));
+
+    // 出力した遅延 FF の数が GetRegisterCount() と一致すること
+    EXPECT_EQ(480, netlist->GetStatus().lut_count);
+    EXPECT_EQ(160, netlist->GetRegisterCount(2));
+    {
+        std::stringstream ss_line(verilog);
+        std::string line;
+        bb::index_t reg_count = 0;
+        while ( std::getline(ss_line, line) ) {
+            if ( line.compare(0, 6, "reg   ") == 0 && line.find("stage") == std::string::npos ) {
+                reg_count++;
+            }
+        }
+        EXPECT_EQ(netlist->GetRegisterCount(2), reg_count);
+    }
+
+    std::stringstream ss2;
+    bb::ExportVerilog_LutLayersOptimized<bb::Bit, float>(ss2, "test_net", layers, 2);
+    EXPECT_EQ(verilog, ss2.str());
+}
+
+
+TEST(LutNetlistTest, testLutNetlist_Pipeline)
+{
+    bb::index_t const input_node_size = 64;
+    bb::index_t const frame_size      = 1000;
+
+    std::vector< std::shared_ptr< bb::LutLayer<bb::Bit, float> > > layers;
+    layers.push_back(bb::BinaryLutN<6>::Create(128, 1));
+    layers.push_back(bb::BinaryLutN<4>::Create(64,  2));
+    layers.push_back(bb::BinaryLutN<6>::Create(32,  3));
+    layers.push_back(bb::BinaryLutN<2>::Create(16,  4));
+    layers.push_back(bb::BinaryLutN<6>::Create(8,   5));
+    auto net = bb::Sequential::Create();
+    for ( auto layer : layers ) {
+        net->Add(layer);
+    }
+    net->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(3);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    // 最適化前の層構成をクロック単位で流した結果を期待値とする
+    auto sim   = bb::LutNetSimulator::Create<bb::Bit, float>(layers);
+    auto e_buf = sim->Simulate(x_buf);
+
+    auto netlist = bb::LutNetlist::Create<bb::Bit, float>(layers);
+    EXPECT_EQ(248, netlist->GetStatus().lut_count);
+    netlist->Optimize();
+    EXPECT_EQ(238, netlist->GetStatus().lut_count);
+    EXPECT_EQ(5,   netlist->GetStatus().depth);
+
+    // パイプライン化しない組み合わせ回路としての評価とも一致すること
+    auto c_buf = netlist->Evaluate(x_buf);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < e_buf.GetNodeSize(); ++node ) {
+            EXPECT_EQ((bool)e_buf.GetBit(frame, node), (bool)c_buf.GetBit(frame, node));
+        }
+    }
+
+    // 段毎のレイテンシと遅延 FF 数 (1段にまとめると出力 FF の 8 個だけ)
+    EXPECT_EQ(5,   netlist->GetLatency(1));
+    EXPECT_EQ(3,   netlist->GetLatency(2));
+    EXPECT_EQ(2,   netlist->GetLatency(3));
+    EXPECT_EQ(1,   netlist->GetLatency(5));
+    EXPECT_EQ(241, netlist->GetRegisterCount(1));
+    EXPECT_EQ(86,  netlist->GetRegisterCount(2));
+    EXPECT_EQ(35,  netlist->GetRegisterCount(3));
+    EXPECT_EQ(8,   netlist->GetRegisterCount(5));
+
+    // 段の区切り方を変えてもレジスタのバランスが取れていれば一致する
+    for ( bb::index_t register_depth : {1, 2, 3, 5} ) {
+        auto y_buf = netlist->Simulate(x_buf, register_depth);
+        EXPECT_EQ(e_buf.GetShape(), y_buf.GetShape());
+        for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+            for ( bb::index_t node = 0; node < e_buf.GetNodeSize(); ++node ) {
+                EXPECT_EQ((bool)e_buf.GetBit(frame, node), (bool)y_buf.GetBit(frame, node));
+            }
+        }
+    }
+}
+
@@ -114,3 +114,36 @@ TEST(MemoryTest, testHostOnly)
 }
 
 
+TEST(MemoryTest, testRevision)
+{
+    auto mem = bb::Memory::Create(1024);
+    auto rev0 = mem->GetRevision();
+
+    // 読み出し専用のロックではリビジョンは変わらない
+    {
+        auto ptr = mem->LockConst();
+        EXPECT_EQ(rev0, mem->GetRevision());
+    }
+    EXPECT_EQ(rev0, mem->GetRevision());
+
+    // 書き込み用ロック中は毎回変わり、解放後は固定される
+    std::uint64_t rev1;
+    {
+        auto ptr = mem->Lock();
+        EXPECT_NE(rev0, mem->GetRevision());
+        EXPECT_NE(mem->GetRevision(), mem->GetRevision());
+    }
+    rev1 = mem->GetRevision();
+    EXPECT_NE(rev0, rev1);
+    EXPECT_EQ(rev1, mem->GetRevision());
+
+    // 書き込み用ロックから作った読み出し専用ポインタだけが残っても固定
+    bb::Memory::ConstPtr cptr;
+    {
+        auto ptr = mem->Lock();
+        cptr = ptr;
+    }
+    auto rev2 = mem->GetRevision();
+    EXPECT_NE(rev1, rev2);
+    EXPECT_EQ(rev2, mem->GetRevision());
+}
@@ -0,0 +1,39 @@
+﻿#include <stdio.h>
+#include <iostream>
+#include <random>
+#include "gtest/gtest.h"
+#include "bb/MetricsBinaryAccuracy.h"
+
+
+
+TEST(MetricsBinaryAccuracyTest, testMetricsBinaryAccuracy_Bit)
+{
+    bb::index_t const frame_size = 131;
+    bb::index_t const node_size  = 5;
+
+    bb::FrameBuffer y_bit (frame_size, {node_size}, BB_TYPE_BIT);
+    bb::FrameBuffer t_bit (frame_size, {node_size}, BB_TYPE_BIT);
+    bb::FrameBuffer y_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+    bb::FrameBuffer t_fp32(frame_size, {node_size}, BB_TYPE_FP32);
+
+    std::mt19937_64 mt(1);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            bool y = ((mt() & 1) != 0);
+            bool t = ((mt() & 1) != 0);
+            y_bit.SetBit(frame, node, y);
+            t_bit.SetBit(frame, node, t);
+            y_fp32.SetFP32(frame, node, y ? 0.8f : 0.2f);
+            t_fp32.SetFP32(frame, node, t ? 1.0f : 0.0f);
+        }
+    }
+
+    auto acc_bit  = bb::MetricsBinaryAccuracy<bb::Bit>::Create();
+    auto acc_fp32 = bb::MetricsBinaryAccuracy<float>::Create();
+    acc_bit->CalculateMetrics(y_bit, t_bit);
+    acc_fp32->CalculateMetrics(y_fp32, t_fp32);
+
+    EXPECT_DOUBLE_EQ(acc_fp32->GetMetrics(), acc_bit->GetMetrics());
+    EXPECT_GT(acc_bit->GetMetrics(), 0.0);
+}
+
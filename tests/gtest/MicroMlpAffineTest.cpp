@@ -786,6 +786,70 @@ TEST(MicroMlpAffineTest, testMicroMlpAffine_CmpBit)
 
 
 
+TEST(MicroMlpAffineTest, testMicroMlpAffine_Int8)
+{
+    int const N = 6;
+    int const M = 16;
+    int const input_node_size  = 120;
+    int const output_node_size = 30;
+    int const frame_size       = 100;
+
+    auto mlp = bb::MicroMlpAffine<N, M>::Create(output_node_size);
+    mlp->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < frame_size; ++frame ) {
+        for ( int node = 0; node < input_node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    // 較正
+    mlp->SendCommand("int8_calibrate true");
+    auto y_buf = mlp->Forward(x_buf, false);
+
+    // INT8 推論
+    mlp->SendCommand("int8 true");
+    auto z_buf = mlp->Forward(x_buf, false);
+
+    for ( int node = 0; node < output_node_size; ++node ) {
+        float y_min = y_buf.GetFP32(0, node);
+        float y_max = y_buf.GetFP32(0, node);
+        for ( int frame = 0; frame < frame_size; ++frame ) {
+            y_min = std::min(y_min, y_buf.GetFP32(frame, node));
+            y_max = std::max(y_max, y_buf.GetFP32(frame, node));
+        }
+        float th = std::max(0.03f * (y_max - y_min), 1.0e-3f);
+        for ( int frame = 0; frame < frame_size; ++frame ) {
+            EXPECT_NEAR(y_buf.GetFP32(frame, node), z_buf.GetFP32(frame, node), th);
+        }
+    }
+
+    // フレーム範囲のビュー入力でも詰めたコピーと同じ結果になること
+    bb::FrameBuffer p_buf(300, {input_node_size}, BB_TYPE_FP32);
+    for ( int frame = 0; frame < 300; ++frame ) {
+        for ( int node = 0; node < input_node_size; ++node ) {
+            p_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+    mlp->SendCommand("int8_calibrate false");
+    auto v_buf  = p_buf.GetFrameRangeView(64, 104);
+    auto zv_buf = mlp->Forward(v_buf, false);
+    auto zc_buf = mlp->Forward(v_buf.Clone(), false);
+    for ( int frame = 0; frame < 104; ++frame ) {
+        for ( int node = 0; node < output_node_size; ++node ) {
+            EXPECT_EQ(zc_buf.GetFP32(frame, node), zv_buf.GetFP32(frame, node));
+        }
+    }
+
+    // 学習時は FP32
+    auto t_buf = mlp->Forward(x_buf, true);
+    EXPECT_EQ(y_buf.GetFP32(5, 7), t_buf.GetFP32(5, 7));
+}
+
+
 #if 0
 
 TEST(NeuralNetStackedMicroAffineTest, testNeuralNetStackedMicroAffine)
@@ -0,0 +1,202 @@
+﻿#include <string>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gtest/gtest.h"
+
+#include "bb/PhiloxDistributionGenerator.h"
+#include "bb/NormalDistributionGenerator.h"
+#include "bb/Tensor.h"
+
+
+// Fill() が GetValue() を順に呼んだ列と一致すること (ブロック境界をまたぐ位置から)
+template <typename T, class Gen>
+static void PhiloxGenerator_CheckFill(std::shared_ptr<Gen> gen_a, std::shared_ptr<Gen> gen_b)
+{
+    std::vector<T> exp(1000);
+    for ( auto &v : exp ) {
+        v = gen_a->GetValue();
+    }
+
+    std::vector<T> val(1000);
+    gen_b->Fill(&val[0],   5);
+    gen_b->Fill(&val[5],   700);
+    val[705] = gen_b->GetValue();
+    gen_b->Fill(&val[706], 294);
+    for ( int i = 0; i < 1000; ++i ) {
+        EXPECT_EQ(exp[i], val[i]);
+    }
+
+    gen_b->Reset();
+    EXPECT_EQ(exp[0], gen_b->GetValue());
+
+    gen_b->SetIndex(333);
+    EXPECT_EQ(exp[333], gen_b->GetValue());
+}
+
+TEST(PhiloxDistributionGeneratorTest, testFill)
+{
+    PhiloxGenerator_CheckFill<float>(bb::PhiloxNormalDistributionGenerator<float>::Create(1.0f, 2.0f, 12),
+                                     bb::PhiloxNormalDistributionGenerator<float>::Create(1.0f, 2.0f, 12));
+    PhiloxGenerator_CheckFill<double>(bb::PhiloxNormalDistributionGenerator<double>::Create(1.0, 2.0, 12),
+                                      bb::PhiloxNormalDistributionGenerator<double>::Create(1.0, 2.0, 12));
+    PhiloxGenerator_CheckFill<float>(bb::PhiloxUniformDistributionGenerator<float>::Create(-1.0f, 3.0f, 34),
+                                     bb::PhiloxUniformDistributionGenerator<float>::Create(-1.0f, 3.0f, 34));
+    PhiloxGenerator_CheckFill<double>(bb::PhiloxUniformDistributionGenerator<double>::Create(-1.0, 3.0, 34),
+                                      bb::PhiloxUniformDistributionGenerator<double>::Create(-1.0, 3.0, 34));
+
+    // 基底の Fill() (mt19937 版) も GetValue() と同じ列
+    auto gen_a = bb::NormalDistributionGenerator<float>::Create(0.0f, 1.0f, 5);
+    auto gen_b = bb::NormalDistributionGenerator<float>::Create(0.0f, 1.0f, 5);
+    std::vector<float> val(100);
+    std::shared_ptr< bb::ValueGenerator<float> >(gen_b)->Fill(val.data(), 100);
+    for ( int i = 0; i < 100; ++i ) {
+        EXPECT_EQ(gen_a->GetValue(), val[i]);
+    }
+}
+
+
+TEST(PhiloxDistributionGeneratorTest, testNormalReference)
+{
+    // SIMD の log/sin/cos 近似を倍精度の Box-Muller と比較
+    std::uint64_t seed   = 0x123456789abcdefULL;
+    std::uint32_t key[2] = {(std::uint32_t)seed, (std::uint32_t)(seed >> 32)};
+    auto gen = bb::PhiloxNormalDistributionGenerator<float>::Create(0.0f, 1.0f, seed);
+
+    std::vector<float> val(32 * 100);
+    gen->Fill(val.data(), (bb::index_t)val.size());
+
+    for ( std::uint64_t block = 0; block < 100; ++block ) {
+        std::uint32_t raw[32];
+        bb::PhiloxGenerator_RawBlock(block, key, raw);
+        for ( int k = 0; k < 4; k += 2 ) {
+            for ( int l = 0; l < 8; ++l ) {
+                double u1 = ((double)(raw[k*8 + l] >> 8) + 1.0) / 16777216.0;
+                double u2 = ((double)(raw[(k+1)*8 + l] >> 8) + 0.5) / 16777216.0;
+                double r  = std::sqrt(-2.0 * std::log(u1));
+                double th = 2.0 * 3.14159265358979323846 * (u2 - 0.5);
+                EXPECT_NEAR(r * std::cos(th), val[block*32 + k*8 + l],     1.0e-5 * (1.0 + r));
+                EXPECT_NEAR(r * std::sin(th), val[block*32 + (k+1)*8 + l], 1.0e-5 * (1.0 + r));
+            }
+        }
+    }
+}
+
+
+TEST(PhiloxDistributionGeneratorTest, testUniformRange)
+{
+    // 乱数ワードの最大・最小でも [a, b) に収まること (丸めで b にならない)
+    std::uint32_t raw[32];
+    for ( int i = 0; i < 32; ++i ) {
+        raw[i] = (i % 2 == 0) ? 0xffffffffu : 0u;
+    }
+
+    float  ranges_f[][2] = {{0.0f, 1.0f}, {1.0f, 2.0f}, {-1.0f, 3.0f}, {100.0f, 100.5f}};
+    for ( auto const &r : ranges_f ) {
+        float out[32];
+        bb::PhiloxGenerator_UniformBlock<float>(raw, r[0], r[1], out);
+        for ( int i = 0; i < 32; ++i ) {
+            EXPECT_GE(out[i], r[0]);
+            EXPECT_LT(out[i], r[1]);
+        }
+        EXPECT_EQ(r[0], out[1]);
+    }
+
+    double ranges_d[][2] = {{0.0, 1.0}, {1.0e9, 1.0e9 + 1.0}, {-1.0, 3.0}};
+    for ( auto const &r : ranges_d ) {
+        double out[32];
+        bb::PhiloxGenerator_UniformBlock<double>(raw, r[0], r[1], out);
+        for ( int i = 0; i < 32; ++i ) {
+            EXPECT_GE(out[i], r[0]);
+            EXPECT_LT(out[i], r[1]);
+        }
+    }
+}
+
+
+TEST(PhiloxDistributionGeneratorTest, testMoment)
+{
+    bb::index_t size = 1 << 20;
+    std::vector<float> val(size);
+
+    auto norm = bb::PhiloxNormalDistributionGenerator<float>::Create(1.5f, 2.0f, 7);
+    norm->Fill(val.data(), size);
+    double sum = 0, sum2 = 0;
+    for ( auto v : val ) {
+        EXPECT_TRUE(std::isfinite(v));
+        sum  += v;
+        sum2 += (double)v * v;
+    }
+    double mean = sum / size;
+    double var  = sum2 / size - mean * mean;
+    EXPECT_NEAR(1.5, mean, 0.01);
+    EXPECT_NEAR(4.0, var,  0.03);
+
+    auto uni = bb::PhiloxUniformDistributionGenerator<float>::Create(-2.0f, 6.0f, 7);
+    uni->Fill(val.data(), size);
+    sum = 0;
+    for ( auto v : val ) {
+        EXPECT_GE(v, -2.0f);
+        EXPECT_LT(v, +6.0f);
+        sum += v;
+    }
+    EXPECT_NEAR(2.0, sum / size, 0.02);
+}
+
+
+TEST(PhiloxDistributionGeneratorTest, testThreadCount)
+{
+    bb::index_t size = 100003;
+
+    std::vector<float> val0(size);
+    std::vector<float> val1(size);
+
+#ifdef _OPENMP
+    int org_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    bb::PhiloxNormalDistributionGenerator<float>::Create(0.0f, 1.0f, 99)->Fill(val0.data(), size);
+#ifdef _OPENMP
+    omp_set_num_threads(std::max(org_threads, 4));
+#endif
+    bb::PhiloxNormalDistributionGenerator<float>::Create(0.0f, 1.0f, 99)->Fill(val1.data(), size);
+#ifdef _OPENMP
+    omp_set_num_threads(org_threads);
+#endif
+
+    for ( bb::index_t i = 0; i < size; ++i ) {
+        EXPECT_EQ(val0[i], val1[i]);
+    }
+}
+
+
+TEST(PhiloxDistributionGeneratorTest, testTensorInit)
+{
+    bb::Tensor_<float> t0(bb::indices_t({123, 45}));
+    bb::Tensor_<float> t1(bb::indices_t({123, 45}));
+    t0.InitNormalDistribution(0.0, 0.5, 3);
+    t1.InitNormalDistribution(0.0, 0.5, 3);
+
+    auto gen = bb::PhiloxNormalDistributionGenerator<float>::Create(0.0f, 0.5f, 3);
+    auto p0 = t0.LockConst();
+    auto p1 = t1.LockConst();
+    for ( bb::index_t i = 0; i < 123*45; ++i ) {
+        float exp = gen->GetValue();
+        EXPECT_EQ(exp, p0[i]);
+        EXPECT_EQ(exp, p1[i]);
+    }
+
+    bb::Tensor t2(bb::indices_t({10, 10}), BB_TYPE_FP64);
+    t2.InitUniformDistribution(-1.0, 1.0, 4);
+    auto p2 = t2.LockConst<double>();
+    for ( bb::index_t i = 0; i < 100; ++i ) {
+        EXPECT_GE(p2[i], -1.0);
+        EXPECT_LT(p2[i], +1.0);
+    }
+}
+
@@ -171,3 +171,36 @@ TEST(RealToBinaryTest, testRealToBinary_cmp_bit)
     RealToBinaryTest_cmp_bit(1024, 1024);
 }
 
+
+// 乱数閾値は出力フレーム毎に GetValue() を順に呼んだ並びになること
+TEST(RealToBinaryTest, testRealToBinary_Generator)
+{
+    int const node_size  = 37;
+    int const frame_size = 20;
+    int const mod_size   = 3;
+
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_FP32);
+    auto valgen = bb::UniformDistributionGenerator<float>::Create(0.0f, 1.0f, 2);
+    for ( int frame = 0; frame < frame_size; ++frame) {
+        for ( int node = 0; node < node_size; ++node ) {
+            x_buf.SetFP32(frame, node, valgen->GetValue());
+        }
+    }
+
+    for ( bool framewise : {false, true} ) {
+        auto real2bin = bb::RealToBinary<bb::Bit>::Create(mod_size, bb::UniformDistributionGenerator<float>::Create(0.0f, 1.0f, 3), framewise);
+        auto ref_gen  = bb::UniformDistributionGenerator<float>::Create(0.0f, 1.0f, 3);
+        auto y_buf = real2bin->Forward(x_buf);
+        ASSERT_EQ(frame_size * mod_size, y_buf.GetFrameSize());
+        for ( int frame = 0; frame < frame_size * mod_size; ++frame ) {
+            float th = framewise ? ref_gen->GetValue() : 0.0f;
+            for ( int node = 0; node < node_size; ++node ) {
+                if ( !framewise ) {
+                    th = ref_gen->GetValue();
+                }
+                bool exp = x_buf.GetFP32(frame / mod_size, node) > th;
+                EXPECT_EQ(exp, y_buf.GetBit(frame, node));
+            }
+        }
+    }
+}
@@ -1,5 +1,6 @@
 ﻿#include <stdio.h>
 #include <iostream>
+#include <random>
 #include "gtest/gtest.h"
 
 #include "bb/Reduce.h"
@@ -75,6 +76,38 @@ TEST(ReduceTest, testReduce_test0)
 }
 
 
+TEST(ReduceTest, testReduce_Bit)
+{
+    bb::index_t const frame_size = 150;
+    bb::index_t const mux_size   = 5;
+    bb::index_t const node_size  = 7;
+
+    auto reduce = bb::Reduce<>::Create(node_size);
+
+    bb::FrameBuffer x_bit (frame_size, {node_size * mux_size}, BB_TYPE_BIT);
+    bb::FrameBuffer x_fp32(frame_size, {node_size * mux_size}, BB_TYPE_FP32);
+
+    std::mt19937_64 mt(1);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame) {
+        for ( bb::index_t node = 0; node < node_size * mux_size; ++node ) {
+            bool v = ((mt() & 1) != 0);
+            x_bit.SetBit(frame, node, v);
+            x_fp32.SetFP32(frame, node, v ? 1.0f : 0.0f);
+        }
+    }
+
+    auto y_fp32 = reduce->Forward(x_fp32);
+    auto y_bit  = reduce->Forward(x_bit);
+
+    EXPECT_EQ(BB_TYPE_FP32, y_bit.GetType());
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            EXPECT_FLOAT_EQ(y_fp32.GetFP32(frame, node), y_bit.GetFP32(frame, node));
+        }
+    }
+}
+
+
 #if 0 // #ifdef BB_WITH_CUDA
 
 template<typename T = float>
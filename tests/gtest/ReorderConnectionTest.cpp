@@ -0,0 +1,113 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/ReorderConnection.h"
+#include "bb/BinaryLutN.h"
+#include "bb/SparseLutN.h"
+#include "bb/StochasticLutN.h"
+
+
+TEST(ReorderConnectionTest, testReorderConnection_BinaryLut)
+{
+    bb::index_t const frame_size = 77;
+    bb::index_t const input_node_size = 256;
+
+    auto lut0 = bb::BinaryLutN<6>::Create(128, 1);
+    auto lut1 = bb::BinaryLutN<6>::Create(64,  2);
+    auto lut2 = bb::BinaryLutN<6>::Create(16,  3);
+
+    auto net = bb::Sequential::Create();
+    net->Add(lut0);
+    net->Add(lut1);
+    net->Add(lut2);
+    net->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(1);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+
+    auto y0_buf = net->Forward(x_buf, false);
+    std::vector<bool> y0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 16; ++node ) {
+            y0.push_back(y0_buf.GetBit(frame, node));
+        }
+    }
+
+    bb::ReorderConnection_Sequential(net);
+
+    // 2段目の入力は参照順に並んでいるはず
+    EXPECT_EQ(0, lut1->GetNodeInput(0, 0));
+    EXPECT_EQ(1, lut1->GetNodeInput(0, 1));
+
+    auto y1_buf = net->Forward(x_buf, false);
+    int i = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 16; ++node ) {
+            EXPECT_EQ(y0[i++], (bool)y1_buf.GetBit(frame, node));
+        }
+    }
+}
+
+
+template <class ModelType>
+void ReorderConnectionTest_Real(void)
+{
+    bb::index_t const frame_size = 32;
+    bb::index_t const input_node_size = 128;
+
+    auto net = bb::Sequential::Create();
+    bb::index_t const output_node_size[3] = {96, 36, 6};
+    for ( int i = 0; i < 3; ++i ) {
+        typename ModelType::create_t create;
+        create.output_shape = bb::indices_t({output_node_size[i]});
+        create.seed         = i + 1;
+        net->Add(ModelType::Create(create));
+    }
+    net->SetInputShape({input_node_size});
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    bb::FrameBuffer x_buf(frame_size, {input_node_size}, BB_TYPE_FP32);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < input_node_size; ++node ) {
+            x_buf.SetFP32(frame, node, dist(mt));
+        }
+    }
+
+    auto y0_buf = net->Forward(x_buf, false);
+    std::vector<float> y0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 6; ++node ) {
+            y0.push_back(y0_buf.GetFP32(frame, node));
+        }
+    }
+
+    bb::ReorderConnection_Sequential(net);
+
+    auto y1_buf = net->Forward(x_buf, false);
+    int i = 0;
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 6; ++node ) {
+            EXPECT_NEAR(y0[i++], y1_buf.GetFP32(frame, node), 1.0e-5);
+        }
+    }
+}
+
+TEST(ReorderConnectionTest, testReorderConnection_SparseLut)
+{
+    ReorderConnectionTest_Real< bb::SparseLutN<6, float, float> >();
+}
+
+TEST(ReorderConnectionTest, testReorderConnection_StochasticLut)
+{
+    ReorderConnectionTest_Real< bb::StochasticLutN<6, float, float> >();
+}
+
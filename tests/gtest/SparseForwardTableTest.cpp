@@ -0,0 +1,134 @@
+﻿#include <string>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bb/SparseLutN.h"
+#include "bb/StochasticLutN.h"
+#include "bb/MicroMlpAffine.h"
+
+
+static bb::FrameBuffer SparseForwardTableTest_MakeInput(bb::index_t frame_size, bb::index_t node_size, std::uint64_t seed)
+{
+    std::mt19937_64 mt(seed);
+    bb::FrameBuffer x_buf(frame_size, {node_size}, BB_TYPE_BIT);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < node_size; ++node ) {
+            x_buf.SetBit(frame, node, (mt() & 1) != 0);
+        }
+    }
+    return x_buf;
+}
+
+
+TEST(SparseForwardTableTest, testSparseForwardTable_SparseLutN)
+{
+    bb::index_t const frame_size = 130;
+    bb::index_t const node_size  = 32;
+
+    auto lut = bb::SparseLutN<6, bb::Bit>::Create(24);
+    auto x_buf = SparseForwardTableTest_MakeInput(frame_size, node_size, 1);
+
+    // 学習で統計とパラメータを動かしておく
+    lut->SetInputShape(x_buf.GetShape());
+    for ( int i = 0; i < 2; ++i ) {
+        auto y_buf = lut->Forward(x_buf, true);
+        bb::FrameBuffer dy_buf(frame_size, y_buf.GetShape(), BB_TYPE_FP32);
+        dy_buf.FillZero();
+        lut->Backward(dy_buf);
+    }
+
+    auto y_buf = lut->Forward(x_buf, false);
+    lut->SendCommand("host_table false");
+    auto z_buf = lut->Forward(x_buf, false);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 24; ++node ) {
+            EXPECT_EQ((bool)z_buf.GetBit(frame, node), (bool)y_buf.GetBit(frame, node));
+        }
+    }
+
+    // パラメータを書き換えたらテーブルは作り直される
+    {
+        auto W_ptr = lut->lock_W();
+        for ( bb::index_t node = 0; node < 24; ++node ) {
+            for ( int i = 0; i < 64; ++i ) {
+                W_ptr(node, i) = 1.0f - W_ptr(node, i);
+            }
+        }
+    }
+    z_buf = lut->Forward(x_buf, false);
+    lut->SendCommand("host_table true");
+    y_buf = lut->Forward(x_buf, false);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 24; ++node ) {
+            EXPECT_EQ((bool)z_buf.GetBit(frame, node), (bool)y_buf.GetBit(frame, node));
+        }
+    }
+}
+
+
+TEST(SparseForwardTableTest, testSparseForwardTable_StochasticLutN)
+{
+    bb::index_t const frame_size = 70;
+    bb::index_t const node_size  = 16;
+
+    auto lut = bb::StochasticLutN<4, bb::Bit>::Create(8);
+    auto x_buf = SparseForwardTableTest_MakeInput(frame_size, node_size, 2);
+
+    auto y_buf = lut->Forward(x_buf, false);
+    lut->SendCommand("host_table false");
+    auto z_buf = lut->Forward(x_buf, false);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 8; ++node ) {
+            EXPECT_NEAR(z_buf.GetFP32(frame, node), y_buf.GetFP32(frame, node), 1.0e-5);
+        }
+    }
+}
+
+
+TEST(SparseForwardTableTest, testSparseForwardTable_MicroMlpAffine)
+{
+    bb::index_t const frame_size = 70;
+    bb::index_t const node_size  = 16;
+
+    auto mlp = bb::MicroMlpAffine<6, 16, bb::Bit, float>::Create(8);
+    auto x_buf = SparseForwardTableTest_MakeInput(frame_size, node_size, 3);
+
+    auto y_buf = mlp->Forward(x_buf, false);
+    mlp->SendCommand("host_table false");
+    auto z_buf = mlp->Forward(x_buf, false);
+
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 8; ++node ) {
+            EXPECT_NEAR(z_buf.GetFP32(frame, node), y_buf.GetFP32(frame, node), 1.0e-5);
+        }
+    }
+}
+
+
+
+TEST(SparseForwardTableTest, testSparseForwardTable_Copy)
+{
+    // テーブル付きのレイヤーもコピーできること
+    static_assert(std::is_copy_constructible< bb::SparseForwardTable<6, float> >::value, "SparseForwardTable must be copyable");
+    static_assert(std::is_copy_assignable< bb::SparseForwardTable<6, float> >::value,    "SparseForwardTable must be copyable");
+    static_assert(std::is_copy_constructible< bb::SparseLutN<6, bb::Bit, float> >::value, "SparseLutN must be copyable");
+
+    bb::index_t const frame_size = 70;
+    bb::index_t const node_size  = 16;
+
+    auto lut = bb::SparseLutN<6, bb::Bit, float>::Create(8);
+    auto x_buf = SparseForwardTableTest_MakeInput(frame_size, node_size, 4);
+    auto y_buf = lut->Forward(x_buf, false);
+
+    bb::SparseLutN<6, bb::Bit, float> copy(*lut);
+    auto z_buf = copy.Forward(x_buf, false);
+    for ( bb::index_t frame = 0; frame < frame_size; ++frame ) {
+        for ( bb::index_t node = 0; node < 8; ++node ) {
+            EXPECT_EQ(y_buf.GetBit(frame, node), z_buf.GetBit(frame, node));
+        }
+    }
+}
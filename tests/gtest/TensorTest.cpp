@@ -842,8 +842,12 @@ void test_Operator(bb::indices_t shape)
 
     {
         // [Z
+        auto b_s0 = base_src0.Lock();
         auto b_s1 = base_src1.Lock();
         for (bb::index_t i = 0; i < node_size; ++i) {
+            if ( b_s0[i] == 0 ) {
+                b_s0[i]++;
+            }
             if ( b_s1[i] == 0 ) {
                 b_s1[i]++;
             }
@@ -1231,8 +1235,12 @@ void test_OperatorX(bb::indices_t shape)
     
     {
         // [Z
+        auto b_s0 = base_src0.Lock<T>();
         auto b_s1 = base_src1.Lock<T>();
         for (bb::index_t i = 0; i < node_size; ++i) {
+            if ( b_s0[i] == 0 ) {
+                b_s0[i]++;
+            }
             if ( b_s1[i] == 0 ) {
                 b_s1[i]++;
             }
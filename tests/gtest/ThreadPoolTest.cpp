@@ -0,0 +1,233 @@
+﻿#include <string>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <chrono>
+#include <set>
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+#include "bb/Manager.h"
+#include "bb/ThreadPool.h"
+#include "bb/FrameBuffer.h"
+
+
+TEST(ThreadPoolTest, testThreadPool_ParallelFor)
+{
+    auto &pool = bb::ThreadPool::GetInstance();
+
+    std::vector<int> hit(10007, 0);
+    pool.ParallelFor(0, (bb::index_t)hit.size(), 13, [&](bb::index_t start, bb::index_t end) {
+            for ( bb::index_t i = start; i < end; ++i ) {
+                hit[i]++;
+            }
+        });
+    for ( auto h : hit ) {
+        EXPECT_EQ(1, h);
+    }
+
+    // 入れ子
+    std::atomic<int> count(0);
+    pool.ParallelFor(0, 16, 1, [&](bb::index_t start, bb::index_t end) {
+            for ( bb::index_t i = start; i < end; ++i ) {
+                pool.ParallelFor(0, 100, 7, [&](bb::index_t s, bb::index_t e) { count += (int)(e - s); });
+            }
+        });
+    EXPECT_EQ(1600, count.load());
+}
+
+
+TEST(ThreadPoolTest, testThreadPool_NodeFrame)
+{
+    auto &pool = bb::ThreadPool::GetInstance();
+
+    bb::index_t const node_size  = 3;
+    bb::index_t const frame_size = 1000;
+
+    std::vector<int> hit(node_size * frame_size, 0);
+    std::atomic<int> misaligned(0);
+    pool.ParallelForNodeFrame(node_size, frame_size,
+        [&](bb::index_t node_start, bb::index_t node_end, bb::index_t frame_start, bb::index_t frame_end) {
+            if ( frame_start % 256 != 0 ) { misaligned++; }
+            for ( bb::index_t node = node_start; node < node_end; ++node ) {
+                for ( bb::index_t frame = frame_start; frame < frame_end; ++frame ) {
+                    hit[node * frame_size + frame]++;
+                }
+            }
+        });
+    EXPECT_EQ(0, misaligned.load());
+    for ( auto h : hit ) {
+        EXPECT_EQ(1, h);
+    }
+}
+
+
+TEST(ThreadPoolTest, testThreadPool_ThreadCount)
+{
+    int org = bb::Manager::GetThreadCount();
+
+    bb::Manager::SetThreadCount(1);
+    EXPECT_EQ(1, bb::Manager::GetThreadCount());
+    int sum = 0;
+    bb::ThreadPool::GetInstance().ParallelFor(0, 100, 1, [&](bb::index_t start, bb::index_t end) { sum += (int)(end - start); });
+    EXPECT_EQ(100, sum);
+
+    bb::Manager::SetThreadCount(3);
+    EXPECT_EQ(3, bb::Manager::GetThreadCount());
+    std::atomic<int> count(0);
+    bb::ThreadPool::GetInstance().ParallelFor(0, 100, 1, [&](bb::index_t start, bb::index_t end) { count += (int)(end - start); });
+    EXPECT_EQ(100, count.load());
+
+    bb::Manager::SetThreadCount(org);
+}
+
+
+TEST(ThreadPoolTest, testThreadPool_Exception)
+{
+    auto &pool = bb::ThreadPool::GetInstance();
+
+    // タスク内の例外は全タスクの完了後に呼び出し元へ投げ直される
+    for ( bb::index_t fail : {(bb::index_t)0, (bb::index_t)500, (bb::index_t)999} ) {
+        std::atomic<bb::index_t> count(0);
+        EXPECT_THROW(pool.ParallelFor(0, 1000, 10, [&](bb::index_t start, bb::index_t end) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                count += end - start;
+                if ( fail >= start && fail < end ) {
+                    throw std::runtime_error("fail");
+                }
+            }), std::runtime_error);
+        EXPECT_EQ(1000, count.load());
+
+        EXPECT_THROW(pool.ParallelForStatic(0, 1000, [&](bb::index_t start, bb::index_t end) {
+                if ( fail >= start && fail < end ) {
+                    throw std::runtime_error("fail");
+                }
+            }), std::runtime_error);
+    }
+
+    // その後も使えること
+    std::atomic<bb::index_t> sum(0);
+    pool.ParallelFor(0, 100, 1, [&](bb::index_t start, bb::index_t end) { sum += end - start; });
+    EXPECT_EQ(100, sum.load());
+}
+
+
+TEST(ThreadPoolTest, testThreadPool_Static)
+{
+    auto &pool = bb::ThreadPool::GetInstance();
+
+    bb::index_t const size = 1000;
+
+    // 同じ区間は毎回同じスレッドが処理する
+    std::vector<std::thread::id> owner0(size), owner1(size);
+    pool.ParallelForStatic(0, size, [&](bb::index_t start, bb::index_t end) {
+            for ( bb::index_t i = start; i < end; ++i ) { owner0[i] = std::this_thread::get_id(); }
+        });
+    pool.ParallelFor(0, 10000, 1, [&](bb::index_t, bb::index_t) {});
+    pool.ParallelForStatic(0, size, [&](bb::index_t start, bb::index_t end) {
+            for ( bb::index_t i = start; i < end; ++i ) { owner1[i] = std::this_thread::get_id(); }
+        });
+    EXPECT_EQ(owner0, owner1);
+}
+
+
+#ifdef __linux__
+TEST(ThreadPoolTest, testThreadPool_Affinity)
+{
+    auto &pool = bb::ThreadPool::GetInstance();
+
+    cpu_set_t org_set;
+    CPU_ZERO(&org_set);
+    ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(org_set), &org_set));
+
+    // 固定中も許可された CPU の中で動く
+    pool.SetAffinity(true);
+    cpu_set_t pin_set;
+    pthread_getaffinity_np(pthread_self(), sizeof(pin_set), &pin_set);
+    EXPECT_EQ(1, CPU_COUNT(&pin_set));
+    for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+        if ( CPU_ISSET(cpu, &pin_set) ) {
+            EXPECT_TRUE(CPU_ISSET(cpu, &org_set));
+        }
+    }
+
+    std::atomic<int> outside(0);
+    pool.ParallelForStatic(0, 1000, [&](bb::index_t, bb::index_t) {
+            cpu_set_t set;
+            pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            CPU_AND(&set, &set, &org_set);
+            if ( CPU_COUNT(&set) == 0 ) {
+                outside++;
+            }
+        });
+    EXPECT_EQ(0, outside.load());
+
+    // 解除で元に戻る
+    pool.SetAffinity(false);
+    cpu_set_t cur_set;
+    pthread_getaffinity_np(pthread_self(), sizeof(cur_set), &cur_set);
+    EXPECT_TRUE(CPU_EQUAL(&org_set, &cur_set));
+}
+#endif
+
+
+#ifdef __linux__
+static int ThreadPoolTest_ReadTopology(int cpu, char const *name)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    FILE *fp = fopen(path, "r");
+    int value = -1;
+    if ( fp != nullptr ) {
+        if ( fscanf(fp, "%d", &value) != 1 ) {
+            value = -1;
+        }
+        fclose(fp);
+    }
+    return value;
+}
+
+TEST(ThreadPoolTest, testThreadPool_Topology)
+{
+    cpu_set_t org_set;
+    CPU_ZERO(&org_set);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(org_set), &org_set));
+
+    // 許可された CPU をすべて1回ずつ、ソケット・コア番号順に並べる
+    auto cpus = bb::ThreadPool::GetInstance().GetAffinityCpus();
+    EXPECT_EQ(CPU_COUNT(&org_set), (int)cpus.size());
+    std::set<int> seen(cpus.begin(), cpus.end());
+    EXPECT_EQ(cpus.size(), seen.size());
+    for ( size_t i = 0; i < cpus.size(); ++i ) {
+        EXPECT_TRUE(CPU_ISSET(cpus[i], &org_set));
+        if ( i > 0 ) {
+            int pkg0 = ThreadPoolTest_ReadTopology(cpus[i-1], "physical_package_id");
+            int pkg1 = ThreadPoolTest_ReadTopology(cpus[i],   "physical_package_id");
+            EXPECT_LE(pkg0, pkg1);
+            if ( pkg0 == pkg1 ) {
+                EXPECT_LE(ThreadPoolTest_ReadTopology(cpus[i-1], "core_id"), ThreadPoolTest_ReadTopology(cpus[i], "core_id"));
+            }
+        }
+    }
+}
+#endif
+
+
+TEST(ThreadPoolTest, testThreadPool_FirstTouch)
+{
+    bb::Manager::SetNumaFirstTouch(true);
+    bb::Manager::SetHugePageThreshold(1024 * 1024);
+
+    bb::FrameBuffer buf(4096, {300}, BB_TYPE_FP32);
+    EXPECT_EQ(0.0f, buf.GetFP32(4095, 299));
+    buf.SetFP32(100, 200, 1.5f);
+    EXPECT_EQ(1.5f, buf.GetFP32(100, 200));
+
+    bb::Manager::SetNumaFirstTouch(false);
+    bb::Manager::SetHugePageThreshold(0);
+}
+